@@ -0,0 +1,925 @@
+/** @file osc_bench.c */
+
+#ifndef _DEFAULT_SOURCE
+    #define _DEFAULT_SOURCE
+#endif // _DEFAULT_SOURCE
+
+#include <stdio.h>
+#include <stdarg.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <sched.h>
+#include <pthread.h>
+#include <sys/uio.h>
+#include "osc.h"
+#include "osc_binding.h"
+#include "osc_instrument.h"
+#include "osc_pipeline.h"
+
+#define MAX_CASES 256
+#define DEFAULT_MIN_TIME_MS 200
+#define PIPELINE_SENDER_SOCKETS 8
+#define PIPELINE_BATCH 32
+#define PIPELINE_WINDOW 512
+#define PIPELINE_STALL_NS 20000000
+
+/**
+ * Structure representing a benchmark case
+ * setup builds the state the measured loop works on (not measured), run performs iterations operations on it
+ * and teardown frees the state; param is the size parameter of the case (argument count, element count or blob size)
+ * and type the argument type for the encoding cases
+ */
+struct bench_case {
+    char name[64];
+    void* (*setup)(const struct bench_case* bench);
+    void (*run)(const struct bench_case* bench, void* state, size_t iterations);
+    void (*teardown)(void* state);
+    size_t param;
+    char type;
+};
+
+static struct bench_case cases[MAX_CASES];
+static size_t case_count = 0;
+static volatile size_t sink = 0;
+static size_t allocation_count = 0;
+
+/**
+ * The osc_allocator functions of the counting allocator (the C library heap, counting every allocate and reallocate call)
+ */
+static void* counting_allocate(void* context, size_t size)
+{
+    (void)context;
+    allocation_count++;
+
+return malloc(size);
+}
+
+static void* counting_reallocate(void* context, void* ptr, size_t size)
+{
+    (void)context;
+    allocation_count++;
+
+return realloc(ptr, size);
+}
+
+static void counting_deallocate(void* context, void* ptr)
+{
+    (void)context;
+    free(ptr);
+}
+
+static const struct osc_allocator counting_allocator = {
+    counting_allocate,
+    counting_reallocate,
+    counting_deallocate,
+    NULL
+};
+
+/**
+ * Reads CLOCK_MONOTONIC in nanoseconds
+ *
+ * @return          the current time in nanoseconds
+ */
+static uint64_t now_ns(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+
+return (uint64_t)ts.tv_sec * 1000000000ULL + (uint64_t)ts.tv_nsec;
+}
+
+/**
+ * Registers a benchmark case
+ *
+ * @param   setup       the setup function (NULL if the case needs no state)
+ * @param   run         the measured function
+ * @param   teardown    the teardown function (NULL if the case needs no state)
+ * @param   param       the size parameter of the case
+ * @param   type        the argument type of the case ('\0' if irrelevant)
+ * @param   format      printf format of the case name followed by its arguments
+ */
+static void add_case(void* (*setup)(const struct bench_case*), void (*run)(const struct bench_case*, void*, size_t),
+                     void (*teardown)(void*), size_t param, char type, const char* format, ...)
+{
+    if(case_count == MAX_CASES) {
+        return;
+    }
+    struct bench_case* bench = &cases[case_count++];
+    va_list args;
+    va_start(args, format);
+    vsnprintf(bench->name, sizeof(bench->name), format, args);
+    va_end(args);
+    bench->setup = setup;
+    bench->run = run;
+    bench->teardown = teardown;
+    bench->param = param;
+    bench->type = type;
+}
+
+/**
+ * Adds one argument of the given type to a message
+ *
+ * @param   msg     pointer to the osc_message structure
+ * @param   type    the argument type
+ * @param   blob    the blob to add for 'b' arguments
+ * @param   i       the argument index (used as value)
+ */
+static void add_typed(struct osc_message* msg, char type, osc_blob blob, size_t i)
+{
+    struct osc_timetag tag = {(uint32_t)i, 1};
+    switch(type) {
+        case OSC_TT_INT:     osc_message_add_int32(msg, (int32_t)i); break;
+        case OSC_TT_FLOAT:   osc_message_add_float(msg, (float)i); break;
+        case OSC_TT_STRING:  osc_message_add_string(msg, "argument"); break;
+        case OSC_TT_TIMETAG: osc_message_add_timetag(msg, tag); break;
+        case OSC_TT_BLOB:    osc_message_add_blob(msg, blob); break;
+    }
+}
+
+/**
+ * Same as add_typed for an osc_message_builder
+ */
+static void builder_add_typed(struct osc_message_builder* builder, char type, osc_blob blob, size_t i)
+{
+    struct osc_timetag tag = {(uint32_t)i, 1};
+    switch(type) {
+        case OSC_TT_INT:     osc_message_builder_add_int32(builder, (int32_t)i); break;
+        case OSC_TT_FLOAT:   osc_message_builder_add_float(builder, (float)i); break;
+        case OSC_TT_STRING:  osc_message_builder_add_string(builder, "argument"); break;
+        case OSC_TT_TIMETAG: osc_message_builder_add_timetag(builder, tag); break;
+        case OSC_TT_BLOB:    osc_message_builder_add_blob(builder, blob); break;
+    }
+}
+
+/**
+ * Structure representing the state of the encoding cases
+ */
+struct encode_state {
+    osc_blob blob;
+    struct osc_message_builder builder;
+};
+
+static void* encode_setup(const struct bench_case* bench)
+{
+    (void)bench;
+    struct encode_state* state = (struct encode_state*)malloc(sizeof(struct encode_state));
+    state->blob = osc_blob_new(16);
+    osc_message_builder_new(&state->builder);
+
+return state;
+}
+
+static void encode_teardown(void* arg)
+{
+    struct encode_state* state = (struct encode_state*)arg;
+    osc_blob_destroy(state->blob);
+    osc_message_builder_destroy(&state->builder);
+    free(state);
+}
+
+/**
+ * Builds a message of param arguments of one type with osc_message_add_*
+ */
+static void run_encode_add(const struct bench_case* bench, void* arg, size_t iterations)
+{
+    struct encode_state* state = (struct encode_state*)arg;
+    for(size_t n = 0; n < iterations; n++) {
+        struct osc_message msg;
+        osc_message_new(&msg);
+        osc_message_set_address(&msg, "/bench/encode");
+        for(size_t i = 0; i < bench->param; i++) {
+            add_typed(&msg, bench->type, state->blob, i);
+        }
+        sink += osc_message_serialized_length(&msg);
+        osc_message_destroy(&msg);
+    }
+}
+
+/**
+ * Builds a message of param arguments of one type with a reused osc_message_builder
+ */
+static void run_encode_builder(const struct bench_case* bench, void* arg, size_t iterations)
+{
+    struct encode_state* state = (struct encode_state*)arg;
+    for(size_t n = 0; n < iterations; n++) {
+        struct osc_message msg;
+        osc_message_builder_begin(&state->builder, "/bench/encode");
+        for(size_t i = 0; i < bench->param; i++) {
+            builder_add_typed(&state->builder, bench->type, state->blob, i);
+        }
+        osc_message_builder_finish(&state->builder, &msg);
+        sink += osc_message_serialized_length(&msg);
+        osc_message_destroy(&msg);
+    }
+}
+
+/**
+ * Structure representing the state of the argument access cases
+ * order holds param argument indexes in random order
+ */
+struct access_state {
+    struct osc_message msg;
+    struct osc_message_index index;
+    size_t* order;
+};
+
+static void* access_setup(const struct bench_case* bench)
+{
+    struct access_state* state = (struct access_state*)malloc(sizeof(struct access_state));
+    osc_message_new(&state->msg);
+    osc_message_set_address(&state->msg, "/bench/access");
+    for(size_t i = 0; i < bench->param; i++) {
+        add_typed(&state->msg, i % 2 == 0 ? OSC_TT_INT : OSC_TT_STRING, NULL, i);
+    }
+    osc_message_index_new(&state->index, &state->msg);
+    state->order = (size_t*)malloc(bench->param * sizeof(size_t));
+    srand(42);
+    for(size_t i = 0; i < bench->param; i++) {
+        state->order[i] = (size_t)rand() % bench->param;
+    }
+
+return state;
+}
+
+static void access_teardown(void* arg)
+{
+    struct access_state* state = (struct access_state*)arg;
+    osc_message_index_destroy(&state->index);
+    osc_message_destroy(&state->msg);
+    free(state->order);
+    free(state);
+}
+
+/**
+ * Reads every argument in order with osc_message_arg (one operation is a pass over all arguments)
+ */
+static void run_access_arg_sequential(const struct bench_case* bench, void* arg, size_t iterations)
+{
+    struct access_state* state = (struct access_state*)arg;
+    for(size_t n = 0; n < iterations; n++) {
+        for(size_t i = 0; i < bench->param; i++) {
+            sink += (size_t)osc_message_arg(&state->msg, i)->s;
+        }
+    }
+}
+
+/**
+ * Reads every argument in order with an osc_arg_cursor
+ */
+static void run_access_cursor_sequential(const struct bench_case* bench, void* arg, size_t iterations)
+{
+    (void)bench;
+    struct access_state* state = (struct access_state*)arg;
+    for(size_t n = 0; n < iterations; n++) {
+        struct osc_arg_cursor cursor;
+        struct osc_arg argument;
+        osc_arg_cursor_init(&cursor, &state->msg);
+        while(osc_arg_cursor_next(&cursor, &argument) == 0) {
+            sink += argument.length;
+        }
+    }
+}
+
+/**
+ * Reads every argument in order through an osc_message_index
+ */
+static void run_access_index_sequential(const struct bench_case* bench, void* arg, size_t iterations)
+{
+    struct access_state* state = (struct access_state*)arg;
+    for(size_t n = 0; n < iterations; n++) {
+        for(size_t i = 0; i < bench->param; i++) {
+            sink += (size_t)osc_message_index_arg(&state->index, i)->s;
+        }
+    }
+}
+
+/**
+ * Reads param arguments in random order with osc_message_arg
+ */
+static void run_access_arg_random(const struct bench_case* bench, void* arg, size_t iterations)
+{
+    struct access_state* state = (struct access_state*)arg;
+    for(size_t n = 0; n < iterations; n++) {
+        for(size_t i = 0; i < bench->param; i++) {
+            sink += (size_t)osc_message_arg(&state->msg, state->order[i])->s;
+        }
+    }
+}
+
+/**
+ * Reads param arguments in random order through an osc_message_index
+ */
+static void run_access_index_random(const struct bench_case* bench, void* arg, size_t iterations)
+{
+    struct access_state* state = (struct access_state*)arg;
+    for(size_t n = 0; n < iterations; n++) {
+        for(size_t i = 0; i < bench->param; i++) {
+            sink += (size_t)osc_message_index_arg(&state->index, state->order[i])->s;
+        }
+    }
+}
+
+/**
+ * Builds the index of a message (allocation included)
+ */
+static void run_access_index_build(const struct bench_case* bench, void* arg, size_t iterations)
+{
+    (void)bench;
+    struct access_state* state = (struct access_state*)arg;
+    for(size_t n = 0; n < iterations; n++) {
+        struct osc_message_index index;
+        osc_message_index_new(&index, &state->msg);
+        sink += index.argc;
+        osc_message_index_destroy(&index);
+    }
+}
+
+/**
+ * Validates a message with osc_message_view_init
+ */
+static void run_decode_view(const struct bench_case* bench, void* arg, size_t iterations)
+{
+    (void)bench;
+    struct access_state* state = (struct access_state*)arg;
+    const char* data = (const char*)state->msg.raw_data + 4;
+    size_t length = osc_message_serialized_length(&state->msg);
+    for(size_t n = 0; n < iterations; n++) {
+        struct osc_message_view view;
+        sink += (size_t)osc_message_view_init(&view, data, length);
+    }
+}
+
+/**
+ * Structure representing the state of the decode/arg_unpack and decode/binding cases
+ * msg holds param float arguments, decoded into the fields array (one field per argument)
+ */
+struct decode_state {
+    struct osc_message msg;
+    struct osc_message_view view;
+    struct osc_binder binder;
+    float* fields;
+};
+
+static void* decode_setup(const struct bench_case* bench)
+{
+    struct decode_state* state = (struct decode_state*)malloc(sizeof(struct decode_state));
+    char* typetag = (char*)malloc(bench->param + 2);
+    size_t* offsets = (size_t*)malloc(bench->param * sizeof(size_t));
+    osc_message_new(&state->msg);
+    osc_message_set_address(&state->msg, "/bench/decode/0");
+    typetag[0] = ',';
+    for(size_t i = 0; i < bench->param; i++) {
+        osc_message_add_float(&state->msg, (float)i);
+        typetag[i + 1] = OSC_TT_FLOAT;
+        offsets[i] = i * sizeof(float);
+    }
+    typetag[bench->param + 1] = '\0';
+    osc_message_view_from_message(&state->view, &state->msg);
+    osc_binder_new(&state->binder, OSC_BINDER_DEFAULT_CACHE_SIZE);
+    osc_binder_add(&state->binder, "/bench/decode/*", typetag, offsets, NULL);
+    state->fields = (float*)malloc(bench->param * sizeof(float));
+    free(typetag);
+    free(offsets);
+
+return state;
+}
+
+static void decode_teardown(void* arg)
+{
+    struct decode_state* state = (struct decode_state*)arg;
+    osc_binder_destroy(&state->binder);
+    osc_message_destroy(&state->msg);
+    free(state->fields);
+    free(state);
+}
+
+/**
+ * Decodes the message into the fields with osc_message_argc, osc_message_arg and osc_unpack_float per field
+ */
+static void run_decode_arg_unpack(const struct bench_case* bench, void* arg, size_t iterations)
+{
+    (void)bench;
+    struct decode_state* state = (struct decode_state*)arg;
+    for(size_t n = 0; n < iterations; n++) {
+        size_t argc = osc_message_argc(&state->msg);
+        for(size_t i = 0; i < argc; i++) {
+            state->fields[i] = osc_unpack_float(osc_message_arg(&state->msg, i)->f);
+        }
+        sink += (size_t)state->fields[argc - 1];
+    }
+}
+
+/**
+ * Decodes the message into the fields with osc_binder_decode
+ */
+static void run_decode_binding(const struct bench_case* bench, void* arg, size_t iterations)
+{
+    struct decode_state* state = (struct decode_state*)arg;
+    for(size_t n = 0; n < iterations; n++) {
+        osc_binder_decode(&state->binder, &state->view, state->fields, NULL);
+        sink += (size_t)state->fields[bench->param - 1];
+    }
+}
+
+/**
+ * Structure representing the state of the bundle cases
+ * msg is the element message, bundle a bundle of param copies of it
+ */
+struct bundle_state {
+    struct osc_message msg;
+    struct osc_bundle bundle;
+};
+
+static void* bundle_setup(const struct bench_case* bench)
+{
+    struct bundle_state* state = (struct bundle_state*)malloc(sizeof(struct bundle_state));
+    osc_message_new(&state->msg);
+    osc_message_set_address(&state->msg, "/bench/bundle");
+    osc_message_add_int32(&state->msg, 1);
+    osc_message_add_float(&state->msg, 2.0f);
+    osc_message_add_string(&state->msg, "three");
+    osc_message_add_int32(&state->msg, 4);
+    osc_bundle_new(&state->bundle);
+    for(size_t i = 0; i < bench->param; i++) {
+        osc_bundle_add_message(&state->bundle, &state->msg);
+    }
+
+return state;
+}
+
+static void bundle_teardown(void* arg)
+{
+    struct bundle_state* state = (struct bundle_state*)arg;
+    osc_message_destroy(&state->msg);
+    osc_bundle_destroy(&state->bundle);
+    free(state);
+}
+
+/**
+ * Packs param prebuilt messages into a new bundle with osc_bundle_add_message
+ */
+static void run_bundle_pack(const struct bench_case* bench, void* arg, size_t iterations)
+{
+    struct bundle_state* state = (struct bundle_state*)arg;
+    for(size_t n = 0; n < iterations; n++) {
+        struct osc_bundle bundle;
+        osc_bundle_new(&bundle);
+        for(size_t i = 0; i < bench->param; i++) {
+            osc_bundle_add_message(&bundle, &state->msg);
+        }
+        sink += osc_bundle_serialized_length(&bundle);
+        osc_bundle_destroy(&bundle);
+    }
+}
+
+/**
+ * Writes param messages directly into a new bundle with an osc_bundle_message_writer
+ */
+static void run_bundle_writer(const struct bench_case* bench, void* arg, size_t iterations)
+{
+    (void)arg;
+    for(size_t n = 0; n < iterations; n++) {
+        struct osc_bundle bundle;
+        osc_bundle_new(&bundle);
+        for(size_t i = 0; i < bench->param; i++) {
+            struct osc_bundle_message_writer writer;
+            osc_bundle_begin_message(&bundle, &writer, "/bench/bundle");
+            osc_bundle_message_add_int32(&writer, 1);
+            osc_bundle_message_add_float(&writer, 2.0f);
+            osc_bundle_message_add_string(&writer, "three");
+            osc_bundle_message_add_int32(&writer, 4);
+            osc_bundle_end_message(&writer);
+        }
+        sink += osc_bundle_serialized_length(&bundle);
+        osc_bundle_destroy(&bundle);
+    }
+}
+
+/**
+ * Iterates over the messages of a bundle with osc_bundle_next_message
+ */
+static void run_bundle_iterate(const struct bench_case* bench, void* arg, size_t iterations)
+{
+    (void)bench;
+    struct bundle_state* state = (struct bundle_state*)arg;
+    for(size_t n = 0; n < iterations; n++) {
+        struct osc_message msg;
+        OSC_MESSAGE_NULL(&msg);
+        while((msg = osc_bundle_next_message(&state->bundle, msg)).raw_data != NULL) {
+            sink += (size_t)msg.address[1];
+        }
+    }
+}
+
+/**
+ * Validates a bundle and iterates over its messages with osc_bundle_view_next_message
+ */
+static void run_bundle_view_iterate(const struct bench_case* bench, void* arg, size_t iterations)
+{
+    (void)bench;
+    struct bundle_state* state = (struct bundle_state*)arg;
+    const char* data = (const char*)state->bundle.raw_data + 4;
+    size_t length = osc_bundle_serialized_length(&state->bundle);
+    for(size_t n = 0; n < iterations; n++) {
+        struct osc_bundle_view view;
+        struct osc_message_view msg;
+        osc_bundle_view_init(&view, data, length);
+        OSC_MESSAGE_VIEW_NULL(&msg);
+        while((msg = osc_bundle_view_next_message(&view, msg)).address != NULL) {
+            sink += (size_t)msg.address[1];
+        }
+    }
+}
+
+/**
+ * Builds the message index of a bundle and visits its messages through it
+ */
+static void run_bundle_index(const struct bench_case* bench, void* arg, size_t iterations)
+{
+    (void)bench;
+    struct bundle_state* state = (struct bundle_state*)arg;
+    for(size_t n = 0; n < iterations; n++) {
+        struct osc_bundle_index index;
+        struct osc_message_view msg;
+        if(osc_bundle_index_new(&index, &state->bundle) == 1) {
+            return;
+        }
+        for(size_t i = 0; i < index.count; i++) {
+            osc_bundle_index_message(&index, i, &msg);
+            sink += (size_t)msg.address[1];
+        }
+        osc_bundle_index_destroy(&index);
+    }
+}
+
+/**
+ * Creates a blob of param bytes and adds it to a new message
+ */
+static void run_blob_add(const struct bench_case* bench, void* arg, size_t iterations)
+{
+    (void)arg;
+    for(size_t n = 0; n < iterations; n++) {
+        struct osc_message msg;
+        osc_blob blob = osc_blob_new(bench->param);
+        osc_message_new(&msg);
+        osc_message_set_address(&msg, "/bench/blob");
+        osc_message_add_blob(&msg, blob);
+        sink += osc_message_serialized_length(&msg);
+        osc_message_destroy(&msg);
+        osc_blob_destroy(blob);
+    }
+}
+
+/**
+ * Structure representing the state of the blob/builder_iovec and blob/stream cases
+ */
+struct blob_state {
+    struct osc_message_builder builder;
+    char* payload;
+};
+
+static void* blob_setup(const struct bench_case* bench)
+{
+    struct blob_state* state = (struct blob_state*)malloc(sizeof(struct blob_state));
+    state->payload = (char*)calloc(bench->param, 1);
+    osc_message_builder_new(&state->builder);
+
+return state;
+}
+
+static void blob_teardown(void* arg)
+{
+    struct blob_state* state = (struct blob_state*)arg;
+    osc_message_builder_destroy(&state->builder);
+    free(state->payload);
+    free(state);
+}
+
+/**
+ * References a payload of param bytes as a blob and lays the message out as an iovec list
+ */
+static void run_blob_builder_iovec(const struct bench_case* bench, void* arg, size_t iterations)
+{
+    struct blob_state* state = (struct blob_state*)arg;
+    for(size_t n = 0; n < iterations; n++) {
+        struct iovec iov[4];
+        size_t count = 0;
+        osc_message_builder_begin(&state->builder, "/bench/blob");
+        osc_message_builder_add_blob_ref(&state->builder, state->payload, bench->param);
+        osc_message_builder_finish_iovec(&state->builder, iov, 4, &count, 0);
+        sink += count;
+    }
+}
+
+/**
+ * Streams a payload of param bytes into a blob in 64KiB chunks and lays the message out as an iovec list
+ */
+static void run_blob_stream(const struct bench_case* bench, void* arg, size_t iterations)
+{
+    struct blob_state* state = (struct blob_state*)arg;
+    for(size_t n = 0; n < iterations; n++) {
+        struct osc_blob_writer writer;
+        struct iovec iov[4];
+        size_t count = 0;
+        osc_message_builder_begin(&state->builder, "/bench/blob");
+        osc_message_builder_begin_blob(&state->builder, &writer);
+        for(size_t offset = 0; offset < bench->param; offset += 65536) {
+            size_t length = bench->param - offset < 65536 ? bench->param - offset : 65536;
+            osc_blob_writer_append(&writer, state->payload + offset, length);
+        }
+        osc_blob_writer_end(&writer);
+        osc_message_builder_finish_iovec(&state->builder, iov, 4, &count, 0);
+        sink += count;
+    }
+}
+
+/**
+ * Structure representing the state of the pipeline/loopback cases
+ * param worker threads and as many consumers receive on a loopback port, fed by param sender threads that each spread
+ * their datagrams over PIPELINE_SENDER_SOCKETS sockets (SO_REUSEPORT balances by source port); sent counts the
+ * datagrams sent since setup and goal the handled count at which the running case is done
+ */
+struct pipeline_state {
+    struct osc_pipeline pipeline;
+    struct osc_udp_socket* sockets;
+    size_t socket_count;
+    struct osc_message msg;
+    uint64_t sent;
+    uint64_t goal;
+};
+
+/**
+ * Structure representing a sender thread of a pipeline/loopback case
+ */
+struct pipeline_sender {
+    pthread_t thread;
+    struct pipeline_state* state;
+    size_t first_socket;
+};
+
+/**
+ * Handles a message of a pipeline/loopback case (the pipeline counts it)
+ */
+static void pipeline_handler(const struct osc_message_view* msg, size_t consumer, void* context)
+{
+    (void)consumer;
+    (void)context;
+    sink += (size_t)msg->address[1];
+}
+
+static void* pipeline_setup(const struct bench_case* bench)
+{
+    struct pipeline_state* state = (struct pipeline_state*)calloc(1, sizeof(struct pipeline_state));
+    osc_pipeline_new(&state->pipeline, "127.0.0.1", 0, bench->param, bench->param, 0, OSC_AFFINITY_NONE,
+                     pipeline_handler, NULL);
+    osc_pipeline_start(&state->pipeline);
+    state->socket_count = bench->param * PIPELINE_SENDER_SOCKETS;
+    state->sockets = (struct osc_udp_socket*)calloc(state->socket_count, sizeof(struct osc_udp_socket));
+    for(size_t i = 0; i < state->socket_count; i++) {
+        osc_udp_new(&state->sockets[i], "127.0.0.1", 0, PIPELINE_BATCH, 0);
+        osc_udp_set_destination(&state->sockets[i], "127.0.0.1", osc_pipeline_port(&state->pipeline));
+    }
+    osc_message_new(&state->msg);
+    osc_message_set_address(&state->msg, "/bench/pipeline");
+    osc_message_add_int32(&state->msg, 1);
+    osc_message_add_float(&state->msg, 2.0f);
+
+return state;
+}
+
+static void pipeline_teardown(void* arg)
+{
+    struct pipeline_state* state = (struct pipeline_state*)arg;
+    osc_pipeline_destroy(&state->pipeline);
+    for(size_t i = 0; i < state->socket_count; i++) {
+        osc_udp_destroy(&state->sockets[i]);
+    }
+    free(state->sockets);
+    osc_message_destroy(&state->msg);
+    free(state);
+}
+
+/**
+ * Main function of the sender threads: sends batches while fewer than PIPELINE_WINDOW datagrams are in flight, until
+ * the pipeline handled the goal; datagrams the kernel dropped are written off when nothing was processed for
+ * PIPELINE_STALL_NS
+ */
+static void* pipeline_sender_main(void* arg)
+{
+    struct pipeline_sender* sender = (struct pipeline_sender*)arg;
+    struct pipeline_state* state = sender->state;
+    uint64_t last_processed = 0;
+    uint64_t last_progress = now_ns();
+    size_t next = 0;
+    while(1) {
+        struct osc_pipeline_stats stats;
+        osc_pipeline_stats(&state->pipeline, &stats);
+        if(stats.handled >= __atomic_load_n(&state->goal, __ATOMIC_RELAXED)) {
+            break;
+        }
+        uint64_t processed = stats.handled + stats.dropped;
+        uint64_t sent = __atomic_load_n(&state->sent, __ATOMIC_RELAXED);
+        if(processed != last_processed) {
+            last_processed = processed;
+            last_progress = now_ns();
+        }
+        if(sent < processed + PIPELINE_WINDOW * state->pipeline.worker_count) {
+            struct osc_udp_socket* sock = &state->sockets[sender->first_socket + next];
+            next = (next + 1) % PIPELINE_SENDER_SOCKETS;
+            for(size_t i = 0; i < PIPELINE_BATCH; i++) {
+                osc_udp_queue_message(sock, &state->msg);
+            }
+            osc_udp_flush(sock);
+            __atomic_fetch_add(&state->sent, PIPELINE_BATCH, __ATOMIC_RELAXED);
+        }
+        else if(now_ns() - last_progress > PIPELINE_STALL_NS) {
+            __atomic_compare_exchange_n(&state->sent, &sent, processed, 0, __ATOMIC_RELAXED, __ATOMIC_RELAXED);
+            last_progress = now_ns();
+        }
+        else {
+            sched_yield();
+        }
+    }
+
+return NULL;
+}
+
+/**
+ * Sends datagrams to the pipeline from param threads until it handled iterations more messages
+ * (one operation is one message received, parsed, handed off and handled)
+ */
+static void run_pipeline_loopback(const struct bench_case* bench, void* arg, size_t iterations)
+{
+    struct pipeline_state* state = (struct pipeline_state*)arg;
+    struct pipeline_sender senders[bench->param];
+    struct osc_pipeline_stats stats;
+    osc_pipeline_stats(&state->pipeline, &stats);
+    __atomic_store_n(&state->goal, stats.handled + iterations, __ATOMIC_RELAXED);
+    for(size_t i = 0; i < bench->param; i++) {
+        senders[i].state = state;
+        senders[i].first_socket = i * PIPELINE_SENDER_SOCKETS;
+        pthread_create(&senders[i].thread, NULL, pipeline_sender_main, &senders[i]);
+    }
+    for(size_t i = 0; i < bench->param; i++) {
+        pthread_join(senders[i].thread, NULL);
+    }
+}
+
+/**
+ * Registers every benchmark case
+ */
+static void register_cases(void)
+{
+    static const size_t arg_counts[] = {1, 4, 16, 64, 256};
+    static const char types[] = {OSC_TT_INT, OSC_TT_FLOAT, OSC_TT_STRING, OSC_TT_TIMETAG, OSC_TT_BLOB};
+    static const size_t bundle_sizes[] = {1, 16, 256};
+    static const size_t blob_sizes[] = {16, 256, 4096, 65536, 1048576, 16777216};
+    static const size_t pipeline_workers[] = {1, 2, 4};
+    for(size_t t = 0; t < sizeof(types); t++) {
+        for(size_t a = 0; a < sizeof(arg_counts) / sizeof(arg_counts[0]); a++) {
+            add_case(encode_setup, run_encode_add, encode_teardown, arg_counts[a], types[t],
+                     "encode/add_%c/%zu", types[t], arg_counts[a]);
+            add_case(encode_setup, run_encode_builder, encode_teardown, arg_counts[a], types[t],
+                     "encode/builder_%c/%zu", types[t], arg_counts[a]);
+        }
+    }
+    for(size_t a = 0; a < sizeof(arg_counts) / sizeof(arg_counts[0]); a++) {
+        size_t n = arg_counts[a];
+        add_case(access_setup, run_decode_view, access_teardown, n, '\0', "decode/view_init/%zu", n);
+        add_case(access_setup, run_access_arg_sequential, access_teardown, n, '\0', "access/arg_sequential/%zu", n);
+        add_case(access_setup, run_access_cursor_sequential, access_teardown, n, '\0', "access/cursor_sequential/%zu", n);
+        add_case(access_setup, run_access_index_sequential, access_teardown, n, '\0', "access/index_sequential/%zu", n);
+        add_case(access_setup, run_access_arg_random, access_teardown, n, '\0', "access/arg_random/%zu", n);
+        add_case(access_setup, run_access_index_random, access_teardown, n, '\0', "access/index_random/%zu", n);
+        add_case(access_setup, run_access_index_build, access_teardown, n, '\0', "access/index_build/%zu", n);
+        add_case(decode_setup, run_decode_arg_unpack, decode_teardown, n, '\0', "decode/arg_unpack/%zu", n);
+        add_case(decode_setup, run_decode_binding, decode_teardown, n, '\0', "decode/binding/%zu", n);
+    }
+    for(size_t b = 0; b < sizeof(bundle_sizes) / sizeof(bundle_sizes[0]); b++) {
+        size_t n = bundle_sizes[b];
+        add_case(bundle_setup, run_bundle_pack, bundle_teardown, n, '\0', "bundle/pack/%zu", n);
+        add_case(bundle_setup, run_bundle_writer, bundle_teardown, n, '\0', "bundle/writer/%zu", n);
+        add_case(bundle_setup, run_bundle_iterate, bundle_teardown, n, '\0', "bundle/iterate/%zu", n);
+        add_case(bundle_setup, run_bundle_view_iterate, bundle_teardown, n, '\0', "bundle/view_iterate/%zu", n);
+        add_case(bundle_setup, run_bundle_index, bundle_teardown, n, '\0', "bundle/index/%zu", n);
+    }
+    for(size_t s = 0; s < sizeof(blob_sizes) / sizeof(blob_sizes[0]); s++) {
+        add_case(NULL, run_blob_add, NULL, blob_sizes[s], '\0', "blob/add/%zu", blob_sizes[s]);
+        add_case(blob_setup, run_blob_builder_iovec, blob_teardown, blob_sizes[s], '\0', "blob/builder_iovec/%zu", blob_sizes[s]);
+        add_case(blob_setup, run_blob_stream, blob_teardown, blob_sizes[s], '\0', "blob/stream/%zu", blob_sizes[s]);
+    }
+    for(size_t w = 0; w < sizeof(pipeline_workers) / sizeof(pipeline_workers[0]); w++) {
+        size_t n = pipeline_workers[w];
+        add_case(pipeline_setup, run_pipeline_loopback, pipeline_teardown, n, '\0', "pipeline/loopback/%zux%zu", n, n);
+    }
+}
+
+/**
+ * Runs a case with a doubling iteration count until one run lasts at least min_time_ns and prints its JSON record
+ *
+ * @param   bench       pointer to the case
+ * @param   min_time_ns the minimal duration of the measured run
+ * @param   out         the output stream
+ * @param   first       whether this is the first record written
+ */
+static void run_case(const struct bench_case* bench, uint64_t min_time_ns, FILE* out, int first)
+{
+    void* state = bench->setup != NULL ? bench->setup(bench) : NULL;
+    size_t iterations = 1;
+    uint64_t elapsed = 0;
+    size_t allocations = 0;
+    for(;;) {
+        allocation_count = 0;
+        uint64_t start = now_ns();
+        bench->run(bench, state, iterations);
+        elapsed = now_ns() - start;
+        allocations = allocation_count;
+        if(elapsed >= min_time_ns || iterations >= ((size_t)1 << 40)) {
+            break;
+        }
+        size_t scale = elapsed == 0 ? 100 : (size_t)(min_time_ns * 1.2 / elapsed) + 1;
+        iterations *= scale < 2 ? 2 : (scale > 100 ? 100 : scale);
+    }
+    if(bench->teardown != NULL) {
+        bench->teardown(state);
+    }
+    fprintf(out, "%s    {\"name\": \"%s\", \"iterations\": %zu, \"ns_per_op\": %.3f, \"ops_per_sec\": %.0f, \"allocs_per_op\": %.3f}",
+            first ? "" : ",\n", bench->name, iterations, (double)elapsed / iterations, iterations * 1e9 / elapsed,
+            (double)allocations / iterations);
+    fflush(out);
+}
+
+/**
+ * Prints the command line usage
+ *
+ * @param   program     the program name
+ */
+static void usage(const char* program)
+{
+    fprintf(stderr, "usage: %s [--filter SUBSTRING] [--min-time-ms N] [--output FILE] [--list]\n", program);
+}
+
+int main(int argc, char** argv)
+{
+    const char* filter = NULL;
+    const char* output = NULL;
+    uint64_t min_time_ms = DEFAULT_MIN_TIME_MS;
+    int list = 0;
+    for(int i = 1; i < argc; i++) {
+        if(strcmp(argv[i], "--filter") == 0 && i + 1 < argc) {
+            filter = argv[++i];
+        }
+        else if(strcmp(argv[i], "--min-time-ms") == 0 && i + 1 < argc) {
+            min_time_ms = strtoull(argv[++i], NULL, 10);
+        }
+        else if(strcmp(argv[i], "--output") == 0 && i + 1 < argc) {
+            output = argv[++i];
+        }
+        else if(strcmp(argv[i], "--list") == 0) {
+            list = 1;
+        }
+        else {
+            usage(argv[0]);
+            return 1;
+        }
+    }
+    register_cases();
+    if(list) {
+        for(size_t i = 0; i < case_count; i++) {
+            printf("%s\n", cases[i].name);
+        }
+        return 0;
+    }
+    FILE* out = stdout;
+    if(output != NULL) {
+        out = fopen(output, "w");
+        if(out == NULL) {
+            perror(output);
+            return 1;
+        }
+    }
+    osc_set_thread_allocator(&counting_allocator);
+    fprintf(out, "{\n  \"min_time_ms\": %llu,\n  \"benchmarks\": [\n", (unsigned long long)min_time_ms);
+    int first = 1;
+    for(size_t i = 0; i < case_count; i++) {
+        if(filter != NULL && strstr(cases[i].name, filter) == NULL) {
+            continue;
+        }
+        run_case(&cases[i], min_time_ms * 1000000ULL, out, first);
+        first = 0;
+    }
+    fprintf(out, "\n  ]\n}\n");
+    osc_set_thread_allocator(NULL);
+    if(osc_instrument_enabled()) {
+        struct osc_instrument_snapshot snapshot;
+        osc_instrument_snapshot_all(&snapshot);
+        osc_instrument_dump(stderr, &snapshot);
+    }
+    if(out != stdout) {
+        fclose(out);
+    }
+
+return 0;
+}
@@ -0,0 +1,109 @@
+/** @file osc_bench_cpp.cpp */
+
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string_view>
+#include "osc.hpp"
+
+namespace {
+
+constexpr std::uint64_t DEFAULT_MIN_TIME_MS = 200;
+
+volatile std::size_t sink = 0;
+
+/**
+ * Runs an operation with a doubling iteration count until one run lasts at least min_time_ns and prints its JSON record
+ */
+template<class Operation>
+void run_case(const char* name, std::uint64_t min_time_ns, bool first, Operation operation)
+{
+    std::size_t iterations = 1;
+    std::uint64_t elapsed = 0;
+    for(;;) {
+        auto start = std::chrono::steady_clock::now();
+        for(std::size_t n = 0; n < iterations; n++) {
+            operation();
+        }
+        elapsed = static_cast<std::uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(
+                                             std::chrono::steady_clock::now() - start).count());
+        if(elapsed >= min_time_ns) {
+            break;
+        }
+        iterations *= 2;
+    }
+    std::printf("%s    {\"name\": \"%s\", \"iterations\": %zu, \"ns_per_op\": %.3f}", first ? "" : ",\n", name, iterations,
+                static_cast<double>(elapsed) / static_cast<double>(iterations));
+}
+
+} // namespace
+
+/**
+ * Compares the C encoding paths with osc.hpp for a message of four arguments (int32, float, string, int32)
+ * Usage: osc_bench_cpp [--min-time-ms N]
+ */
+int main(int argc, char** argv)
+{
+    std::uint64_t min_time_ms = DEFAULT_MIN_TIME_MS;
+    for(int i = 1; i < argc; i++) {
+        if(std::strcmp(argv[i], "--min-time-ms") == 0 && i + 1 < argc) {
+            min_time_ms = std::strtoull(argv[++i], nullptr, 10);
+        }
+        else {
+            std::fprintf(stderr, "usage: %s [--min-time-ms N]\n", argv[0]);
+            return 1;
+        }
+    }
+    std::uint64_t min_time_ns = min_time_ms * 1000000ULL;
+    osc_message_builder builder;
+    osc_message_builder_new(&builder);
+    auto encoded = osc::encode("/bench/cpp", 1, 2.0f, "argument", 3);
+    std::printf("{\n  \"min_time_ms\": %llu,\n  \"benchmarks\": [\n", static_cast<unsigned long long>(min_time_ms));
+    run_case("encode/c_add", min_time_ns, true, [] {
+        osc_message msg;
+        osc_message_new(&msg);
+        osc_message_set_address(&msg, "/bench/cpp");
+        osc_message_add_int32(&msg, 1);
+        osc_message_add_float(&msg, 2.0f);
+        osc_message_add_string(&msg, "argument");
+        osc_message_add_int32(&msg, 3);
+        sink += osc_message_serialized_length(&msg);
+        osc_message_destroy(&msg);
+    });
+    run_case("encode/c_builder", min_time_ns, false, [&builder] {
+        osc_message msg;
+        osc_message_builder_begin(&builder, "/bench/cpp");
+        osc_message_builder_add_int32(&builder, 1);
+        osc_message_builder_add_float(&builder, 2.0f);
+        osc_message_builder_add_string(&builder, "argument");
+        osc_message_builder_add_int32(&builder, 3);
+        osc_message_builder_finish(&builder, &msg);
+        sink += osc_message_serialized_length(&msg);
+        osc_message_destroy(&msg);
+    });
+    run_case("encode/cpp_encode", min_time_ns, false, [] {
+        auto msg = osc::encode("/bench/cpp", 1, 2.0f, "argument", 3);
+        sink += msg.size();
+    });
+    run_case("encode/cpp_encode_into", min_time_ns, false, [] {
+        char buffer[64];
+        sink += osc::encode_into(buffer, sizeof(buffer), "/bench/cpp", 1, 2.0f, "argument", 3);
+    });
+    run_case("decode/c_view_arg", min_time_ns, false, [&encoded] {
+        osc_message_view view;
+        osc_message_view_init(&view, encoded.data(), encoded.size());
+        sink += static_cast<std::size_t>(osc_unpack_int32(osc_message_view_arg(&view, 0)->i));
+        sink += static_cast<std::size_t>(osc_message_view_arg(&view, 2)->s);
+        sink += static_cast<std::size_t>(osc_unpack_int32(osc_message_view_arg(&view, 3)->i));
+    });
+    run_case("decode/cpp_decode", min_time_ns, false, [&encoded] {
+        auto values = osc::decode<std::int32_t, float, std::string_view, std::int32_t>(encoded.data(), encoded.size());
+        sink += static_cast<std::size_t>(std::get<0>(*values)) + std::get<2>(*values).size() + static_cast<std::size_t>(std::get<3>(*values));
+    });
+    std::printf("\n  ]\n}\n");
+    osc_message_builder_destroy(&builder);
+
+    return 0;
+}
@@ -10,7 +10,137 @@
 #include <string.h>
 #include <limits.h>
 #include <endian.h>
+#include <errno.h>
+#include <unistd.h>
+#include <sys/uio.h>
 #include "osc.h"
+#include "osc_instrument.h"
+
+#if defined(__GNUC__) && defined(__x86_64__)
+    #include <immintrin.h>
+    #define OSC_BSWAP_X86
+#elif defined(__ARM_NEON) && __BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__
+    #include <arm_neon.h>
+    #define OSC_BSWAP_NEON
+#endif
+
+/**
+ * The osc_allocator functions of the default allocator (the C library heap)
+ */
+static void* default_allocate(void* context, size_t size)
+{
+    (void)context;
+
+return malloc(size);
+}
+
+static void* default_reallocate(void* context, void* ptr, size_t size)
+{
+    (void)context;
+
+return realloc(ptr, size);
+}
+
+static void default_deallocate(void* context, void* ptr)
+{
+    (void)context;
+    free(ptr);
+}
+
+static const struct osc_allocator default_allocator = {
+    default_allocate,
+    default_reallocate,
+    default_deallocate,
+    NULL
+};
+
+static _Thread_local const struct osc_allocator* thread_allocator = NULL;
+
+const struct osc_allocator* osc_default_allocator(void)
+{
+return &default_allocator;
+}
+
+void osc_set_thread_allocator(const struct osc_allocator* allocator)
+{
+    thread_allocator = allocator;
+}
+
+const struct osc_allocator* osc_thread_allocator(void)
+{
+    if(thread_allocator == NULL) {
+        return &default_allocator;
+    }
+
+return thread_allocator;
+}
+
+/**
+ * Resizes (or allocates when ptr is NULL) a memory block with the given allocator
+ *
+ * @param   allocator   the allocator owning the block (NULL for the default allocator)
+ * @param   ptr         the block to resize or NULL
+ * @param   size        the new size of the block
+ * @return              the resized block or NULL if memory reallocation failed
+ */
+static void* mem_realloc(const struct osc_allocator* allocator, void* ptr, size_t size)
+{
+    if(allocator == NULL) {
+        allocator = &default_allocator;
+    }
+    if(ptr == NULL) {
+        OSC_COUNT(allocations, 1);
+        return allocator->allocate(allocator->context, size);
+    }
+    OSC_COUNT(reallocations, 1);
+
+return allocator->reallocate(allocator->context, ptr, size);
+}
+
+/**
+ * Frees a memory block with the given allocator
+ *
+ * @param   allocator   the allocator owning the block (NULL for the default allocator)
+ * @param   ptr         the block to free or NULL
+ */
+static void mem_free(const struct osc_allocator* allocator, void* ptr)
+{
+    if(ptr == NULL) {
+        return;
+    }
+    if(allocator == NULL) {
+        allocator = &default_allocator;
+    }
+    OSC_COUNT(deallocations, 1);
+    allocator->deallocate(allocator->context, ptr);
+}
+
+/**
+ * Finds the length of a string (strlen, counted in the instrumentation counters)
+ *
+ * @param   str     pointer to the string
+ * @return          the length of the string
+ */
+static size_t scan_length(const char* str)
+{
+    size_t length = strlen(str);
+    OSC_COUNT(bytes_scanned, length + 1);
+
+return length;
+}
+
+/**
+ * Moves bytes inside a buffer (memmove, counted in the instrumentation counters)
+ *
+ * @param   dst     pointer to the destination
+ * @param   src     pointer to the source
+ * @param   count   the number of bytes to move
+ */
+static void move_bytes(void* dst, const void* src, size_t count)
+{
+    OSC_COUNT(bytes_moved, count);
+    memmove(dst, src, count);
+}
 
 int32_t osc_unpack_int32(int32_t value)
 {
@@ -27,6 +157,144 @@ float osc_unpack_float(float value)
 return h_value;
 }
 
+/**
+ * Converts 4B values between big-endian and the host endianity one at a time (portable fallback and vector tail)
+ *
+ * @param   dst     pointer to the first destination byte
+ * @param   src     pointer to the first source byte
+ * @param   count   the number of 4B values to convert
+ */
+static void bswap32_scalar(char* dst, const char* src, size_t count)
+{
+    for(size_t i = 0; i < count; i++) {
+        uint32_t value;
+        memcpy(&value, src + 4 * i, sizeof(uint32_t));
+        value = be32toh(value);
+        memcpy(dst + 4 * i, &value, sizeof(uint32_t));
+    }
+}
+
+#ifdef OSC_BSWAP_X86
+/**
+ * SSE2 version of bswap32_scalar (SSE2 has no byte shuffle, so 16-bit halves are swapped first, then their bytes)
+ */
+static void bswap32_sse2(char* dst, const char* src, size_t count)
+{
+    size_t i = 0;
+    for(; i + 4 <= count; i += 4) {
+        __m128i value = _mm_loadu_si128((const __m128i*)(src + 4 * i));
+        value = _mm_shufflelo_epi16(value, _MM_SHUFFLE(2, 3, 0, 1));
+        value = _mm_shufflehi_epi16(value, _MM_SHUFFLE(2, 3, 0, 1));
+        value = _mm_or_si128(_mm_slli_epi16(value, 8), _mm_srli_epi16(value, 8));
+        _mm_storeu_si128((__m128i*)(dst + 4 * i), value);
+    }
+    bswap32_scalar(dst + 4 * i, src + 4 * i, count - i);
+}
+
+/**
+ * AVX2 version of bswap32_scalar
+ */
+__attribute__((target("avx2")))
+static void bswap32_avx2(char* dst, const char* src, size_t count)
+{
+    const __m256i mask = _mm256_setr_epi8(3, 2, 1, 0, 7, 6, 5, 4, 11, 10, 9, 8, 15, 14, 13, 12,
+                                          3, 2, 1, 0, 7, 6, 5, 4, 11, 10, 9, 8, 15, 14, 13, 12);
+    size_t i = 0;
+    for(; i + 8 <= count; i += 8) {
+        __m256i value = _mm256_loadu_si256((const __m256i*)(src + 4 * i));
+        _mm256_storeu_si256((__m256i*)(dst + 4 * i), _mm256_shuffle_epi8(value, mask));
+    }
+    bswap32_sse2(dst + 4 * i, src + 4 * i, count - i);
+}
+#endif // OSC_BSWAP_X86
+
+#ifdef OSC_BSWAP_NEON
+/**
+ * NEON version of bswap32_scalar
+ */
+static void bswap32_neon(char* dst, const char* src, size_t count)
+{
+    size_t i = 0;
+    for(; i + 4 <= count; i += 4) {
+        uint8x16_t value = vld1q_u8((const uint8_t*)(src + 4 * i));
+        vst1q_u8((uint8_t*)(dst + 4 * i), vrev32q_u8(value));
+    }
+    bswap32_scalar(dst + 4 * i, src + 4 * i, count - i);
+}
+#endif // OSC_BSWAP_NEON
+
+/**
+ * The conversion kernel picked for this CPU by select_bswap32 on first use
+ */
+static void (*bswap32_kernel)(char* dst, const char* src, size_t count) = NULL;
+
+/**
+ * Picks the fastest conversion kernel the CPU supports
+ *
+ * @return          pointer to the kernel
+ */
+static void (*select_bswap32(void))(char*, const char*, size_t)
+{
+#if defined(OSC_BSWAP_X86)
+    __builtin_cpu_init();
+    if(__builtin_cpu_supports("avx2")) {
+        return bswap32_avx2;
+    }
+    return bswap32_sse2;
+#elif defined(OSC_BSWAP_NEON)
+    return bswap32_neon;
+#else
+    return bswap32_scalar;
+#endif
+}
+
+void osc_bswap32_array(void* dst, const void* src, size_t count)
+{
+    void (*kernel)(char*, const char*, size_t) = __atomic_load_n(&bswap32_kernel, __ATOMIC_RELAXED);
+    if(kernel == NULL) {
+        kernel = select_bswap32();
+        __atomic_store_n(&bswap32_kernel, kernel, __ATOMIC_RELAXED);
+    }
+    kernel((char*)dst, (const char*)src, count);
+}
+
+/**
+ * Reads a big-endian 4B value from possibly unaligned memory
+ *
+ * @param   p       pointer to the first byte of the value
+ * @return          the value in the host endianity
+ */
+static uint32_t load_be32(const char* p)
+{
+    uint32_t be_value;
+    memcpy(&be_value, p, sizeof(uint32_t));
+
+return be32toh(be_value);
+}
+
+/**
+ * Finds the first byte after the argument of the given type (the argument is trusted to be well-formed)
+ *
+ * @param   tag         tag of the argument
+ * @param   p_argument  pointer to the first byte of the argument
+ * @return              pointer to the first byte after the argument
+ */
+static const char* skip_argument(char tag, const char* p_argument)
+{
+    size_t size = 0;
+    switch(tag) {
+        case OSC_TT_INT:     return p_argument + 4;
+        case OSC_TT_FLOAT:   return p_argument + 4;
+        case OSC_TT_TIMETAG: return p_argument + 8;
+        case OSC_TT_STRING:  size = scan_length(p_argument);
+                             return p_argument + size + (4 - (size % 4));
+        case OSC_TT_BLOB:    size = load_be32(p_argument);
+                             return p_argument + 4 + ((size + 3) & ~(size_t)3);
+    }
+
+return p_argument;
+}
+
 size_t osc_message_serialized_length(const struct osc_message* msg)
 {
     size_t cur_msg_length = 0;
@@ -88,7 +356,7 @@ static void actualize_length(struct osc_message* msg, unsigned int new_msg_lengt
  */
 static int actualize_typetag(struct osc_message* msg, char tag)
 {
-    unsigned int cur_tg_length = strlen(msg->typetag);
+    unsigned int cur_tg_length = scan_length(msg->typetag);
     unsigned char* uchar_ptr = (unsigned char*)msg->raw_data;
     if(((cur_tg_length % 4) % 3 == 0) && ((cur_tg_length % 4) != 0)) {
         unsigned int cur_msg_length = osc_message_serialized_length(msg);
@@ -96,7 +364,7 @@ static int actualize_typetag(struct osc_message* msg, char tag)
         unsigned int new_msg_length = cur_msg_length + 4;
         unsigned int addr_length = msg->typetag - msg->address;
         unsigned int arg_size = cur_msg_length - addr_length - cur_tg_length - (4 - (cur_tg_length % 4));
-        unsigned char* memory_alloc = (unsigned char*)realloc(uchar_ptr, new_mem_size);
+        unsigned char* memory_alloc = (unsigned char*)mem_realloc(msg->allocator, uchar_ptr, new_mem_size);
             if(memory_alloc == NULL) {
                 return 1;
             }
@@ -104,23 +372,28 @@ static int actualize_typetag(struct osc_message* msg, char tag)
               uchar_ptr = memory_alloc;
               msg->raw_data = (void*)uchar_ptr;
               msg->address = (char*)msg->raw_data + sizeof(int32_t);
-              msg->typetag = msg->address + strlen(msg->address) + (4 - (strlen(msg->address) % 4));
-              char* arg_start = msg->typetag + strlen(msg->typetag) + 1;
-              memmove(arg_start + 4, arg_start, arg_size);
-              memset(msg->typetag + strlen(msg->typetag) + 1, 0, 4);
-              memset(msg->typetag + strlen(msg->typetag), tag, 1);
+              msg->typetag = msg->address + scan_length(msg->address) + (4 - (scan_length(msg->address) % 4));
+              char* arg_start = msg->typetag + scan_length(msg->typetag) + 1;
+              move_bytes(arg_start + 4, arg_start, arg_size);
+              memset(msg->typetag + scan_length(msg->typetag) + 1, 0, 4);
+              memset(msg->typetag + scan_length(msg->typetag), tag, 1);
               actualize_length(msg, new_msg_length);
             }
     }
     else {
-       memset(msg->typetag + strlen(msg->typetag), tag, 1);
+       memset(msg->typetag + scan_length(msg->typetag), tag, 1);
     }
 return 0;
 }
 
 int osc_message_new(struct osc_message* msg)
 {
-    unsigned char* mem_alloc = (unsigned char*)realloc(NULL, 12);
+return osc_message_new_with_allocator(msg, osc_thread_allocator());
+}
+
+int osc_message_new_with_allocator(struct osc_message* msg, const struct osc_allocator* allocator)
+{
+    unsigned char* mem_alloc = (unsigned char*)mem_realloc(allocator, NULL, 12);
     //check if memory allocation was successful
     if(mem_alloc == NULL) {
         return 1;
@@ -128,50 +401,90 @@ int osc_message_new(struct osc_message* msg)
     else {
         unsigned char* uchar_ptr = mem_alloc;
         msg->raw_data = (void*)uchar_ptr;
+        msg->allocator = allocator;
         memset(uchar_ptr, 0, 3);
         memset(uchar_ptr + 3, 8, 1);
         memset(uchar_ptr + 4, '\0', 4);
         memset(uchar_ptr + 8, ',' ,1);
         memset(uchar_ptr + 9, '\0', 3);
         msg->address = (char*)msg->raw_data + sizeof(int32_t);
-        msg->typetag = msg->address + strlen(msg->address) + (4 - (strlen(msg->address) % 4));
+        msg->typetag = msg->address + scan_length(msg->address) + (4 - (scan_length(msg->address) % 4));
+        OSC_COUNT(messages_built, 1);
     }
 return 0;
 }
 
 void osc_message_destroy(struct osc_message* msg)
 {
-    free(msg->raw_data);
+    mem_free(msg->allocator, msg->raw_data);
     msg->raw_data = NULL;
     msg->address = NULL;
     msg->typetag = NULL;
-
+    msg->allocator = NULL;
 }
 
-osc_blob osc_blob_new(size_t length)
+/**
+ * Structure representing the hidden header placed before every osc_blob, remembering the allocator that created it
+ * (padded to 16B so that the blob keeps the alignment of the allocation)
+ */
+union blob_header {
+    const struct osc_allocator* allocator;
+    char padding[16];
+};
+
+/**
+ * Allocates an osc_blob instance and writes its 4B size and its alignment bytes, leaving the data block unset
+ *
+ * @param   length      the desired length of the osc_blob data block
+ * @return              osc_blob instance or NULL if memory allocation failed
+ */
+static osc_blob allocate_blob(size_t length)
 {
     unsigned int add_bytes = 0;
     if(length % 4 != 0) {
         add_bytes = 4 - (length % 4);
     }
-    osc_blob blob = (void*)realloc(NULL, (length + 4 + add_bytes) * sizeof(char));
-    if(blob == NULL) {
-        return blob;
+    const struct osc_allocator* allocator = osc_thread_allocator();
+    union blob_header* header = (union blob_header*)mem_realloc(allocator, NULL,
+                                                                sizeof(union blob_header) + (length + 4 + add_bytes) * sizeof(char));
+    if(header == NULL) {
+        return NULL;
     }
+    header->allocator = allocator;
+    osc_blob blob = (void*)(header + 1);
     uint32_t be_length = (uint32_t)htobe32(length);
     unsigned char* uchar_ptr = (unsigned char*)blob;
     for(int i = 0; i < 4; i++) {
         uchar_ptr[i] = be_length & 0xff;
         be_length >>= 8;
     }
-    memset(uchar_ptr + 4, 0, length + add_bytes);
+    memset(uchar_ptr + 4 + length, 0, add_bytes);
+
+return blob;
+}
+
+osc_blob osc_blob_new(size_t length)
+{
+    osc_blob blob = allocate_blob(length);
+    if(blob != NULL) {
+        memset((unsigned char*)blob + 4, 0, length);
+    }
 
 return blob;
 }
 
+osc_blob osc_blob_new_uninitialized(size_t length)
+{
+return allocate_blob(length);
+}
+
 void osc_blob_destroy(osc_blob b)
 {
-    free(b);
+    if(b == NULL) {
+        return;
+    }
+    union blob_header* header = (union blob_header*)b - 1;
+    mem_free(header->allocator, header);
 }
 
 void* osc_blob_data_ptr(const osc_blob b)
@@ -184,37 +497,45 @@ return void_ptr_data;
 
 int osc_message_set_address (struct osc_message* msg, const char* address)
 {
+    OSC_TIME_BEGIN(start);
+    int result = 0;
     unsigned int cur_addr_space_size = msg->typetag - msg->address;
-    unsigned int new_addr_space_size = strlen(address) + (4 - (strlen(address) % 4));
+    unsigned int new_addr_space_size = scan_length(address) + (4 - (scan_length(address) % 4));
     if(cur_addr_space_size == new_addr_space_size) {
         strcpy(msg->address, address);
-        return 0;
     }
 
     else {
         unsigned char* uchar_ptr = (unsigned char*)msg->raw_data;
-        unsigned int add_mem_size = new_addr_space_size - cur_addr_space_size;
         unsigned int cur_msg_length = osc_message_serialized_length(msg);
-        unsigned int new_mem_size = cur_msg_length + 4 + add_mem_size;
         unsigned int num_bytes_to_copy = cur_msg_length - cur_addr_space_size;
-        unsigned int new_msg_length = cur_msg_length + add_mem_size;
-        unsigned char* memory_alloc = (unsigned char*)realloc(uchar_ptr, new_mem_size);
-        if(memory_alloc == NULL) {
-                return 1;
+        unsigned int new_msg_length = cur_msg_length - cur_addr_space_size + new_addr_space_size;
+        if(new_addr_space_size < cur_addr_space_size) {
+            // the typetag and arguments have to move down before the memory block shrinks
+            move_bytes(msg->address + new_addr_space_size, msg->typetag, num_bytes_to_copy);
         }
-        else {
+        unsigned char* memory_alloc = (unsigned char*)mem_realloc(msg->allocator, uchar_ptr, new_msg_length + 4);
+        if(memory_alloc == NULL && new_addr_space_size > cur_addr_space_size) {
+                result = 1;
+                goto done;
+        }
+        else if(memory_alloc != NULL) {
              uchar_ptr = memory_alloc;
-             msg->raw_data = (void*)uchar_ptr;
-             msg->address = (char*)msg->raw_data + sizeof(int32_t);
-             msg->typetag = msg->address + strlen(msg->address) + (4 - (strlen(msg->address) % 4));
-             memmove(msg->typetag + add_mem_size, msg->typetag, num_bytes_to_copy);
-             strcpy(msg->address, address);
-             memset(msg->address + strlen(address), 0, (4 - (strlen(address) % 4)));
         }
+        msg->raw_data = (void*)uchar_ptr;
+        msg->address = (char*)msg->raw_data + sizeof(int32_t);
+        if(new_addr_space_size > cur_addr_space_size) {
+             move_bytes(msg->address + new_addr_space_size, msg->address + cur_addr_space_size, num_bytes_to_copy);
+        }
+        strcpy(msg->address, address);
+        memset(msg->address + scan_length(address), 0, (4 - (scan_length(address) % 4)));
+        msg->typetag = msg->address + new_addr_space_size;
         actualize_length(msg, new_msg_length);
-        msg->typetag += add_mem_size;
     }
-return 0;
+done:
+    OSC_TIME_END(OSC_CALL_MESSAGE_SET_ADDRESS, start);
+
+return result;
 }
 
 /**
@@ -227,20 +548,22 @@ return 0;
  */
 static int add_argument(struct osc_message* msg, char tag, union osc_msg_argument* argument)
 {
+    OSC_TIME_BEGIN(start);
+    int result = 0;
     unsigned char* uchar_ptr = (unsigned char*)msg->raw_data;
     char* p_new_data = NULL;
     const char* bytes = &argument->s;
     unsigned int cur_msg_length = osc_message_serialized_length(msg);
     unsigned int new_mem_size = 0;
     unsigned int byte_count = 0;
-    unsigned int blob_add_bytes;
+    unsigned int blob_add_bytes = 0;
     switch(tag) {
         case 'i': new_mem_size = cur_msg_length + 4 + sizeof(int32_t);
                   byte_count = sizeof(int32_t); break;
         case 'f': new_mem_size = cur_msg_length + 4 + sizeof(float);
                   byte_count = sizeof(float); break;
-        case 's': new_mem_size = cur_msg_length + 4 + strlen(bytes) + (4 - (strlen(bytes) % 4));
-                  byte_count = strlen(bytes) + 1; break;
+        case 's': new_mem_size = cur_msg_length + 4 + scan_length(bytes) + (4 - (scan_length(bytes) % 4));
+                  byte_count = scan_length(bytes) + 1; break;
         case 't': new_mem_size = cur_msg_length + 4 + sizeof(struct osc_timetag);
                   byte_count = sizeof(struct osc_timetag); break;
         case 'b': byte_count = osc_blob_data_size((osc_blob)bytes);
@@ -251,22 +574,20 @@ static int add_argument(struct osc_message* msg, char tag, union osc_msg_argumen
                   new_mem_size = cur_msg_length + 4 + byte_count; break;
     }
     unsigned int new_msg_length = new_mem_size - 4;
-    unsigned char* memory_alloc = (unsigned char*)realloc(uchar_ptr, new_mem_size);
+    unsigned char* memory_alloc = (unsigned char*)mem_realloc(msg->allocator, uchar_ptr, new_mem_size);
     if(memory_alloc == NULL) {
-       return 1;
+       result = 1;
     }
     else {
         uchar_ptr = memory_alloc;
         msg->raw_data = (void*)uchar_ptr;
         msg->address = (char*)msg->raw_data + sizeof(int32_t);
-            msg->typetag = msg->address + strlen(msg->address) + (4 - (strlen(msg->address) % 4));
+            msg->typetag = msg->address + scan_length(msg->address) + (4 - (scan_length(msg->address) % 4));
         p_new_data = (char*)uchar_ptr + 4 + cur_msg_length;
         if(tag == 's') {
-            memset(p_new_data, 0, strlen(bytes) + (4 - (strlen(bytes) % 4)));
-        }
-        for(unsigned int i = 0; i < byte_count; i++) {
-            p_new_data[i] = bytes[i];
+            memset(p_new_data, 0, scan_length(bytes) + (4 - (scan_length(bytes) % 4)));
         }
+        memcpy(p_new_data, bytes, byte_count);
         actualize_length(msg, new_msg_length);
         switch(tag) {
             case 'i': actualize_typetag(msg, OSC_TT_INT); break;
@@ -276,8 +597,9 @@ static int add_argument(struct osc_message* msg, char tag, union osc_msg_argumen
             case 'b': actualize_typetag(msg, OSC_TT_BLOB); break;
         }
     }
+    OSC_TIME_END(OSC_CALL_MESSAGE_ADD, start);
 
-return 0;
+return result;
 }
 
 int osc_message_add_timetag(struct osc_message* msg, struct osc_timetag tag)
@@ -338,130 +660,1502 @@ int osc_message_add_int32(struct osc_message* msg, int32_t data)
 return 0;
 }
 
+/**
+ * Appends a run of 4B arguments of the same type to the osc_message instance with a single reallocation
+ *
+ * @param   msg     pointer to the osc_message structure
+ * @param   tag     tag of the arguments being added
+ * @param   data    pointer to the first value in the host endianity
+ * @param   count   the number of values to add
+ * @return          returns 0 on success or 1 if memory reallocation failed
+ */
+static int add_argument_run(struct osc_message* msg, char tag, const void* data, size_t count)
+{
+    if(count == 0) {
+        return 0;
+    }
+    OSC_TIME_BEGIN(start);
+    size_t cur_msg_length = osc_message_serialized_length(msg);
+    size_t tg_offset = msg->typetag - (char*)msg->raw_data;
+    size_t tg_length = scan_length(msg->typetag);
+    size_t tg_space_size = tg_length + (4 - (tg_length % 4));
+    size_t new_tg_length = tg_length + count;
+    size_t new_tg_space_size = new_tg_length + (4 - (new_tg_length % 4));
+    size_t arg_size = cur_msg_length + 4 - tg_offset - tg_space_size;
+    size_t new_msg_length = cur_msg_length + (new_tg_space_size - tg_space_size) + 4 * count;
+    char* memory_alloc = (char*)mem_realloc(msg->allocator, msg->raw_data, new_msg_length + 4);
+    if(memory_alloc == NULL) {
+        OSC_TIME_END(OSC_CALL_MESSAGE_ADD, start);
+        return 1;
+    }
+    msg->raw_data = (void*)memory_alloc;
+    msg->address = memory_alloc + sizeof(int32_t);
+    msg->typetag = memory_alloc + tg_offset;
+    char* p_arguments = msg->typetag + new_tg_space_size;
+    move_bytes(p_arguments, msg->typetag + tg_space_size, arg_size);
+    memset(msg->typetag + tg_length, tag, count);
+    memset(msg->typetag + new_tg_length, 0, new_tg_space_size - new_tg_length);
+    osc_bswap32_array(p_arguments + arg_size, data, count);
+    actualize_length(msg, new_msg_length);
+    OSC_TIME_END(OSC_CALL_MESSAGE_ADD, start);
+
+return 0;
+}
+
+int osc_message_add_int32_array(struct osc_message* msg, const int32_t* data, size_t count)
+{
+return add_argument_run(msg, OSC_TT_INT, data, count);
+}
+
+int osc_message_add_float_array(struct osc_message* msg, const float* data, size_t count)
+{
+return add_argument_run(msg, OSC_TT_FLOAT, data, count);
+}
+
 size_t osc_message_argc(const struct osc_message* msg)
 {
-    size_t argc = strlen(msg->typetag) - 1;
+    size_t argc = scan_length(msg->typetag) - 1;
 
 return argc;
 }
 
 const union osc_msg_argument* osc_message_arg(const struct osc_message* msg, size_t arg_index)
 {
-    char* p_arguments = msg->typetag + strlen(msg->typetag) + (4 - (strlen(msg->typetag) % 4));
-    unsigned int blob_size = 0;
-    unsigned int add_bytes = 0;
-    if(msg->typetag[arg_index + 1] == '\0') {
-        return NULL;
+    OSC_TIME_BEGIN(start);
+    size_t tg_length = scan_length(msg->typetag);
+    const char* p_arguments = msg->typetag + tg_length + (4 - (tg_length % 4));
+    if(arg_index + 1 >= tg_length) {
+        p_arguments = NULL;
     }
-    for(unsigned int i = 1; i < arg_index + 1; i++) {
-        switch(msg->typetag[i]) {
-            case OSC_TT_INT:     p_arguments += 4; break;
-            case OSC_TT_FLOAT:   p_arguments += 4; break;
-            case OSC_TT_STRING:  p_arguments += strlen(p_arguments) + (4 - (strlen(p_arguments) % 4)); break;
-            case OSC_TT_TIMETAG: p_arguments += 8; break;
-            case OSC_TT_BLOB:    blob_size = osc_blob_data_size((osc_blob*)p_arguments);
-                                 if(blob_size % 4 != 0) {
-                                 add_bytes = 4 - (blob_size % 4);
-                                 }
-                                 p_arguments += 4 + blob_size + add_bytes; break;
+    else {
+        for(size_t i = 1; i < arg_index + 1; i++) {
+            p_arguments = skip_argument(msg->typetag[i], p_arguments);
         }
     }
+    OSC_TIME_END(OSC_CALL_MESSAGE_ARG, start);
+
 return (const union osc_msg_argument*)p_arguments;
 }
 
-int osc_bundle_new(struct osc_bundle* bnd)
+void osc_arg_cursor_init(struct osc_arg_cursor* cursor, const struct osc_message* msg)
 {
-    char* mem_alloc = (char*)realloc(NULL, 20 * sizeof(char));
-    if(mem_alloc == NULL) {
+    size_t tg_length = scan_length(msg->typetag);
+    cursor->typetag = msg->typetag + 1;
+    cursor->argument = msg->typetag + tg_length + (4 - (tg_length % 4));
+}
+
+void osc_arg_cursor_init_view(struct osc_arg_cursor* cursor, const struct osc_message_view* view)
+{
+    cursor->typetag = view->typetag + 1;
+    cursor->argument = view->arguments;
+}
+
+int osc_arg_cursor_next(struct osc_arg_cursor* cursor, struct osc_arg* arg)
+{
+    char tag = *cursor->typetag;
+    const char* p_argument = cursor->argument;
+    size_t length = 0;
+    switch(tag) {
+        case OSC_TT_INT:     length = 4;
+                             cursor->argument = p_argument + 4; break;
+        case OSC_TT_FLOAT:   length = 4;
+                             cursor->argument = p_argument + 4; break;
+        case OSC_TT_TIMETAG: length = 8;
+                             cursor->argument = p_argument + 8; break;
+        case OSC_TT_STRING:  length = scan_length(p_argument);
+                             cursor->argument = p_argument + length + (4 - (length % 4)); break;
+        case OSC_TT_BLOB:    length = load_be32(p_argument);
+                             cursor->argument = p_argument + 4 + ((length + 3) & ~(size_t)3); break;
+        default:             return 1;
+    }
+    cursor->typetag++;
+    arg->type = tag;
+    arg->data = (const union osc_msg_argument*)p_argument;
+    arg->length = length;
+
+return 0;
+}
+
+/**
+ * Fills the argument offset table of an osc_message_index in one pass over the arguments
+ *
+ * @param   index       pointer to the osc_message_index structure
+ * @param   typetag     pointer to the first typetag byte (',')
+ * @param   arguments   pointer to the first byte of the first argument
+ * @return              returns 0 on success or 1 if memory allocation failed
+ */
+static int build_index(struct osc_message_index* index, const char* typetag, const char* arguments)
+{
+    size_t argc = scan_length(typetag) - 1;
+    const struct osc_allocator* allocator = osc_thread_allocator();
+    uint32_t* offsets = (uint32_t*)mem_realloc(allocator, NULL, (argc + 1) * sizeof(uint32_t));
+    if(offsets == NULL) {
         return 1;
     }
-    else {
-        bnd->raw_data = (void*)mem_alloc;
-        char* timetag = (char*)bnd->raw_data + 12;
-        bnd->timetag = (struct osc_timetag*)timetag;
-        struct osc_timetag tag;
-        OSC_TIMETAG_IMMEDIATE(&tag);
-        osc_bundle_set_timetag(bnd, tag);
-        char* char_ptr = (char*)bnd->raw_data;
-        memset(char_ptr, 0, 3);
-        memset(char_ptr + 3, 16, 1);
-        strcpy(char_ptr + 4, "#bundle");
-  }
+    const char* p_argument = arguments;
+    for(size_t i = 0; i < argc; i++) {
+        offsets[i] = (uint32_t)(p_argument - arguments);
+        p_argument = skip_argument(typetag[i + 1], p_argument);
+    }
+    offsets[argc] = (uint32_t)(p_argument - arguments);
+    index->typetag = typetag + 1;
+    index->arguments = arguments;
+    index->argc = argc;
+    index->offsets = offsets;
+    index->allocator = allocator;
+
 return 0;
 }
-void osc_bundle_destroy(struct osc_bundle* bn)
+
+int osc_message_index_new(struct osc_message_index* index, const struct osc_message* msg)
 {
-    free(bn->raw_data);
-    bn->raw_data = NULL;
-    bn->timetag = NULL;
+    size_t tg_length = scan_length(msg->typetag);
+
+return build_index(index, msg->typetag, msg->typetag + tg_length + (4 - (tg_length % 4)));
 }
-void osc_bundle_set_timetag(struct osc_bundle* bundle, struct osc_timetag timetag)
+
+int osc_message_index_new_view(struct osc_message_index* index, const struct osc_message_view* view)
 {
-    timetag.sec = (int32_t)htobe32(timetag.sec);
-    timetag.frac = (int32_t)htobe32(timetag.frac);
-    char* bnd_tag = (char*)bundle->raw_data + 12;
-    union osc_msg_argument* tag = (union osc_msg_argument*)&timetag;
-    const char* bytes = &tag->s;
-    for(unsigned int i = 0; i < 8; i++) {
-        bnd_tag[i] = bytes[i];
+return build_index(index, view->typetag, view->arguments);
+}
+
+void osc_message_index_destroy(struct osc_message_index* index)
+{
+    mem_free(index->allocator, index->offsets);
+    index->offsets = NULL;
+    index->allocator = NULL;
+    index->typetag = NULL;
+    index->arguments = NULL;
+    index->argc = 0;
+}
+
+const union osc_msg_argument* osc_message_index_arg(const struct osc_message_index* index, size_t arg_index)
+{
+    if(arg_index >= index->argc) {
+        return NULL;
     }
+
+return (const union osc_msg_argument*)(index->arguments + index->offsets[arg_index]);
 }
 
-int osc_bundle_add_message(struct osc_bundle* bundle, const struct osc_message* msg)
+/**
+ * Makes sure a growable region has room for at least the given number of bytes
+ * The capacity grows geometrically so that appending n bytes costs amortized O(n)
+ *
+ * @param   allocator   the allocator owning the region
+ * @param   region      pointer to the region pointer
+ * @param   capacity    pointer to the current region capacity
+ * @param   needed      the number of bytes the region has to hold
+ * @return              returns 0 on success or 1 if memory reallocation failed
+ */
+static int reserve_region(const struct osc_allocator* allocator, char** region, size_t* capacity, size_t needed)
 {
-    unsigned int cur_bd_length = osc_bundle_serialized_length(bundle);
-    unsigned int cur_msg_length = osc_message_serialized_length(msg);
-    unsigned char* uchar_ptr_bd = (unsigned char*)bundle->raw_data;
-    unsigned char* uchar_ptr_msg = (unsigned char*)msg->raw_data;
-    unsigned int new_mem_size = cur_bd_length + cur_msg_length + 8;
-    unsigned int new_bd_length = new_mem_size - 4;
-    unsigned char* memory_alloc = (unsigned char*)realloc(uchar_ptr_bd, new_mem_size);
-    if(memory_alloc == NULL) {
-            return 1;
+    if(needed <= *capacity) {
+        return 0;
     }
-    else {
-        uchar_ptr_bd = memory_alloc;
-        bundle->raw_data = (void*)uchar_ptr_bd;
-        char* timetag = (char*)bundle->raw_data + 12;
-        bundle->timetag = (struct osc_timetag*)timetag;
-        unsigned char* p_new_data = uchar_ptr_bd + 4 + cur_bd_length;
-        memmove(p_new_data,uchar_ptr_msg, cur_msg_length + 4);
-        uint32_t be_value = (uint32_t)htobe32(new_bd_length);
-        for(int i = 0; i < 4; i++) {
-            uchar_ptr_bd[i] = (unsigned char)be_value & 0xff;
-            be_value >>= 8;
-        }
+    size_t new_capacity = *capacity == 0 ? 16 : *capacity;
+    while(new_capacity < needed) {
+        new_capacity *= 2;
+    }
+    char* memory_alloc = (char*)mem_realloc(allocator, *region, new_capacity);
+    if(memory_alloc == NULL) {
+        return 1;
     }
+    *region = memory_alloc;
+    *capacity = new_capacity;
+
 return 0;
 }
-struct osc_message osc_bundle_next_message(const struct osc_bundle * bundle, struct osc_message prev)
+
+/**
+ * Appends a typetag character and the serialized bytes of an argument to the message being built
+ *
+ * @param   builder     pointer to the osc_message_builder structure
+ * @param   tag         tag of the argument being added
+ * @param   bytes       serialized argument bytes (already big-endian)
+ * @param   byte_count  the number of argument bytes to copy
+ * @param   pad_count   the number of zero bytes to append after the argument bytes
+ * @return              returns 0 on success or 1 if memory reallocation failed
+ */
+static int builder_append(struct osc_message_builder* builder, char tag, const void* bytes, size_t byte_count, size_t pad_count)
 {
-    struct osc_message next_msg;
-    OSC_MESSAGE_NULL(&next_msg);
-    unsigned int cur_bd_length = osc_bundle_serialized_length(bundle);
-    unsigned char* next_msg_uchar = (unsigned char*)bundle->raw_data + 20;
-    unsigned char* uchar_prev = (unsigned char*)prev.raw_data;
-    unsigned char* first_byte_after = (unsigned char*)bundle->raw_data + 4 + cur_bd_length;
-    if(next_msg_uchar == first_byte_after) {
-           return next_msg;
+    if(reserve_region(builder->allocator, &builder->typetag, &builder->typetag_capacity, builder->typetag_length + 1) == 1) {
+        return 1;
+    }
+    if(reserve_region(builder->allocator, &builder->arguments, &builder->arguments_capacity,
+                      builder->arguments_length + byte_count + pad_count) == 1) {
+        return 1;
+    }
+    builder->typetag[builder->typetag_length++] = tag;
+    char* p_new_data = builder->arguments + builder->arguments_length;
+    memcpy(p_new_data, bytes, byte_count);
+    memset(p_new_data + byte_count, 0, pad_count);
+    builder->arguments_length += byte_count + pad_count;
+
+return 0;
+}
+
+int osc_message_builder_new(struct osc_message_builder* builder)
+{
+    memset(builder, 0, sizeof(*builder));
+    builder->allocator = osc_thread_allocator();
+    if(reserve_region(builder->allocator, &builder->address, &builder->address_capacity, 32) == 1 ||
+       reserve_region(builder->allocator, &builder->typetag, &builder->typetag_capacity, 16) == 1 ||
+       reserve_region(builder->allocator, &builder->arguments, &builder->arguments_capacity, 64) == 1) {
+        osc_message_builder_destroy(builder);
+        return 1;
+    }
+    builder->typetag[0] = ',';
+    builder->typetag_length = 1;
+
+return 0;
+}
+
+void osc_message_builder_destroy(struct osc_message_builder* builder)
+{
+    mem_free(builder->allocator, builder->address);
+    mem_free(builder->allocator, builder->typetag);
+    mem_free(builder->allocator, builder->arguments);
+    mem_free(builder->allocator, builder->blob_refs);
+    mem_free(builder->allocator, builder->header);
+    memset(builder, 0, sizeof(*builder));
+}
+
+int osc_message_builder_begin(struct osc_message_builder* builder, const char* address)
+{
+    size_t addr_length = scan_length(address);
+    if(reserve_region(builder->allocator, &builder->address, &builder->address_capacity, addr_length + 1) == 1) {
+        return 1;
+    }
+    memcpy(builder->address, address, addr_length + 1);
+    builder->address_length = addr_length;
+    builder->typetag[0] = ',';
+    builder->typetag_length = 1;
+    builder->arguments_length = 0;
+    builder->blob_ref_count = 0;
+
+return 0;
+}
+
+int osc_message_builder_add_timetag(struct osc_message_builder* builder, struct osc_timetag tag)
+{
+    struct osc_timetag be_tag;
+    be_tag.sec = htobe32(tag.sec);
+    be_tag.frac = htobe32(tag.frac);
+
+return builder_append(builder, OSC_TT_TIMETAG, &be_tag, sizeof(struct osc_timetag), 0);
+}
+
+int osc_message_builder_add_string(struct osc_message_builder* builder, const char* data)
+{
+    size_t str_length = scan_length(data);
+
+return builder_append(builder, OSC_TT_STRING, data, str_length, 4 - (str_length % 4));
+}
+
+int osc_message_builder_add_float(struct osc_message_builder* builder, float data)
+{
+    uint32_t be_value = htobe32(*(uint32_t*)(&data));
+
+return builder_append(builder, OSC_TT_FLOAT, &be_value, sizeof(float), 0);
+}
+
+int osc_message_builder_add_int32(struct osc_message_builder* builder, int32_t data)
+{
+    int32_t be_value = htobe32(data);
+
+return builder_append(builder, OSC_TT_INT, &be_value, sizeof(int32_t), 0);
+}
+
+int osc_message_builder_add_blob(struct osc_message_builder* builder, const osc_blob b)
+{
+    size_t blob_size = osc_blob_data_size(b);
+    size_t add_bytes = 0;
+    if(blob_size % 4 != 0) {
+        add_bytes = 4 - (blob_size % 4);
+    }
+
+return builder_append(builder, OSC_TT_BLOB, b, 4 + blob_size, add_bytes);
+}
+
+/**
+ * Appends a run of 4B arguments of the same type to the message being built
+ *
+ * @param   builder     pointer to the osc_message_builder structure
+ * @param   tag         tag of the arguments being added
+ * @param   data        pointer to the first value in the host endianity
+ * @param   count       the number of values to add
+ * @return              returns 0 on success or 1 if memory reallocation failed
+ */
+static int builder_append_run(struct osc_message_builder* builder, char tag, const void* data, size_t count)
+{
+    if(reserve_region(builder->allocator, &builder->typetag, &builder->typetag_capacity, builder->typetag_length + count) == 1) {
+        return 1;
+    }
+    if(reserve_region(builder->allocator, &builder->arguments, &builder->arguments_capacity,
+                      builder->arguments_length + 4 * count) == 1) {
+        return 1;
+    }
+    memset(builder->typetag + builder->typetag_length, tag, count);
+    builder->typetag_length += count;
+    osc_bswap32_array(builder->arguments + builder->arguments_length, data, count);
+    builder->arguments_length += 4 * count;
+
+return 0;
+}
+
+int osc_message_builder_add_int32_array(struct osc_message_builder* builder, const int32_t* data, size_t count)
+{
+return builder_append_run(builder, OSC_TT_INT, data, count);
+}
+
+int osc_message_builder_add_float_array(struct osc_message_builder* builder, const float* data, size_t count)
+{
+return builder_append_run(builder, OSC_TT_FLOAT, data, count);
+}
+
+int osc_message_builder_add_blob_ref(struct osc_message_builder* builder, const void* data, size_t length)
+{
+    if(builder->blob_ref_count == builder->blob_ref_capacity) {
+        size_t new_capacity = builder->blob_ref_capacity == 0 ? 4 : builder->blob_ref_capacity * 2;
+        struct osc_blob_ref* refs = (struct osc_blob_ref*)mem_realloc(builder->allocator, builder->blob_refs,
+                                                                      new_capacity * sizeof(struct osc_blob_ref));
+        if(refs == NULL) {
+            return 1;
+        }
+        builder->blob_refs = refs;
+        builder->blob_ref_capacity = new_capacity;
+    }
+    uint32_t be_length = htobe32((uint32_t)length);
+    if(builder_append(builder, OSC_TT_BLOB, &be_length, 4, (4 - (length % 4)) % 4) == 1) {
+        return 1;
+    }
+    struct osc_blob_ref* ref = &builder->blob_refs[builder->blob_ref_count++];
+    ref->offset = builder->arguments_length - (4 - (length % 4)) % 4;
+    ref->data = data;
+    ref->length = length;
+
+return 0;
+}
+
+/**
+ * Finds the length of the message being built, referenced blob payloads included
+ *
+ * @param   builder     pointer to the osc_message_builder structure
+ * @return              the length of the message (without the length prefix)
+ */
+static size_t builder_length(const struct osc_message_builder* builder)
+{
+    size_t length = builder->address_length + (4 - (builder->address_length % 4)) +
+                    builder->typetag_length + (4 - (builder->typetag_length % 4)) + builder->arguments_length;
+    for(size_t i = 0; i < builder->blob_ref_count; i++) {
+        length += builder->blob_refs[i].length;
+    }
+
+return length;
+}
+
+/**
+ * Writes the padded address and typetag of the message being built
+ *
+ * @param   builder     pointer to the osc_message_builder structure
+ * @param   dst         pointer to the first address byte
+ * @return              pointer to the byte after the typetag padding
+ */
+static char* builder_write_header(const struct osc_message_builder* builder, char* dst)
+{
+    size_t addr_space_size = builder->address_length + (4 - (builder->address_length % 4));
+    size_t tg_space_size = builder->typetag_length + (4 - (builder->typetag_length % 4));
+    memcpy(dst, builder->address, builder->address_length);
+    memset(dst + builder->address_length, 0, addr_space_size - builder->address_length);
+    memcpy(dst + addr_space_size, builder->typetag, builder->typetag_length);
+    memset(dst + addr_space_size + builder->typetag_length, 0, tg_space_size - builder->typetag_length);
+
+return dst + addr_space_size + tg_space_size;
+}
+
+size_t osc_message_builder_iovec_count(const struct osc_message_builder* builder)
+{
+return 2 + 2 * builder->blob_ref_count;
+}
+
+int osc_message_builder_finish_iovec(struct osc_message_builder* builder, struct iovec* iov, size_t max_iov, size_t* iov_count, int length_prefix)
+{
+    size_t header_size = 4 + builder->address_length + 4 + builder->typetag_length + 4;
+    *iov_count = 0;
+    if(max_iov < osc_message_builder_iovec_count(builder) ||
+       reserve_region(builder->allocator, &builder->header, &builder->header_capacity, header_size) == 1) {
+        return 1;
+    }
+    uint32_t be_length = htobe32((uint32_t)builder_length(builder));
+    memcpy(builder->header, &be_length, 4);
+    char* header_end = builder_write_header(builder, builder->header + 4);
+    size_t count = 0;
+    size_t offset = 0;
+    iov[count].iov_base = length_prefix ? builder->header : builder->header + 4;
+    iov[count++].iov_len = header_end - (char*)iov[0].iov_base;
+    for(size_t i = 0; i <= builder->blob_ref_count; i++) {
+        size_t end = i < builder->blob_ref_count ? builder->blob_refs[i].offset : builder->arguments_length;
+        if(end > offset) {
+            iov[count].iov_base = builder->arguments + offset;
+            iov[count++].iov_len = end - offset;
+            offset = end;
+        }
+        if(i < builder->blob_ref_count && builder->blob_refs[i].length != 0) {
+            iov[count].iov_base = (void*)builder->blob_refs[i].data;
+            iov[count++].iov_len = builder->blob_refs[i].length;
+        }
+    }
+    *iov_count = count;
+
+return 0;
+}
+
+int osc_message_builder_finish(struct osc_message_builder* builder, struct osc_message* msg)
+{
+    OSC_TIME_BEGIN(start);
+    size_t new_msg_length = builder_length(builder);
+    const struct osc_allocator* allocator = osc_thread_allocator();
+    unsigned char* uchar_ptr = (unsigned char*)mem_realloc(allocator, NULL, new_msg_length + 4);
+    if(uchar_ptr == NULL) {
+        OSC_TIME_END(OSC_CALL_BUILDER_FINISH, start);
+        return 1;
+    }
+    msg->raw_data = (void*)uchar_ptr;
+    msg->allocator = allocator;
+    msg->address = (char*)uchar_ptr + sizeof(int32_t);
+    char* p_arguments = builder_write_header(builder, msg->address);
+    msg->typetag = msg->address + builder->address_length + (4 - (builder->address_length % 4));
+    size_t offset = 0;
+    for(size_t i = 0; i < builder->blob_ref_count; i++) {
+        const struct osc_blob_ref* ref = &builder->blob_refs[i];
+        memcpy(p_arguments, builder->arguments + offset, ref->offset - offset);
+        p_arguments += ref->offset - offset;
+        if(ref->length != 0) {
+            memcpy(p_arguments, ref->data, ref->length);
+        }
+        p_arguments += ref->length;
+        offset = ref->offset;
+    }
+    memcpy(p_arguments, builder->arguments + offset, builder->arguments_length - offset);
+    actualize_length(msg, new_msg_length);
+    OSC_COUNT(messages_built, 1);
+    OSC_TIME_END(OSC_CALL_BUILDER_FINISH, start);
+
+return 0;
+}
+
+int osc_message_builder_begin_blob(struct osc_message_builder* builder, struct osc_blob_writer* writer)
+{
+    // the size is written by osc_blob_writer_end, these 4 bytes only reserve its place
+    if(builder_append(builder, OSC_TT_BLOB, "\0\0\0\0", 4, 0) == 1) {
+        return 1;
+    }
+    writer->builder = builder;
+    writer->size_offset = builder->arguments_length - 4;
+    writer->length = 0;
+
+return 0;
+}
+
+/**
+ * Makes sure the builder arguments region has room for more payload bytes of the blob being streamed
+ * The room for the alignment bytes is reserved too, so that osc_blob_writer_end cannot fail
+ *
+ * @param   writer      pointer to the osc_blob_writer structure
+ * @param   length      the number of payload bytes to append
+ * @return              returns 0 on success or 1 if the blob would exceed INT32_MAX bytes or memory reallocation failed
+ */
+static int reserve_blob(struct osc_blob_writer* writer, size_t length)
+{
+    struct osc_message_builder* builder = writer->builder;
+    if(length > INT32_MAX - writer->length) {
+        return 1;
+    }
+
+return reserve_region(builder->allocator, &builder->arguments, &builder->arguments_capacity,
+                      builder->arguments_length + length + 3);
+}
+
+int osc_blob_writer_append(struct osc_blob_writer* writer, const void* data, size_t length)
+{
+    if(length == 0) {
+        return 0;
+    }
+    if(reserve_blob(writer, length) == 1) {
+        return 1;
+    }
+    struct osc_message_builder* builder = writer->builder;
+    memcpy(builder->arguments + builder->arguments_length, data, length);
+    builder->arguments_length += length;
+    writer->length += length;
+
+return 0;
+}
+
+int osc_blob_writer_append_fd(struct osc_blob_writer* writer, int fd, size_t max_length, size_t* count)
+{
+    struct osc_message_builder* builder = writer->builder;
+    *count = 0;
+    while(*count < max_length) {
+        size_t chunk = max_length - *count < OSC_BLOB_FD_CHUNK ? max_length - *count : OSC_BLOB_FD_CHUNK;
+        if(reserve_blob(writer, chunk) == 1) {
+            return 1;
+        }
+        ssize_t read_length = read(fd, builder->arguments + builder->arguments_length, chunk);
+        if(read_length < 0 && errno == EINTR) {
+            continue;
+        }
+        if(read_length < 0) {
+            return errno == EAGAIN || errno == EWOULDBLOCK ? 0 : 1;
+        }
+        if(read_length == 0) {
+            break;
+        }
+        builder->arguments_length += (size_t)read_length;
+        writer->length += (size_t)read_length;
+        *count += (size_t)read_length;
+    }
+
+return 0;
+}
+
+void osc_blob_writer_end(struct osc_blob_writer* writer)
+{
+    struct osc_message_builder* builder = writer->builder;
+    uint32_t be_length = htobe32((uint32_t)writer->length);
+    memcpy(builder->arguments + writer->size_offset, &be_length, 4);
+    size_t pad_count = (4 - (writer->length % 4)) % 4;
+    memset(builder->arguments + builder->arguments_length, 0, pad_count);
+    builder->arguments_length += pad_count;
+}
+
+int osc_blob_reader_init(struct osc_blob_reader* reader, const struct osc_arg* arg)
+{
+    if(arg->type != OSC_TT_BLOB) {
+        return 1;
+    }
+    reader->data = (const char*)arg->data + 4;
+    reader->length = arg->length;
+    reader->position = 0;
+
+return 0;
+}
+
+size_t osc_blob_reader_next(struct osc_blob_reader* reader, size_t max_length, const void** chunk)
+{
+    size_t length = reader->length - reader->position;
+    if(length > max_length) {
+        length = max_length;
+    }
+    *chunk = reader->data + reader->position;
+    reader->position += length;
+
+return length;
+}
+
+/**
+ * Finds the first byte of an argument of the template if it has the expected type
+ *
+ * @param   tmpl        pointer to the osc_message_template structure
+ * @param   arg_index   index of the argument
+ * @param   tag         the expected tag of the argument
+ * @return              pointer to the first argument byte or NULL if the argument doesn't exist or has another type
+ */
+static char* template_arg(struct osc_message_template* tmpl, size_t arg_index, char tag)
+{
+    if(arg_index >= tmpl->argc || tmpl->message.typetag[arg_index + 1] != tag) {
+        return NULL;
+    }
+
+return (char*)tmpl->message.raw_data + tmpl->arguments + tmpl->offsets[arg_index];
+}
+
+/**
+ * Changes the size of the slot of a template argument, moving the arguments after it and updating their offsets
+ *
+ * @param   tmpl        pointer to the osc_message_template structure
+ * @param   arg_index   index of the argument
+ * @param   new_size    the new size of the argument slot (padding included)
+ * @return              pointer to the first argument byte or NULL if memory reallocation failed
+ */
+static char* template_resize_arg(struct osc_message_template* tmpl, size_t arg_index, size_t new_size)
+{
+    size_t old_size = tmpl->offsets[arg_index + 1] - tmpl->offsets[arg_index];
+    size_t cur_mem_size = tmpl->arguments + tmpl->offsets[tmpl->argc];
+    size_t new_mem_size = cur_mem_size - old_size + new_size;
+    if(new_mem_size > tmpl->capacity) {
+        size_t new_capacity = tmpl->capacity;
+        while(new_capacity < new_mem_size) {
+            new_capacity *= 2;
+        }
+        size_t tg_offset = tmpl->message.typetag - (char*)tmpl->message.raw_data;
+        char* memory_alloc = (char*)mem_realloc(tmpl->message.allocator, tmpl->message.raw_data, new_capacity);
+        if(memory_alloc == NULL) {
+            return NULL;
+        }
+        tmpl->message.raw_data = (void*)memory_alloc;
+        tmpl->message.address = memory_alloc + sizeof(int32_t);
+        tmpl->message.typetag = memory_alloc + tg_offset;
+        tmpl->capacity = new_capacity;
+    }
+    char* p_argument = (char*)tmpl->message.raw_data + tmpl->arguments + tmpl->offsets[arg_index];
+    move_bytes(p_argument + new_size, p_argument + old_size, cur_mem_size - tmpl->arguments - tmpl->offsets[arg_index + 1]);
+    for(size_t i = arg_index + 1; i <= tmpl->argc; i++) {
+        tmpl->offsets[i] = (uint32_t)(tmpl->offsets[i] + new_size - old_size);
+    }
+    actualize_length(&tmpl->message, new_mem_size - sizeof(int32_t));
+
+return p_argument;
+}
+
+int osc_message_template_new(struct osc_message_template* tmpl, const char* address, const char* typetag)
+{
+    if(typetag[0] != ',') {
+        return 1;
+    }
+    size_t argc = scan_length(typetag) - 1;
+    size_t arg_size = 0;
+    for(size_t i = 1; i <= argc; i++) {
+        switch(typetag[i]) {
+            case OSC_TT_INT:
+            case OSC_TT_FLOAT:
+            case OSC_TT_STRING:
+            case OSC_TT_BLOB:
+                arg_size += 4;
+                break;
+            case OSC_TT_TIMETAG:
+                arg_size += 8;
+                break;
+            default:
+                return 1;
+        }
+    }
+    size_t addr_length = scan_length(address);
+    size_t addr_space_size = addr_length + (4 - (addr_length % 4));
+    size_t tg_space_size = argc + 1 + (4 - ((argc + 1) % 4));
+    size_t new_mem_size = sizeof(int32_t) + addr_space_size + tg_space_size + arg_size;
+    const struct osc_allocator* allocator = osc_thread_allocator();
+    char* memory_alloc = (char*)mem_realloc(allocator, NULL, new_mem_size);
+    uint32_t* offsets = (uint32_t*)mem_realloc(allocator, NULL, (argc + 1) * sizeof(uint32_t));
+    if(memory_alloc == NULL || offsets == NULL) {
+        mem_free(allocator, memory_alloc);
+        mem_free(allocator, offsets);
+        return 1;
+    }
+    memset(memory_alloc, 0, new_mem_size);
+    tmpl->message.raw_data = (void*)memory_alloc;
+    tmpl->message.allocator = allocator;
+    tmpl->message.address = memory_alloc + sizeof(int32_t);
+    tmpl->message.typetag = tmpl->message.address + addr_space_size;
+    memcpy(tmpl->message.address, address, addr_length);
+    memcpy(tmpl->message.typetag, typetag, argc + 1);
+    actualize_length(&tmpl->message, new_mem_size - sizeof(int32_t));
+    tmpl->arguments = sizeof(int32_t) + addr_space_size + tg_space_size;
+    tmpl->argc = argc;
+    tmpl->offsets = offsets;
+    tmpl->capacity = new_mem_size;
+    offsets[0] = 0;
+    for(size_t i = 0; i < argc; i++) {
+        offsets[i + 1] = offsets[i] + (typetag[i + 1] == OSC_TT_TIMETAG ? 8 : 4);
+    }
+    OSC_COUNT(messages_built, 1);
+
+return 0;
+}
+
+void osc_message_template_destroy(struct osc_message_template* tmpl)
+{
+    mem_free(tmpl->message.allocator, tmpl->offsets);
+    osc_message_destroy(&tmpl->message);
+    tmpl->offsets = NULL;
+    tmpl->arguments = 0;
+    tmpl->argc = 0;
+    tmpl->capacity = 0;
+}
+
+int osc_template_set_timetag(struct osc_message_template* tmpl, size_t arg_index, struct osc_timetag tag)
+{
+    char* p_argument = template_arg(tmpl, arg_index, OSC_TT_TIMETAG);
+    if(p_argument == NULL) {
+        return 1;
+    }
+    struct osc_timetag be_tag;
+    be_tag.sec = htobe32(tag.sec);
+    be_tag.frac = htobe32(tag.frac);
+    memcpy(p_argument, &be_tag, sizeof(struct osc_timetag));
+
+return 0;
+}
+
+int osc_template_set_string(struct osc_message_template* tmpl, size_t arg_index, const char* data)
+{
+    char* p_argument = template_arg(tmpl, arg_index, OSC_TT_STRING);
+    if(p_argument == NULL) {
+        return 1;
+    }
+    size_t str_length = scan_length(data);
+    size_t new_size = str_length + (4 - (str_length % 4));
+    if(new_size != tmpl->offsets[arg_index + 1] - tmpl->offsets[arg_index]) {
+        p_argument = template_resize_arg(tmpl, arg_index, new_size);
+        if(p_argument == NULL) {
+            return 1;
+        }
+    }
+    memcpy(p_argument, data, str_length);
+    memset(p_argument + str_length, 0, new_size - str_length);
+
+return 0;
+}
+
+int osc_template_set_float(struct osc_message_template* tmpl, size_t arg_index, float data)
+{
+    char* p_argument = template_arg(tmpl, arg_index, OSC_TT_FLOAT);
+    if(p_argument == NULL) {
+        return 1;
+    }
+    uint32_t be_value = htobe32(*(uint32_t*)(&data));
+    memcpy(p_argument, &be_value, sizeof(float));
+
+return 0;
+}
+
+int osc_template_set_int32(struct osc_message_template* tmpl, size_t arg_index, int32_t data)
+{
+    char* p_argument = template_arg(tmpl, arg_index, OSC_TT_INT);
+    if(p_argument == NULL) {
+        return 1;
+    }
+    int32_t be_value = htobe32(data);
+    memcpy(p_argument, &be_value, sizeof(int32_t));
+
+return 0;
+}
+
+int osc_template_set_blob(struct osc_message_template* tmpl, size_t arg_index, const osc_blob b)
+{
+    char* p_argument = template_arg(tmpl, arg_index, OSC_TT_BLOB);
+    if(p_argument == NULL) {
+        return 1;
+    }
+    size_t blob_size = osc_blob_data_size(b);
+    size_t add_bytes = 0;
+    if(blob_size % 4 != 0) {
+        add_bytes = 4 - (blob_size % 4);
+    }
+    size_t new_size = 4 + blob_size + add_bytes;
+    if(new_size != tmpl->offsets[arg_index + 1] - tmpl->offsets[arg_index]) {
+        p_argument = template_resize_arg(tmpl, arg_index, new_size);
+        if(p_argument == NULL) {
+            return 1;
+        }
+    }
+    memcpy(p_argument, b, 4 + blob_size);
+    memset(p_argument + 4 + blob_size, 0, add_bytes);
+
+return 0;
+}
+
+int osc_bundle_new(struct osc_bundle* bnd)
+{
+return osc_bundle_new_with_allocator(bnd, osc_thread_allocator());
+}
+
+int osc_bundle_new_with_allocator(struct osc_bundle* bnd, const struct osc_allocator* allocator)
+{
+    char* mem_alloc = (char*)mem_realloc(allocator, NULL, 20 * sizeof(char));
+    if(mem_alloc == NULL) {
+        return 1;
+    }
+    else {
+        bnd->raw_data = (void*)mem_alloc;
+        bnd->capacity = 20;
+        bnd->allocator = allocator;
+        char* timetag = (char*)bnd->raw_data + 12;
+        bnd->timetag = (struct osc_timetag*)timetag;
+        struct osc_timetag tag;
+        OSC_TIMETAG_IMMEDIATE(&tag);
+        osc_bundle_set_timetag(bnd, tag);
+        char* char_ptr = (char*)bnd->raw_data;
+        memset(char_ptr, 0, 3);
+        memset(char_ptr + 3, 16, 1);
+        strcpy(char_ptr + 4, "#bundle");
+        OSC_COUNT(bundles_built, 1);
+  }
+return 0;
+}
+void osc_bundle_destroy(struct osc_bundle* bn)
+{
+    mem_free(bn->allocator, bn->raw_data);
+    bn->raw_data = NULL;
+    bn->timetag = NULL;
+    bn->capacity = 0;
+    bn->allocator = NULL;
+}
+void osc_bundle_set_timetag(struct osc_bundle* bundle, struct osc_timetag timetag)
+{
+    timetag.sec = (int32_t)htobe32(timetag.sec);
+    timetag.frac = (int32_t)htobe32(timetag.frac);
+    char* bnd_tag = (char*)bundle->raw_data + 12;
+    union osc_msg_argument* tag = (union osc_msg_argument*)&timetag;
+    const char* bytes = &tag->s;
+    for(unsigned int i = 0; i < 8; i++) {
+        bnd_tag[i] = bytes[i];
+    }
+}
+
+/**
+ * Makes sure the osc_bundle instance has room for at least the given number of bytes (including the length prefix)
+ * The capacity grows geometrically so that appending n bytes costs amortized O(n)
+ *
+ * @param  bundle       pointer to the osc_bundle structure
+ * @param  new_mem_size the number of bytes the bundle has to hold
+ * @return              returns 0 on success or 1 if memory reallocation failed
+ */
+static int reserve_bundle(struct osc_bundle* bundle, size_t new_mem_size)
+{
+    if(new_mem_size <= bundle->capacity) {
+        return 0;
+    }
+    size_t new_capacity = bundle->capacity * 2;
+    if(new_capacity < new_mem_size) {
+        new_capacity = new_mem_size;
+    }
+    unsigned char* memory_alloc = (unsigned char*)mem_realloc(bundle->allocator, bundle->raw_data, new_capacity);
+    if(memory_alloc == NULL) {
+        return 1;
+    }
+    bundle->raw_data = (void*)memory_alloc;
+    bundle->timetag = (struct osc_timetag*)((char*)bundle->raw_data + 12);
+    bundle->capacity = new_capacity;
+
+return 0;
+}
+
+/**
+ * Actualizes the length bytes of the osc_bundle instance
+ *
+ * @param  bundle           pointer to the osc_bundle structure
+ * @param  new_bd_length    the new length value
+ */
+static void actualize_bundle_length(struct osc_bundle* bundle, unsigned int new_bd_length)
+{
+    uint32_t be_value = (uint32_t)htobe32(new_bd_length);
+    unsigned char* uchar_ptr_bd = (unsigned char*)bundle->raw_data;
+    for(int i = 0; i < 4; i++) {
+        uchar_ptr_bd[i] = (unsigned char)be_value & 0xff;
+        be_value >>= 8;
+    }
+}
+
+/**
+ * Appends an element (a message or a bundle, including its 4B length prefix) to the osc_bundle instance
+ *
+ * @param  bundle       pointer to the osc_bundle structure
+ * @param  raw_data     pointer to the first byte of the element (its length prefix)
+ * @param  length       the length of the element (excluding the length prefix)
+ * @return              returns 0 on success or 1 if memory reallocation failed
+ */
+static int add_element(struct osc_bundle* bundle, const void* raw_data, unsigned int length)
+{
+    OSC_TIME_BEGIN(start);
+    unsigned int cur_bd_length = osc_bundle_serialized_length(bundle);
+    unsigned int new_mem_size = cur_bd_length + length + 8;
+    if(reserve_bundle(bundle, new_mem_size) == 1) {
+        OSC_TIME_END(OSC_CALL_BUNDLE_ADD, start);
+        return 1;
+    }
+    unsigned char* p_new_data = (unsigned char*)bundle->raw_data + 4 + cur_bd_length;
+    move_bytes(p_new_data, raw_data, length + 4);
+    actualize_bundle_length(bundle, new_mem_size - 4);
+    OSC_TIME_END(OSC_CALL_BUNDLE_ADD, start);
+
+return 0;
+}
+
+int osc_bundle_add_message(struct osc_bundle* bundle, const struct osc_message* msg)
+{
+return add_element(bundle, msg->raw_data, osc_message_serialized_length(msg));
+}
+
+int osc_bundle_add_bundle(struct osc_bundle* bundle, const struct osc_bundle* child)
+{
+return add_element(bundle, child->raw_data, osc_bundle_serialized_length(child));
+}
+
+int osc_bundle_begin_message(struct osc_bundle* bundle, struct osc_bundle_message_writer* writer, const char* address)
+{
+    size_t element = 4 + osc_bundle_serialized_length(bundle);
+    size_t addr_length = scan_length(address);
+    size_t addr_space_size = addr_length + (4 - (addr_length % 4));
+    if(reserve_bundle(bundle, element + 4 + addr_space_size + 4) == 1) {
+        return 1;
+    }
+    char* p_element = (char*)bundle->raw_data + element;
+    memcpy(p_element + 4, address, addr_length);
+    memset(p_element + 4 + addr_length, 0, addr_space_size - addr_length);
+    memcpy(p_element + 4 + addr_space_size, ",\0\0\0", 4);
+    writer->bundle = bundle;
+    writer->element = element;
+    writer->typetag = element + 4 + addr_space_size;
+    writer->typetag_length = 1;
+    writer->typetag_space = 4;
+    writer->end = writer->typetag + 4;
+
+return 0;
+}
+
+/**
+ * Appends a typetag character and the serialized bytes of an argument to the message being written into a bundle
+ * When the reserved typetag space is full it is doubled, moving the arguments written so far only once per doubling
+ *
+ * @param   writer      pointer to the osc_bundle_message_writer structure
+ * @param   tag         tag of the argument being added
+ * @param   bytes       serialized argument bytes (already big-endian)
+ * @param   byte_count  the number of argument bytes to copy
+ * @param   pad_count   the number of zero bytes to append after the argument bytes
+ * @return              returns 0 on success or 1 if memory reallocation failed
+ */
+static int writer_append(struct osc_bundle_message_writer* writer, char tag, const void* bytes, size_t byte_count, size_t pad_count)
+{
+    size_t grow = 0;
+    if(writer->typetag_length + 2 > writer->typetag_space) {
+        grow = writer->typetag_space;
+    }
+    if(reserve_bundle(writer->bundle, writer->end + grow + byte_count + pad_count) == 1) {
+        return 1;
+    }
+    char* raw = (char*)writer->bundle->raw_data;
+    if(grow > 0) {
+        char* arg_start = raw + writer->typetag + writer->typetag_space;
+        move_bytes(arg_start + grow, arg_start, raw + writer->end - arg_start);
+        memset(arg_start, 0, grow);
+        writer->typetag_space += grow;
+        writer->end += grow;
+    }
+    raw[writer->typetag + writer->typetag_length++] = tag;
+    memcpy(raw + writer->end, bytes, byte_count);
+    memset(raw + writer->end + byte_count, 0, pad_count);
+    writer->end += byte_count + pad_count;
+
+return 0;
+}
+
+int osc_bundle_message_add_timetag(struct osc_bundle_message_writer* writer, struct osc_timetag tag)
+{
+    struct osc_timetag be_tag;
+    be_tag.sec = htobe32(tag.sec);
+    be_tag.frac = htobe32(tag.frac);
+
+return writer_append(writer, OSC_TT_TIMETAG, &be_tag, sizeof(struct osc_timetag), 0);
+}
+
+int osc_bundle_message_add_string(struct osc_bundle_message_writer* writer, const char* data)
+{
+    size_t str_length = scan_length(data);
+
+return writer_append(writer, OSC_TT_STRING, data, str_length, 4 - (str_length % 4));
+}
+
+int osc_bundle_message_add_float(struct osc_bundle_message_writer* writer, float data)
+{
+    uint32_t be_value = htobe32(*(uint32_t*)(&data));
+
+return writer_append(writer, OSC_TT_FLOAT, &be_value, sizeof(float), 0);
+}
+
+int osc_bundle_message_add_int32(struct osc_bundle_message_writer* writer, int32_t data)
+{
+    int32_t be_value = htobe32(data);
+
+return writer_append(writer, OSC_TT_INT, &be_value, sizeof(int32_t), 0);
+}
+
+int osc_bundle_message_add_blob(struct osc_bundle_message_writer* writer, const osc_blob b)
+{
+    size_t blob_size = osc_blob_data_size(b);
+    size_t add_bytes = 0;
+    if(blob_size % 4 != 0) {
+        add_bytes = 4 - (blob_size % 4);
+    }
+
+return writer_append(writer, OSC_TT_BLOB, b, 4 + blob_size, add_bytes);
+}
+
+void osc_bundle_end_message(struct osc_bundle_message_writer* writer)
+{
+    char* raw = (char*)writer->bundle->raw_data;
+    size_t tg_space_size = writer->typetag_length + (4 - (writer->typetag_length % 4));
+    if(tg_space_size < writer->typetag_space) {
+        char* arg_start = raw + writer->typetag + writer->typetag_space;
+        size_t shrink = writer->typetag_space - tg_space_size;
+        move_bytes(arg_start - shrink, arg_start, raw + writer->end - arg_start);
+        writer->end -= shrink;
+        writer->typetag_space = tg_space_size;
+    }
+    uint32_t be_value = htobe32((uint32_t)(writer->end - writer->element - 4));
+    memcpy(raw + writer->element, &be_value, 4);
+    actualize_bundle_length(writer->bundle, writer->end - 4);
+}
+
+/**
+ * Skips the nested bundle elements starting at the given element
+ *
+ * @param  p_element        pointer to the length prefix of an element
+ * @param  first_byte_after pointer to the first byte after the enclosing bundle
+ * @return                  pointer to the length prefix of the first message element or first_byte_after
+ */
+static const unsigned char* skip_bundle_elements(const unsigned char* p_element, const unsigned char* first_byte_after)
+{
+    while(p_element < first_byte_after && osc_packet_is_bundle(p_element + 4, load_be32((const char*)p_element))) {
+        p_element += 4 + load_be32((const char*)p_element);
+    }
+
+return p_element;
+}
+
+struct osc_message osc_bundle_next_message(const struct osc_bundle * bundle, struct osc_message prev)
+{
+    struct osc_message next_msg;
+    OSC_MESSAGE_NULL(&next_msg);
+    unsigned int cur_bd_length = osc_bundle_serialized_length(bundle);
+    const unsigned char* next_msg_uchar = (unsigned char*)bundle->raw_data + 20;
+    const unsigned char* first_byte_after = (unsigned char*)bundle->raw_data + 4 + cur_bd_length;
+    if(prev.raw_data != NULL) {
+        next_msg_uchar = (unsigned char*)prev.raw_data + osc_message_serialized_length(&prev) + 4;
     }
-    if(prev.raw_data == NULL) {
-           next_msg.raw_data = (void*)next_msg_uchar;
-           next_msg.address = (char*)next_msg.raw_data + sizeof(int32_t);
-           next_msg.typetag = next_msg.address + strlen(next_msg.address) + (4 - (strlen(next_msg.address) % 4));
+    next_msg_uchar = skip_bundle_elements(next_msg_uchar, first_byte_after);
+    if(next_msg_uchar >= first_byte_after) {
            return next_msg;
     }
-    else {
-        unsigned int prev_msg_length = osc_message_serialized_length(&prev);
-        if(uchar_prev + prev_msg_length + 4 < first_byte_after) {
-            next_msg_uchar = uchar_prev + prev_msg_length + 4;
-            next_msg.raw_data = (void*)next_msg_uchar;
-            next_msg.address = (char*)next_msg_uchar + 4;
-            next_msg.typetag = next_msg.address + strlen(next_msg.address) + (4 - (strlen(next_msg.address) % 4));
+    next_msg.raw_data = (void*)next_msg_uchar;
+    next_msg.address = (char*)next_msg.raw_data + sizeof(int32_t);
+    next_msg.typetag = next_msg.address + scan_length(next_msg.address) + (4 - (scan_length(next_msg.address) % 4));
+return next_msg;
+}
+
+/**
+ * Checks that a padded osc string starts at the given position and finds its padded end
+ *
+ * @param   p       pointer to the first byte of the string
+ * @param   end     pointer to the first byte after the packet
+ * @return          pointer to the first byte after the padding or NULL if the string is malformed
+ */
+static const char* validate_string(const char* p, const char* end)
+{
+    const char* terminator = (const char*)memchr(p, '\0', end - p);
+    if(terminator == NULL) {
+        return NULL;
+    }
+    size_t str_length = terminator - p;
+    const char* p_next = p + str_length + (4 - (str_length % 4));
+    if(p_next > end) {
+        return NULL;
+    }
+    for(const char* pad = terminator + 1; pad < p_next; pad++) {
+        if(*pad != '\0') {
+            return NULL;
         }
-        else {
-            return next_msg;
+    }
+
+return p_next;
+}
+
+/**
+ * Validates an osc_message packet and fills the osc_message_view describing it
+ *
+ * @param   view    pointer to the osc_message_view structure
+ * @param   data    pointer to the first byte of the packet
+ * @param   size    the length of the packet
+ * @return          returns 0 on success or 1 if the packet is malformed
+ */
+static int validate_message(struct osc_message_view* view, const char* data, size_t size)
+{
+    const char* end = data + size;
+    if(size < 8 || size % 4 != 0 || data[0] == '#') {
+        return 1;
+    }
+    const char* typetag = validate_string(data, end);
+    if(typetag == NULL || typetag == end || typetag[0] != ',') {
+        return 1;
+    }
+    const char* p_argument = validate_string(typetag, end);
+    if(p_argument == NULL) {
+        return 1;
+    }
+    const char* arguments = p_argument;
+    for(const char* tag = typetag + 1; *tag != '\0'; tag++) {
+        size_t remaining = end - p_argument;
+        size_t blob_size = 0;
+        switch(*tag) {
+            case OSC_TT_INT:
+            case OSC_TT_FLOAT:   if(remaining < 4) {
+                                     return 1;
+                                 }
+                                 p_argument += 4; break;
+            case OSC_TT_TIMETAG: if(remaining < 8) {
+                                     return 1;
+                                 }
+                                 p_argument += 8; break;
+            case OSC_TT_STRING:  p_argument = validate_string(p_argument, end);
+                                 if(p_argument == NULL) {
+                                     return 1;
+                                 }
+                                 break;
+            case OSC_TT_BLOB:    if(remaining < 4) {
+                                     return 1;
+                                 }
+                                 blob_size = load_be32(p_argument);
+                                 if(blob_size > remaining - 4 || ((blob_size + 3) & ~(size_t)3) > remaining - 4) {
+                                     return 1;
+                                 }
+                                 p_argument += 4 + ((blob_size + 3) & ~(size_t)3); break;
+            default:             return 1;
         }
-   }
+    }
+    if(p_argument != end) {
+        return 1;
+    }
+    view->address = data;
+    view->typetag = typetag;
+    view->arguments = arguments;
+    view->length = size;
+
+return 0;
+}
+
+int osc_packet_is_bundle(const void* data, size_t size)
+{
+    if(size < 8 || memcmp(data, "#bundle", 8) != 0) {
+        return 0;
+    }
+
+return 1;
+}
+
+int osc_message_view_init(struct osc_message_view* view, const void* data, size_t size)
+{
+    OSC_TIME_BEGIN(start);
+    OSC_MESSAGE_VIEW_NULL(view);
+    int result = validate_message(view, (const char*)data, size);
+    if(result == 0) {
+        OSC_COUNT(packets_parsed, 1);
+    }
+    OSC_TIME_END(OSC_CALL_MESSAGE_VIEW_INIT, start);
+
+return result;
+}
+
+void osc_message_view_from_message(struct osc_message_view* view, const struct osc_message* msg)
+{
+    size_t tg_length = scan_length(msg->typetag);
+    view->address = msg->address;
+    view->typetag = msg->typetag;
+    view->arguments = msg->typetag + tg_length + (4 - (tg_length % 4));
+    view->length = osc_message_serialized_length(msg);
+}
+
+size_t osc_message_view_argc(const struct osc_message_view* view)
+{
+    size_t argc = (size_t)(view->arguments - view->typetag);
+    while(argc > 0 && view->typetag[argc - 1] == '\0') {
+        argc--;
+    }
+
+return argc - 1;
+}
+
+const union osc_msg_argument* osc_message_view_arg(const struct osc_message_view* view, size_t arg_index)
+{
+    const char* p_argument = view->arguments;
+    if(arg_index >= osc_message_view_argc(view)) {
+        return NULL;
+    }
+    for(size_t i = 1; i < arg_index + 1; i++) {
+        p_argument = skip_argument(view->typetag[i], p_argument);
+    }
+
+return (const union osc_msg_argument*)p_argument;
+}
+
+/**
+ * Decodes a run of 4B arguments of the given type into a host array
+ *
+ * @param   view        pointer to the osc_message_view structure
+ * @param   tag         tag of the arguments to decode
+ * @param   arg_index   index of the first argument to decode
+ * @param   out         pointer to the first destination value
+ * @param   count       the maximum number of values to decode
+ * @return              the number of values decoded
+ */
+static size_t read_argument_run(const struct osc_message_view* view, char tag, size_t arg_index, void* out, size_t count)
+{
+    const union osc_msg_argument* p_argument = osc_message_view_arg(view, arg_index);
+    if(p_argument == NULL) {
+        return 0;
+    }
+    const char* p_tag = view->typetag + 1 + arg_index;
+    size_t run_length = 0;
+    while(run_length < count && p_tag[run_length] == tag) {
+        run_length++;
+    }
+    osc_bswap32_array(out, p_argument, run_length);
+
+return run_length;
+}
+
+size_t osc_message_view_read_int32_array(const struct osc_message_view* view, size_t arg_index, int32_t* out, size_t count)
+{
+return read_argument_run(view, OSC_TT_INT, arg_index, out, count);
+}
+
+size_t osc_message_view_read_float_array(const struct osc_message_view* view, size_t arg_index, float* out, size_t count)
+{
+return read_argument_run(view, OSC_TT_FLOAT, arg_index, out, count);
+}
+
+int osc_bundle_view_init(struct osc_bundle_view* view, const void* data, size_t size)
+{
+    OSC_TIME_BEGIN(start);
+    int result = 1;
+    const char* bytes = (const char*)data;
+    const char* ends[OSC_BUNDLE_MAX_DEPTH];
+    size_t depth = 1;
+    view->data = NULL;
+    view->length = 0;
+    if(size < 16 || size % 4 != 0 || osc_packet_is_bundle(data, size) == 0) {
+        goto done;
+    }
+    ends[0] = bytes + size;
+    struct osc_message_view element;
+    const char* p_element = bytes + 16;
+    while(depth > 0) {
+        const char* end = ends[depth - 1];
+        if(p_element == end) {
+            depth--;
+            continue;
+        }
+        if(end - p_element < 4) {
+            goto done;
+        }
+        size_t element_size = load_be32(p_element);
+        if(element_size > (size_t)(end - p_element - 4)) {
+            goto done;
+        }
+        const char* p_content = p_element + 4;
+        p_element = p_content + element_size;
+        if(osc_packet_is_bundle(p_content, element_size)) {
+            if(depth == OSC_BUNDLE_MAX_DEPTH || element_size < 16 || element_size % 4 != 0) {
+                goto done;
+            }
+            ends[depth++] = p_element;
+            p_element = p_content + 16;
+        }
+        else if(validate_message(&element, p_content, element_size) == 1) {
+            goto done;
+        }
+    }
+    view->data = bytes;
+    view->length = size;
+    OSC_COUNT(packets_parsed, 1);
+    result = 0;
+done:
+    OSC_TIME_END(OSC_CALL_BUNDLE_VIEW_INIT, start);
+
+return result;
+}
+
+void osc_bundle_view_from_bundle(struct osc_bundle_view* view, const struct osc_bundle* bundle)
+{
+    view->data = (const char*)bundle->raw_data + 4;
+    view->length = osc_bundle_serialized_length(bundle);
+}
+
+struct osc_timetag osc_bundle_view_timetag(const struct osc_bundle_view* view)
+{
+    struct osc_timetag tag;
+    tag.sec = load_be32(view->data + 8);
+    tag.frac = load_be32(view->data + 12);
+
+return tag;
+}
+
+/**
+ * Fills an osc_message_view describing a message element of a trusted bundle
+ *
+ * @param   msg         pointer to the osc_message_view structure
+ * @param   p_element   pointer to the length prefix of the element
+ */
+static void element_message(struct osc_message_view* msg, const char* p_element)
+{
+    msg->length = load_be32(p_element);
+    msg->address = p_element + 4;
+    size_t addr_length = scan_length(msg->address);
+    msg->typetag = msg->address + addr_length + (4 - (addr_length % 4));
+    size_t tg_length = scan_length(msg->typetag);
+    msg->arguments = msg->typetag + tg_length + (4 - (tg_length % 4));
+}
+
+/**
+ * Reads a big-endian timetag from possibly unaligned memory
+ *
+ * @param   p       pointer to the first byte of the timetag
+ * @return          the timetag in the host endianity
+ */
+static struct osc_timetag load_timetag(const char* p)
+{
+    struct osc_timetag tag;
+    tag.sec = load_be32(p);
+    tag.frac = load_be32(p + 4);
+
+return tag;
+}
+
+struct osc_message_view osc_bundle_view_next_message(const struct osc_bundle_view* view, struct osc_message_view prev)
+{
+    struct osc_message_view next_msg;
+    OSC_MESSAGE_VIEW_NULL(&next_msg);
+    const char* p_element = view->data + 16;
+    const char* first_byte_after = view->data + view->length;
+    if(prev.address != NULL) {
+        p_element = prev.address + prev.length;
+    }
+    p_element = (const char*)skip_bundle_elements((const unsigned char*)p_element, (const unsigned char*)first_byte_after);
+    if(p_element >= first_byte_after) {
+        return next_msg;
+    }
+    element_message(&next_msg, p_element);
+
 return next_msg;
 }
+
+void osc_bundle_walker_init(struct osc_bundle_walker* walker, const struct osc_bundle_view* view)
+{
+    walker->stack[0].position = view->data + 16;
+    walker->stack[0].end = view->data + view->length;
+    walker->stack[0].timetag = load_timetag(view->data + 8);
+    walker->depth = 1;
+}
+
+int osc_bundle_walker_next(struct osc_bundle_walker* walker, struct osc_message_view* msg, struct osc_timetag* timetag)
+{
+    while(walker->depth > 0) {
+        struct osc_bundle_walker_level* level = &walker->stack[walker->depth - 1];
+        if(level->position >= level->end) {
+            walker->depth--;
+            continue;
+        }
+        const char* p_element = level->position;
+        size_t element_size = load_be32(p_element);
+        level->position = p_element + 4 + element_size;
+        if(osc_packet_is_bundle(p_element + 4, element_size)) {
+            if(walker->depth < OSC_BUNDLE_MAX_DEPTH) {
+                struct osc_bundle_walker_level* nested = &walker->stack[walker->depth++];
+                struct osc_timetag tag = load_timetag(p_element + 12);
+                nested->position = p_element + 20;
+                nested->end = p_element + 4 + element_size;
+                nested->timetag = level->timetag;
+                if(tag.sec > level->timetag.sec || (tag.sec == level->timetag.sec && tag.frac > level->timetag.frac)) {
+                    nested->timetag = tag;
+                }
+            }
+            continue;
+        }
+        element_message(msg, p_element);
+        *timetag = level->timetag;
+        return 0;
+    }
+
+return 1;
+}
+
+/**
+ * Fills the message offset table of an osc_bundle_index in one pass over the elements, descending into nested bundles
+ * Bundles nested deeper than OSC_BUNDLE_MAX_DEPTH are skipped, as osc_bundle_walker does
+ *
+ * @param   index       pointer to the osc_bundle_index structure
+ * @param   data        pointer to the first byte of the bundle ("#bundle")
+ * @param   length      the length of the bundle
+ * @return              returns 0 on success or 1 if memory allocation failed
+ */
+static int build_bundle_index(struct osc_bundle_index* index, const char* data, size_t length)
+{
+    const struct osc_allocator* allocator = osc_thread_allocator();
+    char* offsets = NULL;
+    size_t capacity = 0;
+    size_t count = 0;
+    const char* ends[OSC_BUNDLE_MAX_DEPTH];
+    size_t depth = 1;
+    ends[0] = data + length;
+    const char* p_element = data + 16;
+    while(depth > 0) {
+        if(p_element >= ends[depth - 1]) {
+            depth--;
+            continue;
+        }
+        size_t element_size = load_be32(p_element);
+        const char* p_content = p_element + 4;
+        if(osc_packet_is_bundle(p_content, element_size)) {
+            if(depth < OSC_BUNDLE_MAX_DEPTH) {
+                ends[depth++] = p_content + element_size;
+                p_element = p_content + 16;
+            }
+            else {
+                p_element = p_content + element_size;
+            }
+            continue;
+        }
+        if(reserve_region(allocator, &offsets, &capacity, (count + 1) * sizeof(uint32_t)) == 1) {
+            mem_free(allocator, offsets);
+            return 1;
+        }
+        ((uint32_t*)offsets)[count++] = (uint32_t)(p_element - data);
+        p_element = p_content + element_size;
+    }
+    index->data = data;
+    index->count = count;
+    index->offsets = (uint32_t*)offsets;
+    index->allocator = allocator;
+
+return 0;
+}
+
+int osc_bundle_index_new(struct osc_bundle_index* index, const struct osc_bundle* bundle)
+{
+return build_bundle_index(index, (const char*)bundle->raw_data + 4, osc_bundle_serialized_length(bundle));
+}
+
+int osc_bundle_index_new_view(struct osc_bundle_index* index, const struct osc_bundle_view* view)
+{
+return build_bundle_index(index, view->data, view->length);
+}
+
+void osc_bundle_index_destroy(struct osc_bundle_index* index)
+{
+    mem_free(index->allocator, index->offsets);
+    index->offsets = NULL;
+    index->allocator = NULL;
+    index->data = NULL;
+    index->count = 0;
+}
+
+int osc_bundle_index_message(const struct osc_bundle_index* index, size_t msg_index, struct osc_message_view* msg)
+{
+    if(msg_index >= index->count) {
+        return 1;
+    }
+    element_message(msg, index->data + index->offsets[msg_index]);
+
+return 0;
+}
+
+uint64_t osc_hash_bytes(const char* data, size_t length)
+{
+    uint64_t hash = 14695981039346656037ULL;
+    for(size_t i = 0; i < length; i++) {
+        hash ^= (unsigned char)data[i];
+        hash *= 1099511628211ULL;
+    }
+
+return hash;
+}
@@ -11,6 +11,8 @@
 #define OSC_TT_FLOAT 'f'
 #define OSC_TT_TIMETAG 't'
 #define OSC_TT_BLOB 'b'
+#define OSC_BUNDLE_MAX_DEPTH 16
+#define OSC_BLOB_FD_CHUNK 65536
 #define OSC_TYPETAG(...)  { ',', __VA_ARGS__, '\0'}
 #define OSC_TIMETAG_IMMEDIATE(timetag_instance) \
     do { \
@@ -27,34 +29,151 @@
     (*msg).address = NULL; \
     (*msg).typetag = NULL; \
     (*msg).raw_data = NULL; \
+    (*msg).allocator = NULL; \
     } while (0)
 #define OSC_BUNDLE_NULL(bnd) \
     do {\
     (*bnd).timetag = NULL; \
     (*bnd).raw_data = NULL; \
+    (*bnd).capacity = 0; \
+    (*bnd).allocator = NULL; \
     } while (0)
+#define OSC_MESSAGE_VIEW_NULL(view) \
+    do { \
+    (*view).address = NULL; \
+    (*view).typetag = NULL; \
+    (*view).arguments = NULL; \
+    (*view).length = 0; \
+    } while (0)
+/**
+ * An osc_blob points to the 4B size of the blob; a hidden header recording the allocator of the blob sits right before it
+ * API break: an osc_blob is no longer the start of its allocation, it must only be released with osc_blob_destroy (passing
+ * it to free() or realloc() corrupts the heap)
+ */
 typedef void* osc_blob;
 
+struct iovec;
+
+/**
+ * How messages are spread over the threads of an osc_pipeline (its consumers) or an osc_parallel pool (its workers)
+ * OSC_AFFINITY_NONE balances them freely, OSC_AFFINITY_ADDRESS sends all messages with the same address to the same
+ * thread, which then handles them in the order they arrived
+ */
+enum osc_affinity {
+    OSC_AFFINITY_NONE,
+    OSC_AFFINITY_ADDRESS
+};
+
+/**
+ * Structure representing an osc_allocator
+ * allocate, reallocate and deallocate behave like malloc, realloc and free and receive context as first argument
+ */
+struct osc_allocator {
+    void* (*allocate)(void* context, size_t size);
+    void* (*reallocate)(void* context, void* ptr, size_t size);
+    void (*deallocate)(void* context, void* ptr);
+    void* context;
+};
+
 /**
  * Structure representing an osc_message
  * raw_data points to the first byte of the allocated memory block (if any)
  * address points to the first address byte ('\0' if address is not set)
  * typetag points to the first typetag byte (',')
+ * allocator is the allocator owning raw_data (NULL for the default allocator or if the message owns no memory)
  */
 struct osc_message {
     char* address;
     char* typetag;
     void* raw_data;
+    const struct osc_allocator* allocator;
 };
 
 /**
  * Structure representing an osc_bundle
  * raw_data points to the first byte of the allocated memory block (if any)
  * timetag points to the first byte of the osc_bundle timetag ('\0' if not set)
+ * capacity is the size of the allocated memory block, which grows geometrically as elements are added
+ * allocator is the allocator owning raw_data (NULL for the default allocator)
  */
 struct osc_bundle {
     struct osc_timetag* timetag;
     void* raw_data;
+    size_t capacity;
+    const struct osc_allocator* allocator;
+};
+
+/**
+ * Structure representing a message being written directly into an osc_bundle
+ * All positions are offsets from the bundle raw_data, which may move while the message grows
+ * element is the offset of the element length prefix, typetag the offset of the ',' typetag byte,
+ * typetag_space the number of bytes reserved for the typetag and end the offset after the last argument
+ */
+struct osc_bundle_message_writer {
+    struct osc_bundle* bundle;
+    size_t element;
+    size_t typetag;
+    size_t typetag_length;
+    size_t typetag_space;
+    size_t end;
+};
+
+/**
+ * Structure representing a blob payload referenced by an osc_message_builder instead of being copied into it
+ * offset is the position in the builder arguments region where the payload belongs (right after its 4B size)
+ */
+struct osc_blob_ref {
+    size_t offset;
+    const void* data;
+    size_t length;
+};
+
+/**
+ * Structure representing an osc_message_builder
+ * address, typetag and arguments are separate growable regions filled while the message is being built
+ * typetag holds the unpadded typetag characters (starting with ','), arguments holds the serialized argument bytes
+ * except the payloads of referenced blobs, which are listed in blob_refs in increasing offset order
+ * header is the region osc_message_builder_finish_iovec lays the length prefix, address and typetag out into
+ * the final osc_message layout is produced only once, by osc_message_builder_finish
+ * allocator is the allocator owning the regions
+ */
+struct osc_message_builder {
+    const struct osc_allocator* allocator;
+    char* address;
+    size_t address_length;
+    size_t address_capacity;
+    char* typetag;
+    size_t typetag_length;
+    size_t typetag_capacity;
+    char* arguments;
+    size_t arguments_length;
+    size_t arguments_capacity;
+    struct osc_blob_ref* blob_refs;
+    size_t blob_ref_count;
+    size_t blob_ref_capacity;
+    char* header;
+    size_t header_capacity;
+};
+
+/**
+ * Structure representing a blob argument being streamed into an osc_message_builder
+ * size_offset is the offset of the blob 4B size in the builder arguments region and length the number of payload bytes
+ * appended so far; the payload is written in place, so no other argument may be added until the blob is ended
+ */
+struct osc_blob_writer {
+    struct osc_message_builder* builder;
+    size_t size_offset;
+    size_t length;
+};
+
+/**
+ * Structure representing a reader handing the payload of a received blob out in chunks, without copying it
+ * data points to the first payload byte, position is the number of payload bytes already handed out
+ */
+struct osc_blob_reader {
+    const char* data;
+    size_t length;
+    size_t position;
 };
 
 /**
@@ -67,6 +186,113 @@ struct osc_timetag {
     uint32_t frac;
 };
 
+/**
+ * Structure representing a read-only view of an osc_message stored in memory the library does not own (e.g. a receive buffer)
+ * address points to the first address byte, typetag points to the first typetag byte (',')
+ * arguments points to the first byte of the first argument
+ * length is the length of the whole message (a view never includes the 4B length prefix)
+ */
+struct osc_message_view {
+    const char* address;
+    const char* typetag;
+    const char* arguments;
+    size_t length;
+};
+
+/**
+ * Structure representing a read-only view of an osc_bundle stored in memory the library does not own
+ * data points to the first byte of the "#bundle" string
+ * length is the length of the whole bundle (a view never includes the 4B length prefix)
+ */
+struct osc_bundle_view {
+    const char* data;
+    size_t length;
+};
+
+/**
+ * Structure representing one open bundle of an osc_bundle_walker
+ * position points to the length prefix of the next element, end to the first byte after the bundle
+ * timetag is the effective timetag of the bundle (the later of its own timetag and the enclosing one)
+ */
+struct osc_bundle_walker_level {
+    const char* position;
+    const char* end;
+    struct osc_timetag timetag;
+};
+
+/**
+ * Structure representing a depth-first iterator over the messages of an arbitrarily nested bundle
+ * stack holds the currently open bundles (at most OSC_BUNDLE_MAX_DEPTH), depth is the number of open bundles
+ */
+struct osc_bundle_walker {
+    struct osc_bundle_walker_level stack[OSC_BUNDLE_MAX_DEPTH];
+    size_t depth;
+};
+
+/**
+ * Structure representing a precomputed message offset table of a bundle
+ * data points to the first byte of the bundle (the "#bundle" string)
+ * offsets holds the offset from data of the length prefix of each of the count messages, the messages of nested
+ * bundles included in depth-first order (as osc_bundle_walker yields them)
+ * allocator is the allocator owning offsets
+ */
+struct osc_bundle_index {
+    const char* data;
+    size_t count;
+    uint32_t* offsets;
+    const struct osc_allocator* allocator;
+};
+
+/**
+ * Structure representing an argument yielded by an osc_arg_cursor
+ * type is the typetag character of the argument
+ * data points to the first byte of the argument (the same pointer osc_message_arg returns)
+ * length is the argument data length: 4 for 'i' and 'f', 8 for 't', strlen for 's' and the data size for 'b'
+ */
+struct osc_arg {
+    char type;
+    const union osc_msg_argument* data;
+    size_t length;
+};
+
+/**
+ * Structure representing a forward iterator over the arguments of a message
+ * typetag points to the tag of the next argument, argument points to its first byte
+ */
+struct osc_arg_cursor {
+    const char* typetag;
+    const char* argument;
+};
+
+/**
+ * Structure representing a precomputed argument offset table of a message
+ * typetag points to the first argument tag (the byte after ','), arguments to the first byte of the first argument
+ * offsets holds argc + 1 offsets relative to arguments, the last one being the end of the arguments
+ * allocator is the allocator owning offsets
+ */
+struct osc_message_index {
+    const char* typetag;
+    const char* arguments;
+    size_t argc;
+    uint32_t* offsets;
+    const struct osc_allocator* allocator;
+};
+
+/**
+ * Structure representing an osc_message_template, a message whose address and typetag are fixed and whose arguments are patched in place
+ * message is the serialized message, ready to be sent or added to a bundle as is
+ * arguments is the offset of the first argument byte from message.raw_data
+ * offsets holds argc + 1 offsets relative to the first argument byte, the last one being the end of the arguments
+ * capacity is the size of the allocated memory block, which grows geometrically when a string or blob outgrows its slot
+ */
+struct osc_message_template {
+    struct osc_message message;
+    size_t arguments;
+    size_t argc;
+    uint32_t* offsets;
+    size_t capacity;
+};
+
 /**
  * Union used for representing osc_message arguments of different types and for accessing particular bytes of an argument
  */
@@ -95,7 +321,39 @@ int32_t osc_unpack_int32(int32_t value);
 float osc_unpack_float(float value);
 
 /**
- * Creates a new osc_message instance by allocating to it 12B (basic osc_message size)
+ * Converts an array of 4B values between big-endian and the host endianity
+ * The conversion runs on the widest byte-shuffle unit the CPU supports (AVX2, SSE2 or NEON), picked on first use
+ *
+ * @param   dst     pointer to the destination (may be src, otherwise the arrays must not overlap)
+ * @param   src     pointer to the source
+ * @param   count   the number of 4B values to convert
+ */
+void osc_bswap32_array(void* dst, const void* src, size_t count);
+
+/**
+ * Finds the default osc_allocator (the C library heap)
+ *
+ * @return          pointer to the default allocator
+ */
+const struct osc_allocator* osc_default_allocator(void);
+
+/**
+ * Sets the allocator used by the calling thread for every message, bundle, blob, builder and index it creates afterwards
+ * Objects remember the allocator they were created with and are freed with it whatever the thread allocator is then
+ *
+ * @param   allocator   pointer to the allocator (NULL restores the default allocator); it must outlive every object using it
+ */
+void osc_set_thread_allocator(const struct osc_allocator* allocator);
+
+/**
+ * Finds the allocator currently used by the calling thread
+ *
+ * @return          pointer to the thread allocator
+ */
+const struct osc_allocator* osc_thread_allocator(void);
+
+/**
+ * Creates a new osc_message instance by allocating to it 12B (basic osc_message size) with the thread allocator
  *
  * @param   msg     pointer to the osc_message structure
  * @return          returns 0 on success or 1 if memory allocation failed
@@ -103,6 +361,15 @@ float osc_unpack_float(float value);
 
 int osc_message_new(struct osc_message* msg);
 
+/**
+ * Creates a new osc_message instance by allocating to it 12B (basic osc_message size) with the given allocator
+ *
+ * @param   msg         pointer to the osc_message structure
+ * @param   allocator   the allocator to use for this message (NULL for the default allocator)
+ * @return              returns 0 on success or 1 if memory allocation failed
+ */
+int osc_message_new_with_allocator(struct osc_message* msg, const struct osc_allocator* allocator);
+
 /**
  * Destroys an osc_message instance by freeing the memory to which its raw_data pointer is pointing
  *
@@ -163,6 +430,26 @@ int osc_message_add_float(struct osc_message* msg, float data);
  */
 int osc_message_add_int32(struct osc_message* msg, int32_t data);
 
+/**
+ * Adds an array of 4B integers as consecutive arguments to the osc_message instance
+ *
+ * @param    msg        pointer to the osc_message structure
+ * @param    data       pointer to the first integer
+ * @param    count      the number of integers to add
+ * @return              returns 0 on success or 1 if memory reallocation failed
+ */
+int osc_message_add_int32_array(struct osc_message* msg, const int32_t* data, size_t count);
+
+/**
+ * Adds an array of floating point numbers as consecutive arguments to the osc_message instance
+ *
+ * @param    msg        pointer to the osc_message structure
+ * @param    data       pointer to the first floating point number
+ * @param    count      the number of floating point numbers to add
+ * @return              returns 0 on success or 1 if memory reallocation failed
+ */
+int osc_message_add_float_array(struct osc_message* msg, const float* data, size_t count);
+
 /**
  * Find the number of arguments in the osc_message instance
  *
@@ -181,13 +468,353 @@ size_t osc_message_argc(const struct osc_message* msg);
 const union osc_msg_argument* osc_message_arg(const struct osc_message* msg, size_t arg_index);
 
 /**
- * Creates a new osc_bundle instance by allocating to it 16B (basic bundle size)
+ * Positions an osc_arg_cursor before the first argument of the osc_message instance
+ *
+ * @param   cursor      pointer to the osc_arg_cursor structure
+ * @param   msg         pointer to the osc_message structure
+ */
+void osc_arg_cursor_init(struct osc_arg_cursor* cursor, const struct osc_message* msg);
+
+/**
+ * Positions an osc_arg_cursor before the first argument of the osc_message_view
+ *
+ * @param   cursor      pointer to the osc_arg_cursor structure
+ * @param   view        pointer to the osc_message_view structure
+ */
+void osc_arg_cursor_init_view(struct osc_arg_cursor* cursor, const struct osc_message_view* view);
+
+/**
+ * Yields the next argument and advances the osc_arg_cursor past it
+ * Reading all arguments with a cursor takes a single pass over the message
+ *
+ * @param   cursor      pointer to the osc_arg_cursor structure
+ * @param   arg         pointer to the osc_arg structure to fill
+ * @return              returns 0 on success or 1 if there are no more arguments
+ */
+int osc_arg_cursor_next(struct osc_arg_cursor* cursor, struct osc_arg* arg);
+
+/**
+ * Creates an osc_message_index for the osc_message instance in one pass over its arguments
+ * The index points into the message and is valid as long as the message is not modified or destroyed
+ *
+ * @param   index       pointer to the osc_message_index structure
+ * @param   msg         pointer to the osc_message structure
+ * @return              returns 0 on success or 1 if memory allocation failed
+ */
+int osc_message_index_new(struct osc_message_index* index, const struct osc_message* msg);
+
+/**
+ * Creates an osc_message_index for the osc_message_view in one pass over its arguments
+ *
+ * @param   index       pointer to the osc_message_index structure
+ * @param   view        pointer to the osc_message_view structure
+ * @return              returns 0 on success or 1 if memory allocation failed
+ */
+int osc_message_index_new_view(struct osc_message_index* index, const struct osc_message_view* view);
+
+/**
+ * Destroys an osc_message_index instance by freeing its offset table
+ *
+ * @param   index       pointer to the osc_message_index structure
+ */
+void osc_message_index_destroy(struct osc_message_index* index);
+
+/**
+ * Finds an argument with the given index in constant time
+ *
+ * @param   index       pointer to the osc_message_index structure
+ * @param   arg_index   index of the desired argument
+ * @return              pointer to the argument with the given index or NULL if it doesn't exist
+ */
+const union osc_msg_argument* osc_message_index_arg(const struct osc_message_index* index, size_t arg_index);
+
+/**
+ * Creates a new osc_message_builder instance by allocating its address, typetag and argument regions
+ * A builder can be reused for any number of messages, its regions keep their capacity between messages
+ *
+ * @param   builder     pointer to the osc_message_builder structure
+ * @return              returns 0 on success or 1 if memory allocation failed
+ */
+int osc_message_builder_new(struct osc_message_builder* builder);
+
+/**
+ * Destroys an osc_message_builder instance by freeing its regions
+ *
+ * @param   builder     pointer to the osc_message_builder structure
+ */
+void osc_message_builder_destroy(struct osc_message_builder* builder);
+
+/**
+ * Starts building a new message, discarding anything added since the last osc_message_builder_begin
+ *
+ * @param   builder     pointer to the osc_message_builder structure
+ * @param   address     pointer to the string to be used as address
+ * @return              returns 0 on success or 1 if memory reallocation failed
+ */
+int osc_message_builder_begin(struct osc_message_builder* builder, const char* address);
+
+/**
+ * Adds the argument of struct osc_timetag type to the message being built
+ *
+ * @param   builder     pointer to the osc_message_builder structure
+ * @param   tag         struct osc_timetag variable to be added as a new argument
+ * @return              returns 0 on success or 1 if memory reallocation failed
+ */
+int osc_message_builder_add_timetag(struct osc_message_builder* builder, struct osc_timetag tag);
+
+/**
+ * Adds a string as an argument to the message being built
+ *
+ * @param   builder     pointer to the osc_message_builder structure
+ * @param   data        pointer to the string to be added as an argument
+ * @return              returns 0 on success or 1 if memory reallocation failed
+ */
+int osc_message_builder_add_string(struct osc_message_builder* builder, const char* data);
+
+/**
+ * Adds a floating point number as an argument to the message being built
+ *
+ * @param   builder     pointer to the osc_message_builder structure
+ * @param   data        floating point number to be added as an argument
+ * @return              returns 0 on success or 1 if memory reallocation failed
+ */
+int osc_message_builder_add_float(struct osc_message_builder* builder, float data);
+
+/**
+ * Adds a 4B integer as an argument to the message being built
+ *
+ * @param   builder     pointer to the osc_message_builder structure
+ * @param   data        4B integer to be added as an argument
+ * @return              returns 0 on success or 1 if memory reallocation failed
+ */
+int osc_message_builder_add_int32(struct osc_message_builder* builder, int32_t data);
+
+/**
+ * Adds an array of 4B integers as consecutive arguments to the message being built
+ *
+ * @param   builder     pointer to the osc_message_builder structure
+ * @param   data        pointer to the first integer
+ * @param   count       the number of integers to add
+ * @return              returns 0 on success or 1 if memory reallocation failed
+ */
+int osc_message_builder_add_int32_array(struct osc_message_builder* builder, const int32_t* data, size_t count);
+
+/**
+ * Adds an array of floating point numbers as consecutive arguments to the message being built
+ *
+ * @param   builder     pointer to the osc_message_builder structure
+ * @param   data        pointer to the first floating point number
+ * @param   count       the number of floating point numbers to add
+ * @return              returns 0 on success or 1 if memory reallocation failed
+ */
+int osc_message_builder_add_float_array(struct osc_message_builder* builder, const float* data, size_t count);
+
+/**
+ * Adds osc_blob instance as an argument to the message being built
+ *
+ * @param   builder     pointer to the osc_message_builder structure
+ * @param   b           osc_blob instance to be added as an argument
+ * @return              returns 0 on success or 1 if memory reallocation failed
+ */
+int osc_message_builder_add_blob(struct osc_message_builder* builder, const osc_blob b);
+
+/**
+ * Adds a blob argument to the message being built without copying its payload: only the 4B size and the alignment
+ * bytes are written, the payload is referenced by pointer until the message is laid out
+ * The payload must stay valid and unchanged until osc_message_builder_finish returns or, with
+ * osc_message_builder_finish_iovec, until the returned iovec list has been sent
+ *
+ * @param   builder     pointer to the osc_message_builder structure
+ * @param   data        pointer to the first payload byte
+ * @param   length      the length of the payload
+ * @return              returns 0 on success or 1 if memory reallocation failed
+ */
+int osc_message_builder_add_blob_ref(struct osc_message_builder* builder, const void* data, size_t length);
+
+/**
+ * Finds the number of iovec entries osc_message_builder_finish_iovec needs at most for the message being built
+ *
+ * @param   builder     pointer to the osc_message_builder structure
+ * @return              the maximum number of iovec entries
+ */
+size_t osc_message_builder_iovec_count(const struct osc_message_builder* builder);
+
+/**
+ * Lays out the message being built as a scatter-gather list usable with writev or sendmsg, without copying the
+ * arguments: the first entry covers the address and typetag, the next ones alternate between slices of the builder
+ * arguments region and referenced blob payloads
+ * The entries point into the builder and the referenced payloads; they stay valid until the builder is modified
+ *
+ * @param   builder         pointer to the osc_message_builder structure
+ * @param   iov             pointer to the array receiving the entries
+ * @param   max_iov         the capacity of iov (osc_message_builder_iovec_count is always enough)
+ * @param   iov_count       set to the number of entries used
+ * @param   length_prefix   whether the 4B big-endian length prefix starts the first entry (for stream transports)
+ * @return                  returns 0 on success or 1 if iov is too small or memory reallocation failed
+ */
+int osc_message_builder_finish_iovec(struct osc_message_builder* builder, struct iovec* iov, size_t max_iov, size_t* iov_count, int length_prefix);
+
+/**
+ * Lays out the message being built into a new osc_message instance allocated with the thread allocator
+ * The resulting raw_data is byte for byte what the osc_message_add_* functions would have produced
+ * (the payloads of referenced blobs are copied in)
+ * The whole arguments region is copied, streamed blobs included, so the peak memory is about twice the message plus the
+ * region growth slack; only osc_message_builder_finish_iovec sends a streamed blob without this second copy
+ *
+ * @param   builder     pointer to the osc_message_builder structure
+ * @param   msg         pointer to the osc_message structure to fill (must not own any memory)
+ * @return              returns 0 on success or 1 if memory allocation failed
+ */
+int osc_message_builder_finish(struct osc_message_builder* builder, struct osc_message* msg);
+
+/**
+ * Starts a blob argument whose payload is streamed into the message being built with osc_blob_writer_append and
+ * osc_blob_writer_append_fd; its size is only known once osc_blob_writer_end is called
+ * The payload lands in the builder arguments region, which grows geometrically: send the message with
+ * osc_message_builder_finish_iovec to avoid copying it again (see osc_message_builder_finish)
+ *
+ * @param   builder     pointer to the osc_message_builder structure
+ * @param   writer      pointer to the osc_blob_writer structure to fill
+ * @return              returns 0 on success or 1 if memory reallocation failed
+ */
+int osc_message_builder_begin_blob(struct osc_message_builder* builder, struct osc_blob_writer* writer);
+
+/**
+ * Appends payload bytes to the blob being streamed, copying them straight into the builder arguments region
+ *
+ * @param   writer      pointer to the osc_blob_writer structure
+ * @param   data        pointer to the bytes
+ * @param   length      the number of bytes
+ * @return              returns 0 on success or 1 if the blob would exceed INT32_MAX bytes or memory reallocation failed
+ */
+int osc_blob_writer_append(struct osc_blob_writer* writer, const void* data, size_t length);
+
+/**
+ * Appends payload bytes read from a file descriptor to the blob being streamed, reading straight into the builder
+ * arguments region in chunks of at most OSC_BLOB_FD_CHUNK bytes until end of file or max_length bytes
+ *
+ * @param   writer      pointer to the osc_blob_writer structure
+ * @param   fd          the file descriptor to read from (a blocking one, or reading stops when it would block)
+ * @param   max_length  the maximum number of bytes to read
+ * @param   count       set to the number of bytes appended (also on failure)
+ * @return              returns 0 on success or 1 if reading failed, the blob would exceed INT32_MAX bytes or memory
+ *                      reallocation failed
+ */
+int osc_blob_writer_append_fd(struct osc_blob_writer* writer, int fd, size_t max_length, size_t* count);
+
+/**
+ * Ends the blob being streamed: writes its 4B size and zeroes its alignment bytes (the payload is never zeroed)
+ *
+ * @param   writer      pointer to the osc_blob_writer structure
+ */
+void osc_blob_writer_end(struct osc_blob_writer* writer);
+
+/**
+ * Initializes an osc_blob_reader over a blob argument yielded by an osc_arg_cursor
+ *
+ * @param   reader      pointer to the osc_blob_reader structure
+ * @param   arg         pointer to the osc_arg structure (which must outlive the reader, as the message it points into)
+ * @return              returns 0 on success or 1 if the argument is not a blob
+ */
+int osc_blob_reader_init(struct osc_blob_reader* reader, const struct osc_arg* arg);
+
+/**
+ * Hands out the next chunk of the blob payload as a pointer into the message
+ *
+ * @param   reader      pointer to the osc_blob_reader structure
+ * @param   max_length  the maximum length of the chunk
+ * @param   chunk       set to the first byte of the chunk
+ * @return              the length of the chunk (0 once the whole payload was handed out)
+ */
+size_t osc_blob_reader_next(struct osc_blob_reader* reader, size_t max_length, const void** chunk);
+
+/**
+ * Creates a new osc_message_template instance with the thread allocator
+ * Every argument starts as zero, an empty string or an empty blob
+ *
+ * @param   tmpl        pointer to the osc_message_template structure
+ * @param   address     pointer to the string to be used as address
+ * @param   typetag     pointer to the typetag string (starting with ','), made of 'i', 'f', 's', 't' and 'b' tags only
+ * @return              returns 0 on success or 1 if the typetag is invalid or memory allocation failed
+ */
+int osc_message_template_new(struct osc_message_template* tmpl, const char* address, const char* typetag);
+
+/**
+ * Destroys an osc_message_template instance by freeing its message and offset table
+ *
+ * @param   tmpl        pointer to the osc_message_template structure
+ */
+void osc_message_template_destroy(struct osc_message_template* tmpl);
+
+/**
+ * Overwrites an argument of osc_timetag type of the template
+ *
+ * @param   tmpl        pointer to the osc_message_template structure
+ * @param   arg_index   index of the argument
+ * @param   tag         the new value
+ * @return              returns 0 on success or 1 if the argument doesn't exist or is not a timetag
+ */
+int osc_template_set_timetag(struct osc_message_template* tmpl, size_t arg_index, struct osc_timetag tag);
+
+/**
+ * Overwrites a string argument of the template
+ * The arguments after it are moved only if the padded length of the string changes
+ *
+ * @param   tmpl        pointer to the osc_message_template structure
+ * @param   arg_index   index of the argument
+ * @param   data        pointer to the new string
+ * @return              returns 0 on success or 1 if the argument doesn't exist, is not a string or memory reallocation failed
+ */
+int osc_template_set_string(struct osc_message_template* tmpl, size_t arg_index, const char* data);
+
+/**
+ * Overwrites a floating point argument of the template
+ *
+ * @param   tmpl        pointer to the osc_message_template structure
+ * @param   arg_index   index of the argument
+ * @param   data        the new value
+ * @return              returns 0 on success or 1 if the argument doesn't exist or is not a float
+ */
+int osc_template_set_float(struct osc_message_template* tmpl, size_t arg_index, float data);
+
+/**
+ * Overwrites a 4B integer argument of the template
+ *
+ * @param   tmpl        pointer to the osc_message_template structure
+ * @param   arg_index   index of the argument
+ * @param   data        the new value
+ * @return              returns 0 on success or 1 if the argument doesn't exist or is not an integer
+ */
+int osc_template_set_int32(struct osc_message_template* tmpl, size_t arg_index, int32_t data);
+
+/**
+ * Overwrites a blob argument of the template
+ * The arguments after it are moved only if the padded size of the blob changes
+ *
+ * @param   tmpl        pointer to the osc_message_template structure
+ * @param   arg_index   index of the argument
+ * @param   b           osc_blob instance to copy into the argument
+ * @return              returns 0 on success or 1 if the argument doesn't exist, is not a blob or memory reallocation failed
+ */
+int osc_template_set_blob(struct osc_message_template* tmpl, size_t arg_index, const osc_blob b);
+
+/**
+ * Creates a new osc_bundle instance by allocating to it 16B (basic bundle size) with the thread allocator
  *
  * @param   bnd         pointer to the osc_bundle structure
  * @return              returns 0 on success or 1 if memory allocation failed
  */
 int osc_bundle_new(struct osc_bundle * bnd);
 
+/**
+ * Creates a new osc_bundle instance by allocating to it 16B (basic bundle size) with the given allocator
+ *
+ * @param   bnd         pointer to the osc_bundle structure
+ * @param   allocator   the allocator to use for this bundle (NULL for the default allocator)
+ * @return              returns 0 on success or 1 if memory allocation failed
+ */
+int osc_bundle_new_with_allocator(struct osc_bundle * bnd, const struct osc_allocator* allocator);
+
 /**
  * Sets the timtetag bytes of the osc_bundle instance
  *
@@ -212,8 +839,83 @@ void osc_bundle_destroy(struct osc_bundle * bn);
  */
 int osc_bundle_add_message(struct osc_bundle * bundle, const struct osc_message * msg);
 
+/**
+ * Opens a message slot at the end of the osc_bundle and writes its address in place
+ * Arguments are then appended with the osc_bundle_message_add_* functions and the message is closed with
+ * osc_bundle_end_message; until then the bundle length is unchanged, so an unfinished message is simply discarded
+ * No other element may be added to the bundle while a message is open
+ *
+ * @param  bundle       pointer to the osc_bundle structure
+ * @param  writer       pointer to the osc_bundle_message_writer structure
+ * @param  address      pointer to the string to be used as address
+ * @return              returns 0 on success or 1 if memory reallocation failed
+ */
+int osc_bundle_begin_message(struct osc_bundle * bundle, struct osc_bundle_message_writer * writer, const char* address);
+
+/**
+ * Adds the argument of struct osc_timetag type to the message open in the bundle
+ *
+ * @param  writer       pointer to the osc_bundle_message_writer structure
+ * @param  tag          struct osc_timetag variable to be added as a new argument
+ * @return              returns 0 on success or 1 if memory reallocation failed
+ */
+int osc_bundle_message_add_timetag(struct osc_bundle_message_writer * writer, struct osc_timetag tag);
+
+/**
+ * Adds a string as an argument to the message open in the bundle
+ *
+ * @param  writer       pointer to the osc_bundle_message_writer structure
+ * @param  data         pointer to the string to be added as an argument
+ * @return              returns 0 on success or 1 if memory reallocation failed
+ */
+int osc_bundle_message_add_string(struct osc_bundle_message_writer * writer, const char* data);
+
+/**
+ * Adds a floating point number as an argument to the message open in the bundle
+ *
+ * @param  writer       pointer to the osc_bundle_message_writer structure
+ * @param  data         floating point number to be added as an argument
+ * @return              returns 0 on success or 1 if memory reallocation failed
+ */
+int osc_bundle_message_add_float(struct osc_bundle_message_writer * writer, float data);
+
+/**
+ * Adds a 4B integer as an argument to the message open in the bundle
+ *
+ * @param  writer       pointer to the osc_bundle_message_writer structure
+ * @param  data         4B integer to be added as an argument
+ * @return              returns 0 on success or 1 if memory reallocation failed
+ */
+int osc_bundle_message_add_int32(struct osc_bundle_message_writer * writer, int32_t data);
+
+/**
+ * Adds osc_blob instance as an argument to the message open in the bundle
+ *
+ * @param  writer       pointer to the osc_bundle_message_writer structure
+ * @param  b            osc_blob instance to be added as an argument
+ * @return              returns 0 on success or 1 if memory reallocation failed
+ */
+int osc_bundle_message_add_blob(struct osc_bundle_message_writer * writer, const osc_blob b);
+
+/**
+ * Closes the message open in the bundle by patching its element size and the bundle length
+ *
+ * @param  writer       pointer to the osc_bundle_message_writer structure
+ */
+void osc_bundle_end_message(struct osc_bundle_message_writer * writer);
+
+/**
+ * Adds an osc_bundle instance to the osc_bundle as a nested bundle element
+ *
+ * @param  bundle       pointer to the osc_bundle structure
+ * @param  child        pointer to the osc_bundle instance to be added
+ * @return              returns 0 on success or 1 if memory reallocation failed
+ */
+int osc_bundle_add_bundle(struct osc_bundle * bundle, const struct osc_bundle * child);
+
 /**
  * Finds the osc_message instance immediately following the given instance
+ * Nested bundle elements are skipped, use osc_bundle_walker to visit the messages they contain
  *
  * @param  bundle       pointer to the osc_bundle structure
  * @param  prev         the preceding osc_message instance
@@ -246,7 +948,9 @@ size_t osc_blob_data_size(const osc_blob b);
 void * osc_blob_data_ptr(const osc_blob b);
 
 /**
- * Creates an osc_blob instance of the given length
+ * Creates an osc_blob instance of the given length with the thread allocator, which the blob remembers in a hidden
+ * header placed before it
+ * The data block and the alignment bytes are zeroed
  *
  * @param   length      the desired length of the osc_blob data block
  * @return              osc_blob instance with the desired data block length
@@ -254,8 +958,18 @@ void * osc_blob_data_ptr(const osc_blob b);
 osc_blob osc_blob_new(size_t length);
 
 /**
- * Destroys the given osc_blob instance by freeing its memory
- * @param  b            the osc_blob instance to destroy
+ * Creates an osc_blob instance like osc_blob_new, without zeroing the data block (only the alignment bytes are zeroed)
+ * The caller must fill the whole data block before the blob is sent or added to a message
+ *
+ * @param   length      the desired length of the osc_blob data block
+ * @return              osc_blob instance with the desired data block length
+ */
+osc_blob osc_blob_new_uninitialized(size_t length);
+
+/**
+ * Destroys the given osc_blob instance by freeing its memory with the allocator it was created with
+ * This is the only valid way to release an osc_blob (see osc_blob)
+ * @param  b            the osc_blob instance to destroy (NULL is ignored)
  */
 void osc_blob_destroy(osc_blob b);
 
@@ -268,4 +982,178 @@ void osc_blob_destroy(osc_blob b);
  */
 int osc_message_add_blob(struct osc_message * msg, const osc_blob b);
 
+/**
+ * Checks whether the given packet is an osc_bundle (starts with the "#bundle" string)
+ *
+ * @param   data        pointer to the first byte of the packet
+ * @param   size        the number of bytes available at data
+ * @return              returns 1 if the packet is an osc_bundle or 0 otherwise
+ */
+int osc_packet_is_bundle(const void* data, size_t size);
+
+/**
+ * Creates an osc_message_view over a received packet without copying it
+ * The whole packet is validated in a single pass (padding, typetag, string terminators, blob lengths),
+ * after which the unchecked osc_message_view accessors are safe to use
+ *
+ * @param   view        pointer to the osc_message_view structure
+ * @param   data        pointer to the first byte of the packet (the address)
+ * @param   size        the length of the packet
+ * @return              returns 0 on success or 1 if the packet is not a well-formed osc_message
+ */
+int osc_message_view_init(struct osc_message_view* view, const void* data, size_t size);
+
+/**
+ * Creates an osc_message_view over an osc_message instance built by the library (no validation is done)
+ *
+ * @param   view        pointer to the osc_message_view structure
+ * @param   msg         pointer to the osc_message structure
+ */
+void osc_message_view_from_message(struct osc_message_view* view, const struct osc_message* msg);
+
+/**
+ * Find the number of arguments in the osc_message_view
+ *
+ * @param   view        pointer to the osc_message_view structure
+ * @return              the number of arguments
+ */
+size_t osc_message_view_argc(const struct osc_message_view* view);
+
+/**
+ * Finds an argument with the given index in the osc_message_view
+ *
+ * @param   view        pointer to the osc_message_view structure
+ * @param   arg_index   index of the desired argument
+ * @return              pointer to the argument with the given index or NULL if it doesn't exist
+ */
+const union osc_msg_argument* osc_message_view_arg(const struct osc_message_view* view, size_t arg_index);
+
+/**
+ * Decodes the run of consecutive 'i' arguments starting at the given index into a host array
+ * Decoding stops at the first argument of another type, at the end of the arguments or after count values
+ * (use osc_message_view_from_message to decode the arguments of an osc_message)
+ *
+ * @param   view        pointer to the osc_message_view structure
+ * @param   arg_index   index of the first argument to decode
+ * @param   out         pointer to the array receiving the integers
+ * @param   count       the capacity of out
+ * @return              the number of integers decoded
+ */
+size_t osc_message_view_read_int32_array(const struct osc_message_view* view, size_t arg_index, int32_t* out, size_t count);
+
+/**
+ * Decodes the run of consecutive 'f' arguments starting at the given index into a host array
+ * Decoding stops at the first argument of another type, at the end of the arguments or after count values
+ *
+ * @param   view        pointer to the osc_message_view structure
+ * @param   arg_index   index of the first argument to decode
+ * @param   out         pointer to the array receiving the floating point numbers
+ * @param   count       the capacity of out
+ * @return              the number of floating point numbers decoded
+ */
+size_t osc_message_view_read_float_array(const struct osc_message_view* view, size_t arg_index, float* out, size_t count);
+
+/**
+ * Creates an osc_bundle_view over a received packet without copying it
+ * The bundle header, every element size and every contained message or nested bundle are validated in a single pass
+ * (nested bundles are accepted up to OSC_BUNDLE_MAX_DEPTH levels including the outermost one)
+ *
+ * @param   view        pointer to the osc_bundle_view structure
+ * @param   data        pointer to the first byte of the packet (the "#bundle" string)
+ * @param   size        the length of the packet
+ * @return              returns 0 on success or 1 if the packet is not a well-formed osc_bundle
+ */
+int osc_bundle_view_init(struct osc_bundle_view* view, const void* data, size_t size);
+
+/**
+ * Creates an osc_bundle_view over an osc_bundle instance built by the library (no validation is done)
+ *
+ * @param   view        pointer to the osc_bundle_view structure
+ * @param   bundle      pointer to the osc_bundle structure
+ */
+void osc_bundle_view_from_bundle(struct osc_bundle_view* view, const struct osc_bundle* bundle);
+
+/**
+ * Reads the timetag of the osc_bundle_view
+ *
+ * @param   view        pointer to the osc_bundle_view structure
+ * @return              the timetag in the host endianity
+ */
+struct osc_timetag osc_bundle_view_timetag(const struct osc_bundle_view* view);
+
+/**
+ * Finds the osc_message_view immediately following the given one in the osc_bundle_view
+ * Nested bundle elements are skipped, use osc_bundle_walker to visit the messages they contain
+ *
+ * @param   view        pointer to the osc_bundle_view structure
+ * @param   prev        the preceding osc_message_view (a null view to get the first message)
+ * @return              the next message or a null osc_message_view if the given one is the last in the bundle
+ */
+struct osc_message_view osc_bundle_view_next_message(const struct osc_bundle_view* view, struct osc_message_view prev);
+
+/**
+ * Positions an osc_bundle_walker before the first message of the osc_bundle_view
+ *
+ * @param   walker      pointer to the osc_bundle_walker structure
+ * @param   view        pointer to the osc_bundle_view structure
+ */
+void osc_bundle_walker_init(struct osc_bundle_walker* walker, const struct osc_bundle_view* view);
+
+/**
+ * Yields the next message of the bundle in depth-first order, descending into nested bundles
+ * Nothing is copied or allocated; bundles nested deeper than OSC_BUNDLE_MAX_DEPTH are skipped
+ *
+ * @param   walker      pointer to the osc_bundle_walker structure
+ * @param   msg         pointer to the osc_message_view to fill
+ * @param   timetag     set to the effective timetag of the message (the later of its bundle's and the enclosing ones')
+ * @return              returns 0 on success or 1 if there are no more messages
+ */
+int osc_bundle_walker_next(struct osc_bundle_walker* walker, struct osc_message_view* msg, struct osc_timetag* timetag);
+
+/**
+ * Creates an osc_bundle_index for the osc_bundle instance in one pass over its elements
+ * The index points into the bundle and is valid as long as the bundle is not modified or destroyed
+ *
+ * @param   index       pointer to the osc_bundle_index structure
+ * @param   bundle      pointer to the osc_bundle structure
+ * @return              returns 0 on success or 1 if memory allocation failed
+ */
+int osc_bundle_index_new(struct osc_bundle_index* index, const struct osc_bundle* bundle);
+
+/**
+ * Creates an osc_bundle_index for a validated osc_bundle_view in one pass over its elements
+ *
+ * @param   index       pointer to the osc_bundle_index structure
+ * @param   view        pointer to the osc_bundle_view structure
+ * @return              returns 0 on success or 1 if memory allocation failed
+ */
+int osc_bundle_index_new_view(struct osc_bundle_index* index, const struct osc_bundle_view* view);
+
+/**
+ * Destroys an osc_bundle_index instance by freeing its offset table
+ *
+ * @param   index       pointer to the osc_bundle_index structure
+ */
+void osc_bundle_index_destroy(struct osc_bundle_index* index);
+
+/**
+ * Finds the message with the given index in constant time
+ *
+ * @param   index       pointer to the osc_bundle_index structure
+ * @param   msg_index   index of the desired message
+ * @param   msg         pointer to the osc_message_view to fill
+ * @return              returns 0 on success or 1 if the message doesn't exist
+ */
+int osc_bundle_index_message(const struct osc_bundle_index* index, size_t msg_index, struct osc_message_view* msg);
+
+/**
+ * Computes the 64-bit FNV-1a hash of a byte string (library internal, shared by the address caches and the address
+ * affinity of the threaded modules)
+ *
+ * @param   data        pointer to the first byte
+ * @param   length      the number of bytes to hash
+ * @return              the hash value
+ */
+uint64_t osc_hash_bytes(const char* data, size_t length);
+
 #endif //OSC_H
@@ -0,0 +1,407 @@
+/** @file osc.hpp */
+
+#ifndef OSC_HPP
+#define OSC_HPP
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <new>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <tuple>
+#include <type_traits>
+#include <utility>
+
+extern "C" {
+#include "osc.h"
+}
+
+namespace osc {
+
+/**
+ * Blob argument referring to bytes the caller owns
+ */
+struct blob_view {
+    const void* data;
+    std::size_t size;
+};
+
+using timetag = osc_timetag;
+
+namespace detail {
+
+/**
+ * Rounds a size up to the next multiple of 4
+ */
+constexpr std::size_t pad4(std::size_t size)
+{
+    return (size + 3) & ~static_cast<std::size_t>(3);
+}
+
+/**
+ * Size of an OSC string of the given length (terminator and alignment bytes included)
+ */
+constexpr std::size_t string_size(std::size_t length)
+{
+    return length + (4 - (length % 4));
+}
+
+inline void store_be32(char* dst, std::uint32_t value)
+{
+    dst[0] = static_cast<char>(value >> 24);
+    dst[1] = static_cast<char>(value >> 16);
+    dst[2] = static_cast<char>(value >> 8);
+    dst[3] = static_cast<char>(value);
+}
+
+inline std::uint32_t load_be32(const char* src)
+{
+    const unsigned char* bytes = reinterpret_cast<const unsigned char*>(src);
+    return (static_cast<std::uint32_t>(bytes[0]) << 24) | (static_cast<std::uint32_t>(bytes[1]) << 16) |
+           (static_cast<std::uint32_t>(bytes[2]) << 8) | static_cast<std::uint32_t>(bytes[3]);
+}
+
+/**
+ * Maps the argument types accepted by encode to the types stored in osc::message
+ * (every string-like type becomes std::string_view)
+ */
+template<class T>
+struct normalize {
+    using type = T;
+};
+template<>
+struct normalize<const char*> {
+    using type = std::string_view;
+};
+template<>
+struct normalize<char*> {
+    using type = std::string_view;
+};
+template<>
+struct normalize<std::string> {
+    using type = std::string_view;
+};
+template<std::size_t N>
+struct normalize<char[N]> {
+    using type = std::string_view;
+};
+template<class T>
+using normalize_t = typename normalize<std::remove_cv_t<std::remove_reference_t<T>>>::type;
+
+/**
+ * Serialization of one argument type: the typetag character, the size when it does not depend on the value
+ * (0 otherwise) and the functions computing the size, writing the bytes and reading them back
+ */
+template<class T>
+struct argument;
+
+template<>
+struct argument<std::int32_t> {
+    static constexpr char tag = OSC_TT_INT;
+    static constexpr std::size_t fixed_size = 4;
+    static constexpr std::size_t size(std::int32_t) { return 4; }
+    static char* write(char* dst, std::int32_t value)
+    {
+        store_be32(dst, static_cast<std::uint32_t>(value));
+        return dst + 4;
+    }
+    static const char* read(const char* src, std::int32_t& value)
+    {
+        value = static_cast<std::int32_t>(load_be32(src));
+        return src + 4;
+    }
+};
+
+template<>
+struct argument<float> {
+    static constexpr char tag = OSC_TT_FLOAT;
+    static constexpr std::size_t fixed_size = 4;
+    static constexpr std::size_t size(float) { return 4; }
+    static char* write(char* dst, float value)
+    {
+        std::uint32_t bits;
+        std::memcpy(&bits, &value, 4);
+        store_be32(dst, bits);
+        return dst + 4;
+    }
+    static const char* read(const char* src, float& value)
+    {
+        std::uint32_t bits = load_be32(src);
+        std::memcpy(&value, &bits, 4);
+        return src + 4;
+    }
+};
+
+template<>
+struct argument<timetag> {
+    static constexpr char tag = OSC_TT_TIMETAG;
+    static constexpr std::size_t fixed_size = 8;
+    static constexpr std::size_t size(const timetag&) { return 8; }
+    static char* write(char* dst, const timetag& value)
+    {
+        store_be32(dst, value.sec);
+        store_be32(dst + 4, value.frac);
+        return dst + 8;
+    }
+    static const char* read(const char* src, timetag& value)
+    {
+        value.sec = load_be32(src);
+        value.frac = load_be32(src + 4);
+        return src + 8;
+    }
+};
+
+template<>
+struct argument<std::string_view> {
+    static constexpr char tag = OSC_TT_STRING;
+    static constexpr std::size_t fixed_size = 0;
+    static constexpr std::size_t size(std::string_view value) { return string_size(value.size()); }
+    static char* write(char* dst, std::string_view value)
+    {
+        std::size_t space = string_size(value.size());
+        std::memcpy(dst, value.data(), value.size());
+        std::memset(dst + value.size(), 0, space - value.size());
+        return dst + space;
+    }
+    static const char* read(const char* src, std::string_view& value)
+    {
+        value = std::string_view(src);
+        return src + string_size(value.size());
+    }
+};
+
+template<>
+struct argument<blob_view> {
+    static constexpr char tag = OSC_TT_BLOB;
+    static constexpr std::size_t fixed_size = 0;
+    static constexpr std::size_t size(const blob_view& value) { return 4 + pad4(value.size); }
+    static char* write(char* dst, const blob_view& value)
+    {
+        store_be32(dst, static_cast<std::uint32_t>(value.size));
+        if(value.size != 0) {
+            std::memcpy(dst + 4, value.data, value.size);
+        }
+        std::memset(dst + 4 + value.size, 0, pad4(value.size) - value.size);
+        return dst + 4 + pad4(value.size);
+    }
+    static const char* read(const char* src, blob_view& value)
+    {
+        value.size = load_be32(src);
+        value.data = src + 4;
+        return src + 4 + pad4(value.size);
+    }
+};
+
+/**
+ * The typetag of an argument list (',' + tags + '\0'), built at compile time with its alignment bytes
+ */
+template<class... Ts>
+struct typetag {
+    static constexpr std::size_t length = 1 + sizeof...(Ts);
+    static constexpr std::size_t space = string_size(length);
+    static constexpr std::array<char, space> make()
+    {
+        std::array<char, space> value{};
+        const char tags[] = {',', argument<Ts>::tag..., '\0'};
+        for(std::size_t i = 0; i < length; i++) {
+            value[i] = tags[i];
+        }
+        return value;
+    }
+    static constexpr std::array<char, space> value = make();
+};
+
+/**
+ * Size of the arguments whose size does not depend on their value, folded at compile time
+ */
+template<class... Ts>
+constexpr std::size_t fixed_arguments_size()
+{
+    return (std::size_t{0} + ... + argument<Ts>::fixed_size);
+}
+
+template<class... Ts>
+std::size_t dynamic_arguments_size(const Ts&... args)
+{
+    return (std::size_t{0} + ... + (argument<Ts>::fixed_size == 0 ? argument<Ts>::size(args) : 0));
+}
+
+} // namespace detail
+
+/**
+ * Computes the serialized size of a message (without the 4B length prefix) in one pass over the arguments
+ *
+ * @param   address     the address of the message
+ * @param   args        the arguments
+ * @return              the size of the message
+ */
+template<class... Ts>
+std::size_t encoded_size(std::string_view address, const Ts&... args)
+{
+    return detail::string_size(address.size()) + detail::typetag<Ts...>::space +
+           detail::fixed_arguments_size<Ts...>() + detail::dynamic_arguments_size<Ts...>(args...);
+}
+
+/**
+ * Writes a message with the 4B big-endian length prefix into a caller buffer, exactly as struct osc_message raw_data
+ *
+ * @param   dst         pointer to the buffer
+ * @param   capacity    the size of the buffer
+ * @param   address     the address of the message
+ * @param   args        the arguments
+ * @return              the number of bytes written (length prefix included) or 0 if the buffer is too small
+ */
+template<class... Args>
+std::size_t encode_into(char* dst, std::size_t capacity, std::string_view address, const Args&... args)
+{
+    return [&](const detail::normalize_t<Args>&... values) -> std::size_t {
+        std::size_t length = encoded_size(address, values...);
+        if(length + 4 > capacity) {
+            return 0;
+        }
+        detail::store_be32(dst, static_cast<std::uint32_t>(length));
+        char* p = detail::argument<std::string_view>::write(dst + 4, address);
+        const auto& tags = detail::typetag<detail::normalize_t<Args>...>::value;
+        std::memcpy(p, tags.data(), tags.size());
+        p += tags.size();
+        ((p = detail::argument<detail::normalize_t<Args>>::write(p, values)), ...);
+        return length + 4;
+    }(detail::normalize_t<Args>(args)...);
+}
+
+/**
+ * Message with a typetag fixed at compile time, owning a struct osc_message allocated once with the thread allocator
+ * The raw_data layout is the one the osc_message_add_* functions produce, so c_message() can be used with the whole C API
+ * (as long as it is not modified through it)
+ */
+template<class... Ts>
+class message {
+public:
+    message() { OSC_MESSAGE_NULL(&msg_); }
+
+    /**
+     * Encodes a message, throwing std::bad_alloc if memory allocation failed
+     */
+    explicit message(std::string_view address, const Ts&... args)
+    {
+        std::size_t length = encoded_size(address, args...);
+        const osc_allocator* allocator = osc_thread_allocator();
+        char* raw_data = static_cast<char*>(allocator->allocate(allocator->context, length + 4));
+        if(raw_data == nullptr) {
+            throw std::bad_alloc();
+        }
+        encode_into(raw_data, length + 4, address, args...);
+        msg_.raw_data = raw_data;
+        msg_.allocator = allocator;
+        msg_.address = raw_data + 4;
+        msg_.typetag = msg_.address + detail::string_size(address.size());
+    }
+
+    message(const message&) = delete;
+    message& operator=(const message&) = delete;
+
+    message(message&& other) noexcept : msg_(other.msg_) { OSC_MESSAGE_NULL(&other.msg_); }
+
+    message& operator=(message&& other) noexcept
+    {
+        if(this != &other) {
+            reset();
+            msg_ = other.msg_;
+            OSC_MESSAGE_NULL(&other.msg_);
+        }
+        return *this;
+    }
+
+    ~message() { reset(); }
+
+    /**
+     * The underlying C message (the message keeps owning it)
+     */
+    const osc_message& c_message() const { return msg_; }
+
+    /**
+     * Gives the underlying C message away, the caller destroys it with osc_message_destroy
+     */
+    osc_message release()
+    {
+        osc_message msg = msg_;
+        OSC_MESSAGE_NULL(&msg_);
+        return msg;
+    }
+
+    /**
+     * The first byte of the packet (without the 4B length prefix) and its length, e.g. for a datagram
+     */
+    const char* data() const { return msg_.address; }
+    std::size_t size() const { return msg_.raw_data != nullptr ? detail::load_be32(static_cast<const char*>(msg_.raw_data)) : 0; }
+
+    /**
+     * Read-only view of the message
+     */
+    osc_message_view view() const
+    {
+        osc_message_view view;
+        osc_message_view_from_message(&view, &msg_);
+        return view;
+    }
+
+private:
+    void reset()
+    {
+        if(msg_.raw_data != nullptr) {
+            osc_message_destroy(&msg_);
+        }
+    }
+
+    osc_message msg_;
+};
+
+/**
+ * Encodes a message with a single allocation, the typetag being deduced from the argument types
+ * (int32_t, float, osc::timetag, string types and osc::blob_view)
+ */
+template<class... Args>
+message<detail::normalize_t<Args>...> encode(std::string_view address, const Args&... args)
+{
+    return message<detail::normalize_t<Args>...>(address, detail::normalize_t<Args>(args)...);
+}
+
+/**
+ * Decodes the arguments of a validated message view into a tuple after a single typetag comparison
+ * Strings and blobs point into the message data
+ *
+ * @param   view    the message view (from osc_message_view_init or osc_message_view_from_message)
+ * @return          the arguments or std::nullopt if the typetag is not exactly the expected one
+ */
+template<class... Ts>
+std::optional<std::tuple<Ts...>> decode(const osc_message_view& view)
+{
+    const auto& tags = detail::typetag<Ts...>::value;
+    if(view.typetag == nullptr || std::strncmp(view.typetag, tags.data(), detail::typetag<Ts...>::length + 1) != 0) {
+        return std::nullopt;
+    }
+    std::tuple<Ts...> values;
+    const char* p = view.arguments;
+    std::apply([&](Ts&... value) { ((p = detail::argument<Ts>::read(p, value)), ...); }, values);
+    return values;
+}
+
+/**
+ * Validates a packet (without the 4B length prefix) and decodes its arguments (see decode(const osc_message_view&))
+ */
+template<class... Ts>
+std::optional<std::tuple<Ts...>> decode(const void* data, std::size_t size)
+{
+    osc_message_view view;
+    if(osc_message_view_init(&view, data, size) != 0) {
+        return std::nullopt;
+    }
+    return decode<Ts...>(view);
+}
+
+} // namespace osc
+
+#endif //OSC_HPP
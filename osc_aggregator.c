@@ -0,0 +1,272 @@
+/** @file osc_aggregator.c */
+
+#ifndef _DEFAULT_SOURCE
+    #define _DEFAULT_SOURCE
+#endif // _DEFAULT_SOURCE
+
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <sched.h>
+#include <endian.h>
+#include "osc_aggregator.h"
+
+#define NTP_UNIX_EPOCH_DELTA 2208988800ULL
+#define BUNDLE_HEADER_SIZE 16
+#define MIN_ELEMENT_SIZE 12
+#define STATE_OFFSET(state) ((size_t)((state) & 0xffffffffu))
+#define STATE_COUNT(state) ((size_t)((state) >> 32))
+#define RESERVATION(size) ((uint64_t)(size) | (1ULL << 32))
+
+/**
+ * Reasons for flushing a bundle, counted in the stats
+ */
+enum flush_reason {
+    FLUSH_FULL,
+    FLUSH_DEADLINE,
+    FLUSH_EXPLICIT
+};
+
+/**
+ * Reads a clock in nanoseconds
+ *
+ * @param   clock_id    the clock to read
+ * @return              the time in nanoseconds
+ */
+static uint64_t clock_ns(clockid_t clock_id)
+{
+    struct timespec ts;
+    clock_gettime(clock_id, &ts);
+
+return (uint64_t)ts.tv_sec * 1000000000ULL + (uint64_t)ts.tv_nsec;
+}
+
+/**
+ * Tells whether a buffer state is closed to new reservations
+ *
+ * @param   agg     pointer to the osc_aggregator structure
+ * @param   state   the buffer state
+ * @return          returns 1 if the buffer is closed or 0 otherwise
+ */
+static int is_closed(const struct osc_aggregator* agg, uint64_t state)
+{
+return STATE_OFFSET(state) > agg->capacity || STATE_COUNT(state) > agg->max_messages;
+}
+
+/**
+ * Writes the timetag chosen by the policy into a buffer about to be sent
+ *
+ * @param   agg     pointer to the osc_aggregator structure
+ * @param   buffer  pointer to the buffer
+ */
+static void write_timetag(const struct osc_aggregator* agg, struct osc_aggregator_buffer* buffer)
+{
+    uint32_t be_value[2] = {0, htobe32(1)};
+    if(agg->policy != OSC_AGGREGATOR_IMMEDIATE) {
+        uint64_t unix_ns = clock_ns(CLOCK_REALTIME) + agg->timetag_delay_ns;
+        if(agg->policy == OSC_AGGREGATOR_FIRST_MESSAGE) {
+            unix_ns -= clock_ns(CLOCK_MONOTONIC) - buffer->first_ns;
+        }
+        uint64_t frac = ((unix_ns % 1000000000ULL) << 32) / 1000000000ULL;
+        be_value[0] = htobe32((uint32_t)(unix_ns / 1000000000ULL + NTP_UNIX_EPOCH_DELTA));
+        be_value[1] = htobe32((uint32_t)frac);
+    }
+    memcpy(buffer->data + 8, be_value, sizeof(be_value));
+}
+
+/**
+ * Flushes a buffer sealed by the calling thread: moves the producers to the next buffer, waits for the messages
+ * being copied, sends the bundle and recycles the buffer
+ *
+ * @param   agg     pointer to the osc_aggregator structure
+ * @param   buffer  pointer to the sealed buffer
+ * @param   used    the number of element bytes in the buffer
+ * @param   count   the number of messages in the buffer
+ * @param   reason  why the buffer was sealed
+ */
+static void flush_sealed(struct osc_aggregator* agg, struct osc_aggregator_buffer* buffer, size_t used, size_t count, enum flush_reason reason)
+{
+    uint32_t generation = __atomic_load_n(&agg->generation, __ATOMIC_ACQUIRE);
+    struct osc_aggregator_buffer* next = &agg->buffers[(generation + 1) % OSC_AGGREGATOR_BUFFERS];
+    __atomic_store_n(&buffer->busy, 1, __ATOMIC_RELAXED);
+    while(__atomic_load_n(&next->busy, __ATOMIC_ACQUIRE) != 0) {
+        sched_yield();
+    }
+    __atomic_store_n(&agg->generation, generation + 1, __ATOMIC_RELEASE);
+    __atomic_store_n(&next->state, 0, __ATOMIC_RELEASE);
+    while(__atomic_load_n(&buffer->committed, __ATOMIC_ACQUIRE) != count) {
+        sched_yield();
+    }
+    if(count != 0) {
+        write_timetag(agg, buffer);
+        agg->sender(buffer->data, BUNDLE_HEADER_SIZE + used, count, agg->context);
+        __atomic_fetch_add(&agg->stats.bundles, 1, __ATOMIC_RELAXED);
+        switch(reason) {
+            case FLUSH_FULL:     __atomic_fetch_add(&agg->stats.full_flushes, 1, __ATOMIC_RELAXED); break;
+            case FLUSH_DEADLINE: __atomic_fetch_add(&agg->stats.deadline_flushes, 1, __ATOMIC_RELAXED); break;
+            case FLUSH_EXPLICIT: break;
+        }
+    }
+    __atomic_store_n(&buffer->first_ns, 0, __ATOMIC_RELAXED);
+    __atomic_store_n(&buffer->committed, 0, __ATOMIC_RELAXED);
+    __atomic_store_n(&buffer->state, RESERVATION(agg->capacity + 1), __ATOMIC_RELAXED);
+    __atomic_store_n(&buffer->busy, 0, __ATOMIC_RELEASE);
+}
+
+/**
+ * Seals and flushes a buffer if it is still open and holds messages, by reserving more than its capacity
+ *
+ * @param   agg     pointer to the osc_aggregator structure
+ * @param   buffer  pointer to the buffer
+ * @param   reason  why the buffer is flushed
+ * @return          returns 1 if the buffer was flushed by the calling thread or 0 otherwise
+ */
+static int seal(struct osc_aggregator* agg, struct osc_aggregator_buffer* buffer, enum flush_reason reason)
+{
+    uint64_t state = __atomic_load_n(&buffer->state, __ATOMIC_ACQUIRE);
+    if(is_closed(agg, state) || STATE_COUNT(state) == 0) {
+        return 0;
+    }
+    state = __atomic_fetch_add(&buffer->state, RESERVATION(agg->capacity + 1), __ATOMIC_ACQ_REL);
+    if(is_closed(agg, state)) {
+        return 0;
+    }
+    flush_sealed(agg, buffer, STATE_OFFSET(state), STATE_COUNT(state), reason);
+
+return 1;
+}
+
+/**
+ * Tells whether the deadline of a buffer has passed
+ *
+ * @param   agg     pointer to the osc_aggregator structure
+ * @param   buffer  pointer to the buffer
+ * @return          returns 1 if the first message of the buffer has waited max_delay_ns or 0 otherwise
+ */
+static int deadline_passed(const struct osc_aggregator* agg, const struct osc_aggregator_buffer* buffer)
+{
+    uint64_t first_ns = __atomic_load_n(&buffer->first_ns, __ATOMIC_RELAXED);
+
+return agg->max_delay_ns != 0 && first_ns != 0 && clock_ns(CLOCK_MONOTONIC) - first_ns >= agg->max_delay_ns;
+}
+
+int osc_aggregator_new(struct osc_aggregator* agg, size_t mtu, size_t max_messages, uint64_t max_delay_ns,
+                       enum osc_aggregator_timetag policy, uint64_t timetag_delay_ns, osc_aggregator_sender sender, void* context)
+{
+    memset(agg, 0, sizeof(*agg));
+    mtu = mtu == 0 ? OSC_AGGREGATOR_DEFAULT_MTU : mtu;
+    if(mtu < BUNDLE_HEADER_SIZE + MIN_ELEMENT_SIZE || mtu > UINT32_MAX / 2) {
+        return 1;
+    }
+    agg->capacity = mtu - BUNDLE_HEADER_SIZE;
+    agg->max_messages = max_messages == 0 || max_messages > agg->capacity ? agg->capacity : max_messages;
+    agg->max_delay_ns = max_delay_ns;
+    agg->policy = policy;
+    agg->timetag_delay_ns = timetag_delay_ns;
+    agg->sender = sender;
+    agg->context = context;
+    for(size_t i = 0; i < OSC_AGGREGATOR_BUFFERS; i++) {
+        struct osc_aggregator_buffer* buffer = &agg->buffers[i];
+        buffer->data = (char*)malloc(mtu);
+        if(buffer->data == NULL) {
+            osc_aggregator_destroy(agg);
+            return 1;
+        }
+        memcpy(buffer->data, "#bundle", 8);
+        buffer->state = i == 0 ? 0 : RESERVATION(agg->capacity + 1);
+    }
+
+return 0;
+}
+
+void osc_aggregator_destroy(struct osc_aggregator* agg)
+{
+    if(agg->buffers[OSC_AGGREGATOR_BUFFERS - 1].data != NULL) {
+        osc_aggregator_flush(agg);
+    }
+    for(size_t i = 0; i < OSC_AGGREGATOR_BUFFERS; i++) {
+        while(__atomic_load_n(&agg->buffers[i].busy, __ATOMIC_ACQUIRE) != 0) {
+            sched_yield();
+        }
+        free(agg->buffers[i].data);
+    }
+    memset(agg, 0, sizeof(*agg));
+}
+
+int osc_aggregator_add(struct osc_aggregator* agg, const void* data, size_t length)
+{
+    size_t size = sizeof(int32_t) + length;
+    if(size > agg->capacity) {
+        __atomic_fetch_add(&agg->stats.oversized, 1, __ATOMIC_RELAXED);
+        return 1;
+    }
+    for(;;) {
+        uint32_t generation = __atomic_load_n(&agg->generation, __ATOMIC_ACQUIRE);
+        struct osc_aggregator_buffer* buffer = &agg->buffers[generation % OSC_AGGREGATOR_BUFFERS];
+        // checking first keeps the producers waiting for the next buffer from inflating the closed state
+        if(is_closed(agg, __atomic_load_n(&buffer->state, __ATOMIC_ACQUIRE))) {
+            sched_yield();
+            continue;
+        }
+        uint64_t state = __atomic_fetch_add(&buffer->state, RESERVATION(size), __ATOMIC_ACQ_REL);
+        if(is_closed(agg, state)) {
+            continue;
+        }
+        size_t offset = STATE_OFFSET(state);
+        size_t count = STATE_COUNT(state);
+        if(offset + size > agg->capacity || count == agg->max_messages) {
+            // the first reservation that does not fit seals the buffer, the ones before it form the bundle
+            flush_sealed(agg, buffer, offset, count, FLUSH_FULL);
+            continue;
+        }
+        char* p_element = buffer->data + BUNDLE_HEADER_SIZE + offset;
+        uint32_t be_length = htobe32((uint32_t)length);
+        memcpy(p_element, &be_length, sizeof(be_length));
+        memcpy(p_element + sizeof(be_length), data, length);
+        if(count == 0) {
+            __atomic_store_n(&buffer->first_ns, clock_ns(CLOCK_MONOTONIC), __ATOMIC_RELAXED);
+        }
+        __atomic_fetch_add(&buffer->committed, 1, __ATOMIC_RELEASE);
+        __atomic_fetch_add(&agg->stats.messages, 1, __ATOMIC_RELAXED);
+        if(count + 1 == agg->max_messages || agg->capacity - offset - size < MIN_ELEMENT_SIZE) {
+            seal(agg, buffer, FLUSH_FULL);
+        }
+        else if(deadline_passed(agg, buffer)) {
+            seal(agg, buffer, FLUSH_DEADLINE);
+        }
+        return 0;
+    }
+}
+
+int osc_aggregator_add_message(struct osc_aggregator* agg, const struct osc_message* msg)
+{
+return osc_aggregator_add(agg, (const char*)msg->raw_data + 4, osc_message_serialized_length(msg));
+}
+
+int osc_aggregator_poll(struct osc_aggregator* agg)
+{
+    uint32_t generation = __atomic_load_n(&agg->generation, __ATOMIC_ACQUIRE);
+    struct osc_aggregator_buffer* buffer = &agg->buffers[generation % OSC_AGGREGATOR_BUFFERS];
+    if(!deadline_passed(agg, buffer)) {
+        return 0;
+    }
+
+return seal(agg, buffer, FLUSH_DEADLINE);
+}
+
+int osc_aggregator_flush(struct osc_aggregator* agg)
+{
+    uint32_t generation = __atomic_load_n(&agg->generation, __ATOMIC_ACQUIRE);
+
+return seal(agg, &agg->buffers[generation % OSC_AGGREGATOR_BUFFERS], FLUSH_EXPLICIT);
+}
+
+void osc_aggregator_stats(const struct osc_aggregator* agg, struct osc_aggregator_stats* stats)
+{
+    stats->messages = __atomic_load_n(&agg->stats.messages, __ATOMIC_RELAXED);
+    stats->bundles = __atomic_load_n(&agg->stats.bundles, __ATOMIC_RELAXED);
+    stats->oversized = __atomic_load_n(&agg->stats.oversized, __ATOMIC_RELAXED);
+    stats->full_flushes = __atomic_load_n(&agg->stats.full_flushes, __ATOMIC_RELAXED);
+    stats->deadline_flushes = __atomic_load_n(&agg->stats.deadline_flushes, __ATOMIC_RELAXED);
+}
@@ -0,0 +1,153 @@
+/** @file osc_aggregator.h */
+
+#ifndef OSC_AGGREGATOR_H
+#define OSC_AGGREGATOR_H
+
+#include <stdint.h>
+#include <stdlib.h>
+#include "osc.h"
+#include "osc_ring.h"
+
+#define OSC_AGGREGATOR_DEFAULT_MTU 1472
+#define OSC_AGGREGATOR_BUFFERS 4
+
+/**
+ * Timetag policies of the bundles flushed by an osc_aggregator
+ * OSC_AGGREGATOR_IMMEDIATE sets the immediate timetag, OSC_AGGREGATOR_FIRST_MESSAGE the time the first message
+ * of the bundle was added plus timetag_delay_ns and OSC_AGGREGATOR_FLUSH_TIME the flush time plus timetag_delay_ns
+ */
+enum osc_aggregator_timetag {
+    OSC_AGGREGATOR_IMMEDIATE,
+    OSC_AGGREGATOR_FIRST_MESSAGE,
+    OSC_AGGREGATOR_FLUSH_TIME
+};
+
+/**
+ * Type of the functions sending the bundles flushed by an osc_aggregator
+ * Called on the thread that triggered the flush; data is only valid during the call and the function must not add
+ * messages to the same aggregator
+ *
+ * @param   data        pointer to the first byte of the bundle (without the 4B length prefix)
+ * @param   length      the length of the bundle
+ * @param   count       the number of messages in the bundle
+ * @param   context     the context given to osc_aggregator_new
+ */
+typedef void (*osc_aggregator_sender)(const char* data, size_t length, size_t count, void* context);
+
+/**
+ * Structure representing the osc_aggregator counters
+ * oversized counts the messages rejected because they do not fit into an empty bundle
+ */
+struct osc_aggregator_stats {
+    uint64_t messages;
+    uint64_t bundles;
+    uint64_t oversized;
+    uint64_t full_flushes;
+    uint64_t deadline_flushes;
+};
+
+/**
+ * Structure representing one of the bundle buffers of an osc_aggregator
+ * state packs the bytes reserved (low 32 bits) and the number of reservations (high 32 bits); the buffer is closed
+ * once either exceeds its limit, the first reservation going over the limit seals the buffer and flushes it
+ * committed counts the reservations whose message has been copied, busy is set while the buffer is being flushed
+ * first_ns is the CLOCK_MONOTONIC time of the first message (0 while the buffer is empty)
+ */
+struct osc_aggregator_buffer {
+    uint64_t state __attribute__((aligned(OSC_CACHE_LINE)));
+    uint32_t committed;
+    uint32_t busy;
+    uint64_t first_ns;
+    char* data;
+};
+
+/**
+ * Structure representing a thread-safe bundle aggregator
+ * Producers reserve room in the current buffer with a single atomic add and copy their message without locking;
+ * a buffer is flushed as one bundle when it reaches capacity bytes of elements, max_messages messages or
+ * max_delay_ns after its first message, while the producers move on to the next buffer
+ * generation is the number of buffers sealed so far, the current buffer being buffers[generation % OSC_AGGREGATOR_BUFFERS]
+ */
+struct osc_aggregator {
+    struct osc_aggregator_buffer buffers[OSC_AGGREGATOR_BUFFERS];
+    uint32_t generation __attribute__((aligned(OSC_CACHE_LINE)));
+    size_t capacity;
+    size_t max_messages;
+    uint64_t max_delay_ns;
+    enum osc_aggregator_timetag policy;
+    uint64_t timetag_delay_ns;
+    osc_aggregator_sender sender;
+    void* context;
+    struct osc_aggregator_stats stats;
+};
+
+/**
+ * Creates a new osc_aggregator instance
+ *
+ * @param   agg                 pointer to the osc_aggregator structure
+ * @param   mtu                 the maximum size of a flushed bundle (0 for OSC_AGGREGATOR_DEFAULT_MTU, at least 24)
+ * @param   max_messages        the maximum number of messages per bundle (0 for no limit)
+ * @param   max_delay_ns        how long the first message of a bundle may wait before the bundle is flushed (0 for no limit)
+ * @param   policy              the timetag policy
+ * @param   timetag_delay_ns    the delay added to the timetag by the OSC_AGGREGATOR_FIRST_MESSAGE and OSC_AGGREGATOR_FLUSH_TIME policies
+ * @param   sender              the function sending the flushed bundles
+ * @param   context             the context passed to sender
+ * @return                      returns 0 on success or 1 if mtu is too small or memory allocation failed
+ */
+int osc_aggregator_new(struct osc_aggregator* agg, size_t mtu, size_t max_messages, uint64_t max_delay_ns,
+                       enum osc_aggregator_timetag policy, uint64_t timetag_delay_ns, osc_aggregator_sender sender, void* context);
+
+/**
+ * Flushes the pending messages, waits for the flushes in progress and destroys an osc_aggregator instance
+ * No producer may use the aggregator anymore
+ *
+ * @param   agg         pointer to the osc_aggregator structure
+ */
+void osc_aggregator_destroy(struct osc_aggregator* agg);
+
+/**
+ * Appends a packet to the current bundle (safe to call from any number of threads)
+ * The calling thread flushes the bundle if the packet does not fit or the bundle deadline has passed
+ *
+ * @param   agg         pointer to the osc_aggregator structure
+ * @param   data        pointer to the first byte of the packet (without the 4B length prefix)
+ * @param   length      the length of the packet
+ * @return              returns 0 on success or 1 if the packet does not fit into an empty bundle
+ */
+int osc_aggregator_add(struct osc_aggregator* agg, const void* data, size_t length);
+
+/**
+ * Appends an osc_message instance to the current bundle (see osc_aggregator_add)
+ *
+ * @param   agg         pointer to the osc_aggregator structure
+ * @param   msg         pointer to the osc_message structure
+ * @return              returns 0 on success or 1 if the message does not fit into an empty bundle
+ */
+int osc_aggregator_add_message(struct osc_aggregator* agg, const struct osc_message* msg);
+
+/**
+ * Flushes the current bundle if its deadline has passed; to be called periodically (at least every max_delay_ns)
+ * when producers may stay idle
+ *
+ * @param   agg         pointer to the osc_aggregator structure
+ * @return              returns 1 if a bundle was flushed or 0 otherwise
+ */
+int osc_aggregator_poll(struct osc_aggregator* agg);
+
+/**
+ * Flushes the current bundle if it holds any message
+ *
+ * @param   agg         pointer to the osc_aggregator structure
+ * @return              returns 1 if a bundle was flushed or 0 otherwise
+ */
+int osc_aggregator_flush(struct osc_aggregator* agg);
+
+/**
+ * Copies the counters of an osc_aggregator instance
+ *
+ * @param   agg         pointer to the osc_aggregator structure
+ * @param   stats       pointer to the osc_aggregator_stats structure to fill
+ */
+void osc_aggregator_stats(const struct osc_aggregator* agg, struct osc_aggregator_stats* stats);
+
+#endif //OSC_AGGREGATOR_H
@@ -0,0 +1,310 @@
+/** @file osc_alloc.c */
+
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include "osc_alloc.h"
+
+#define ALIGNMENT 16
+#define HEADER_SIZE 16
+#define ALIGN_UP(n) (((n) + ALIGNMENT - 1) & ~(size_t)(ALIGNMENT - 1))
+
+/**
+ * Structure representing an arena block, its data starts HEADER_SIZE bytes after the structure
+ */
+struct osc_arena_block {
+    struct osc_arena_block* next;
+    size_t size;
+    size_t used;
+};
+
+/**
+ * Structure representing a pool slab, its blocks start HEADER_SIZE bytes after the structure
+ */
+struct osc_pool_slab {
+    struct osc_pool_slab* next;
+};
+
+/**
+ * Structure stored in the HEADER_SIZE bytes in front of every arena or pool allocation
+ * size is the requested size, size_class the pool class (OSC_POOL_CLASSES for blocks from the C library heap)
+ */
+struct block_header {
+    size_t size;
+    size_t size_class;
+};
+
+/**
+ * Finds the header of an allocation
+ *
+ * @param   ptr     the allocation
+ * @return          pointer to its header
+ */
+static struct block_header* header_of(void* ptr)
+{
+return (struct block_header*)((char*)ptr - HEADER_SIZE);
+}
+
+/**
+ * Creates an arena block with room for at least the given number of bytes
+ *
+ * @param   size    the number of data bytes in the block
+ * @return          the new block or NULL if memory allocation failed
+ */
+static struct osc_arena_block* arena_block_new(size_t size)
+{
+    struct osc_arena_block* block = (struct osc_arena_block*)malloc(ALIGN_UP(sizeof(struct osc_arena_block)) + size);
+    if(block == NULL) {
+        return NULL;
+    }
+    block->next = NULL;
+    block->size = size;
+    block->used = 0;
+
+return block;
+}
+
+/**
+ * Finds the first data byte of an arena block
+ *
+ * @param   block   pointer to the block
+ * @return          pointer to the first data byte
+ */
+static char* arena_block_data(struct osc_arena_block* block)
+{
+return (char*)block + ALIGN_UP(sizeof(struct osc_arena_block));
+}
+
+/**
+ * The osc_allocator functions of an osc_arena
+ */
+static void* arena_allocate(void* context, size_t size)
+{
+    struct osc_arena* arena = (struct osc_arena*)context;
+    size_t needed = HEADER_SIZE + ALIGN_UP(size);
+    struct osc_arena_block* block = arena->current;
+    while(block != NULL && block->used + needed > block->size) {
+        block = block->next;
+    }
+    if(block == NULL) {
+        block = arena_block_new(needed > arena->block_size ? needed : arena->block_size);
+        if(block == NULL) {
+            return NULL;
+        }
+        block->next = arena->current->next;
+        arena->current->next = block;
+    }
+    arena->current = block;
+    struct block_header* header = (struct block_header*)(arena_block_data(block) + block->used);
+    header->size = size;
+    header->size_class = 0;
+    block->used += needed;
+    arena->last = (char*)header + HEADER_SIZE;
+
+return arena->last;
+}
+
+static void* arena_reallocate(void* context, void* ptr, size_t size)
+{
+    struct osc_arena* arena = (struct osc_arena*)context;
+    struct block_header* header = header_of(ptr);
+    size_t old_size = header->size;
+    if(ptr == arena->last) {
+        struct osc_arena_block* block = arena->current;
+        size_t start = (char*)ptr - arena_block_data(block);
+        if(start + ALIGN_UP(size) <= block->size) {
+            block->used = start + ALIGN_UP(size);
+            header->size = size;
+            return ptr;
+        }
+    }
+    else if(size <= old_size) {
+        return ptr;
+    }
+    void* new_ptr = arena_allocate(context, size);
+    if(new_ptr == NULL) {
+        return NULL;
+    }
+    memcpy(new_ptr, ptr, old_size < size ? old_size : size);
+
+return new_ptr;
+}
+
+static void arena_deallocate(void* context, void* ptr)
+{
+    struct osc_arena* arena = (struct osc_arena*)context;
+    if(ptr == arena->last) {
+        arena->current->used = (char*)ptr - HEADER_SIZE - arena_block_data(arena->current);
+        arena->last = NULL;
+    }
+}
+
+int osc_arena_new(struct osc_arena* arena, size_t block_size)
+{
+    memset(arena, 0, sizeof(*arena));
+    arena->block_size = block_size == 0 ? OSC_ARENA_DEFAULT_BLOCK_SIZE : ALIGN_UP(block_size);
+    arena->first = arena_block_new(arena->block_size);
+    if(arena->first == NULL) {
+        return 1;
+    }
+    arena->current = arena->first;
+    arena->allocator.allocate = arena_allocate;
+    arena->allocator.reallocate = arena_reallocate;
+    arena->allocator.deallocate = arena_deallocate;
+    arena->allocator.context = arena;
+
+return 0;
+}
+
+void osc_arena_reset(struct osc_arena* arena)
+{
+    for(struct osc_arena_block* block = arena->first; block != NULL; block = block->next) {
+        block->used = 0;
+    }
+    arena->current = arena->first;
+    arena->last = NULL;
+}
+
+void osc_arena_destroy(struct osc_arena* arena)
+{
+    struct osc_arena_block* block = arena->first;
+    while(block != NULL) {
+        struct osc_arena_block* next = block->next;
+        free(block);
+        block = next;
+    }
+    memset(arena, 0, sizeof(*arena));
+}
+
+/**
+ * Finds the pool class of an allocation size
+ *
+ * @param   size    the requested size
+ * @return          the class index or OSC_POOL_CLASSES if the size is larger than the biggest class
+ */
+static size_t pool_class(size_t size)
+{
+    size_t size_class = 0;
+    size_t class_size = OSC_POOL_MIN_SIZE;
+    while(size_class < OSC_POOL_CLASSES && class_size < size) {
+        class_size <<= 1;
+        size_class++;
+    }
+
+return size_class;
+}
+
+/**
+ * Carves a new slab into blocks of the given class and puts them on the class free list
+ *
+ * @param   pool        pointer to the osc_pool structure
+ * @param   size_class  the class index
+ * @return              returns 0 on success or 1 if memory allocation failed
+ */
+static int pool_refill(struct osc_pool* pool, size_t size_class)
+{
+    size_t block_size = HEADER_SIZE + ((size_t)OSC_POOL_MIN_SIZE << size_class);
+    size_t count = OSC_POOL_SLAB_SIZE / block_size;
+    struct osc_pool_slab* slab = (struct osc_pool_slab*)malloc(HEADER_SIZE + count * block_size);
+    if(slab == NULL) {
+        return 1;
+    }
+    slab->next = pool->slabs;
+    pool->slabs = slab;
+    char* p_block = (char*)slab + HEADER_SIZE;
+    for(size_t i = 0; i < count; i++, p_block += block_size) {
+        struct block_header* header = (struct block_header*)p_block;
+        header->size_class = size_class;
+        void** link = (void**)(p_block + HEADER_SIZE);
+        *link = pool->free_lists[size_class];
+        pool->free_lists[size_class] = link;
+    }
+
+return 0;
+}
+
+/**
+ * The osc_allocator functions of an osc_pool
+ */
+static void* pool_allocate(void* context, size_t size)
+{
+    struct osc_pool* pool = (struct osc_pool*)context;
+    size_t size_class = pool_class(size);
+    if(size_class == OSC_POOL_CLASSES) {
+        struct block_header* header = (struct block_header*)malloc(HEADER_SIZE + size);
+        if(header == NULL) {
+            return NULL;
+        }
+        header->size = size;
+        header->size_class = OSC_POOL_CLASSES;
+        return (char*)header + HEADER_SIZE;
+    }
+    if(pool->free_lists[size_class] == NULL && pool_refill(pool, size_class) == 1) {
+        return NULL;
+    }
+    void** link = (void**)pool->free_lists[size_class];
+    pool->free_lists[size_class] = *link;
+    header_of(link)->size = size;
+
+return link;
+}
+
+static void pool_deallocate(void* context, void* ptr)
+{
+    struct osc_pool* pool = (struct osc_pool*)context;
+    struct block_header* header = header_of(ptr);
+    if(header->size_class == OSC_POOL_CLASSES) {
+        free(header);
+        return;
+    }
+    void** link = (void**)ptr;
+    *link = pool->free_lists[header->size_class];
+    pool->free_lists[header->size_class] = link;
+}
+
+static void* pool_reallocate(void* context, void* ptr, size_t size)
+{
+    struct block_header* header = header_of(ptr);
+    if(header->size_class == OSC_POOL_CLASSES && pool_class(size) == OSC_POOL_CLASSES) {
+        header = (struct block_header*)realloc(header, HEADER_SIZE + size);
+        if(header == NULL) {
+            return NULL;
+        }
+        header->size = size;
+        return (char*)header + HEADER_SIZE;
+    }
+    if(header->size_class < OSC_POOL_CLASSES && size <= ((size_t)OSC_POOL_MIN_SIZE << header->size_class)) {
+        header->size = size;
+        return ptr;
+    }
+    void* new_ptr = pool_allocate(context, size);
+    if(new_ptr == NULL) {
+        return NULL;
+    }
+    memcpy(new_ptr, ptr, header->size < size ? header->size : size);
+    pool_deallocate(context, ptr);
+
+return new_ptr;
+}
+
+int osc_pool_new(struct osc_pool* pool)
+{
+    memset(pool, 0, sizeof(*pool));
+    pool->allocator.allocate = pool_allocate;
+    pool->allocator.reallocate = pool_reallocate;
+    pool->allocator.deallocate = pool_deallocate;
+    pool->allocator.context = pool;
+
+return 0;
+}
+
+void osc_pool_destroy(struct osc_pool* pool)
+{
+    struct osc_pool_slab* slab = pool->slabs;
+    while(slab != NULL) {
+        struct osc_pool_slab* next = slab->next;
+        free(slab);
+        slab = next;
+    }
+    memset(pool, 0, sizeof(*pool));
+}
@@ -0,0 +1,85 @@
+/** @file osc_alloc.h */
+
+#ifndef OSC_ALLOC_H
+#define OSC_ALLOC_H
+
+#include <stdint.h>
+#include <stdlib.h>
+#include "osc.h"
+
+#define OSC_ARENA_DEFAULT_BLOCK_SIZE 65536
+#define OSC_POOL_CLASSES 8
+#define OSC_POOL_MIN_SIZE 64
+#define OSC_POOL_SLAB_SIZE 65536
+
+struct osc_arena_block;
+struct osc_pool_slab;
+
+/**
+ * Structure representing an osc_arena (a bump allocator)
+ * Allocations are carved from a chain of blocks of block_size bytes and are all released at once by osc_arena_reset;
+ * freeing or growing the most recent allocation (last) is done in place, any other free is a no-op
+ * allocator is the osc_allocator to hand to osc_set_thread_allocator or to the *_with_allocator functions
+ * An arena is not thread-safe, use one per thread
+ */
+struct osc_arena {
+    struct osc_arena_block* first;
+    struct osc_arena_block* current;
+    size_t block_size;
+    void* last;
+    struct osc_allocator allocator;
+};
+
+/**
+ * Structure representing an osc_pool (a size-class allocator)
+ * Blocks of OSC_POOL_MIN_SIZE to OSC_POOL_MIN_SIZE << (OSC_POOL_CLASSES - 1) bytes (64B to 8KB, which covers MTU-sized
+ * packets) are carved from slabs and recycled through one free list per class; larger blocks go to the C library heap
+ * allocator is the osc_allocator to hand to osc_set_thread_allocator or to the *_with_allocator functions
+ * A pool is not thread-safe, use one per thread
+ */
+struct osc_pool {
+    void* free_lists[OSC_POOL_CLASSES];
+    struct osc_pool_slab* slabs;
+    struct osc_allocator allocator;
+};
+
+/**
+ * Creates a new osc_arena instance by allocating its first block
+ *
+ * @param   arena       pointer to the osc_arena structure
+ * @param   block_size  the size of the arena blocks (0 for OSC_ARENA_DEFAULT_BLOCK_SIZE)
+ * @return              returns 0 on success or 1 if memory allocation failed
+ */
+int osc_arena_new(struct osc_arena* arena, size_t block_size);
+
+/**
+ * Releases every allocation made from the arena at once, keeping its blocks for reuse
+ *
+ * @param   arena       pointer to the osc_arena structure
+ */
+void osc_arena_reset(struct osc_arena* arena);
+
+/**
+ * Destroys an osc_arena instance by freeing all of its blocks
+ *
+ * @param   arena       pointer to the osc_arena structure
+ */
+void osc_arena_destroy(struct osc_arena* arena);
+
+/**
+ * Creates a new osc_pool instance (slabs are allocated on demand)
+ *
+ * @param   pool        pointer to the osc_pool structure
+ * @return              returns 0 on success
+ */
+int osc_pool_new(struct osc_pool* pool);
+
+/**
+ * Destroys an osc_pool instance by freeing all of its slabs
+ * Blocks larger than the biggest class that are still in use are not freed
+ *
+ * @param   pool        pointer to the osc_pool structure
+ */
+void osc_pool_destroy(struct osc_pool* pool);
+
+#endif //OSC_ALLOC_H
@@ -0,0 +1,426 @@
+/** @file osc_binding.c */
+
+#ifndef _DEFAULT_SOURCE
+    #define _DEFAULT_SOURCE
+#endif // _DEFAULT_SOURCE
+
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <endian.h>
+#include "osc_binding.h"
+#include "osc_dispatch.h"
+
+#define STEP_WORDS 0
+#define STEP_STRING 1
+#define STEP_BLOB 2
+#define NO_BINDING SIZE_MAX
+
+/**
+ * Structure representing one step of a compiled decode routine
+ * skip is the number of argument bytes to step over first (arguments bound to no field), then a STEP_WORDS step
+ * converts count 4B words to the struct bytes at offset, and a STEP_STRING or STEP_BLOB step stores one argument
+ * at offset (nothing for OSC_BINDING_SKIP) and steps over it
+ */
+struct osc_binding_step {
+    int kind;
+    size_t skip;
+    size_t count;
+    size_t offset;
+};
+
+/**
+ * Structure representing a resolved incoming address
+ * the entry is valid only while generation equals the generation of the binder
+ */
+struct osc_binder_cache_entry {
+    uint64_t hash;
+    uint64_t generation;
+    char* address;
+    size_t address_length;
+    size_t address_capacity;
+    size_t binding;
+};
+
+/**
+ * Finds the padded size of a string argument
+ *
+ * @param   p       pointer to the first byte of the argument
+ * @return          the number of bytes the argument takes
+ */
+static size_t string_size(const char* p)
+{
+    size_t length = strlen(p);
+
+return length + (4 - (length % 4));
+}
+
+/**
+ * Reads a big-endian 4B value from possibly unaligned memory
+ *
+ * @param   p       pointer to the first byte of the value
+ * @return          the value in the host endianity
+ */
+static uint32_t load_be32(const char* p)
+{
+    uint32_t be_value;
+    memcpy(&be_value, p, sizeof(uint32_t));
+
+return be32toh(be_value);
+}
+
+/**
+ * Compiles the decode routine of a binding from its typetag and field offsets
+ *
+ * @param   binding     pointer to the osc_binding structure (typetag, typetag_length and offsets already set)
+ * @return              returns 0 on success or 1 if the typetag is invalid or memory allocation failed
+ */
+static int compile_steps(struct osc_binding* binding)
+{
+    size_t argc = binding->typetag_length - 1;
+    binding->steps = (struct osc_binding_step*)malloc((argc > 0 ? argc : 1) * sizeof(struct osc_binding_step));
+    if(binding->steps == NULL) {
+        return 1;
+    }
+    size_t skip = 0;
+    for(size_t i = 0; i < argc; i++) {
+        char tag = binding->typetag[i + 1];
+        size_t offset = binding->offsets[i];
+        size_t words = 0;
+        switch(tag) {
+            case OSC_TT_INT:
+            case OSC_TT_FLOAT:   words = 1; break;
+            case OSC_TT_TIMETAG: words = 2; break;
+            case OSC_TT_STRING:
+            case OSC_TT_BLOB:    break;
+            default:             return 1;
+        }
+        if(words > 0 && offset == OSC_BINDING_SKIP) {
+            skip += 4 * words;
+            continue;
+        }
+        struct osc_binding_step* last = binding->step_count > 0 ? &binding->steps[binding->step_count - 1] : NULL;
+        // a word run continues the previous one when both the arguments and the fields are adjacent
+        if(words > 0 && skip == 0 && last != NULL && last->kind == STEP_WORDS && offset == last->offset + 4 * last->count) {
+            last->count += words;
+            continue;
+        }
+        struct osc_binding_step* step = &binding->steps[binding->step_count++];
+        step->kind = words > 0 ? STEP_WORDS : (tag == OSC_TT_STRING ? STEP_STRING : STEP_BLOB);
+        step->skip = skip;
+        step->count = words;
+        step->offset = offset;
+        skip = 0;
+    }
+
+return 0;
+}
+
+/**
+ * Runs the compiled decode routine of a binding over the arguments of a message with the expected typetag
+ *
+ * @param   binding     pointer to the osc_binding structure
+ * @param   arguments   pointer to the first byte of the first argument
+ * @param   out         pointer to the struct to fill
+ */
+static void run_steps(const struct osc_binding* binding, const char* arguments, char* out)
+{
+    const char* src = arguments;
+    for(size_t i = 0; i < binding->step_count; i++) {
+        const struct osc_binding_step* step = &binding->steps[i];
+        src += step->skip;
+        switch(step->kind) {
+            case STEP_WORDS:
+                if(step->count < 4) {
+                    for(size_t k = 0; k < step->count; k++) {
+                        uint32_t value = load_be32(src + 4 * k);
+                        memcpy(out + step->offset + 4 * k, &value, sizeof(uint32_t));
+                    }
+                }
+                else {
+                    osc_bswap32_array(out + step->offset, src, step->count);
+                }
+                src += 4 * step->count;
+                break;
+            case STEP_STRING:
+                if(step->offset != OSC_BINDING_SKIP) {
+                    memcpy(out + step->offset, &src, sizeof(const char*));
+                }
+                src += string_size(src);
+                break;
+            case STEP_BLOB: {
+                size_t length = load_be32(src);
+                if(step->offset != OSC_BINDING_SKIP) {
+                    struct osc_arg arg;
+                    arg.type = OSC_TT_BLOB;
+                    arg.data = (const union osc_msg_argument*)src;
+                    arg.length = length;
+                    memcpy(out + step->offset, &arg, sizeof(struct osc_arg));
+                }
+                src += 4 + ((length + 3) & ~(size_t)3);
+                break;
+            }
+        }
+    }
+}
+
+/**
+ * Stores one argument into its field, converting 'i' and 'f' into each other
+ *
+ * @param   tag         the expected tag of the argument
+ * @param   arg         pointer to the osc_arg structure yielded by the cursor
+ * @param   field       pointer to the first byte of the field
+ * @return              returns 0 on success or 1 if the argument type is incompatible
+ */
+static int store_field(char tag, const struct osc_arg* arg, char* field)
+{
+    const char* src = (const char*)arg->data;
+    if(tag == OSC_TT_INT && arg->type == OSC_TT_FLOAT) {
+        uint32_t bits = load_be32(src);
+        float value;
+        memcpy(&value, &bits, sizeof(float));
+        // out of range values saturate, NaN becomes INT32_MIN
+        int32_t converted = value >= 2147483647.0f ? INT32_MAX : (value > -2147483648.0f ? (int32_t)value : INT32_MIN);
+        memcpy(field, &converted, sizeof(int32_t));
+        return 0;
+    }
+    if(tag == OSC_TT_FLOAT && arg->type == OSC_TT_INT) {
+        float converted = (float)(int32_t)load_be32(src);
+        memcpy(field, &converted, sizeof(float));
+        return 0;
+    }
+    if(tag != arg->type) {
+        return 1;
+    }
+    switch(tag) {
+        case OSC_TT_INT:
+        case OSC_TT_FLOAT:
+        case OSC_TT_TIMETAG:
+            for(size_t k = 0; k < (tag == OSC_TT_TIMETAG ? 2 : 1); k++) {
+                uint32_t value = load_be32(src + 4 * k);
+                memcpy(field + 4 * k, &value, sizeof(uint32_t));
+            }
+            break;
+        case OSC_TT_STRING:
+            memcpy(field, &src, sizeof(const char*));
+            break;
+        case OSC_TT_BLOB:
+            memcpy(field, arg, sizeof(struct osc_arg));
+            break;
+    }
+
+return 0;
+}
+
+/**
+ * Decodes a message with a binding (see osc_binding_decode), telling which path was taken
+ *
+ * @param   binding     pointer to the osc_binding structure
+ * @param   msg         pointer to the osc_message_view structure
+ * @param   out         pointer to the struct to fill
+ * @param   fast        set to 1 if the compiled routine was used or 0 for the generic path
+ * @return              returns 0 on success or 1 if an argument is missing or has an incompatible type
+ */
+static int decode(const struct osc_binding* binding, const struct osc_message_view* msg, void* out, int* fast)
+{
+    *fast = strncmp(msg->typetag, binding->typetag, binding->typetag_length + 1) == 0;
+    if(*fast) {
+        run_steps(binding, msg->arguments, (char*)out);
+        return 0;
+    }
+    struct osc_arg_cursor cursor;
+    struct osc_arg arg;
+    osc_arg_cursor_init_view(&cursor, msg);
+    for(size_t i = 0; i + 1 < binding->typetag_length; i++) {
+        if(osc_arg_cursor_next(&cursor, &arg) == 1) {
+            return 1;
+        }
+        if(binding->offsets[i] != OSC_BINDING_SKIP &&
+           store_field(binding->typetag[i + 1], &arg, (char*)out + binding->offsets[i]) == 1) {
+            return 1;
+        }
+    }
+
+return 0;
+}
+
+/**
+ * Frees the memory of a binding
+ *
+ * @param   binding     pointer to the osc_binding structure
+ */
+static void binding_destroy(struct osc_binding* binding)
+{
+    free(binding->pattern);
+    free(binding->typetag);
+    free(binding->offsets);
+    free(binding->steps);
+}
+
+/**
+ * Finds the first binding from a given index on whose pattern matches an address
+ *
+ * @param   binder      pointer to the osc_binder structure
+ * @param   address     the address to match
+ * @param   first       the index of the first binding to try
+ * @return              the index of the binding or NO_BINDING
+ */
+static size_t find_binding(const struct osc_binder* binder, const char* address, size_t first)
+{
+    for(size_t i = first; i < binder->binding_count; i++) {
+        if(osc_pattern_match(binder->bindings[i].pattern, address)) {
+            return i;
+        }
+    }
+
+return NO_BINDING;
+}
+
+/**
+ * Finds the binding of an address through the cache, resolving and remembering it on a miss
+ *
+ * @param   binder      pointer to the osc_binder structure
+ * @param   address     the address to resolve
+ * @return              the index of the binding or NO_BINDING
+ */
+static size_t resolve(struct osc_binder* binder, const char* address)
+{
+    if(binder->cache_size == 0) {
+        return find_binding(binder, address, 0);
+    }
+    size_t addr_length = strlen(address);
+    uint64_t hash = osc_hash_bytes(address, addr_length);
+    struct osc_binder_cache_entry* entry = &binder->cache[hash & (binder->cache_size - 1)];
+    if(entry->generation == binder->generation && entry->hash == hash &&
+       entry->address_length == addr_length && memcmp(entry->address, address, addr_length) == 0) {
+        return entry->binding;
+    }
+    size_t binding = find_binding(binder, address, 0);
+    entry->generation = 0;
+    if(entry->address_capacity < addr_length + 1) {
+        char* memory_alloc = (char*)realloc(entry->address, addr_length + 1);
+        if(memory_alloc == NULL) {
+            return binding;
+        }
+        entry->address = memory_alloc;
+        entry->address_capacity = addr_length + 1;
+    }
+    memcpy(entry->address, address, addr_length + 1);
+    entry->address_length = addr_length;
+    entry->hash = hash;
+    entry->binding = binding;
+    entry->generation = binder->generation;
+
+return binding;
+}
+
+int osc_binder_new(struct osc_binder* binder, size_t cache_size)
+{
+    memset(binder, 0, sizeof(*binder));
+    binder->generation = 1;
+    if(cache_size > 0) {
+        size_t slots = 1;
+        while(slots < cache_size) {
+            slots *= 2;
+        }
+        binder->cache = (struct osc_binder_cache_entry*)calloc(slots, sizeof(struct osc_binder_cache_entry));
+        if(binder->cache == NULL) {
+            return 1;
+        }
+        binder->cache_size = slots;
+    }
+
+return 0;
+}
+
+void osc_binder_destroy(struct osc_binder* binder)
+{
+    for(size_t i = 0; i < binder->binding_count; i++) {
+        binding_destroy(&binder->bindings[i]);
+    }
+    free(binder->bindings);
+    for(size_t i = 0; i < binder->cache_size; i++) {
+        free(binder->cache[i].address);
+    }
+    free(binder->cache);
+    memset(binder, 0, sizeof(*binder));
+}
+
+int osc_binder_add(struct osc_binder* binder, const char* pattern, const char* typetag, const size_t* offsets, size_t* binding)
+{
+    if(typetag[0] != ',') {
+        return 1;
+    }
+    if(binder->binding_count == binder->binding_capacity) {
+        size_t new_capacity = binder->binding_capacity == 0 ? 4 : binder->binding_capacity * 2;
+        struct osc_binding* memory_alloc = (struct osc_binding*)realloc(binder->bindings,
+                                                                        new_capacity * sizeof(struct osc_binding));
+        if(memory_alloc == NULL) {
+            return 1;
+        }
+        binder->bindings = memory_alloc;
+        binder->binding_capacity = new_capacity;
+    }
+    struct osc_binding* new_binding = &binder->bindings[binder->binding_count];
+    memset(new_binding, 0, sizeof(*new_binding));
+    new_binding->typetag_length = strlen(typetag);
+    size_t argc = new_binding->typetag_length - 1;
+    new_binding->pattern = strdup(pattern);
+    new_binding->typetag = strdup(typetag);
+    new_binding->offsets = (size_t*)malloc((argc > 0 ? argc : 1) * sizeof(size_t));
+    if(new_binding->pattern == NULL || new_binding->typetag == NULL || new_binding->offsets == NULL) {
+        binding_destroy(new_binding);
+        return 1;
+    }
+    if(argc > 0) {
+        memcpy(new_binding->offsets, offsets, argc * sizeof(size_t));
+    }
+    if(compile_steps(new_binding) == 1) {
+        binding_destroy(new_binding);
+        return 1;
+    }
+    if(binding != NULL) {
+        *binding = binder->binding_count;
+    }
+    binder->binding_count++;
+    binder->generation++;
+
+return 0;
+}
+
+int osc_binding_decode(const struct osc_binding* binding, const struct osc_message_view* msg, void* out)
+{
+    int fast = 0;
+
+return decode(binding, msg, out, &fast);
+}
+
+int osc_binder_decode(struct osc_binder* binder, const struct osc_message_view* msg, void* out, size_t* binding)
+{
+    size_t index = resolve(binder, msg->address);
+    int fast = 0;
+    while(index != NO_BINDING && decode(&binder->bindings[index], msg, out, &fast) == 1) {
+        // the message does not convert to this binding, a later one matching the address may accept it
+        index = find_binding(binder, msg->address, index + 1);
+    }
+    if(index == NO_BINDING) {
+        binder->stats.unmatched++;
+        return 1;
+    }
+    if(fast) {
+        binder->stats.fast++;
+    }
+    else {
+        binder->stats.fallback++;
+    }
+    if(binding != NULL) {
+        *binding = index;
+    }
+
+return 0;
+}
+
+void osc_binder_stats(const struct osc_binder* binder, struct osc_binder_stats* stats)
+{
+    *stats = binder->stats;
+}
@@ -0,0 +1,123 @@
+/** @file osc_binding.h */
+
+#ifndef OSC_BINDING_H
+#define OSC_BINDING_H
+
+#include <stdint.h>
+#include <stdlib.h>
+#include "osc.h"
+
+#define OSC_BINDING_SKIP SIZE_MAX
+#define OSC_BINDER_DEFAULT_CACHE_SIZE 256
+
+struct osc_binding_step;
+struct osc_binder_cache_entry;
+
+/**
+ * Structure representing a binding of the messages matching an address pattern to the fields of a user struct
+ * offsets holds the struct offset of the field of every argument of the expected typetag (OSC_BINDING_SKIP to ignore
+ * the argument): an int32_t for 'i', a float for 'f', a struct osc_timetag for 't', a const char* pointing into the
+ * message for 's' and a struct osc_arg for 'b'
+ * steps is the decode routine compiled from the typetag and the offsets when the binding is added: consecutive
+ * 4B words landing in consecutive struct bytes are converted by a single step
+ */
+struct osc_binding {
+    char* pattern;
+    char* typetag;
+    size_t typetag_length;
+    size_t* offsets;
+    struct osc_binding_step* steps;
+    size_t step_count;
+};
+
+/**
+ * Structure representing the osc_binder counters
+ * fast counts the messages decoded by a compiled routine, fallback the ones whose typetag differed from the expected
+ * one and went through the generic path, unmatched the messages no binding matched or every matching binding refused
+ */
+struct osc_binder_stats {
+    uint64_t fast;
+    uint64_t fallback;
+    uint64_t unmatched;
+};
+
+/**
+ * Structure representing an osc_binder, the set of bindings messages are decoded with
+ * bindings is an array indexed by the binding indices osc_binder_add returns (it moves when a binding is added)
+ * cache is a direct-mapped table of recently resolved incoming addresses (cache_size slots, a power of two or 0)
+ * remembering which binding each one matched; generation is bumped on every osc_binder_add, which invalidates it
+ */
+struct osc_binder {
+    struct osc_binding* bindings;
+    size_t binding_count;
+    size_t binding_capacity;
+    struct osc_binder_cache_entry* cache;
+    size_t cache_size;
+    uint64_t generation;
+    struct osc_binder_stats stats;
+};
+
+/**
+ * Creates a new osc_binder instance
+ *
+ * @param   binder      pointer to the osc_binder structure
+ * @param   cache_size  the number of resolved addresses to remember (rounded up to a power of two, 0 disables the cache)
+ * @return              returns 0 on success or 1 if memory allocation failed
+ */
+int osc_binder_new(struct osc_binder* binder, size_t cache_size);
+
+/**
+ * Destroys an osc_binder instance by freeing its bindings and its cache
+ *
+ * @param   binder      pointer to the osc_binder structure
+ */
+void osc_binder_destroy(struct osc_binder* binder);
+
+/**
+ * Adds a binding; when several bindings match an address, the first one added that accepts the message wins
+ *
+ * @param   binder      pointer to the osc_binder structure
+ * @param   pattern     the address pattern of the bound messages (may contain the OSC pattern syntax)
+ * @param   typetag     the expected typetag (starting with ','), made of 'i', 'f', 't', 's' and 'b' tags only
+ * @param   offsets     the struct offset of the field of every argument (see osc_binding)
+ * @param   binding     set to the index of the new binding (may be NULL)
+ * @return              returns 0 on success or 1 if the typetag is invalid or memory allocation failed
+ */
+int osc_binder_add(struct osc_binder* binder, const char* pattern, const char* typetag, const size_t* offsets, size_t* binding);
+
+/**
+ * Decodes a message into a struct with a given binding, whatever its address
+ * A message with the expected typetag is decoded by the compiled routine, after a single typetag compare; any other
+ * message goes through the generic path, which walks its arguments and converts 'i' and 'f' into each other
+ *
+ * @param   binding     pointer to the osc_binding structure
+ * @param   msg         pointer to the osc_message_view structure
+ * @param   out         pointer to the struct to fill
+ * @return              returns 0 on success or 1 if an argument is missing or has an incompatible type (out may then be
+ *                      partially filled)
+ */
+int osc_binding_decode(const struct osc_binding* binding, const struct osc_message_view* msg, void* out);
+
+/**
+ * Decodes a message into a struct with the first binding whose pattern matches its address
+ * When that binding refuses the message (see osc_binding_decode), the next bindings matching the address are tried in
+ * the order they were added; the cache only remembers the first matching binding, so the others are found by a scan
+ *
+ * @param   binder      pointer to the osc_binder structure
+ * @param   msg         pointer to the osc_message_view structure
+ * @param   out         pointer to the struct to fill
+ * @param   binding     set to the index of the binding used (may be NULL)
+ * @return              returns 0 on success or 1 if no binding matches or every matching binding refused the message
+ *                      (out may then be partially filled)
+ */
+int osc_binder_decode(struct osc_binder* binder, const struct osc_message_view* msg, void* out, size_t* binding);
+
+/**
+ * Copies the counters of an osc_binder instance
+ *
+ * @param   binder      pointer to the osc_binder structure
+ * @param   stats       pointer to the osc_binder_stats structure to fill
+ */
+void osc_binder_stats(const struct osc_binder* binder, struct osc_binder_stats* stats);
+
+#endif //OSC_BINDING_H
@@ -0,0 +1,563 @@
+/** @file osc_capture.c */
+
+#ifndef _GNU_SOURCE
+    #define _GNU_SOURCE
+#endif // _GNU_SOURCE
+
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <time.h>
+#include <endian.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include "osc_capture.h"
+
+#define CAPTURE_MAGIC "OSCCAPT"
+#define CAPTURE_VERSION 1
+#define CAPTURE_INITIAL_MAP_SIZE (1 << 20)
+#define RECORD_PACKET 1
+#define RECORD_INDEX 2
+#define ALIGN8(size) (((size) + 7) & ~(size_t)7)
+
+/**
+ * Structure representing the header at the start of a capture file
+ * end is updated after every record, so that a file left by a crashed writer can still be read up to its last record
+ */
+struct file_header {
+    char magic[8];
+    uint32_t version;
+    uint32_t index_interval;
+    uint64_t end;
+    uint64_t last_index;
+    uint64_t packet_count;
+    char reserved[24];
+};
+
+/**
+ * Structure representing the header of a record, followed by size payload bytes and the padding to 8B
+ */
+struct record_header {
+    uint64_t timestamp_ns;
+    uint32_t size;
+    uint16_t kind;
+    uint16_t reserved;
+};
+
+/**
+ * Structure representing the start of an index block payload, followed by count osc_capture_index_entry structures
+ * previous is the offset of the previous index block (0 for the first one)
+ */
+struct index_header {
+    uint64_t previous;
+    uint32_t count;
+    uint32_t reserved;
+};
+
+uint32_t osc_capture_address_hash(const char* address)
+{
+    uint32_t hash = 2166136261u;
+    for(const unsigned char* p = (const unsigned char*)address; *p != '\0'; p++) {
+        hash ^= *p;
+        hash *= 16777619u;
+    }
+
+return hash;
+}
+
+uint64_t osc_capture_time_ns(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_REALTIME, &ts);
+
+return (uint64_t)ts.tv_sec * 1000000000ULL + (uint64_t)ts.tv_nsec;
+}
+
+/**
+ * Finds the address of a packet ("#bundle" for bundles)
+ *
+ * @param   data    pointer to the first byte of the packet
+ * @param   length  the length of the packet
+ * @return          pointer to the address or NULL if the packet does not start with a terminated string
+ */
+static const char* packet_address(const char* data, size_t length)
+{
+    if(length >= 8 && memcmp(data, "#bundle", 8) == 0) {
+        return "#bundle";
+    }
+    if(memchr(data, '\0', length) == NULL) {
+        return NULL;
+    }
+
+return data;
+}
+
+/**
+ * Grows the file and its mapping so that it can hold size more bytes
+ *
+ * @param   writer  pointer to the osc_capture_writer structure
+ * @param   size    the number of bytes to append
+ * @return          returns 0 on success or 1 if the file could not be grown or remapped
+ */
+static int reserve(struct osc_capture_writer* writer, size_t size)
+{
+    if(writer->end + size <= writer->map_size) {
+        return 0;
+    }
+    size_t new_size = writer->map_size;
+    while(new_size < writer->end + size) {
+        new_size *= 2;
+    }
+    if(ftruncate(writer->fd, (off_t)new_size) != 0) {
+        return 1;
+    }
+    void* map = mremap(writer->map, writer->map_size, new_size, MREMAP_MAYMOVE);
+    if(map == MAP_FAILED) {
+        return 1;
+    }
+    writer->map = (char*)map;
+    writer->map_size = new_size;
+
+return 0;
+}
+
+/**
+ * Writes the header of a new record at the end of the file
+ *
+ * @param   writer          pointer to the osc_capture_writer structure
+ * @param   timestamp_ns    the timestamp of the record
+ * @param   kind            RECORD_PACKET or RECORD_INDEX
+ * @param   size            the size of the payload
+ * @return                  pointer to the first payload byte or NULL if the file could not be grown
+ */
+static char* begin_record(struct osc_capture_writer* writer, uint64_t timestamp_ns, uint16_t kind, size_t size)
+{
+    if(size > UINT32_MAX || reserve(writer, sizeof(struct record_header) + ALIGN8(size)) == 1) {
+        return NULL;
+    }
+    struct record_header header;
+    header.timestamp_ns = timestamp_ns;
+    header.size = (uint32_t)size;
+    header.kind = kind;
+    header.reserved = 0;
+    char* p_record = writer->map + writer->end;
+    memcpy(p_record, &header, sizeof(header));
+    memset(p_record + sizeof(header) + size, 0, ALIGN8(size) - size);
+
+return p_record + sizeof(header);
+}
+
+/**
+ * Publishes the record started by begin_record by moving the end of the file past it
+ *
+ * @param   writer  pointer to the osc_capture_writer structure
+ * @param   size    the size of the payload
+ */
+static void commit_record(struct osc_capture_writer* writer, size_t size)
+{
+    struct file_header* header = (struct file_header*)writer->map;
+    writer->end += sizeof(struct record_header) + ALIGN8(size);
+    header->packet_count = writer->packet_count;
+    header->last_index = writer->last_index;
+    __atomic_store_n(&header->end, (uint64_t)writer->end, __ATOMIC_RELEASE);
+}
+
+/**
+ * Writes the index block of the pending packets
+ *
+ * @param   writer  pointer to the osc_capture_writer structure
+ * @return          returns 0 on success or 1 if the file could not be grown
+ */
+static int write_index(struct osc_capture_writer* writer)
+{
+    size_t size = sizeof(struct index_header) + writer->pending_count * sizeof(struct osc_capture_index_entry);
+    char* payload = begin_record(writer, writer->pending[0].timestamp_ns, RECORD_INDEX, size);
+    if(payload == NULL) {
+        return 1;
+    }
+    struct index_header header;
+    header.previous = writer->last_index;
+    header.count = (uint32_t)writer->pending_count;
+    header.reserved = 0;
+    memcpy(payload, &header, sizeof(header));
+    memcpy(payload + sizeof(header), writer->pending, writer->pending_count * sizeof(struct osc_capture_index_entry));
+    writer->last_index = writer->end;
+    writer->pending_count = 0;
+    commit_record(writer, size);
+
+return 0;
+}
+
+/**
+ * Releases what a failed osc_capture_writer_open had acquired
+ *
+ * @param   writer  pointer to the osc_capture_writer structure
+ * @return          always 1, for convenience
+ */
+static int abort_open(struct osc_capture_writer* writer)
+{
+    if(writer->map != NULL) {
+        munmap(writer->map, writer->map_size);
+    }
+    if(writer->fd >= 0) {
+        close(writer->fd);
+    }
+    free(writer->pending);
+    memset(writer, 0, sizeof(*writer));
+    writer->fd = -1;
+
+return 1;
+}
+
+int osc_capture_writer_open(struct osc_capture_writer* writer, const char* path, size_t index_interval)
+{
+    memset(writer, 0, sizeof(*writer));
+    writer->index_interval = index_interval == 0 ? OSC_CAPTURE_DEFAULT_INDEX_INTERVAL : index_interval;
+    writer->map_size = CAPTURE_INITIAL_MAP_SIZE;
+    writer->pending = (struct osc_capture_index_entry*)malloc(writer->index_interval * sizeof(struct osc_capture_index_entry));
+    writer->fd = open(path, O_RDWR | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+    if(writer->pending == NULL || writer->fd < 0 || ftruncate(writer->fd, (off_t)writer->map_size) != 0) {
+        return abort_open(writer);
+    }
+    void* map = mmap(NULL, writer->map_size, PROT_READ | PROT_WRITE, MAP_SHARED, writer->fd, 0);
+    if(map == MAP_FAILED) {
+        return abort_open(writer);
+    }
+    writer->map = (char*)map;
+    struct file_header header;
+    memset(&header, 0, sizeof(header));
+    memcpy(header.magic, CAPTURE_MAGIC, sizeof(header.magic));
+    header.version = CAPTURE_VERSION;
+    header.index_interval = (uint32_t)writer->index_interval;
+    header.end = OSC_CAPTURE_HEADER_SIZE;
+    memcpy(writer->map, &header, sizeof(header));
+    writer->end = OSC_CAPTURE_HEADER_SIZE;
+
+return 0;
+}
+
+int osc_capture_write(struct osc_capture_writer* writer, uint64_t timestamp_ns, const void* data, size_t length)
+{
+    if(writer->pending_count == writer->index_interval && write_index(writer) == 1) {
+        return 1;
+    }
+    size_t size = sizeof(int32_t) + length;
+    size_t offset = writer->end;
+    char* payload = begin_record(writer, timestamp_ns, RECORD_PACKET, size);
+    if(payload == NULL) {
+        return 1;
+    }
+    uint32_t be_length = htobe32((uint32_t)length);
+    memcpy(payload, &be_length, sizeof(be_length));
+    memcpy(payload + sizeof(be_length), data, length);
+    const char* address = packet_address((const char*)data, length);
+    struct osc_capture_index_entry* entry = &writer->pending[writer->pending_count++];
+    entry->timestamp_ns = timestamp_ns;
+    entry->offset = offset;
+    entry->address_hash = address != NULL ? osc_capture_address_hash(address) : 0;
+    entry->reserved = 0;
+    writer->packet_count++;
+    commit_record(writer, size);
+
+return 0;
+}
+
+int osc_capture_write_message(struct osc_capture_writer* writer, uint64_t timestamp_ns, const struct osc_message* msg)
+{
+return osc_capture_write(writer, timestamp_ns, (const char*)msg->raw_data + 4, osc_message_serialized_length(msg));
+}
+
+int osc_capture_write_bundle(struct osc_capture_writer* writer, uint64_t timestamp_ns, const struct osc_bundle* bundle)
+{
+return osc_capture_write(writer, timestamp_ns, (const char*)bundle->raw_data + 4, osc_bundle_serialized_length(bundle));
+}
+
+int osc_capture_writer_sync(struct osc_capture_writer* writer)
+{
+    if(msync(writer->map, writer->end, MS_SYNC) != 0) {
+        return 1;
+    }
+
+return 0;
+}
+
+int osc_capture_writer_close(struct osc_capture_writer* writer)
+{
+    int return_value = 0;
+    if(writer->pending_count != 0 && write_index(writer) == 1) {
+        return_value = 1;
+    }
+    munmap(writer->map, writer->map_size);
+    if(ftruncate(writer->fd, (off_t)writer->end) != 0) {
+        return_value = 1;
+    }
+    close(writer->fd);
+    free(writer->pending);
+    memset(writer, 0, sizeof(*writer));
+    writer->fd = -1;
+
+return return_value;
+}
+
+/**
+ * Reads the header of the record at the given offset
+ *
+ * @param   reader  pointer to the osc_capture_reader structure
+ * @param   offset  the offset of the record
+ * @param   header  pointer to the record_header structure to fill
+ * @return          returns 0 on success or 1 if the record does not fit before the end of the file
+ */
+static int read_record_header(const struct osc_capture_reader* reader, size_t offset, struct record_header* header)
+{
+    if(offset + sizeof(*header) > reader->end) {
+        return 1;
+    }
+    memcpy(header, reader->map + offset, sizeof(*header));
+    if(header->size > reader->end - offset - sizeof(*header)) {
+        return 1;
+    }
+
+return 0;
+}
+
+/**
+ * Loads the chain of index blocks, from the last one back to the first one
+ *
+ * @param   reader  pointer to the osc_capture_reader structure
+ * @param   last    the offset of the last index block (0 if there is none)
+ * @return          returns 0 on success or 1 if memory allocation failed or an index block is damaged
+ */
+static int load_blocks(struct osc_capture_reader* reader, uint64_t last)
+{
+    size_t capacity = 0;
+    reader->indexed_end = OSC_CAPTURE_HEADER_SIZE;
+    for(uint64_t offset = last; offset != 0;) {
+        struct record_header record;
+        struct index_header header;
+        if(offset < OSC_CAPTURE_HEADER_SIZE || offset % 8 != 0 || read_record_header(reader, offset, &record) == 1 ||
+           record.kind != RECORD_INDEX || record.size < sizeof(header)) {
+            return 1;
+        }
+        memcpy(&header, reader->map + offset + sizeof(record), sizeof(header));
+        if(header.count == 0 || header.count > (record.size - sizeof(header)) / sizeof(struct osc_capture_index_entry) ||
+           header.previous >= offset) {
+            return 1;
+        }
+        if(reader->block_count == capacity) {
+            capacity = capacity == 0 ? 16 : capacity * 2;
+            struct osc_capture_block* blocks = (struct osc_capture_block*)realloc(reader->blocks, capacity * sizeof(struct osc_capture_block));
+            if(blocks == NULL) {
+                return 1;
+            }
+            reader->blocks = blocks;
+        }
+        struct osc_capture_block* block = &reader->blocks[reader->block_count++];
+        block->entries = (const struct osc_capture_index_entry*)(reader->map + offset + sizeof(record) + sizeof(header));
+        block->count = header.count;
+        block->first_ns = block->entries[0].timestamp_ns;
+        block->last_ns = block->entries[header.count - 1].timestamp_ns;
+        if(offset == last) {
+            reader->indexed_end = offset + sizeof(record) + ALIGN8(record.size);
+        }
+        offset = header.previous;
+    }
+    for(size_t i = 0; i < reader->block_count / 2; i++) {
+        struct osc_capture_block block = reader->blocks[i];
+        reader->blocks[i] = reader->blocks[reader->block_count - 1 - i];
+        reader->blocks[reader->block_count - 1 - i] = block;
+    }
+
+return 0;
+}
+
+int osc_capture_reader_open(struct osc_capture_reader* reader, const char* path)
+{
+    struct stat st;
+    struct file_header header;
+    memset(reader, 0, sizeof(*reader));
+    reader->fd = open(path, O_RDONLY | O_CLOEXEC);
+    if(reader->fd < 0 || fstat(reader->fd, &st) != 0 || (size_t)st.st_size < OSC_CAPTURE_HEADER_SIZE) {
+        osc_capture_reader_close(reader);
+        return 1;
+    }
+    reader->size = (size_t)st.st_size;
+    void* map = mmap(NULL, reader->size, PROT_READ, MAP_SHARED, reader->fd, 0);
+    if(map == MAP_FAILED) {
+        osc_capture_reader_close(reader);
+        return 1;
+    }
+    reader->map = (const char*)map;
+    memcpy(&header, reader->map, sizeof(header));
+    if(memcmp(header.magic, CAPTURE_MAGIC, sizeof(header.magic)) != 0 || header.version != CAPTURE_VERSION) {
+        osc_capture_reader_close(reader);
+        return 1;
+    }
+    reader->end = header.end < reader->size ? header.end : reader->size;
+    reader->packet_count = header.packet_count;
+    if(load_blocks(reader, header.last_index) == 1) {
+        osc_capture_reader_close(reader);
+        return 1;
+    }
+
+return 0;
+}
+
+void osc_capture_reader_close(struct osc_capture_reader* reader)
+{
+    if(reader->map != NULL) {
+        munmap((void*)reader->map, reader->size);
+    }
+    if(reader->fd >= 0) {
+        close(reader->fd);
+    }
+    free(reader->blocks);
+    memset(reader, 0, sizeof(*reader));
+    reader->fd = -1;
+}
+
+size_t osc_capture_begin(const struct osc_capture_reader* reader)
+{
+    (void)reader;
+
+return OSC_CAPTURE_HEADER_SIZE;
+}
+
+int osc_capture_next(const struct osc_capture_reader* reader, size_t* cursor, struct osc_capture_record* record)
+{
+    struct record_header header;
+    while(read_record_header(reader, *cursor, &header) == 0) {
+        size_t offset = *cursor;
+        *cursor += sizeof(header) + ALIGN8(header.size);
+        if(header.kind != RECORD_PACKET) {
+            continue;
+        }
+        const char* raw_data = reader->map + offset + sizeof(header);
+        uint32_t be_length;
+        if(header.size < sizeof(be_length)) {
+            return 1;
+        }
+        memcpy(&be_length, raw_data, sizeof(be_length));
+        size_t length = be32toh(be_length);
+        if(length != header.size - sizeof(be_length)) {
+            return 1;
+        }
+        record->timestamp_ns = header.timestamp_ns;
+        record->raw_data = raw_data;
+        record->data = raw_data + sizeof(be_length);
+        record->length = length;
+        record->offset = offset;
+        return 0;
+    }
+
+return 1;
+}
+
+size_t osc_capture_seek_time(const struct osc_capture_reader* reader, uint64_t timestamp_ns)
+{
+    size_t low = 0;
+    size_t high = reader->block_count;
+    while(low < high) {
+        size_t middle = low + (high - low) / 2;
+        if(reader->blocks[middle].last_ns < timestamp_ns) {
+            low = middle + 1;
+        }
+        else {
+            high = middle;
+        }
+    }
+    if(low < reader->block_count) {
+        const struct osc_capture_block* block = &reader->blocks[low];
+        size_t first = 0;
+        size_t last = block->count - 1;
+        while(first < last) {
+            size_t middle = first + (last - first) / 2;
+            if(block->entries[middle].timestamp_ns < timestamp_ns) {
+                first = middle + 1;
+            }
+            else {
+                last = middle;
+            }
+        }
+        return block->entries[first].offset;
+    }
+    size_t cursor = reader->indexed_end;
+    struct osc_capture_record record;
+    while(osc_capture_next(reader, &cursor, &record) == 0) {
+        if(record.timestamp_ns >= timestamp_ns) {
+            return record.offset;
+        }
+    }
+
+return reader->end;
+}
+
+int osc_capture_seek_address(const struct osc_capture_reader* reader, size_t* cursor, const char* address, struct osc_capture_record* record)
+{
+    uint32_t hash = osc_capture_address_hash(address);
+    for(size_t b = 0; b < reader->block_count; b++) {
+        const struct osc_capture_block* block = &reader->blocks[b];
+        if(block->entries[block->count - 1].offset < *cursor) {
+            continue;
+        }
+        for(size_t i = 0; i < block->count; i++) {
+            const struct osc_capture_index_entry* entry = &block->entries[i];
+            if(entry->offset < *cursor || entry->address_hash != hash) {
+                continue;
+            }
+            size_t next = entry->offset;
+            if(osc_capture_next(reader, &next, record) == 0) {
+                const char* p_address = packet_address(record->data, record->length);
+                if(p_address != NULL && strcmp(p_address, address) == 0) {
+                    *cursor = next;
+                    return 0;
+                }
+            }
+        }
+    }
+    size_t next = *cursor > reader->indexed_end ? *cursor : reader->indexed_end;
+    while(osc_capture_next(reader, &next, record) == 0) {
+        const char* p_address = packet_address(record->data, record->length);
+        if(p_address != NULL && strcmp(p_address, address) == 0) {
+            *cursor = next;
+            return 0;
+        }
+    }
+
+return 1;
+}
+
+int osc_capture_replay(const struct osc_capture_reader* reader, size_t cursor, uint64_t end_ns, double speed,
+                       osc_capture_handler handler, void* context, size_t* count)
+{
+    struct osc_capture_record record;
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    uint64_t start_ns = (uint64_t)now.tv_sec * 1000000000ULL + (uint64_t)now.tv_nsec;
+    uint64_t first_ns = 0;
+    *count = 0;
+    while(osc_capture_next(reader, &cursor, &record) == 0) {
+        if(end_ns != 0 && record.timestamp_ns > end_ns) {
+            break;
+        }
+        if(*count == 0) {
+            first_ns = record.timestamp_ns;
+        }
+        if(speed > 0 && record.timestamp_ns > first_ns) {
+            uint64_t target_ns = start_ns + (uint64_t)((double)(record.timestamp_ns - first_ns) / speed);
+            struct timespec target;
+            target.tv_sec = (time_t)(target_ns / 1000000000ULL);
+            target.tv_nsec = (long)(target_ns % 1000000000ULL);
+            while(clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &target, NULL) == EINTR) {
+            }
+        }
+        (*count)++;
+        if(handler(&record, context) != 0) {
+            return 1;
+        }
+    }
+
+return 0;
+}
@@ -0,0 +1,243 @@
+/** @file osc_capture.h */
+
+#ifndef OSC_CAPTURE_H
+#define OSC_CAPTURE_H
+
+#include <stdint.h>
+#include <stdlib.h>
+#include "osc.h"
+
+#define OSC_CAPTURE_DEFAULT_INDEX_INTERVAL 1024
+#define OSC_CAPTURE_HEADER_SIZE 64
+
+/**
+ * Capture file layout (native endianness, every record 8B aligned):
+ * - a OSC_CAPTURE_HEADER_SIZE header holding the magic, the index interval, the end of the written data,
+ *   the offset of the last index block and the packet count
+ * - records made of a 16B header (timestamp in nanoseconds, payload size, kind) and a payload:
+ *   the raw_data bytes of a packet (4B big-endian length prefix followed by the packet), or an index block
+ *   listing the timestamp, offset and address hash of the index_interval packets written before it,
+ *   linked to the previous index block
+ */
+
+/**
+ * Structure representing a packet read from a capture file
+ * raw_data points to the 4B length prefix inside the mapped file, data to the first byte of the packet and
+ * length is the length of the packet; offset is the position of the record in the file
+ */
+struct osc_capture_record {
+    uint64_t timestamp_ns;
+    const char* raw_data;
+    const char* data;
+    size_t length;
+    size_t offset;
+};
+
+/**
+ * Structure representing an index entry, one per packet
+ */
+struct osc_capture_index_entry {
+    uint64_t timestamp_ns;
+    uint64_t offset;
+    uint32_t address_hash;
+    uint32_t reserved;
+};
+
+/**
+ * Structure representing an append-only capture file written through a shared memory mapping
+ * map covers the first map_size bytes of the file, end is the offset the next record is written at
+ * pending holds the index entries of the packets written since the last index block
+ */
+struct osc_capture_writer {
+    int fd;
+    char* map;
+    size_t map_size;
+    size_t end;
+    size_t index_interval;
+    struct osc_capture_index_entry* pending;
+    size_t pending_count;
+    uint64_t last_index;
+    uint64_t packet_count;
+};
+
+/**
+ * Structure representing an index block of a capture file as loaded by the reader
+ * entries points into the mapped file; first_ns and last_ns are the timestamps of the first and last entries
+ */
+struct osc_capture_block {
+    const struct osc_capture_index_entry* entries;
+    size_t count;
+    uint64_t first_ns;
+    uint64_t last_ns;
+};
+
+/**
+ * Structure representing a capture file mapped read-only
+ * blocks lists the index blocks in file order; indexed_end is the offset after the last index block,
+ * the records past it (left by a writer that did not close the file) are found by scanning
+ */
+struct osc_capture_reader {
+    int fd;
+    const char* map;
+    size_t size;
+    size_t end;
+    struct osc_capture_block* blocks;
+    size_t block_count;
+    size_t indexed_end;
+    uint64_t packet_count;
+};
+
+/**
+ * Type of the functions receiving the packets emitted by osc_capture_replay
+ *
+ * @param   record      pointer to the packet record
+ * @param   context     the context given to osc_capture_replay
+ * @return              0 to continue the replay or any other value to stop it
+ */
+typedef int (*osc_capture_handler)(const struct osc_capture_record* record, void* context);
+
+/**
+ * Computes the hash stored in the index for an address (32-bit FNV-1a, bundles are indexed as "#bundle")
+ *
+ * @param   address     the address
+ * @return              the hash of the address
+ */
+uint32_t osc_capture_address_hash(const char* address);
+
+/**
+ * Reads CLOCK_REALTIME in nanoseconds, the usual timestamp of captured packets
+ *
+ * @return              the current time in nanoseconds since the Unix epoch
+ */
+uint64_t osc_capture_time_ns(void);
+
+/**
+ * Creates (or truncates) a capture file and maps it for writing
+ *
+ * @param   writer          pointer to the osc_capture_writer structure
+ * @param   path            the path of the file
+ * @param   index_interval  the number of packets per index block (0 for OSC_CAPTURE_DEFAULT_INDEX_INTERVAL)
+ * @return                  returns 0 on success or 1 if the file could not be created or mapped
+ */
+int osc_capture_writer_open(struct osc_capture_writer* writer, const char* path, size_t index_interval);
+
+/**
+ * Appends a packet to the capture file
+ * Timestamps are expected to be non-decreasing, osc_capture_seek_time relies on it
+ *
+ * @param   writer          pointer to the osc_capture_writer structure
+ * @param   timestamp_ns    the receive time of the packet in nanoseconds
+ * @param   data            pointer to the first byte of the packet (without the 4B length prefix)
+ * @param   length          the length of the packet
+ * @return                  returns 0 on success or 1 if the file could not be grown
+ */
+int osc_capture_write(struct osc_capture_writer* writer, uint64_t timestamp_ns, const void* data, size_t length);
+
+/**
+ * Appends the raw_data of an osc_message instance to the capture file
+ *
+ * @param   writer          pointer to the osc_capture_writer structure
+ * @param   timestamp_ns    the receive time of the message in nanoseconds
+ * @param   msg             pointer to the osc_message structure
+ * @return                  returns 0 on success or 1 if the file could not be grown
+ */
+int osc_capture_write_message(struct osc_capture_writer* writer, uint64_t timestamp_ns, const struct osc_message* msg);
+
+/**
+ * Appends the raw_data of an osc_bundle instance to the capture file
+ *
+ * @param   writer          pointer to the osc_capture_writer structure
+ * @param   timestamp_ns    the receive time of the bundle in nanoseconds
+ * @param   bundle          pointer to the osc_bundle structure
+ * @return                  returns 0 on success or 1 if the file could not be grown
+ */
+int osc_capture_write_bundle(struct osc_capture_writer* writer, uint64_t timestamp_ns, const struct osc_bundle* bundle);
+
+/**
+ * Flushes the mapped pages to the file (msync)
+ *
+ * @param   writer          pointer to the osc_capture_writer structure
+ * @return                  returns 0 on success or 1 if msync failed
+ */
+int osc_capture_writer_sync(struct osc_capture_writer* writer);
+
+/**
+ * Writes the index block of the pending packets, trims the file to its data and closes it
+ *
+ * @param   writer          pointer to the osc_capture_writer structure
+ * @return                  returns 0 on success or 1 if the last index block could not be written or the file trimmed
+ */
+int osc_capture_writer_close(struct osc_capture_writer* writer);
+
+/**
+ * Maps a capture file for reading and loads the list of its index blocks (the packets are not read)
+ *
+ * @param   reader      pointer to the osc_capture_reader structure
+ * @param   path        the path of the file
+ * @return              returns 0 on success or 1 if the file could not be mapped or is not a capture file
+ */
+int osc_capture_reader_open(struct osc_capture_reader* reader, const char* path);
+
+/**
+ * Unmaps a capture file and frees the index block list
+ *
+ * @param   reader      pointer to the osc_capture_reader structure
+ */
+void osc_capture_reader_close(struct osc_capture_reader* reader);
+
+/**
+ * Finds the cursor of the first packet of the file
+ *
+ * @param   reader      pointer to the osc_capture_reader structure
+ * @return              the cursor of the first packet
+ */
+size_t osc_capture_begin(const struct osc_capture_reader* reader);
+
+/**
+ * Reads the packet at the cursor (skipping index blocks) and moves the cursor past it
+ *
+ * @param   reader      pointer to the osc_capture_reader structure
+ * @param   cursor      pointer to the cursor
+ * @param   record      pointer to the record to fill
+ * @return              returns 0 if a packet was read or 1 at the end of the file (or on a damaged record)
+ */
+int osc_capture_next(const struct osc_capture_reader* reader, size_t* cursor, struct osc_capture_record* record);
+
+/**
+ * Finds the cursor of the first packet received at or after the given time, using the index
+ *
+ * @param   reader          pointer to the osc_capture_reader structure
+ * @param   timestamp_ns    the time in nanoseconds
+ * @return                  the cursor of the packet (the end of the file if there is none)
+ */
+size_t osc_capture_seek_time(const struct osc_capture_reader* reader, uint64_t timestamp_ns);
+
+/**
+ * Finds the next packet at or after the cursor whose address is the given one, using the index address hashes
+ * On success the cursor is moved past the packet found
+ *
+ * @param   reader      pointer to the osc_capture_reader structure
+ * @param   cursor      pointer to the cursor
+ * @param   address     the address (bundles are found with "#bundle")
+ * @param   record      pointer to the record to fill
+ * @return              returns 0 if a packet was found or 1 otherwise
+ */
+int osc_capture_seek_address(const struct osc_capture_reader* reader, size_t* cursor, const char* address, struct osc_capture_record* record);
+
+/**
+ * Emits the packets from the cursor to the end time, reproducing the gaps between their timestamps
+ * divided by speed (1.0 replays at the original speed, 2.0 twice as fast, 0 as fast as possible)
+ *
+ * @param   reader      pointer to the osc_capture_reader structure
+ * @param   cursor      the cursor of the first packet to emit
+ * @param   end_ns      the timestamp after which the replay stops (0 for the end of the file)
+ * @param   speed       the speed factor
+ * @param   handler     the function receiving the packets
+ * @param   context     the context passed to handler
+ * @param   count       set to the number of packets emitted
+ * @return              returns 0 if the end was reached or 1 if the handler stopped the replay
+ */
+int osc_capture_replay(const struct osc_capture_reader* reader, size_t cursor, uint64_t end_ns, double speed,
+                       osc_capture_handler handler, void* context, size_t* count);
+
+#endif //OSC_CAPTURE_H
@@ -0,0 +1,562 @@
+/** @file osc_dispatch.c */
+
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include "osc_dispatch.h"
+
+/**
+ * Structure representing a handler registered on an address
+ */
+struct osc_dispatch_method {
+    osc_method_handler handler;
+    void* context;
+};
+
+/**
+ * Structure representing one address segment of the dispatch trie
+ * children are kept sorted by name so that literal segments are found by binary search
+ */
+struct osc_dispatch_node {
+    char* name;
+    size_t name_length;
+    struct osc_dispatch_node** children;
+    size_t child_count;
+    size_t child_capacity;
+    struct osc_dispatch_method* methods;
+    size_t method_count;
+};
+
+/**
+ * Structure representing a resolved incoming address
+ * the entry is valid only while generation equals the generation of the dispatcher
+ * dispatching counts the dispatch calls up the stack calling the handlers of the entry, which must not be overwritten
+ * until it drops back to 0
+ */
+struct osc_dispatch_cache_entry {
+    uint64_t hash;
+    uint64_t generation;
+    char* address;
+    size_t address_length;
+    size_t address_capacity;
+    const struct osc_dispatch_method** methods;
+    size_t method_count;
+    size_t method_capacity;
+    size_t dispatching;
+};
+
+/**
+ * Structure collecting the methods matched by one dispatch walk
+ * when entry is NULL the matched methods are called directly instead of being collected
+ */
+struct dispatch_walk {
+    struct osc_dispatcher* dispatcher;
+    const struct osc_message_view* msg;
+    struct osc_dispatch_cache_entry* entry;
+    size_t matched;
+    int failed;
+};
+
+/**
+ * Checks whether an address segment contains OSC pattern characters
+ *
+ * @param   segment     pointer to the first byte of the segment
+ * @param   length      the length of the segment
+ * @return              returns 1 if the segment is a pattern or 0 if it is a literal
+ */
+static int is_pattern(const char* segment, size_t length)
+{
+    for(size_t i = 0; i < length; i++) {
+        switch(segment[i]) {
+            case '*': case '?': case '[': case '{': return 1;
+        }
+    }
+
+return 0;
+}
+
+/**
+ * Checks whether a character belongs to the body of a "[...]" character class
+ *
+ * @param   cls         pointer to the first byte of the class body (after '[' and '!')
+ * @param   length      the length of the class body
+ * @param   c           the character to look for
+ * @return              returns 1 if the character is in the class or 0 otherwise
+ */
+static int class_contains(const char* cls, size_t length, unsigned char c)
+{
+    for(size_t k = 0; k < length; k++) {
+        unsigned char first = (unsigned char)cls[k];
+        if(k + 2 < length && cls[k + 1] == '-') {
+            if(c >= first && c <= (unsigned char)cls[k + 2]) {
+                return 1;
+            }
+            k += 2;
+        }
+        else if(c == first) {
+            return 1;
+        }
+    }
+
+return 0;
+}
+
+/**
+ * Matches one address segment against one segment of an OSC address pattern
+ * The pattern is evaluated left to right while tracking the set of reachable name offsets,
+ * so the cost is bounded by pattern length times name length and never backtracks
+ *
+ * @param   pat         pointer to the first byte of the pattern segment
+ * @param   pat_length  the length of the pattern segment
+ * @param   name        pointer to the first byte of the segment to match
+ * @param   name_length the length of the segment to match
+ * @param   reach       scratch memory of at least 2 * (name_length + 1) bytes
+ * @return              returns 1 if the segment matches or 0 otherwise
+ */
+static int match_segment(const char* pat, size_t pat_length, const char* name, size_t name_length, unsigned char* reach)
+{
+    unsigned char* cur = reach;
+    unsigned char* next = reach + name_length + 1;
+    memset(cur, 0, name_length + 1);
+    cur[0] = 1;
+    size_t i = 0;
+    while(i < pat_length) {
+        const char* close = NULL;
+        int reachable = 0;
+        memset(next, 0, name_length + 1);
+        if(pat[i] == '[') {
+            close = (const char*)memchr(pat + i + 1, ']', pat_length - i - 1);
+        }
+        else if(pat[i] == '{') {
+            close = (const char*)memchr(pat + i + 1, '}', pat_length - i - 1);
+        }
+        if(pat[i] == '*') {
+            size_t o = 0;
+            while(o <= name_length && cur[o] == 0) {
+                o++;
+            }
+            for(; o <= name_length; o++) {
+                next[o] = 1;
+                reachable = 1;
+            }
+            while(i < pat_length && pat[i] == '*') {
+                i++;
+            }
+        }
+        else if(pat[i] == '[' && close != NULL) {
+            const char* cls = pat + i + 1;
+            size_t cls_length = close - cls;
+            int negate = 0;
+            if(cls_length > 0 && cls[0] == '!') {
+                negate = 1;
+                cls++;
+                cls_length--;
+            }
+            for(size_t o = 0; o < name_length; o++) {
+                if(cur[o] && class_contains(cls, cls_length, (unsigned char)name[o]) != negate) {
+                    next[o + 1] = 1;
+                    reachable = 1;
+                }
+            }
+            i = close - pat + 1;
+        }
+        else if(pat[i] == '{' && close != NULL) {
+            for(const char* alt = pat + i + 1; alt <= close; ) {
+                const char* alt_end = (const char*)memchr(alt, ',', close - alt);
+                if(alt_end == NULL) {
+                    alt_end = close;
+                }
+                size_t alt_length = alt_end - alt;
+                for(size_t o = 0; o + alt_length <= name_length; o++) {
+                    if(cur[o] && memcmp(name + o, alt, alt_length) == 0) {
+                        next[o + alt_length] = 1;
+                        reachable = 1;
+                    }
+                }
+                alt = alt_end + 1;
+            }
+            i = close - pat + 1;
+        }
+        else {
+            for(size_t o = 0; o < name_length; o++) {
+                if(cur[o] && (pat[i] == '?' || name[o] == pat[i])) {
+                    next[o + 1] = 1;
+                    reachable = 1;
+                }
+            }
+            i++;
+        }
+        if(reachable == 0) {
+            return 0;
+        }
+        unsigned char* swap = cur;
+        cur = next;
+        next = swap;
+    }
+
+return cur[name_length];
+}
+
+/**
+ * Finds the position of a child segment in the sorted children array of a node
+ *
+ * @param   node        pointer to the parent node
+ * @param   name        pointer to the first byte of the segment
+ * @param   length      the length of the segment
+ * @param   found       set to 1 if the child exists or 0 otherwise
+ * @return              the index of the child or the index at which it would be inserted
+ */
+static size_t find_child(const struct osc_dispatch_node* node, const char* name, size_t length, int* found)
+{
+    size_t lo = 0;
+    size_t hi = node->child_count;
+    *found = 0;
+    while(lo < hi) {
+        size_t mid = lo + (hi - lo) / 2;
+        const struct osc_dispatch_node* child = node->children[mid];
+        size_t common = child->name_length < length ? child->name_length : length;
+        int cmp = memcmp(child->name, name, common);
+        if(cmp == 0) {
+            cmp = (child->name_length > length) - (child->name_length < length);
+        }
+        if(cmp == 0) {
+            *found = 1;
+            return mid;
+        }
+        if(cmp < 0) {
+            lo = mid + 1;
+        }
+        else {
+            hi = mid;
+        }
+    }
+
+return lo;
+}
+
+/**
+ * Creates a trie node for the given segment
+ *
+ * @param   name        pointer to the first byte of the segment
+ * @param   length      the length of the segment
+ * @return              the new node or NULL if memory allocation failed
+ */
+static struct osc_dispatch_node* node_new(const char* name, size_t length)
+{
+    struct osc_dispatch_node* node = (struct osc_dispatch_node*)calloc(1, sizeof(struct osc_dispatch_node));
+    if(node == NULL) {
+        return NULL;
+    }
+    node->name = (char*)malloc(length + 1);
+    if(node->name == NULL) {
+        free(node);
+        return NULL;
+    }
+    memcpy(node->name, name, length);
+    node->name[length] = '\0';
+    node->name_length = length;
+
+return node;
+}
+
+/**
+ * Destroys a trie node and all of its descendants
+ *
+ * @param   node        pointer to the node
+ */
+static void node_destroy(struct osc_dispatch_node* node)
+{
+    for(size_t i = 0; i < node->child_count; i++) {
+        node_destroy(node->children[i]);
+    }
+    free(node->children);
+    free(node->methods);
+    free(node->name);
+    free(node);
+}
+
+/**
+ * Records a matched node: either collects its methods into the cache entry or calls them directly
+ *
+ * @param   walk        pointer to the dispatch_walk structure
+ * @param   node        pointer to the matched node
+ */
+static void walk_match(struct dispatch_walk* walk, const struct osc_dispatch_node* node)
+{
+    struct osc_dispatch_cache_entry* entry = walk->entry;
+    for(size_t i = 0; i < node->method_count; i++) {
+        if(entry == NULL) {
+            node->methods[i].handler(walk->msg, node->methods[i].context);
+        }
+        else if(walk->failed == 0) {
+            if(entry->method_count == entry->method_capacity) {
+                size_t new_capacity = entry->method_capacity == 0 ? 4 : entry->method_capacity * 2;
+                const struct osc_dispatch_method** memory_alloc = (const struct osc_dispatch_method**)realloc(
+                        (void*)entry->methods, new_capacity * sizeof(*entry->methods));
+                if(memory_alloc == NULL) {
+                    walk->failed = 1;
+                    return;
+                }
+                entry->methods = memory_alloc;
+                entry->method_capacity = new_capacity;
+            }
+            entry->methods[entry->method_count++] = &node->methods[i];
+        }
+    }
+    walk->matched += node->method_count;
+}
+
+/**
+ * Matches the remaining address segments below a trie node
+ *
+ * @param   walk        pointer to the dispatch_walk structure
+ * @param   node        pointer to the node whose children are matched against the next segment
+ * @param   segment     pointer to the first byte of the next segment
+ */
+static void walk_node(struct dispatch_walk* walk, const struct osc_dispatch_node* node, const char* segment)
+{
+    const char* segment_end = strchr(segment, '/');
+    if(segment_end == NULL) {
+        segment_end = segment + strlen(segment);
+    }
+    size_t length = segment_end - segment;
+    int last = (*segment_end == '\0');
+    if(is_pattern(segment, length)) {
+        for(size_t i = 0; i < node->child_count; i++) {
+            const struct osc_dispatch_node* child = node->children[i];
+            if(match_segment(segment, length, child->name, child->name_length, walk->dispatcher->reach)) {
+                if(last) {
+                    walk_match(walk, child);
+                }
+                else {
+                    walk_node(walk, child, segment_end + 1);
+                }
+            }
+        }
+    }
+    else {
+        int found = 0;
+        size_t i = find_child(node, segment, length, &found);
+        if(found) {
+            if(last) {
+                walk_match(walk, node->children[i]);
+            }
+            else {
+                walk_node(walk, node->children[i], segment_end + 1);
+            }
+        }
+    }
+}
+
+int osc_dispatcher_new(struct osc_dispatcher* dispatcher, size_t cache_size)
+{
+    memset(dispatcher, 0, sizeof(*dispatcher));
+    dispatcher->generation = 1;
+    dispatcher->root = node_new("", 0);
+    if(dispatcher->root == NULL) {
+        return 1;
+    }
+    if(cache_size > 0) {
+        size_t slots = 1;
+        while(slots < cache_size) {
+            slots *= 2;
+        }
+        dispatcher->cache = (struct osc_dispatch_cache_entry*)calloc(slots, sizeof(struct osc_dispatch_cache_entry));
+        if(dispatcher->cache == NULL) {
+            osc_dispatcher_destroy(dispatcher);
+            return 1;
+        }
+        dispatcher->cache_size = slots;
+    }
+    dispatcher->reach_size = 64;
+    dispatcher->reach = (unsigned char*)malloc(dispatcher->reach_size);
+    if(dispatcher->reach == NULL) {
+        osc_dispatcher_destroy(dispatcher);
+        return 1;
+    }
+
+return 0;
+}
+
+void osc_dispatcher_destroy(struct osc_dispatcher* dispatcher)
+{
+    if(dispatcher->root != NULL) {
+        node_destroy(dispatcher->root);
+    }
+    for(size_t i = 0; i < dispatcher->cache_size; i++) {
+        free(dispatcher->cache[i].address);
+        free((void*)dispatcher->cache[i].methods);
+    }
+    free(dispatcher->cache);
+    free(dispatcher->reach);
+    memset(dispatcher, 0, sizeof(*dispatcher));
+}
+
+int osc_dispatcher_add_method(struct osc_dispatcher* dispatcher, const char* address, osc_method_handler handler, void* context)
+{
+    if(address[0] != '/' || strpbrk(address, "#*,?[]{}") != NULL) {
+        return 1;
+    }
+    struct osc_dispatch_node* node = dispatcher->root;
+    const char* segment = address + 1;
+    while(1) {
+        const char* segment_end = strchr(segment, '/');
+        if(segment_end == NULL) {
+            segment_end = segment + strlen(segment);
+        }
+        size_t length = segment_end - segment;
+        if(2 * (length + 1) > dispatcher->reach_size) {
+            unsigned char* memory_alloc = (unsigned char*)realloc(dispatcher->reach, 2 * (length + 1));
+            if(memory_alloc == NULL) {
+                return 1;
+            }
+            dispatcher->reach = memory_alloc;
+            dispatcher->reach_size = 2 * (length + 1);
+        }
+        int found = 0;
+        size_t i = find_child(node, segment, length, &found);
+        if(found == 0) {
+            if(node->child_count == node->child_capacity) {
+                size_t new_capacity = node->child_capacity == 0 ? 4 : node->child_capacity * 2;
+                struct osc_dispatch_node** memory_alloc = (struct osc_dispatch_node**)realloc(
+                        node->children, new_capacity * sizeof(*node->children));
+                if(memory_alloc == NULL) {
+                    return 1;
+                }
+                node->children = memory_alloc;
+                node->child_capacity = new_capacity;
+            }
+            struct osc_dispatch_node* child = node_new(segment, length);
+            if(child == NULL) {
+                return 1;
+            }
+            memmove(node->children + i + 1, node->children + i, (node->child_count - i) * sizeof(*node->children));
+            node->children[i] = child;
+            node->child_count++;
+        }
+        node = node->children[i];
+        if(*segment_end == '\0') {
+            break;
+        }
+        segment = segment_end + 1;
+    }
+    struct osc_dispatch_method* memory_alloc = (struct osc_dispatch_method*)realloc(
+            node->methods, (node->method_count + 1) * sizeof(*node->methods));
+    if(memory_alloc == NULL) {
+        return 1;
+    }
+    node->methods = memory_alloc;
+    node->methods[node->method_count].handler = handler;
+    node->methods[node->method_count].context = context;
+    node->method_count++;
+    dispatcher->generation++;
+
+return 0;
+}
+
+size_t osc_dispatcher_dispatch(struct osc_dispatcher* dispatcher, const struct osc_message_view* msg)
+{
+    struct dispatch_walk walk;
+    walk.dispatcher = dispatcher;
+    walk.msg = msg;
+    walk.entry = NULL;
+    walk.matched = 0;
+    walk.failed = 0;
+    if(msg->address[0] != '/') {
+        return 0;
+    }
+    if(dispatcher->cache_size == 0) {
+        walk_node(&walk, dispatcher->root, msg->address + 1);
+        return walk.matched;
+    }
+    size_t addr_length = strlen(msg->address);
+    uint64_t hash = osc_hash_bytes(msg->address, addr_length);
+    struct osc_dispatch_cache_entry* entry = &dispatcher->cache[hash & (dispatcher->cache_size - 1)];
+    if(entry->generation != dispatcher->generation || entry->hash != hash ||
+       entry->address_length != addr_length || memcmp(entry->address, msg->address, addr_length) != 0) {
+        if(entry->dispatching != 0) {
+            // a handler dispatched a message whose address shares the slot being iterated, so resolve it uncached
+            walk_node(&walk, dispatcher->root, msg->address + 1);
+            return walk.matched;
+        }
+        entry->generation = 0;
+        entry->method_count = 0;
+        if(entry->address_capacity < addr_length + 1) {
+            char* memory_alloc = (char*)realloc(entry->address, addr_length + 1);
+            if(memory_alloc == NULL) {
+                walk_node(&walk, dispatcher->root, msg->address + 1);
+                return walk.matched;
+            }
+            entry->address = memory_alloc;
+            entry->address_capacity = addr_length + 1;
+        }
+        walk.entry = entry;
+        walk_node(&walk, dispatcher->root, msg->address + 1);
+        if(walk.failed) {
+            walk.entry = NULL;
+            walk.matched = 0;
+            walk_node(&walk, dispatcher->root, msg->address + 1);
+            return walk.matched;
+        }
+        memcpy(entry->address, msg->address, addr_length + 1);
+        entry->address_length = addr_length;
+        entry->hash = hash;
+        entry->generation = dispatcher->generation;
+    }
+    size_t method_count = entry->method_count;
+    entry->dispatching++;
+    for(size_t i = 0; i < method_count; i++) {
+        entry->methods[i]->handler(msg, entry->methods[i]->context);
+    }
+    entry->dispatching--;
+
+return method_count;
+}
+
+size_t osc_dispatcher_dispatch_message(struct osc_dispatcher* dispatcher, const struct osc_message* msg)
+{
+    struct osc_message_view view;
+    osc_message_view_from_message(&view, msg);
+
+return osc_dispatcher_dispatch(dispatcher, &view);
+}
+
+int osc_pattern_match(const char* pattern, const char* address)
+{
+    unsigned char stack_reach[128];
+    unsigned char* reach = stack_reach;
+    size_t reach_size = sizeof(stack_reach);
+    int matched = 1;
+    while(matched) {
+        const char* pat_end = strchr(pattern, '/');
+        const char* addr_end = strchr(address, '/');
+        if(pat_end == NULL) {
+            pat_end = pattern + strlen(pattern);
+        }
+        if(addr_end == NULL) {
+            addr_end = address + strlen(address);
+        }
+        size_t addr_length = addr_end - address;
+        if(2 * (addr_length + 1) > reach_size) {
+            unsigned char* memory_alloc = (unsigned char*)realloc(reach == stack_reach ? NULL : reach, 2 * (addr_length + 1));
+            if(memory_alloc == NULL) {
+                matched = 0;
+                break;
+            }
+            reach = memory_alloc;
+            reach_size = 2 * (addr_length + 1);
+        }
+        matched = match_segment(pattern, pat_end - pattern, address, addr_length, reach);
+        if(*pat_end == '\0' || *addr_end == '\0') {
+            matched = matched && *pat_end == *addr_end;
+            break;
+        }
+        pattern = pat_end + 1;
+        address = addr_end + 1;
+    }
+    if(reach != stack_reach) {
+        free(reach);
+    }
+
+return matched;
+}
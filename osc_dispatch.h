@@ -0,0 +1,98 @@
+/** @file osc_dispatch.h */
+
+#ifndef OSC_DISPATCH_H
+#define OSC_DISPATCH_H
+
+#include <stdint.h>
+#include <stdlib.h>
+#include "osc.h"
+
+#define OSC_DISPATCH_DEFAULT_CACHE_SIZE 256
+
+/**
+ * Function called for every message whose address pattern matches the address a handler was registered on
+ *
+ * @param   msg         pointer to the dispatched osc_message_view
+ * @param   context     the context pointer given at registration
+ */
+typedef void (*osc_method_handler)(const struct osc_message_view* msg, void* context);
+
+struct osc_dispatch_node;
+struct osc_dispatch_cache_entry;
+
+/**
+ * Structure representing an osc_dispatcher
+ * root is the root of the segment trie built from the registered addresses (one node per address segment)
+ * cache is a direct-mapped table of recently resolved incoming addresses (cache_size slots, a power of two or 0)
+ * generation is bumped on every registration, which invalidates all cache slots at once
+ * reach is scratch memory used by the segment pattern matcher (reach_size bytes)
+ */
+struct osc_dispatcher {
+    struct osc_dispatch_node* root;
+    struct osc_dispatch_cache_entry* cache;
+    size_t cache_size;
+    uint64_t generation;
+    unsigned char* reach;
+    size_t reach_size;
+};
+
+/**
+ * Creates a new osc_dispatcher instance
+ *
+ * @param   dispatcher  pointer to the osc_dispatcher structure
+ * @param   cache_size  the number of resolved addresses to remember (rounded up to a power of two, 0 disables the cache)
+ * @return              returns 0 on success or 1 if memory allocation failed
+ */
+int osc_dispatcher_new(struct osc_dispatcher* dispatcher, size_t cache_size);
+
+/**
+ * Destroys an osc_dispatcher instance by freeing the trie and the cache
+ *
+ * @param   dispatcher  pointer to the osc_dispatcher structure
+ */
+void osc_dispatcher_destroy(struct osc_dispatcher* dispatcher);
+
+/**
+ * Registers a handler on an address (e.g. "/mixer/ch/1/level")
+ * Registered addresses must start with '/' and must not contain '#' or any of the pattern characters "*?[]{},"
+ * Several handlers can be registered on the same address, they are called in registration order
+ *
+ * @param   dispatcher  pointer to the osc_dispatcher structure
+ * @param   address     the address to register the handler on
+ * @param   handler     the function to call for matching messages
+ * @param   context     pointer passed to the handler
+ * @return              returns 0 on success or 1 if the address is invalid or memory allocation failed
+ */
+int osc_dispatcher_add_method(struct osc_dispatcher* dispatcher, const char* address, osc_method_handler handler, void* context);
+
+/**
+ * Calls every handler whose address matches the address pattern of the message
+ * Supports the OSC pattern syntax '*', '?', "[a-z]", "[!a-z]" and "{foo,bar}" within address segments
+ * Handlers may dispatch other messages (a nested dispatch whose address shares the cache slot being iterated is
+ * resolved without the cache) but must not register new methods while they are being dispatched
+ *
+ * @param   dispatcher  pointer to the osc_dispatcher structure
+ * @param   msg         pointer to the osc_message_view to dispatch
+ * @return              the number of handlers called
+ */
+size_t osc_dispatcher_dispatch(struct osc_dispatcher* dispatcher, const struct osc_message_view* msg);
+
+/**
+ * Calls every handler whose address matches the address pattern of the osc_message instance
+ *
+ * @param   dispatcher  pointer to the osc_dispatcher structure
+ * @param   msg         pointer to the osc_message structure
+ * @return              the number of handlers called
+ */
+size_t osc_dispatcher_dispatch_message(struct osc_dispatcher* dispatcher, const struct osc_message* msg);
+
+/**
+ * Checks whether an OSC address pattern matches an address, segment by segment
+ *
+ * @param   pattern     the address pattern (may contain the OSC pattern syntax)
+ * @param   address     the address to match against
+ * @return              returns 1 if the pattern matches or 0 otherwise
+ */
+int osc_pattern_match(const char* pattern, const char* address);
+
+#endif //OSC_DISPATCH_H
@@ -0,0 +1,218 @@
+/** @file osc_instrument.c */
+
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <pthread.h>
+#include "osc_instrument.h"
+
+static const char* call_names[OSC_CALL_COUNT] = {
+    "message_add",
+    "message_set_address",
+    "message_arg",
+    "builder_finish",
+    "bundle_add",
+    "message_view_init",
+    "bundle_view_init"
+};
+
+/**
+ * Adds the counters and histograms of a snapshot to another one
+ *
+ * @param   sum         pointer to the snapshot receiving the sum
+ * @param   snapshot    pointer to the snapshot to add (read with relaxed atomic loads)
+ */
+static void add_snapshot(struct osc_instrument_snapshot* sum, const struct osc_instrument_snapshot* snapshot)
+{
+    const uint64_t* p_source = (const uint64_t*)&snapshot->counters;
+    uint64_t* p_sum = (uint64_t*)&sum->counters;
+    const struct osc_histogram* source_histograms = snapshot->histograms;
+    for(size_t i = 0; i < sizeof(struct osc_counters) / sizeof(uint64_t); i++) {
+        p_sum[i] += __atomic_load_n(&p_source[i], __ATOMIC_RELAXED);
+    }
+    for(size_t call = 0; call < OSC_CALL_COUNT; call++) {
+        struct osc_histogram* histogram = &sum->histograms[call];
+        histogram->count += __atomic_load_n(&source_histograms[call].count, __ATOMIC_RELAXED);
+        histogram->total_ns += __atomic_load_n(&source_histograms[call].total_ns, __ATOMIC_RELAXED);
+        uint64_t max_ns = __atomic_load_n(&source_histograms[call].max_ns, __ATOMIC_RELAXED);
+        if(max_ns > histogram->max_ns) {
+            histogram->max_ns = max_ns;
+        }
+        for(size_t b = 0; b < OSC_HISTOGRAM_BUCKETS; b++) {
+            histogram->buckets[b] += __atomic_load_n(&source_histograms[call].buckets[b], __ATOMIC_RELAXED);
+        }
+    }
+}
+
+#ifdef OSC_INSTRUMENT
+
+/**
+ * Structure representing the instrumentation data of a thread, linked into the list of live threads
+ */
+struct thread_data {
+    struct osc_instrument_snapshot snapshot;
+    struct thread_data* next;
+    int registered;
+};
+
+static _Thread_local struct thread_data thread_data;
+static struct thread_data* live_threads = NULL;
+static struct osc_instrument_snapshot exited_threads;
+static pthread_mutex_t registry_mutex = PTHREAD_MUTEX_INITIALIZER;
+static pthread_key_t exit_key;
+static pthread_once_t exit_key_once = PTHREAD_ONCE_INIT;
+
+/**
+ * Folds the data of an exiting thread into exited_threads and unlinks it
+ *
+ * @param   arg     pointer to the thread_data structure of the thread
+ */
+static void unregister_thread(void* arg)
+{
+    struct thread_data* data = (struct thread_data*)arg;
+    pthread_mutex_lock(&registry_mutex);
+    add_snapshot(&exited_threads, &data->snapshot);
+    for(struct thread_data** p_link = &live_threads; *p_link != NULL; p_link = &(*p_link)->next) {
+        if(*p_link == data) {
+            *p_link = data->next;
+            break;
+        }
+    }
+    pthread_mutex_unlock(&registry_mutex);
+}
+
+/**
+ * Creates the key whose destructor unregisters exiting threads
+ */
+static void create_exit_key(void)
+{
+    pthread_key_create(&exit_key, unregister_thread);
+}
+
+struct osc_instrument_snapshot* osc_instrument_thread_data(void)
+{
+    if(!thread_data.registered) {
+        pthread_once(&exit_key_once, create_exit_key);
+        pthread_mutex_lock(&registry_mutex);
+        thread_data.next = live_threads;
+        live_threads = &thread_data;
+        pthread_mutex_unlock(&registry_mutex);
+        pthread_setspecific(exit_key, &thread_data);
+        thread_data.registered = 1;
+    }
+
+return &thread_data.snapshot;
+}
+
+uint64_t osc_instrument_clock(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+
+return (uint64_t)ts.tv_sec * 1000000000ULL + (uint64_t)ts.tv_nsec;
+}
+
+void osc_instrument_record(enum osc_instrumented_call call, uint64_t start_ns)
+{
+    uint64_t elapsed = osc_instrument_clock() - start_ns;
+    struct osc_histogram* histogram = &osc_instrument_thread_data()->histograms[call];
+    size_t bucket = elapsed == 0 ? 0 : 63 - __builtin_clzll(elapsed);
+    if(bucket >= OSC_HISTOGRAM_BUCKETS) {
+        bucket = OSC_HISTOGRAM_BUCKETS - 1;
+    }
+    __atomic_store_n(&histogram->count, histogram->count + 1, __ATOMIC_RELAXED);
+    __atomic_store_n(&histogram->total_ns, histogram->total_ns + elapsed, __ATOMIC_RELAXED);
+    __atomic_store_n(&histogram->buckets[bucket], histogram->buckets[bucket] + 1, __ATOMIC_RELAXED);
+    if(elapsed > histogram->max_ns) {
+        __atomic_store_n(&histogram->max_ns, elapsed, __ATOMIC_RELAXED);
+    }
+}
+
+int osc_instrument_enabled(void)
+{
+return 1;
+}
+
+void osc_instrument_snapshot_thread(struct osc_instrument_snapshot* snapshot)
+{
+    memset(snapshot, 0, sizeof(*snapshot));
+    add_snapshot(snapshot, osc_instrument_thread_data());
+}
+
+void osc_instrument_snapshot_all(struct osc_instrument_snapshot* snapshot)
+{
+    memset(snapshot, 0, sizeof(*snapshot));
+    pthread_mutex_lock(&registry_mutex);
+    add_snapshot(snapshot, &exited_threads);
+    for(struct thread_data* data = live_threads; data != NULL; data = data->next) {
+        add_snapshot(snapshot, &data->snapshot);
+    }
+    pthread_mutex_unlock(&registry_mutex);
+}
+
+void osc_instrument_reset_thread(void)
+{
+    memset(osc_instrument_thread_data(), 0, sizeof(struct osc_instrument_snapshot));
+}
+
+#else
+
+int osc_instrument_enabled(void)
+{
+return 0;
+}
+
+void osc_instrument_snapshot_thread(struct osc_instrument_snapshot* snapshot)
+{
+    memset(snapshot, 0, sizeof(*snapshot));
+}
+
+void osc_instrument_snapshot_all(struct osc_instrument_snapshot* snapshot)
+{
+    memset(snapshot, 0, sizeof(*snapshot));
+    (void)add_snapshot;
+}
+
+void osc_instrument_reset_thread(void)
+{
+}
+
+#endif // OSC_INSTRUMENT
+
+const char* osc_instrument_call_name(enum osc_instrumented_call call)
+{
+    if(call >= OSC_CALL_COUNT) {
+        return "unknown";
+    }
+
+return call_names[call];
+}
+
+void osc_instrument_dump(FILE* out, const struct osc_instrument_snapshot* snapshot)
+{
+    const struct osc_counters* counters = &snapshot->counters;
+    fprintf(out, "allocations     %llu\n", (unsigned long long)counters->allocations);
+    fprintf(out, "reallocations   %llu\n", (unsigned long long)counters->reallocations);
+    fprintf(out, "deallocations   %llu\n", (unsigned long long)counters->deallocations);
+    fprintf(out, "bytes_moved     %llu\n", (unsigned long long)counters->bytes_moved);
+    fprintf(out, "bytes_scanned   %llu\n", (unsigned long long)counters->bytes_scanned);
+    fprintf(out, "messages_built  %llu\n", (unsigned long long)counters->messages_built);
+    fprintf(out, "bundles_built   %llu\n", (unsigned long long)counters->bundles_built);
+    fprintf(out, "packets_parsed  %llu\n", (unsigned long long)counters->packets_parsed);
+    for(size_t call = 0; call < OSC_CALL_COUNT; call++) {
+        const struct osc_histogram* histogram = &snapshot->histograms[call];
+        if(histogram->count == 0) {
+            continue;
+        }
+        fprintf(out, "%-20s count %llu mean %.1f ns max %llu ns |", call_names[call], (unsigned long long)histogram->count,
+                (double)histogram->total_ns / histogram->count, (unsigned long long)histogram->max_ns);
+        for(size_t b = 0; b < OSC_HISTOGRAM_BUCKETS; b++) {
+            if(histogram->buckets[b] != 0) {
+                fprintf(out, " <%lluns:%llu", 2ULL << b, (unsigned long long)histogram->buckets[b]);
+            }
+        }
+        fprintf(out, "\n");
+    }
+}
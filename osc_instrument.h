@@ -0,0 +1,145 @@
+/** @file osc_instrument.h */
+
+#ifndef OSC_INSTRUMENT_H
+#define OSC_INSTRUMENT_H
+
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+#define OSC_HISTOGRAM_BUCKETS 32
+
+/**
+ * API calls whose latency is recorded when the library is compiled with OSC_INSTRUMENT
+ */
+enum osc_instrumented_call {
+    OSC_CALL_MESSAGE_ADD,
+    OSC_CALL_MESSAGE_SET_ADDRESS,
+    OSC_CALL_MESSAGE_ARG,
+    OSC_CALL_BUILDER_FINISH,
+    OSC_CALL_BUNDLE_ADD,
+    OSC_CALL_MESSAGE_VIEW_INIT,
+    OSC_CALL_BUNDLE_VIEW_INIT,
+    OSC_CALL_COUNT
+};
+
+/**
+ * Structure representing the instrumentation counters
+ * allocations, reallocations and deallocations count the osc_allocator calls, bytes_moved the bytes shifted by memmove
+ * inside buffers, bytes_scanned the bytes read by strlen, messages_built and bundles_built the packets created
+ * and packets_parsed the messages and bundles validated into views
+ */
+struct osc_counters {
+    uint64_t allocations;
+    uint64_t reallocations;
+    uint64_t deallocations;
+    uint64_t bytes_moved;
+    uint64_t bytes_scanned;
+    uint64_t messages_built;
+    uint64_t bundles_built;
+    uint64_t packets_parsed;
+};
+
+/**
+ * Structure representing a latency histogram
+ * buckets[n] counts the calls that took between 2^n and 2^(n+1) - 1 nanoseconds (the last bucket takes everything above)
+ */
+struct osc_histogram {
+    uint64_t count;
+    uint64_t total_ns;
+    uint64_t max_ns;
+    uint64_t buckets[OSC_HISTOGRAM_BUCKETS];
+};
+
+/**
+ * Structure representing a copy of the instrumentation counters and histograms
+ */
+struct osc_instrument_snapshot {
+    struct osc_counters counters;
+    struct osc_histogram histograms[OSC_CALL_COUNT];
+};
+
+/**
+ * Tells whether the library was compiled with OSC_INSTRUMENT
+ *
+ * @return              returns 1 if instrumentation is compiled in or 0 otherwise
+ */
+int osc_instrument_enabled(void);
+
+/**
+ * Copies the counters and histograms of the calling thread (all zero without OSC_INSTRUMENT)
+ *
+ * @param   snapshot    pointer to the osc_instrument_snapshot structure to fill
+ */
+void osc_instrument_snapshot_thread(struct osc_instrument_snapshot* snapshot);
+
+/**
+ * Sums up the counters and histograms of every thread, including the threads that have exited
+ * The values of running threads are read without stopping them and may be slightly behind
+ *
+ * @param   snapshot    pointer to the osc_instrument_snapshot structure to fill
+ */
+void osc_instrument_snapshot_all(struct osc_instrument_snapshot* snapshot);
+
+/**
+ * Resets the counters and histograms of the calling thread
+ */
+void osc_instrument_reset_thread(void);
+
+/**
+ * Finds the name of an instrumented call
+ *
+ * @param   call        the instrumented call
+ * @return              the name of the call
+ */
+const char* osc_instrument_call_name(enum osc_instrumented_call call);
+
+/**
+ * Writes a snapshot as text, one counter or one histogram per line
+ *
+ * @param   out         the output stream
+ * @param   snapshot    pointer to the osc_instrument_snapshot structure
+ */
+void osc_instrument_dump(FILE* out, const struct osc_instrument_snapshot* snapshot);
+
+#ifdef OSC_INSTRUMENT
+
+/**
+ * Finds the instrumentation data of the calling thread, registering it on first use (library internal)
+ *
+ * @return              pointer to the snapshot structure the calling thread updates
+ */
+struct osc_instrument_snapshot* osc_instrument_thread_data(void);
+
+/**
+ * Reads CLOCK_MONOTONIC in nanoseconds (library internal)
+ *
+ * @return              the current time in nanoseconds
+ */
+uint64_t osc_instrument_clock(void);
+
+/**
+ * Records the latency of a call in the histogram of the calling thread (library internal)
+ *
+ * @param   call        the instrumented call
+ * @param   start_ns    the osc_instrument_clock value taken when the call started
+ */
+void osc_instrument_record(enum osc_instrumented_call call, uint64_t start_ns);
+
+#define OSC_COUNT(field, value) \
+    do { \
+    struct osc_counters* osc_counters_ = &osc_instrument_thread_data()->counters; \
+    __atomic_store_n(&osc_counters_->field, osc_counters_->field + (value), __ATOMIC_RELAXED); \
+    } while (0)
+#define OSC_TIME_BEGIN(start) uint64_t start = osc_instrument_clock()
+#define OSC_TIME_END(call, start) osc_instrument_record(call, start)
+
+#else
+
+#define OSC_COUNT(field, value) do { } while (0)
+#define OSC_TIME_BEGIN(start) do { } while (0)
+#define OSC_TIME_END(call, start) do { } while (0)
+
+#endif // OSC_INSTRUMENT
+
+#endif //OSC_INSTRUMENT_H
@@ -0,0 +1,975 @@
+/** @file osc_loop.c */
+
+#ifndef _GNU_SOURCE
+    #define _GNU_SOURCE
+#endif // _GNU_SOURCE
+
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <time.h>
+#include <unistd.h>
+#include <endian.h>
+#include <sys/epoll.h>
+#include <sys/mman.h>
+#include <sys/socket.h>
+#include <sys/syscall.h>
+#include <sys/uio.h>
+#include <linux/io_uring.h>
+#include "osc_loop.h"
+
+#define NTP_UNIX_EPOCH_DELTA 2208988800ULL
+#define NO_SLOT UINT32_MAX
+#define NOT_PENDING SIZE_MAX
+#define TOKEN_POLL 0ULL
+#define TOKEN_SEND (1ULL << 62)
+#define TOKEN_IGNORE (2ULL << 62)
+#define TOKEN_KIND (3ULL << 62)
+#define GENERATION_MASK 0x3FFFFFFFU
+
+/** Endpoint states: nothing known, a readiness notification is awaited, the socket may be read */
+#define STATE_IDLE 0
+#define STATE_ARMED 1
+#define STATE_READY 2
+
+/**
+ * Structure representing a datagram sent through io_uring, kept until its completion
+ */
+struct osc_loop_send {
+    struct msghdr header;
+    struct iovec iov;
+    struct sockaddr_storage address;
+    struct osc_packet* packet;
+    uint32_t next;
+};
+
+/**
+ * Structure representing an io_uring instance and its mapped rings
+ * sqe_tail counts the submission entries prepared so far, pending the ones not handed to the kernel yet
+ * sends is a pool of depth datagrams, the unused ones linked from send_free
+ */
+struct osc_loop_ring {
+    void* sq_map;
+    size_t sq_map_size;
+    void* cq_map;
+    size_t cq_map_size;
+    struct io_uring_sqe* sqes;
+    size_t sqes_size;
+    uint32_t* sq_head;
+    uint32_t* sq_tail;
+    uint32_t* sq_array;
+    uint32_t sq_mask;
+    uint32_t sq_entries;
+    uint32_t* cq_head;
+    uint32_t* cq_tail;
+    uint32_t cq_mask;
+    struct io_uring_cqe* cqes;
+    uint32_t sqe_tail;
+    uint32_t pending;
+    struct osc_loop_send* sends;
+    uint32_t send_free;
+    size_t sends_in_flight;
+};
+
+/**
+ * Reads the given clock in nanoseconds
+ *
+ * @param   clock_id    the clock to read
+ * @return              the clock value in nanoseconds
+ */
+static uint64_t clock_ns(clockid_t clock_id)
+{
+    struct timespec ts;
+    clock_gettime(clock_id, &ts);
+
+return (uint64_t)ts.tv_sec * 1000000000ULL + (uint64_t)ts.tv_nsec;
+}
+
+/**
+ * Builds the token identifying the readiness notifications of an endpoint
+ *
+ * @param   loop        pointer to the osc_loop structure
+ * @param   endpoint    pointer to the osc_loop_endpoint structure
+ * @return              the token
+ */
+static uint64_t poll_token(const struct osc_loop* loop, const struct osc_loop_endpoint* endpoint)
+{
+return TOKEN_POLL | ((uint64_t)loop->generations[endpoint->slot] << 32) | endpoint->slot;
+}
+
+/**
+ * Finds the endpoint a readiness token belongs to
+ *
+ * @param   loop        pointer to the osc_loop structure
+ * @param   token       the token
+ * @return              the endpoint or NULL if it was removed since
+ */
+static struct osc_loop_endpoint* find_endpoint(const struct osc_loop* loop, uint64_t token)
+{
+    uint32_t slot = (uint32_t)token;
+    if(slot >= loop->max_endpoints || loop->endpoints[slot] == NULL ||
+       loop->generations[slot] != (uint32_t)(token >> 32 & GENERATION_MASK)) {
+        return NULL;
+    }
+
+return loop->endpoints[slot];
+}
+
+/**
+ * Appends an endpoint to the ready list unless it is disabled or already there
+ *
+ * @param   loop        pointer to the osc_loop structure
+ * @param   endpoint    pointer to the osc_loop_endpoint structure
+ */
+static void push_ready(struct osc_loop* loop, struct osc_loop_endpoint* endpoint)
+{
+    if(!endpoint->enabled || endpoint->queued) {
+        return;
+    }
+    endpoint->queued = 1;
+    endpoint->next_ready = NULL;
+    if(loop->ready_tail != NULL) {
+        loop->ready_tail->next_ready = endpoint;
+    }
+    else {
+        loop->ready = endpoint;
+    }
+    loop->ready_tail = endpoint;
+    loop->ready_count++;
+}
+
+/**
+ * Removes the first endpoint of the ready list
+ *
+ * @param   loop        pointer to the osc_loop structure
+ * @return              the endpoint
+ */
+static struct osc_loop_endpoint* pop_ready(struct osc_loop* loop)
+{
+    struct osc_loop_endpoint* endpoint = loop->ready;
+    loop->ready = endpoint->next_ready;
+    if(loop->ready == NULL) {
+        loop->ready_tail = NULL;
+    }
+    endpoint->queued = 0;
+    loop->ready_count--;
+
+return endpoint;
+}
+
+/**
+ * Removes an endpoint from the ready list if it is there
+ *
+ * @param   loop        pointer to the osc_loop structure
+ * @param   endpoint    pointer to the osc_loop_endpoint structure
+ */
+static void unlink_ready(struct osc_loop* loop, struct osc_loop_endpoint* endpoint)
+{
+    if(!endpoint->queued) {
+        return;
+    }
+    struct osc_loop_endpoint* previous = NULL;
+    struct osc_loop_endpoint* current = loop->ready;
+    while(current != endpoint) {
+        previous = current;
+        current = current->next_ready;
+    }
+    if(previous != NULL) {
+        previous->next_ready = endpoint->next_ready;
+    }
+    else {
+        loop->ready = endpoint->next_ready;
+    }
+    if(loop->ready_tail == endpoint) {
+        loop->ready_tail = previous;
+    }
+    endpoint->queued = 0;
+    loop->ready_count--;
+}
+
+/**
+ * Records that the socket of an endpoint became readable
+ *
+ * @param   loop        pointer to the osc_loop structure
+ * @param   token       the readiness token of the endpoint
+ */
+static void mark_ready(struct osc_loop* loop, uint64_t token)
+{
+    struct osc_loop_endpoint* endpoint = find_endpoint(loop, token);
+    if(endpoint == NULL || endpoint->state != STATE_ARMED) {
+        return;
+    }
+    loop->stats.events++;
+    endpoint->state = STATE_READY;
+    push_ready(loop, endpoint);
+}
+
+/**
+ * Unmaps the rings and closes an io_uring instance
+ *
+ * @param   loop        pointer to the osc_loop structure
+ */
+static void ring_close(struct osc_loop* loop)
+{
+    struct osc_loop_ring* ring = loop->ring;
+    if(ring->sqes != NULL) {
+        munmap(ring->sqes, ring->sqes_size);
+    }
+    if(ring->cq_map != NULL && ring->cq_map != ring->sq_map) {
+        munmap(ring->cq_map, ring->cq_map_size);
+    }
+    if(ring->sq_map != NULL) {
+        munmap(ring->sq_map, ring->sq_map_size);
+    }
+    if(ring->sends != NULL) {
+        for(size_t i = 0; i < loop->depth; i++) {
+            osc_packet_release(ring->sends[i].packet);
+        }
+    }
+    free(ring->sends);
+    free(ring);
+    loop->ring = NULL;
+    if(loop->fd >= 0) {
+        close(loop->fd);
+        loop->fd = -1;
+    }
+}
+
+/**
+ * Maps one region of an io_uring instance
+ *
+ * @param   fd          the io_uring file descriptor
+ * @param   size        the size of the region
+ * @param   offset      the offset identifying the region
+ * @return              the region or NULL if it could not be mapped
+ */
+static void* ring_map(int fd, size_t size, off_t offset)
+{
+    void* map = mmap(NULL, size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, fd, offset);
+
+return map == MAP_FAILED ? NULL : map;
+}
+
+/**
+ * Creates the io_uring instance of a loop, with room in the completion ring for a readiness notification per
+ * endpoint and a completion per datagram in flight
+ *
+ * @param   loop        pointer to the osc_loop structure
+ * @return              returns 0 on success or 1 if io_uring (with IORING_FEAT_EXT_ARG) is not available
+ */
+static int ring_open(struct osc_loop* loop)
+{
+    struct io_uring_params params;
+    memset(&params, 0, sizeof(params));
+    params.flags = IORING_SETUP_CQSIZE | IORING_SETUP_CLAMP;
+    params.cq_entries = (uint32_t)(loop->max_endpoints + loop->depth);
+    loop->fd = (int)syscall(__NR_io_uring_setup, (unsigned int)loop->depth, &params);
+    if(loop->fd < 0) {
+        return 1;
+    }
+    struct osc_loop_ring* ring = (struct osc_loop_ring*)calloc(1, sizeof(struct osc_loop_ring));
+    if(ring == NULL) {
+        close(loop->fd);
+        loop->fd = -1;
+        return 1;
+    }
+    loop->ring = ring;
+    if(!(params.features & IORING_FEAT_EXT_ARG)) {
+        ring_close(loop);
+        return 1;
+    }
+    ring->sq_map_size = params.sq_off.array + params.sq_entries * sizeof(uint32_t);
+    ring->cq_map_size = params.cq_off.cqes + params.cq_entries * sizeof(struct io_uring_cqe);
+    if(params.features & IORING_FEAT_SINGLE_MMAP) {
+        if(ring->cq_map_size > ring->sq_map_size) {
+            ring->sq_map_size = ring->cq_map_size;
+        }
+        ring->sq_map = ring_map(loop->fd, ring->sq_map_size, IORING_OFF_SQ_RING);
+        ring->cq_map = ring->sq_map;
+    }
+    else {
+        ring->sq_map = ring_map(loop->fd, ring->sq_map_size, IORING_OFF_SQ_RING);
+        ring->cq_map = ring_map(loop->fd, ring->cq_map_size, IORING_OFF_CQ_RING);
+    }
+    ring->sqes_size = params.sq_entries * sizeof(struct io_uring_sqe);
+    ring->sqes = (struct io_uring_sqe*)ring_map(loop->fd, ring->sqes_size, IORING_OFF_SQES);
+    // the sends are sized by the actual number of submission entries, which the kernel rounds to a power of 2
+    loop->depth = params.sq_entries;
+    ring->sends = (struct osc_loop_send*)calloc(loop->depth, sizeof(struct osc_loop_send));
+    if(ring->sq_map == NULL || ring->cq_map == NULL || ring->sqes == NULL || ring->sends == NULL) {
+        ring_close(loop);
+        return 1;
+    }
+    char* sq = (char*)ring->sq_map;
+    char* cq = (char*)ring->cq_map;
+    ring->sq_head = (uint32_t*)(sq + params.sq_off.head);
+    ring->sq_tail = (uint32_t*)(sq + params.sq_off.tail);
+    ring->sq_array = (uint32_t*)(sq + params.sq_off.array);
+    ring->sq_mask = *(uint32_t*)(sq + params.sq_off.ring_mask);
+    ring->sq_entries = params.sq_entries;
+    ring->cq_head = (uint32_t*)(cq + params.cq_off.head);
+    ring->cq_tail = (uint32_t*)(cq + params.cq_off.tail);
+    ring->cq_mask = *(uint32_t*)(cq + params.cq_off.ring_mask);
+    ring->cqes = (struct io_uring_cqe*)(cq + params.cq_off.cqes);
+    ring->sqe_tail = *ring->sq_tail;
+    for(size_t i = 0; i < loop->depth; i++) {
+        ring->sends[i].next = i + 1 < loop->depth ? (uint32_t)(i + 1) : NO_SLOT;
+    }
+    ring->send_free = 0;
+
+return 0;
+}
+
+/**
+ * Hands the pending submission entries to the kernel and optionally waits for completions
+ *
+ * @param   loop            pointer to the osc_loop structure
+ * @param   min_complete    the number of completions to wait for (0 does not wait)
+ * @param   timeout_ns      how long to wait at most (-1 waits forever)
+ * @return                  returns 0 on success (including a timeout or a full completion ring) or 1 if the call failed
+ */
+static int ring_enter(struct osc_loop* loop, unsigned int min_complete, int64_t timeout_ns)
+{
+    struct osc_loop_ring* ring = loop->ring;
+    if(ring->pending == 0 && min_complete == 0) {
+        return 0;
+    }
+    __atomic_store_n(ring->sq_tail, ring->sqe_tail, __ATOMIC_RELEASE);
+    unsigned int flags = 0;
+    struct io_uring_getevents_arg arg;
+    struct __kernel_timespec ts;
+    memset(&arg, 0, sizeof(arg));
+    if(min_complete > 0) {
+        flags = IORING_ENTER_GETEVENTS | IORING_ENTER_EXT_ARG;
+        if(timeout_ns >= 0) {
+            ts.tv_sec = timeout_ns / 1000000000LL;
+            ts.tv_nsec = timeout_ns % 1000000000LL;
+            arg.ts = (uint64_t)(uintptr_t)&ts;
+        }
+    }
+    int result = (int)syscall(__NR_io_uring_enter, loop->fd, ring->pending, min_complete, flags,
+                              min_complete > 0 ? &arg : NULL, sizeof(arg));
+    loop->stats.syscalls++;
+    if(result < 0) {
+        return (errno == ETIME || errno == EINTR || errno == EAGAIN || errno == EBUSY) ? 0 : 1;
+    }
+    ring->pending -= (uint32_t)result;
+
+return 0;
+}
+
+/**
+ * Prepares a submission entry, handing the pending ones to the kernel first if the submission ring is full
+ *
+ * @param   loop        pointer to the osc_loop structure
+ * @return              the zeroed entry or NULL if the submission ring stays full
+ */
+static struct io_uring_sqe* ring_sqe(struct osc_loop* loop)
+{
+    struct osc_loop_ring* ring = loop->ring;
+    if(ring->sqe_tail - __atomic_load_n(ring->sq_head, __ATOMIC_ACQUIRE) == ring->sq_entries) {
+        ring_enter(loop, 0, -1);
+        if(ring->sqe_tail - __atomic_load_n(ring->sq_head, __ATOMIC_ACQUIRE) == ring->sq_entries) {
+            return NULL;
+        }
+    }
+    uint32_t index = ring->sqe_tail & ring->sq_mask;
+    struct io_uring_sqe* sqe = &ring->sqes[index];
+    memset(sqe, 0, sizeof(*sqe));
+    ring->sq_array[index] = index;
+    ring->sqe_tail++;
+    ring->pending++;
+
+return sqe;
+}
+
+/**
+ * Consumes the available completions: readiness notifications mark their endpoint ready, send completions
+ * release their packet; no handler is called
+ *
+ * @param   loop        pointer to the osc_loop structure
+ */
+static void ring_reap(struct osc_loop* loop)
+{
+    struct osc_loop_ring* ring = loop->ring;
+    uint32_t head = *ring->cq_head;
+    uint32_t tail = __atomic_load_n(ring->cq_tail, __ATOMIC_ACQUIRE);
+    while(head != tail) {
+        const struct io_uring_cqe* cqe = &ring->cqes[head & ring->cq_mask];
+        if((cqe->user_data & TOKEN_KIND) == TOKEN_POLL) {
+            mark_ready(loop, cqe->user_data);
+        }
+        else if((cqe->user_data & TOKEN_KIND) == TOKEN_SEND) {
+            struct osc_loop_send* send = &ring->sends[(uint32_t)cqe->user_data];
+            if(cqe->res < 0) {
+                loop->stats.send_errors++;
+            }
+            else {
+                loop->stats.sent++;
+            }
+            osc_packet_release(send->packet);
+            send->packet = NULL;
+            send->next = ring->send_free;
+            ring->send_free = (uint32_t)cqe->user_data;
+            ring->sends_in_flight--;
+        }
+        head++;
+    }
+    __atomic_store_n(ring->cq_head, head, __ATOMIC_RELEASE);
+}
+
+/**
+ * Adds the outcome of a flush of a socket queue to the loop counters (epoll backend)
+ *
+ * @param   loop        pointer to the osc_loop structure
+ * @param   sock        pointer to the flushed osc_udp_socket structure
+ * @param   sent        the sent counter of the socket before the flush
+ * @param   send_calls  the send_calls counter of the socket before the flush
+ * @param   queued      the number of datagrams queued before the flush
+ */
+static void count_flush(struct osc_loop* loop, const struct osc_udp_socket* sock, uint64_t sent, uint64_t send_calls, size_t queued)
+{
+    loop->stats.sent += sock->stats.sent - sent;
+    loop->stats.send_errors += queued - (sock->stats.sent - sent);
+    loop->stats.syscalls += sock->stats.send_calls - send_calls;
+}
+
+/**
+ * Flushes the sockets holding datagrams queued through the loop (epoll backend)
+ *
+ * @param   loop        pointer to the osc_loop structure
+ */
+static void flush_dirty(struct osc_loop* loop)
+{
+    while(loop->dirty != NULL) {
+        struct osc_loop_endpoint* endpoint = loop->dirty;
+        struct osc_udp_socket* sock = endpoint->sock;
+        loop->dirty = endpoint->next_dirty;
+        endpoint->dirty = 0;
+        uint64_t sent = sock->stats.sent;
+        uint64_t send_calls = sock->stats.send_calls;
+        size_t queued = sock->tx_count;
+        osc_udp_flush(sock);
+        count_flush(loop, sock, sent, send_calls, queued);
+    }
+}
+
+/**
+ * Watches the socket of an idle endpoint for readability
+ *
+ * @param   loop        pointer to the osc_loop structure
+ * @param   endpoint    pointer to the osc_loop_endpoint structure
+ * @return              returns 0 on success or 1 if the socket could not be watched
+ */
+static int arm(struct osc_loop* loop, struct osc_loop_endpoint* endpoint)
+{
+    if(loop->ring != NULL) {
+        struct io_uring_sqe* sqe = ring_sqe(loop);
+        if(sqe == NULL) {
+            return 1;
+        }
+        sqe->opcode = IORING_OP_POLL_ADD;
+        sqe->fd = endpoint->sock->fd;
+#if __BYTE_ORDER == __BIG_ENDIAN
+        sqe->poll32_events = (uint32_t)POLLIN << 16;
+#else
+        sqe->poll32_events = POLLIN;
+#endif
+        sqe->user_data = poll_token(loop, endpoint);
+    }
+    else {
+        struct epoll_event event;
+        event.events = EPOLLIN | EPOLLONESHOT;
+        event.data.u64 = poll_token(loop, endpoint);
+        loop->stats.syscalls++;
+        if(epoll_ctl(loop->fd, EPOLL_CTL_MOD, endpoint->sock->fd, &event) != 0) {
+            return 1;
+        }
+    }
+    endpoint->state = STATE_ARMED;
+
+return 0;
+}
+
+/**
+ * Receives one batch from every endpoint that was ready when the call started and calls their handlers
+ * An endpoint that filled its batch stays ready for the next iteration, the others are watched again
+ *
+ * @param   loop        pointer to the osc_loop structure
+ */
+static void dispatch_ready(struct osc_loop* loop)
+{
+    size_t remaining = loop->ready_count;
+    while(remaining-- > 0 && loop->ready != NULL) {
+        struct osc_loop_endpoint* endpoint = pop_ready(loop);
+        if(!endpoint->enabled) {
+            continue;
+        }
+        struct osc_udp_socket* sock = endpoint->sock;
+        uint64_t receive_calls = sock->stats.receive_calls;
+        size_t count = 0;
+        int result = osc_udp_receive(sock, loop->packets, sock->batch, -1, &count);
+        loop->stats.syscalls += sock->stats.receive_calls - receive_calls;
+        loop->stats.received += count;
+        // decided before the handler runs, since it may disable or remove the endpoint
+        if(result == 0 && count == sock->batch) {
+            push_ready(loop, endpoint);
+        }
+        else {
+            endpoint->state = STATE_IDLE;
+            arm(loop, endpoint);
+        }
+        if(count > 0) {
+            endpoint->handler(endpoint, loop->packets, count, endpoint->context);
+        }
+    }
+}
+
+/**
+ * Moves a timer of the heap up to its place
+ *
+ * @param   loop        pointer to the osc_loop structure
+ * @param   index       the position of the timer
+ */
+static void heap_up(struct osc_loop* loop, size_t index)
+{
+    struct osc_loop_timer* timer = loop->timers[index];
+    while(index > 0) {
+        size_t parent = (index - 1) / 2;
+        if(loop->timers[parent]->deadline_ns <= timer->deadline_ns) {
+            break;
+        }
+        loop->timers[index] = loop->timers[parent];
+        loop->timers[index]->heap_index = index;
+        index = parent;
+    }
+    loop->timers[index] = timer;
+    timer->heap_index = index;
+}
+
+/**
+ * Moves a timer of the heap down to its place
+ *
+ * @param   loop        pointer to the osc_loop structure
+ * @param   index       the position of the timer
+ */
+static void heap_down(struct osc_loop* loop, size_t index)
+{
+    struct osc_loop_timer* timer = loop->timers[index];
+    while(1) {
+        size_t child = 2 * index + 1;
+        if(child >= loop->timer_count) {
+            break;
+        }
+        if(child + 1 < loop->timer_count && loop->timers[child + 1]->deadline_ns < loop->timers[child]->deadline_ns) {
+            child++;
+        }
+        if(timer->deadline_ns <= loop->timers[child]->deadline_ns) {
+            break;
+        }
+        loop->timers[index] = loop->timers[child];
+        loop->timers[index]->heap_index = index;
+        index = child;
+    }
+    loop->timers[index] = timer;
+    timer->heap_index = index;
+}
+
+/**
+ * Removes the timer at a position of the heap
+ *
+ * @param   loop        pointer to the osc_loop structure
+ * @param   index       the position of the timer
+ */
+static void heap_remove(struct osc_loop* loop, size_t index)
+{
+    loop->timers[index]->heap_index = NOT_PENDING;
+    loop->timer_count--;
+    if(index == loop->timer_count) {
+        return;
+    }
+    struct osc_loop_timer* moved = loop->timers[loop->timer_count];
+    loop->timers[index] = moved;
+    heap_up(loop, index);
+    heap_down(loop, moved->heap_index);
+}
+
+/**
+ * Calls the handlers of the timers due at the given time, earliest first
+ *
+ * @param   loop        pointer to the osc_loop structure
+ * @param   now_ns      the current CLOCK_MONOTONIC time in nanoseconds
+ */
+static void fire_timers(struct osc_loop* loop, uint64_t now_ns)
+{
+    while(loop->timer_count > 0 && loop->timers[0]->deadline_ns <= now_ns) {
+        struct osc_loop_timer* timer = loop->timers[0];
+        heap_remove(loop, 0);
+        loop->stats.timers++;
+        timer->handler(timer, timer->context);
+    }
+}
+
+int osc_loop_new(struct osc_loop* loop, enum osc_loop_backend backend, size_t max_endpoints, size_t depth)
+{
+    memset(loop, 0, sizeof(*loop));
+    loop->fd = -1;
+    loop->max_endpoints = max_endpoints == 0 ? OSC_LOOP_DEFAULT_MAX_ENDPOINTS : max_endpoints;
+    loop->depth = depth == 0 ? OSC_LOOP_DEFAULT_DEPTH : depth;
+    if(loop->max_endpoints >= NO_SLOT || loop->depth >= NO_SLOT) {
+        return 1;
+    }
+    loop->endpoints = (struct osc_loop_endpoint**)calloc(loop->max_endpoints, sizeof(struct osc_loop_endpoint*));
+    loop->generations = (uint32_t*)calloc(loop->max_endpoints, sizeof(uint32_t));
+    loop->free_slots = (uint32_t*)malloc(loop->max_endpoints * sizeof(uint32_t));
+    if(loop->endpoints == NULL || loop->generations == NULL || loop->free_slots == NULL) {
+        osc_loop_destroy(loop);
+        return 1;
+    }
+    for(size_t i = 0; i < loop->max_endpoints; i++) {
+        loop->free_slots[i] = (uint32_t)(loop->max_endpoints - 1 - i);
+    }
+    loop->free_count = loop->max_endpoints;
+    loop->realtime_offset_ns = (int64_t)(clock_ns(CLOCK_REALTIME) - clock_ns(CLOCK_MONOTONIC));
+    if(backend != OSC_LOOP_EPOLL && ring_open(loop) == 0) {
+        loop->backend = OSC_LOOP_IO_URING;
+        return 0;
+    }
+    if(backend == OSC_LOOP_IO_URING) {
+        osc_loop_destroy(loop);
+        return 1;
+    }
+    loop->backend = OSC_LOOP_EPOLL;
+    loop->fd = epoll_create1(EPOLL_CLOEXEC);
+    loop->events = (struct epoll_event*)calloc(loop->depth, sizeof(struct epoll_event));
+    if(loop->fd < 0 || loop->events == NULL) {
+        osc_loop_destroy(loop);
+        return 1;
+    }
+
+return 0;
+}
+
+void osc_loop_destroy(struct osc_loop* loop)
+{
+    if(loop->ring != NULL) {
+        ring_enter(loop, 0, -1);
+        while(loop->ring->sends_in_flight > 0 && ring_enter(loop, 1, -1) == 0) {
+            ring_reap(loop);
+        }
+        ring_close(loop);
+    }
+    else {
+        flush_dirty(loop);
+        if(loop->fd >= 0) {
+            close(loop->fd);
+        }
+    }
+    free(loop->events);
+    free(loop->endpoints);
+    free(loop->generations);
+    free(loop->free_slots);
+    free(loop->packets);
+    free(loop->timers);
+    memset(loop, 0, sizeof(*loop));
+    loop->fd = -1;
+}
+
+int osc_loop_add(struct osc_loop* loop, struct osc_loop_endpoint* endpoint, struct osc_udp_socket* sock,
+                 osc_loop_handler handler, void* context)
+{
+    if(loop->free_count == 0) {
+        return 1;
+    }
+    if(sock->batch > loop->packet_capacity) {
+        struct osc_udp_packet* packets = (struct osc_udp_packet*)realloc(loop->packets, sock->batch * sizeof(struct osc_udp_packet));
+        if(packets == NULL) {
+            return 1;
+        }
+        loop->packets = packets;
+        loop->packet_capacity = sock->batch;
+    }
+    int flags = fcntl(sock->fd, F_GETFL);
+    if(flags < 0 || fcntl(sock->fd, F_SETFL, flags | O_NONBLOCK) != 0) {
+        return 1;
+    }
+    memset(endpoint, 0, sizeof(*endpoint));
+    endpoint->sock = sock;
+    endpoint->handler = handler;
+    endpoint->context = context;
+    endpoint->enabled = 1;
+    endpoint->state = STATE_IDLE;
+    endpoint->slot = loop->free_slots[loop->free_count - 1];
+    if(loop->ring != NULL) {
+        if(arm(loop, endpoint) == 1) {
+            return 1;
+        }
+    }
+    else {
+        struct epoll_event event;
+        event.events = EPOLLIN | EPOLLONESHOT;
+        event.data.u64 = poll_token(loop, endpoint);
+        loop->stats.syscalls++;
+        if(epoll_ctl(loop->fd, EPOLL_CTL_ADD, sock->fd, &event) != 0) {
+            return 1;
+        }
+        endpoint->state = STATE_ARMED;
+    }
+    loop->free_count--;
+    loop->endpoints[endpoint->slot] = endpoint;
+    loop->enabled_count++;
+
+return 0;
+}
+
+void osc_loop_remove(struct osc_loop* loop, struct osc_loop_endpoint* endpoint)
+{
+    if(endpoint->slot >= loop->max_endpoints || loop->endpoints[endpoint->slot] != endpoint) {
+        return;
+    }
+    if(loop->ring != NULL) {
+        struct io_uring_sqe* sqe = endpoint->state == STATE_ARMED ? ring_sqe(loop) : NULL;
+        if(sqe != NULL) {
+            sqe->opcode = IORING_OP_POLL_REMOVE;
+            sqe->addr = poll_token(loop, endpoint);
+            sqe->user_data = TOKEN_IGNORE;
+        }
+        // the queued datagrams of the socket must reach the kernel while its descriptor is still open
+        ring_enter(loop, 0, -1);
+    }
+    else {
+        if(endpoint->dirty) {
+            flush_dirty(loop);
+        }
+        loop->stats.syscalls++;
+        epoll_ctl(loop->fd, EPOLL_CTL_DEL, endpoint->sock->fd, NULL);
+    }
+    unlink_ready(loop, endpoint);
+    if(endpoint->enabled) {
+        loop->enabled_count--;
+    }
+    loop->generations[endpoint->slot] = (loop->generations[endpoint->slot] + 1) & GENERATION_MASK;
+    loop->endpoints[endpoint->slot] = NULL;
+    loop->free_slots[loop->free_count++] = endpoint->slot;
+    endpoint->slot = NO_SLOT;
+    endpoint->enabled = 0;
+    endpoint->state = STATE_IDLE;
+}
+
+int osc_loop_enable(struct osc_loop* loop, struct osc_loop_endpoint* endpoint, int enabled)
+{
+    if(!enabled) {
+        if(endpoint->enabled) {
+            endpoint->enabled = 0;
+            loop->enabled_count--;
+        }
+        return 0;
+    }
+    if(endpoint->enabled) {
+        return 0;
+    }
+    endpoint->enabled = 1;
+    loop->enabled_count++;
+    if(endpoint->state == STATE_READY) {
+        push_ready(loop, endpoint);
+    }
+    else if(endpoint->state == STATE_IDLE) {
+        return arm(loop, endpoint);
+    }
+
+return 0;
+}
+
+int osc_loop_send(struct osc_loop* loop, struct osc_loop_endpoint* endpoint, struct osc_packet* packet,
+                  const struct sockaddr* address, socklen_t address_length)
+{
+    if(address == NULL) {
+        address = (const struct sockaddr*)&endpoint->sock->destination;
+        address_length = endpoint->sock->destination_length;
+    }
+    if(address_length == 0 || address_length > sizeof(struct sockaddr_storage)) {
+        return 1;
+    }
+    if(loop->ring == NULL) {
+        struct osc_udp_socket* sock = endpoint->sock;
+        uint64_t sent = sock->stats.sent;
+        uint64_t send_calls = sock->stats.send_calls;
+        size_t queued = sock->tx_count;
+        int return_value = osc_udp_queue_packet(sock, packet, address, address_length);
+        // a full queue is flushed by osc_udp_queue_packet before the datagram is queued
+        if(sock->stats.send_calls != send_calls) {
+            count_flush(loop, sock, sent, send_calls, queued);
+        }
+        if(return_value == 1) {
+            return 1;
+        }
+        if(!endpoint->dirty) {
+            endpoint->dirty = 1;
+            endpoint->next_dirty = loop->dirty;
+            loop->dirty = endpoint;
+        }
+        return 0;
+    }
+    struct osc_loop_ring* ring = loop->ring;
+    while(ring->send_free == NO_SLOT) {
+        if(ring_enter(loop, 1, -1) == 1) {
+            return 1;
+        }
+        ring_reap(loop);
+    }
+    struct io_uring_sqe* sqe = ring_sqe(loop);
+    if(sqe == NULL) {
+        return 1;
+    }
+    uint32_t index = ring->send_free;
+    struct osc_loop_send* send = &ring->sends[index];
+    ring->send_free = send->next;
+    ring->sends_in_flight++;
+    memcpy(&send->address, address, address_length);
+    send->iov.iov_base = (void*)packet->data;
+    send->iov.iov_len = packet->length;
+    memset(&send->header, 0, sizeof(send->header));
+    send->header.msg_name = &send->address;
+    send->header.msg_namelen = address_length;
+    send->header.msg_iov = &send->iov;
+    send->header.msg_iovlen = 1;
+    send->packet = osc_packet_retain(packet);
+    sqe->opcode = IORING_OP_SENDMSG;
+    sqe->fd = endpoint->sock->fd;
+    sqe->addr = (uint64_t)(uintptr_t)&send->header;
+    sqe->len = 1;
+    sqe->user_data = TOKEN_SEND | index;
+
+return 0;
+}
+
+int osc_loop_send_message(struct osc_loop* loop, struct osc_loop_endpoint* endpoint, const struct osc_message* msg)
+{
+    struct osc_packet* packet = osc_packet_copy((const char*)msg->raw_data + 4, osc_message_serialized_length(msg));
+    if(packet == NULL) {
+        return 1;
+    }
+    int return_value = osc_loop_send(loop, endpoint, packet, NULL, 0);
+    osc_packet_release(packet);
+
+return return_value;
+}
+
+int osc_loop_timer_start(struct osc_loop* loop, struct osc_loop_timer* timer, uint64_t deadline_ns,
+                         osc_loop_timer_handler handler, void* context)
+{
+    if(loop->timer_count == loop->timer_capacity) {
+        size_t capacity = loop->timer_capacity == 0 ? 16 : 2 * loop->timer_capacity;
+        struct osc_loop_timer** timers = (struct osc_loop_timer**)realloc(loop->timers, capacity * sizeof(struct osc_loop_timer*));
+        if(timers == NULL) {
+            return 1;
+        }
+        loop->timers = timers;
+        loop->timer_capacity = capacity;
+    }
+    timer->deadline_ns = deadline_ns;
+    timer->handler = handler;
+    timer->context = context;
+    loop->timers[loop->timer_count] = timer;
+    heap_up(loop, loop->timer_count++);
+
+return 0;
+}
+
+void osc_loop_timer_cancel(struct osc_loop* loop, struct osc_loop_timer* timer)
+{
+    if(timer->heap_index < loop->timer_count && loop->timers[timer->heap_index] == timer) {
+        heap_remove(loop, timer->heap_index);
+    }
+}
+
+uint64_t osc_loop_timetag_to_ns(const struct osc_loop* loop, struct osc_timetag timetag)
+{
+    if(timetag.sec < NTP_UNIX_EPOCH_DELTA) {
+        return 0;
+    }
+    uint64_t unix_ns = (uint64_t)(timetag.sec - NTP_UNIX_EPOCH_DELTA) * 1000000000ULL +
+                       (((uint64_t)timetag.frac * 1000000000ULL) >> 32);
+    int64_t monotonic_ns = (int64_t)unix_ns - loop->realtime_offset_ns;
+    if(monotonic_ns <= 0) {
+        return 0;
+    }
+
+return (uint64_t)monotonic_ns;
+}
+
+int osc_loop_run_once(struct osc_loop* loop, int timeout_ms)
+{
+    loop->stats.iterations++;
+    uint64_t now_ns = clock_ns(CLOCK_MONOTONIC);
+    fire_timers(loop, now_ns);
+    int64_t wait_ns = timeout_ms < 0 ? -1 : (int64_t)timeout_ms * 1000000LL;
+    if(loop->ready_count > 0 || loop->stopped) {
+        wait_ns = 0;
+    }
+    else if(loop->timer_count > 0) {
+        uint64_t deadline_ns = loop->timers[0]->deadline_ns;
+        int64_t timer_ns = deadline_ns > now_ns ? (int64_t)(deadline_ns - now_ns) : 0;
+        if(wait_ns < 0 || timer_ns < wait_ns) {
+            wait_ns = timer_ns;
+        }
+    }
+    if(loop->ring != NULL) {
+        if(ring_enter(loop, wait_ns != 0 ? 1 : 0, wait_ns) == 1) {
+            return 1;
+        }
+        ring_reap(loop);
+    }
+    else {
+        flush_dirty(loop);
+        int wait_ms = -1;
+        if(wait_ns >= 0) {
+            // rounded up, a timer is never woken for before its deadline
+            int64_t ms = (wait_ns + 999999) / 1000000;
+            wait_ms = ms > INT32_MAX ? INT32_MAX : (int)ms;
+        }
+        int count = epoll_wait(loop->fd, loop->events, (int)loop->depth, wait_ms);
+        loop->stats.syscalls++;
+        if(count < 0 && errno != EINTR) {
+            return 1;
+        }
+        for(int i = 0; i < count; i++) {
+            mark_ready(loop, loop->events[i].data.u64);
+        }
+    }
+    fire_timers(loop, clock_ns(CLOCK_MONOTONIC));
+    dispatch_ready(loop);
+
+return 0;
+}
+
+int osc_loop_run(struct osc_loop* loop)
+{
+    loop->stopped = 0;
+    while(!loop->stopped && (loop->enabled_count > 0 || loop->timer_count > 0)) {
+        if(osc_loop_run_once(loop, -1) == 1) {
+            return 1;
+        }
+    }
+    if(loop->ring != NULL) {
+        ring_enter(loop, 0, -1);
+    }
+    else {
+        flush_dirty(loop);
+    }
+
+return 0;
+}
+
+void osc_loop_stop(struct osc_loop* loop)
+{
+    loop->stopped = 1;
+}
+
+void osc_loop_stats(const struct osc_loop* loop, struct osc_loop_stats* stats)
+{
+    *stats = loop->stats;
+}
@@ -0,0 +1,273 @@
+/** @file osc_loop.h */
+
+#ifndef OSC_LOOP_H
+#define OSC_LOOP_H
+
+#include <stdint.h>
+#include <stdlib.h>
+#include <sys/socket.h>
+#include "osc.h"
+#include "osc_packet.h"
+#include "osc_udp.h"
+
+#define OSC_LOOP_DEFAULT_MAX_ENDPOINTS 1024
+#define OSC_LOOP_DEFAULT_DEPTH 256
+
+/**
+ * Kernel interfaces an osc_loop can wait with
+ * OSC_LOOP_AUTO picks io_uring when the kernel provides it (5.11 or later) and epoll otherwise
+ */
+enum osc_loop_backend {
+    OSC_LOOP_AUTO,
+    OSC_LOOP_IO_URING,
+    OSC_LOOP_EPOLL
+};
+
+struct osc_loop_endpoint;
+struct osc_loop_timer;
+
+/**
+ * Function called with every batch of datagrams an enabled endpoint received
+ * The handler may send, enable or disable endpoints, start timers and remove endpoints (this one included)
+ *
+ * @param   endpoint    pointer to the osc_loop_endpoint structure
+ * @param   packets     the datagrams (valid until the handler returns)
+ * @param   count       the number of datagrams
+ * @param   context     the context given to osc_loop_add
+ */
+typedef void (*osc_loop_handler)(struct osc_loop_endpoint* endpoint, const struct osc_udp_packet* packets, size_t count, void* context);
+
+/**
+ * Function called when an osc_loop_timer is due
+ *
+ * @param   timer       pointer to the osc_loop_timer structure (which may be started again)
+ * @param   context     the context given to osc_loop_timer_start
+ */
+typedef void (*osc_loop_timer_handler)(struct osc_loop_timer* timer, void* context);
+
+/**
+ * Structure representing an osc_udp_socket registered in an osc_loop, owned by the caller until it is removed
+ * state is the readiness of the socket (idle, waiting for a readiness notification or readable), slot its index in
+ * the loop; next_ready links the endpoints to receive from and next_dirty, with the epoll backend, the endpoints
+ * whose socket holds datagrams to flush
+ */
+struct osc_loop_endpoint {
+    struct osc_udp_socket* sock;
+    osc_loop_handler handler;
+    void* context;
+    int enabled;
+    int state;
+    int queued;
+    int dirty;
+    uint32_t slot;
+    struct osc_loop_endpoint* next_ready;
+    struct osc_loop_endpoint* next_dirty;
+};
+
+/**
+ * Structure representing a one-shot timer of an osc_loop, owned by the caller
+ * deadline_ns is a CLOCK_MONOTONIC time, heap_index the position of the timer in the loop heap while it is pending
+ */
+struct osc_loop_timer {
+    uint64_t deadline_ns;
+    osc_loop_timer_handler handler;
+    void* context;
+    size_t heap_index;
+};
+
+/**
+ * Structure representing the osc_loop counters
+ * syscalls counts every system call the loop made (io_uring_enter, epoll_wait, epoll_ctl, recvmmsg and sendmmsg),
+ * events the readiness notifications, send_errors the datagrams the kernel refused
+ */
+struct osc_loop_stats {
+    uint64_t iterations;
+    uint64_t syscalls;
+    uint64_t events;
+    uint64_t received;
+    uint64_t sent;
+    uint64_t send_errors;
+    uint64_t timers;
+};
+
+struct osc_loop_ring;
+struct epoll_event;
+
+/**
+ * Structure representing a single-threaded event loop serving any number of UDP endpoints and timers
+ * With io_uring the readiness polls of all endpoints and every datagram sent through the loop are queued as
+ * submission entries and handed to the kernel together with the wait, in one io_uring_enter call per iteration;
+ * readable endpoints are drained by osc_udp_receive (one recvmmsg per batch)
+ * With epoll the sockets are registered one-shot and re-armed with epoll_ctl, and queued datagrams are flushed
+ * with sendmmsg before every wait
+ * endpoints maps the slots to the registered endpoints, generations tells stale notifications of reused slots apart,
+ * free_slots is a stack of the unused slots; ready is the FIFO of the endpoints to receive from, timers a binary
+ * min-heap of the pending timers; ring holds the io_uring state and events the epoll_wait buffer
+ */
+struct osc_loop {
+    enum osc_loop_backend backend;
+    int fd;
+    struct osc_loop_ring* ring;
+    struct epoll_event* events;
+    size_t depth;
+    struct osc_loop_endpoint** endpoints;
+    uint32_t* generations;
+    uint32_t* free_slots;
+    size_t free_count;
+    size_t max_endpoints;
+    size_t enabled_count;
+    struct osc_loop_endpoint* ready;
+    struct osc_loop_endpoint* ready_tail;
+    size_t ready_count;
+    struct osc_loop_endpoint* dirty;
+    struct osc_udp_packet* packets;
+    size_t packet_capacity;
+    struct osc_loop_timer** timers;
+    size_t timer_count;
+    size_t timer_capacity;
+    int64_t realtime_offset_ns;
+    int stopped;
+    struct osc_loop_stats stats;
+};
+
+/**
+ * Creates a new osc_loop instance
+ *
+ * @param   loop            pointer to the osc_loop structure
+ * @param   backend         the kernel interface to use
+ * @param   max_endpoints   the maximum number of registered endpoints (0 for OSC_LOOP_DEFAULT_MAX_ENDPOINTS)
+ * @param   depth           the number of submission entries and of datagrams in flight with io_uring, of events per
+ *                          wait with epoll (0 for OSC_LOOP_DEFAULT_DEPTH)
+ * @return                  returns 0 on success or 1 if the backend is not available or memory allocation failed
+ */
+int osc_loop_new(struct osc_loop* loop, enum osc_loop_backend backend, size_t max_endpoints, size_t depth);
+
+/**
+ * Sends the datagrams still queued, waits for the ones in flight and destroys an osc_loop instance
+ * The registered endpoints are left untouched (their sockets stay non-blocking)
+ *
+ * @param   loop        pointer to the osc_loop structure
+ */
+void osc_loop_destroy(struct osc_loop* loop);
+
+/**
+ * Registers an enabled endpoint, switching its socket to non-blocking mode
+ *
+ * @param   loop        pointer to the osc_loop structure
+ * @param   endpoint    pointer to the osc_loop_endpoint structure to fill
+ * @param   sock        pointer to the osc_udp_socket structure (which must outlive the registration)
+ * @param   handler     the function to call with the received datagrams
+ * @param   context     the context passed to handler
+ * @return              returns 0 on success or 1 if max_endpoints are registered or the socket could not be registered
+ */
+int osc_loop_add(struct osc_loop* loop, struct osc_loop_endpoint* endpoint, struct osc_udp_socket* sock,
+                 osc_loop_handler handler, void* context);
+
+/**
+ * Unregisters an endpoint; datagrams it sent through the loop are still delivered
+ *
+ * @param   loop        pointer to the osc_loop structure
+ * @param   endpoint    pointer to the osc_loop_endpoint structure
+ */
+void osc_loop_remove(struct osc_loop* loop, struct osc_loop_endpoint* endpoint);
+
+/**
+ * Enables or disables the delivery of the datagrams of an endpoint
+ * The socket of a disabled endpoint is not read, so its datagrams wait in the kernel until it is enabled again
+ *
+ * @param   loop        pointer to the osc_loop structure
+ * @param   endpoint    pointer to the osc_loop_endpoint structure
+ * @param   enabled     1 to enable the endpoint, 0 to disable it
+ * @return              returns 0 on success or 1 if the socket could not be watched
+ */
+int osc_loop_enable(struct osc_loop* loop, struct osc_loop_endpoint* endpoint, int enabled);
+
+/**
+ * Queues a datagram holding a packet, sent with the next wait of the loop (the loop holds a reference to the
+ * packet until the kernel is done with it)
+ *
+ * @param   loop            pointer to the osc_loop structure
+ * @param   endpoint        pointer to the osc_loop_endpoint structure of the sending socket
+ * @param   packet          pointer to the osc_packet structure
+ * @param   address         the destination (NULL for the default destination of the socket)
+ * @param   address_length  the length of address
+ * @return                  returns 0 on success or 1 if there is no destination or the datagram could not be queued
+ */
+int osc_loop_send(struct osc_loop* loop, struct osc_loop_endpoint* endpoint, struct osc_packet* packet,
+                  const struct sockaddr* address, socklen_t address_length);
+
+/**
+ * Queues a copy of an osc_message instance for the default destination of the socket (see osc_loop_send)
+ *
+ * @param   loop        pointer to the osc_loop structure
+ * @param   endpoint    pointer to the osc_loop_endpoint structure of the sending socket
+ * @param   msg         pointer to the osc_message structure
+ * @return              returns 0 on success or 1 if there is no destination, memory allocation failed or the datagram
+ *                      could not be queued
+ */
+int osc_loop_send_message(struct osc_loop* loop, struct osc_loop_endpoint* endpoint, const struct osc_message* msg);
+
+/**
+ * Starts a one-shot timer; a timer must not be started again before it fired or was cancelled
+ *
+ * @param   loop        pointer to the osc_loop structure
+ * @param   timer       pointer to the osc_loop_timer structure to fill
+ * @param   deadline_ns the CLOCK_MONOTONIC time in nanoseconds at which to call handler
+ * @param   handler     the function to call
+ * @param   context     the context passed to handler
+ * @return              returns 0 on success or 1 if memory allocation failed
+ */
+int osc_loop_timer_start(struct osc_loop* loop, struct osc_loop_timer* timer, uint64_t deadline_ns,
+                         osc_loop_timer_handler handler, void* context);
+
+/**
+ * Cancels a timer if it is pending
+ *
+ * @param   loop        pointer to the osc_loop structure
+ * @param   timer       pointer to the osc_loop_timer structure
+ */
+void osc_loop_timer_cancel(struct osc_loop* loop, struct osc_loop_timer* timer);
+
+/**
+ * Converts an NTP timetag into CLOCK_MONOTONIC nanoseconds, for osc_loop_timer_start
+ *
+ * @param   loop        pointer to the osc_loop structure
+ * @param   timetag     the timetag in the host endianity
+ * @return              the CLOCK_MONOTONIC time in nanoseconds (0 for the immediate timetag)
+ */
+uint64_t osc_loop_timetag_to_ns(const struct osc_loop* loop, struct osc_timetag timetag);
+
+/**
+ * Runs one iteration: hands the queued submissions to the kernel, waits until an endpoint is readable, a timer is
+ * due or the timeout expires, then calls the due timer handlers and delivers one batch per readable endpoint
+ *
+ * @param   loop        pointer to the osc_loop structure
+ * @param   timeout_ms  how long to wait at most (-1 waits until an event or timer, 0 does not wait)
+ * @return              returns 0 on success (including a timeout) or 1 if the wait failed
+ */
+int osc_loop_run_once(struct osc_loop* loop, int timeout_ms);
+
+/**
+ * Runs iterations until osc_loop_stop is called or no endpoint is enabled and no timer is pending
+ *
+ * @param   loop        pointer to the osc_loop structure
+ * @return              returns 0 on success or 1 if a wait failed
+ */
+int osc_loop_run(struct osc_loop* loop);
+
+/**
+ * Makes osc_loop_run return after the current iteration (to be called from a handler)
+ *
+ * @param   loop        pointer to the osc_loop structure
+ */
+void osc_loop_stop(struct osc_loop* loop);
+
+/**
+ * Copies the counters of an osc_loop instance
+ *
+ * @param   loop        pointer to the osc_loop structure
+ * @param   stats       pointer to the osc_loop_stats structure to fill
+ */
+void osc_loop_stats(const struct osc_loop* loop, struct osc_loop_stats* stats);
+
+#endif //OSC_LOOP_H
@@ -0,0 +1,248 @@
+/** @file osc_loop.hpp */
+
+#ifndef OSC_LOOP_HPP
+#define OSC_LOOP_HPP
+
+#include <chrono>
+#include <coroutine>
+#include <cstddef>
+#include <cstdint>
+#include <exception>
+#include <new>
+#include <stdexcept>
+#include <utility>
+#include "osc.hpp"
+
+extern "C" {
+#include "osc_loop.h"
+}
+
+namespace osc {
+
+/**
+ * Owner of an osc_loop (C++20)
+ * Not movable: endpoints and pending awaiters refer to it
+ */
+class loop {
+public:
+    /**
+     * Creates the loop, throwing std::runtime_error if the backend is not available or memory allocation failed
+     */
+    explicit loop(osc_loop_backend backend = OSC_LOOP_AUTO, std::size_t max_endpoints = 0, std::size_t depth = 0)
+    {
+        if(osc_loop_new(&loop_, backend, max_endpoints, depth) != 0) {
+            throw std::runtime_error("osc_loop_new failed");
+        }
+    }
+
+    loop(const loop&) = delete;
+    loop& operator=(const loop&) = delete;
+
+    ~loop() { osc_loop_destroy(&loop_); }
+
+    /**
+     * Runs until stop() is called or nothing is awaited anymore, throwing std::runtime_error if a wait failed
+     */
+    void run()
+    {
+        if(osc_loop_run(&loop_) != 0) {
+            throw std::runtime_error("osc_loop_run failed");
+        }
+    }
+
+    /**
+     * Runs one iteration (see osc_loop_run_once), returning false if the wait failed
+     */
+    bool run_once(int timeout_ms) { return osc_loop_run_once(&loop_, timeout_ms) == 0; }
+
+    void stop() { osc_loop_stop(&loop_); }
+
+    osc_loop_backend backend() const { return loop_.backend; }
+
+    struct osc_loop_stats stats() const
+    {
+        struct osc_loop_stats stats;
+        osc_loop_stats(&loop_, &stats);
+        return stats;
+    }
+
+    osc_loop* c_loop() { return &loop_; }
+
+private:
+    osc_loop loop_;
+};
+
+/**
+ * Batch of datagrams resumed from co_await recv(endpoint), valid until the coroutine suspends again
+ */
+struct datagrams {
+    const osc_udp_packet* packets;
+    std::size_t count;
+
+    const osc_udp_packet* begin() const { return packets; }
+    const osc_udp_packet* end() const { return packets + count; }
+    std::size_t size() const { return count; }
+};
+
+/**
+ * osc_udp_socket registered in a loop, whose datagrams are delivered to the coroutine awaiting recv(endpoint)
+ * The socket is only read while a coroutine awaits it, the datagrams wait in the kernel meanwhile; at most one
+ * coroutine may await an endpoint at a time
+ */
+class endpoint {
+public:
+    /**
+     * Registers the socket, throwing std::runtime_error if the loop is full or the socket could not be registered
+     */
+    endpoint(loop& owner, osc_udp_socket& sock) : loop_(owner)
+    {
+        if(osc_loop_add(loop_.c_loop(), &endpoint_, &sock, &endpoint::on_receive, this) != 0) {
+            throw std::runtime_error("osc_loop_add failed");
+        }
+        osc_loop_enable(loop_.c_loop(), &endpoint_, 0);
+    }
+
+    endpoint(const endpoint&) = delete;
+    endpoint& operator=(const endpoint&) = delete;
+
+    ~endpoint() { osc_loop_remove(loop_.c_loop(), &endpoint_); }
+
+    /**
+     * Queues a datagram (see osc_loop_send), returning false if it could not be queued
+     */
+    bool send(osc_packet* packet, const sockaddr* address = nullptr, socklen_t address_length = 0)
+    {
+        return osc_loop_send(loop_.c_loop(), &endpoint_, packet, address, address_length) == 0;
+    }
+
+    /**
+     * Queues a copy of a message for the default destination of the socket
+     */
+    bool send(const osc_message& msg) { return osc_loop_send_message(loop_.c_loop(), &endpoint_, &msg) == 0; }
+
+    template<class... Ts>
+    bool send(const message<Ts...>& msg) { return send(msg.c_message()); }
+
+    /**
+     * Awaiter resuming the coroutine with the next batch of datagrams
+     */
+    class receive_awaiter {
+    public:
+        explicit receive_awaiter(endpoint& owner) : endpoint_(owner) {}
+
+        bool await_ready() const noexcept { return false; }
+
+        void await_suspend(std::coroutine_handle<> handle)
+        {
+            endpoint_.waiter_ = handle;
+            if(osc_loop_enable(endpoint_.loop_.c_loop(), &endpoint_.endpoint_, 1) != 0) {
+                endpoint_.waiter_ = nullptr;
+                throw std::runtime_error("osc_loop_enable failed");
+            }
+        }
+
+        datagrams await_resume() const noexcept { return endpoint_.received_; }
+
+    private:
+        endpoint& endpoint_;
+    };
+
+    receive_awaiter receive() { return receive_awaiter(*this); }
+
+    osc_udp_socket& socket() { return *endpoint_.sock; }
+
+private:
+    static void on_receive(osc_loop_endpoint* c_endpoint, const osc_udp_packet* packets, std::size_t count, void* context)
+    {
+        endpoint* self = static_cast<endpoint*>(context);
+        osc_loop_enable(self->loop_.c_loop(), c_endpoint, 0);
+        self->received_ = datagrams{packets, count};
+        std::exchange(self->waiter_, nullptr).resume();
+    }
+
+    loop& loop_;
+    osc_loop_endpoint endpoint_;
+    std::coroutine_handle<> waiter_;
+    datagrams received_{nullptr, 0};
+};
+
+/**
+ * Awaiter resuming the coroutine once a CLOCK_MONOTONIC deadline has passed (immediately if it already has)
+ */
+class deadline_awaiter {
+public:
+    deadline_awaiter(loop& owner, std::uint64_t deadline_ns) : loop_(owner), deadline_ns_(deadline_ns) {}
+
+    bool await_ready() const { return deadline_ns_ <= now_ns(); }
+
+    /**
+     * Starts the timer, throwing std::bad_alloc if memory allocation failed
+     */
+    void await_suspend(std::coroutine_handle<> handle)
+    {
+        waiter_ = handle;
+        if(osc_loop_timer_start(loop_.c_loop(), &timer_, deadline_ns_, &deadline_awaiter::on_timer, this) != 0) {
+            throw std::bad_alloc();
+        }
+    }
+
+    void await_resume() const noexcept {}
+
+    static std::uint64_t now_ns()
+    {
+        return static_cast<std::uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(
+                                          std::chrono::steady_clock::now().time_since_epoch()).count());
+    }
+
+private:
+    static void on_timer(osc_loop_timer*, void* context) { static_cast<deadline_awaiter*>(context)->waiter_.resume(); }
+
+    loop& loop_;
+    std::uint64_t deadline_ns_;
+    osc_loop_timer timer_;
+    std::coroutine_handle<> waiter_;
+};
+
+/**
+ * co_await recv(endpoint) suspends until the endpoint received a batch of datagrams
+ */
+inline endpoint::receive_awaiter recv(endpoint& source)
+{
+    return source.receive();
+}
+
+/**
+ * co_await until(loop, timetag) suspends until the time of an NTP timetag (not at all for the immediate timetag)
+ */
+inline deadline_awaiter until(loop& owner, timetag time)
+{
+    return deadline_awaiter(owner, osc_loop_timetag_to_ns(owner.c_loop(), time));
+}
+
+/**
+ * co_await sleep_for(loop, duration) suspends for at least duration
+ */
+template<class Rep, class Period>
+deadline_awaiter sleep_for(loop& owner, std::chrono::duration<Rep, Period> duration)
+{
+    return deadline_awaiter(owner, deadline_awaiter::now_ns() +
+                            static_cast<std::uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(duration).count()));
+}
+
+/**
+ * Return type of detached coroutines: the coroutine starts running immediately and frees itself when it returns
+ * An exception escaping the coroutine calls std::terminate
+ */
+struct task {
+    struct promise_type {
+        task get_return_object() noexcept { return {}; }
+        std::suspend_never initial_suspend() noexcept { return {}; }
+        std::suspend_never final_suspend() noexcept { return {}; }
+        void return_void() noexcept {}
+        void unhandled_exception() noexcept { std::terminate(); }
+    };
+};
+
+} // namespace osc
+
+#endif //OSC_LOOP_HPP
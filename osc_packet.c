@@ -0,0 +1,103 @@
+/** @file osc_packet.c */
+
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include "osc_packet.h"
+
+/**
+ * Creates a packet taking over a memory block that starts with the 4B length prefix
+ *
+ * @param   raw_data    pointer to the memory block
+ * @param   length      the length of the packet (without the length prefix)
+ * @param   allocator   the allocator owning raw_data (NULL for the default allocator)
+ * @return              pointer to the packet or NULL if memory allocation failed
+ */
+static struct osc_packet* freeze(void* raw_data, size_t length, const struct osc_allocator* allocator)
+{
+    if(allocator == NULL) {
+        allocator = osc_default_allocator();
+    }
+    struct osc_packet* packet = (struct osc_packet*)allocator->allocate(allocator->context, sizeof(struct osc_packet));
+    if(packet == NULL) {
+        return NULL;
+    }
+    packet->data = (const char*)raw_data + sizeof(int32_t);
+    packet->length = length;
+    packet->references = 1;
+    packet->raw_data = raw_data;
+    packet->allocator = allocator;
+
+return packet;
+}
+
+struct osc_packet* osc_packet_freeze_message(struct osc_message* msg)
+{
+    struct osc_packet* packet = freeze(msg->raw_data, osc_message_serialized_length(msg), msg->allocator);
+    if(packet == NULL) {
+        return NULL;
+    }
+    OSC_MESSAGE_NULL(msg);
+
+return packet;
+}
+
+struct osc_packet* osc_packet_freeze_bundle(struct osc_bundle* bundle)
+{
+    struct osc_packet* packet = freeze(bundle->raw_data, osc_bundle_serialized_length(bundle), bundle->allocator);
+    if(packet == NULL) {
+        return NULL;
+    }
+    OSC_BUNDLE_NULL(bundle);
+
+return packet;
+}
+
+struct osc_packet* osc_packet_copy(const void* data, size_t length)
+{
+    const struct osc_allocator* allocator = osc_default_allocator();
+    struct osc_packet* packet = (struct osc_packet*)allocator->allocate(allocator->context, sizeof(struct osc_packet) + length);
+    if(packet == NULL) {
+        return NULL;
+    }
+    char* p_data = (char*)(packet + 1);
+    if(length != 0) {
+        memcpy(p_data, data, length);
+    }
+    packet->data = p_data;
+    packet->length = length;
+    packet->references = 1;
+    packet->raw_data = NULL;
+    packet->allocator = allocator;
+
+return packet;
+}
+
+struct osc_packet* osc_packet_retain(struct osc_packet* packet)
+{
+    __atomic_fetch_add(&packet->references, 1, __ATOMIC_RELAXED);
+
+return packet;
+}
+
+void osc_packet_release(struct osc_packet* packet)
+{
+    if(packet == NULL) {
+        return;
+    }
+    // the release/acquire pair makes every use of the data by other holders happen before the memory is freed
+    if(__atomic_fetch_sub(&packet->references, 1, __ATOMIC_RELEASE) != 1) {
+        return;
+    }
+    __atomic_thread_fence(__ATOMIC_ACQUIRE);
+    const struct osc_allocator* allocator = packet->allocator;
+    if(packet->raw_data != NULL) {
+        allocator->deallocate(allocator->context, packet->raw_data);
+    }
+    allocator->deallocate(allocator->context, packet);
+}
+
+size_t osc_packet_references(const struct osc_packet* packet)
+{
+return __atomic_load_n(&packet->references, __ATOMIC_RELAXED);
+}
@@ -0,0 +1,78 @@
+/** @file osc_packet.h */
+
+#ifndef OSC_PACKET_H
+#define OSC_PACKET_H
+
+#include <stdint.h>
+#include <stdlib.h>
+#include "osc.h"
+
+/**
+ * Structure representing an immutable, reference-counted packet (a message or a bundle) that can be shared between threads
+ * data points to the first byte of the packet (the 4B length prefix is not included) and length is its size
+ * references is the number of holders, updated atomically by osc_packet_retain and osc_packet_release
+ * raw_data is the memory block taken over from the frozen message or bundle (NULL if the data follows the structure)
+ * and allocator the allocator owning both the structure and raw_data
+ * The fields must not be modified once the packet exists
+ */
+struct osc_packet {
+    const char* data;
+    size_t length;
+    uint32_t references;
+    void* raw_data;
+    const struct osc_allocator* allocator;
+};
+
+/**
+ * Turns an osc_message instance into a packet holding one reference, without copying the message data
+ * On success the message owns no memory anymore (as after OSC_MESSAGE_NULL) and must not be destroyed
+ * The packet is freed with the allocator of the message, which must then be safe to call from any thread releasing it
+ *
+ * @param   msg     pointer to the osc_message structure
+ * @return          pointer to the packet or NULL if memory allocation failed (the message is left untouched)
+ */
+struct osc_packet* osc_packet_freeze_message(struct osc_message* msg);
+
+/**
+ * Turns an osc_bundle instance into a packet holding one reference, without copying the bundle data
+ * On success the bundle owns no memory anymore (as after OSC_BUNDLE_NULL) and must not be destroyed
+ * The packet is freed with the allocator of the bundle, which must then be safe to call from any thread releasing it
+ *
+ * @param   bundle  pointer to the osc_bundle structure
+ * @return          pointer to the packet or NULL if memory allocation failed (the bundle is left untouched)
+ */
+struct osc_packet* osc_packet_freeze_bundle(struct osc_bundle* bundle);
+
+/**
+ * Creates a packet holding one reference from a copy of the given bytes, with a single allocation of the default allocator
+ *
+ * @param   data    pointer to the first byte of the packet (without the 4B length prefix)
+ * @param   length  the length of the packet
+ * @return          pointer to the packet or NULL if memory allocation failed
+ */
+struct osc_packet* osc_packet_copy(const void* data, size_t length);
+
+/**
+ * Adds a reference to a packet
+ *
+ * @param   packet  pointer to the osc_packet structure
+ * @return          the packet, for convenience
+ */
+struct osc_packet* osc_packet_retain(struct osc_packet* packet);
+
+/**
+ * Drops a reference to a packet, freeing it when the last reference is dropped
+ *
+ * @param   packet  pointer to the osc_packet structure (NULL is ignored)
+ */
+void osc_packet_release(struct osc_packet* packet);
+
+/**
+ * Finds the number of references to a packet (only meaningful while no other thread retains or releases it)
+ *
+ * @param   packet  pointer to the osc_packet structure
+ * @return          the number of references
+ */
+size_t osc_packet_references(const struct osc_packet* packet);
+
+#endif //OSC_PACKET_H
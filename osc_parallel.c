@@ -0,0 +1,205 @@
+/** @file osc_parallel.c */
+
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <pthread.h>
+#include "osc_parallel.h"
+
+#define PHASE_HASH 0
+#define PHASE_CHUNKS 1
+#define PHASE_OWNED 2
+#define MAX_WORKERS 65536
+
+/**
+ * Structure representing a pool thread
+ */
+struct osc_parallel_thread {
+    pthread_t thread;
+    struct osc_parallel* pool;
+    size_t worker;
+};
+
+/**
+ * Does the share of a worker in the current phase of a run
+ *
+ * @param   pool        pointer to the osc_parallel structure
+ * @param   worker      the index of the worker
+ */
+static void run_phase(struct osc_parallel* pool, size_t worker)
+{
+    const struct osc_bundle_index* index = pool->index;
+    struct osc_message_view msg;
+    if(pool->phase == PHASE_OWNED) {
+        for(size_t i = 0; i < index->count; i++) {
+            if(pool->owners[i] == worker) {
+                osc_bundle_index_message(index, i, &msg);
+                pool->handler(&msg, i, worker, pool->context);
+            }
+        }
+        return;
+    }
+    size_t workers = pool->thread_count + 1;
+    while(1) {
+        size_t first = __atomic_fetch_add(&pool->next, OSC_PARALLEL_CHUNK, __ATOMIC_RELAXED);
+        if(first >= index->count) {
+            break;
+        }
+        size_t last = first + OSC_PARALLEL_CHUNK < index->count ? first + OSC_PARALLEL_CHUNK : index->count;
+        for(size_t i = first; i < last; i++) {
+            if(pool->phase == PHASE_HASH) {
+                // the address follows the 4B length prefix of the element
+                const char* address = index->data + index->offsets[i] + 4;
+                pool->owners[i] = (uint16_t)(osc_hash_bytes(address, strlen(address)) % workers);
+            }
+            else {
+                osc_bundle_index_message(index, i, &msg);
+                pool->handler(&msg, i, worker, pool->context);
+            }
+        }
+    }
+}
+
+/**
+ * Runs one phase on every worker and waits until all of them are done
+ *
+ * @param   pool        pointer to the osc_parallel structure
+ * @param   phase       the phase to run
+ */
+static void run(struct osc_parallel* pool, int phase)
+{
+    pool->phase = phase;
+    pool->next = 0;
+    pthread_mutex_lock(&pool->lock);
+    pool->generation++;
+    pool->active = pool->thread_count;
+    pthread_cond_broadcast(&pool->start);
+    pthread_mutex_unlock(&pool->lock);
+    run_phase(pool, 0);
+    pthread_mutex_lock(&pool->lock);
+    while(pool->active > 0) {
+        pthread_cond_wait(&pool->done, &pool->lock);
+    }
+    pthread_mutex_unlock(&pool->lock);
+}
+
+/**
+ * Main function of the pool threads: runs every announced phase until the pool stops
+ *
+ * @param   arg         pointer to the osc_parallel_thread structure
+ * @return              NULL
+ */
+static void* thread_main(void* arg)
+{
+    struct osc_parallel_thread* thread = (struct osc_parallel_thread*)arg;
+    struct osc_parallel* pool = thread->pool;
+    // a run may be announced before the thread first takes the lock, so it starts from the initial generation
+    uint64_t seen = 0;
+    pthread_mutex_lock(&pool->lock);
+    while(1) {
+        while(pool->generation == seen && !pool->stopping) {
+            pthread_cond_wait(&pool->start, &pool->lock);
+        }
+        if(pool->stopping) {
+            break;
+        }
+        seen = pool->generation;
+        pthread_mutex_unlock(&pool->lock);
+        run_phase(pool, thread->worker);
+        pthread_mutex_lock(&pool->lock);
+        if(--pool->active == 0) {
+            pthread_cond_signal(&pool->done);
+        }
+    }
+    pthread_mutex_unlock(&pool->lock);
+
+return NULL;
+}
+
+int osc_parallel_new(struct osc_parallel* pool, size_t workers)
+{
+    memset(pool, 0, sizeof(*pool));
+    if(workers == 0) {
+        long online = sysconf(_SC_NPROCESSORS_ONLN);
+        workers = online > 0 ? (size_t)online : 1;
+    }
+    if(workers > MAX_WORKERS) {
+        return 1;
+    }
+    pthread_mutex_init(&pool->lock, NULL);
+    pthread_cond_init(&pool->start, NULL);
+    pthread_cond_init(&pool->done, NULL);
+    pool->threads = (struct osc_parallel_thread*)calloc(workers, sizeof(struct osc_parallel_thread));
+    if(pool->threads == NULL) {
+        osc_parallel_destroy(pool);
+        return 1;
+    }
+    for(size_t i = 1; i < workers; i++) {
+        struct osc_parallel_thread* thread = &pool->threads[i - 1];
+        thread->pool = pool;
+        thread->worker = i;
+        if(pthread_create(&thread->thread, NULL, thread_main, thread) != 0) {
+            osc_parallel_destroy(pool);
+            return 1;
+        }
+        pool->thread_count++;
+    }
+
+return 0;
+}
+
+void osc_parallel_destroy(struct osc_parallel* pool)
+{
+    pthread_mutex_lock(&pool->lock);
+    pool->stopping = 1;
+    pthread_cond_broadcast(&pool->start);
+    pthread_mutex_unlock(&pool->lock);
+    for(size_t i = 0; i < pool->thread_count; i++) {
+        pthread_join(pool->threads[i].thread, NULL);
+    }
+    pthread_cond_destroy(&pool->start);
+    pthread_cond_destroy(&pool->done);
+    pthread_mutex_destroy(&pool->lock);
+    free(pool->threads);
+    free(pool->owners);
+    memset(pool, 0, sizeof(*pool));
+}
+
+int osc_parallel_for_each(struct osc_parallel* pool, const struct osc_bundle_index* index, enum osc_affinity affinity,
+                      osc_parallel_handler handler, void* context)
+{
+    if(pool->thread_count == 0 || index->count <= OSC_PARALLEL_CHUNK) {
+        struct osc_message_view msg;
+        for(size_t i = 0; i < index->count; i++) {
+            osc_bundle_index_message(index, i, &msg);
+            handler(&msg, i, 0, context);
+        }
+        return 0;
+    }
+    pool->index = index;
+    pool->handler = handler;
+    pool->context = context;
+    if(affinity == OSC_AFFINITY_ADDRESS) {
+        if(index->count > pool->owner_capacity) {
+            uint16_t* owners = (uint16_t*)realloc(pool->owners, index->count * sizeof(uint16_t));
+            if(owners == NULL) {
+                return 1;
+            }
+            pool->owners = owners;
+            pool->owner_capacity = index->count;
+        }
+        run(pool, PHASE_HASH);
+        run(pool, PHASE_OWNED);
+    }
+    else {
+        run(pool, PHASE_CHUNKS);
+    }
+
+return 0;
+}
+
+size_t osc_parallel_workers(const struct osc_parallel* pool)
+{
+return pool->thread_count + 1;
+}
@@ -0,0 +1,94 @@
+/** @file osc_parallel.h */
+
+#ifndef OSC_PARALLEL_H
+#define OSC_PARALLEL_H
+
+#include <stdint.h>
+#include <stdlib.h>
+#include <pthread.h>
+#include "osc.h"
+
+#define OSC_PARALLEL_CHUNK 64
+
+/**
+ * Function called for every message of a bundle by osc_parallel_for_each
+ * Handlers of different workers run concurrently, per-worker state can be indexed by worker
+ *
+ * @param   msg         pointer to the osc_message_view of the message (valid until the handler returns)
+ * @param   msg_index   the index of the message in the osc_bundle_index
+ * @param   worker      the index of the worker (0 is the thread that called osc_parallel_for_each)
+ * @param   context     the context given to osc_parallel_for_each
+ */
+typedef void (*osc_parallel_handler)(const struct osc_message_view* msg, size_t msg_index, size_t worker, void* context);
+
+struct osc_parallel_thread;
+
+/**
+ * Structure representing a pool of threads running the messages of indexed bundles in parallel
+ * The thread calling osc_parallel_for_each works as worker 0 alongside the thread_count pool threads; every run is
+ * announced by incrementing generation under lock, and active counts the pool threads still working on it
+ * phase is the step of the run (hashing the addresses, handling chunks or handling the messages a worker owns),
+ * next is the index of the next chunk of OSC_PARALLEL_CHUNK messages to hand out, owners the worker of every message
+ * of the run for OSC_AFFINITY_ADDRESS (owner_capacity being its capacity)
+ */
+struct osc_parallel {
+    struct osc_parallel_thread* threads;
+    size_t thread_count;
+    pthread_mutex_t lock;
+    pthread_cond_t start;
+    pthread_cond_t done;
+    uint64_t generation;
+    size_t active;
+    int stopping;
+    int phase;
+    size_t next;
+    const struct osc_bundle_index* index;
+    osc_parallel_handler handler;
+    void* context;
+    uint16_t* owners;
+    size_t owner_capacity;
+};
+
+/**
+ * Creates a new osc_parallel instance and starts its threads
+ *
+ * @param   pool        pointer to the osc_parallel structure
+ * @param   workers     the number of workers including the calling thread (0 for the number of online processors)
+ * @return              returns 0 on success or 1 if workers is too large, a thread could not be created or memory
+ *                      allocation failed
+ */
+int osc_parallel_new(struct osc_parallel* pool, size_t workers);
+
+/**
+ * Stops the threads and destroys an osc_parallel instance
+ *
+ * @param   pool        pointer to the osc_parallel structure
+ */
+void osc_parallel_destroy(struct osc_parallel* pool);
+
+/**
+ * Calls the handler for every message of an indexed bundle, spreading the messages over the workers, and returns
+ * once all of them were handled
+ * OSC_AFFINITY_NONE hands out chunks of consecutive messages to whichever worker is free; OSC_AFFINITY_ADDRESS
+ * gives all messages with the same address to the same worker, which handles them in bundle order
+ * Only one run may be in progress at a time
+ *
+ * @param   pool        pointer to the osc_parallel structure
+ * @param   index       pointer to the osc_bundle_index structure
+ * @param   affinity    how messages are spread over the workers
+ * @param   handler     the function to call for every message
+ * @param   context     pointer passed to the handler
+ * @return              returns 0 on success or 1 if memory allocation failed
+ */
+int osc_parallel_for_each(struct osc_parallel* pool, const struct osc_bundle_index* index, enum osc_affinity affinity,
+                      osc_parallel_handler handler, void* context);
+
+/**
+ * Finds the number of workers of an osc_parallel instance
+ *
+ * @param   pool        pointer to the osc_parallel structure
+ * @return              the number of workers including the calling thread
+ */
+size_t osc_parallel_workers(const struct osc_parallel* pool);
+
+#endif //OSC_PARALLEL_H
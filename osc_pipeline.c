@@ -0,0 +1,441 @@
+/** @file osc_pipeline.c */
+
+#ifndef _GNU_SOURCE
+    #define _GNU_SOURCE
+#endif // _GNU_SOURCE
+
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <time.h>
+#include <sched.h>
+#include <pthread.h>
+#include "osc_pipeline.h"
+
+#define CONSUMER_BURST 64
+#define IDLE_SPINS 64
+#define IDLE_SLEEP_NS 100000
+#define WORKER_POLL_MS 50
+#define WORKER_BACKOFF_NS 1000000
+
+/**
+ * Structure representing a decoded message travelling from a worker to a consumer
+ * data holds a copy of the message (without the 4B length prefix), typetag and arguments are offsets into data
+ */
+struct pipeline_item {
+    size_t length;
+    size_t typetag;
+    size_t arguments;
+    char data[];
+};
+
+/**
+ * Structure representing a receiving thread of an osc_pipeline
+ * next_consumer is the round-robin position (OSC_AFFINITY_NONE), stop is set to make the thread return
+ * truncated mirrors the truncated counter of the socket, which other threads must not read
+ */
+struct osc_pipeline_worker {
+    struct osc_pipeline* pipeline;
+    size_t index;
+    pthread_t thread;
+    int started;
+    int stop;
+    struct osc_udp_socket socket;
+    size_t next_consumer;
+    uint64_t packets;
+    uint64_t messages;
+    uint64_t dropped;
+    uint64_t invalid;
+    uint64_t truncated;
+    uint64_t receive_errors;
+};
+
+/**
+ * Structure representing a handling thread of an osc_pipeline
+ * stop is set to make the thread return once all of its rings are empty
+ */
+struct osc_pipeline_consumer {
+    struct osc_pipeline* pipeline;
+    size_t index;
+    pthread_t thread;
+    int started;
+    int stop;
+    uint64_t handled;
+};
+
+/**
+ * Adds to a counter that only the calling thread writes but other threads may read
+ *
+ * @param   counter     pointer to the counter
+ * @param   value       the value to add
+ */
+static void count(uint64_t* counter, uint64_t value)
+{
+    __atomic_store_n(counter, __atomic_load_n(counter, __ATOMIC_RELAXED) + value, __ATOMIC_RELAXED);
+}
+
+/**
+ * Finds the ring carrying messages from a worker to a consumer
+ *
+ * @param   pipeline    pointer to the osc_pipeline structure
+ * @param   worker      the worker index
+ * @param   consumer    the consumer index
+ * @return              pointer to the ring
+ */
+static struct osc_ring* forward_ring(const struct osc_pipeline* pipeline, size_t worker, size_t consumer)
+{
+return &pipeline->rings[worker * pipeline->consumer_count + consumer];
+}
+
+/**
+ * Finds the ring carrying used items from a consumer back to a worker
+ *
+ * @param   pipeline    pointer to the osc_pipeline structure
+ * @param   worker      the worker index
+ * @param   consumer    the consumer index
+ * @return              pointer to the ring
+ */
+static struct osc_ring* return_ring(const struct osc_pipeline* pipeline, size_t worker, size_t consumer)
+{
+return &pipeline->rings[(pipeline->worker_count + worker) * pipeline->consumer_count + consumer];
+}
+
+/**
+ * Copies a decoded message into an item and queues it for its consumer
+ *
+ * @param   worker      pointer to the worker structure
+ * @param   msg         pointer to the osc_message_view of the message
+ */
+static void deliver(struct osc_pipeline_worker* worker, const struct osc_message_view* msg)
+{
+    struct osc_pipeline* pipeline = worker->pipeline;
+    size_t consumer = 0;
+    if(pipeline->affinity == OSC_AFFINITY_ADDRESS) {
+        consumer = osc_hash_bytes(msg->address, strlen(msg->address)) % pipeline->consumer_count;
+    }
+    else {
+        consumer = worker->next_consumer++ % pipeline->consumer_count;
+    }
+    void* value = NULL;
+    struct pipeline_item* item = NULL;
+    if(osc_ring_pop(return_ring(pipeline, worker->index, consumer), &value) == 0) {
+        item = (struct pipeline_item*)value;
+    }
+    else {
+        item = (struct pipeline_item*)malloc(sizeof(struct pipeline_item) + worker->socket.buffer_size);
+        if(item == NULL) {
+            count(&worker->dropped, 1);
+            return;
+        }
+    }
+    item->length = msg->length;
+    item->typetag = msg->typetag - msg->address;
+    item->arguments = msg->arguments - msg->address;
+    memcpy(item->data, msg->address, msg->length);
+    if(osc_ring_push(forward_ring(pipeline, worker->index, consumer), item) == 1) {
+        free(item);
+        count(&worker->dropped, 1);
+        return;
+    }
+    count(&worker->messages, 1);
+}
+
+/**
+ * Tells whether a receive error leaves the socket unusable for good
+ *
+ * @param   error   the errno value of the failed receive
+ * @return          returns 1 if retrying cannot succeed or 0 otherwise
+ */
+static int permanent_error(int error)
+{
+    switch(error) {
+        case EBADF:
+        case ENOTSOCK:
+        case EINVAL:
+        case EFAULT:
+        case EOPNOTSUPP: return 1;
+    }
+
+return 0;
+}
+
+/**
+ * The function run by the worker threads
+ * After a failed receive the worker sleeps WORKER_BACKOFF_NS, doubling up to WORKER_POLL_MS while the failures go on;
+ * it returns on a permanent error
+ *
+ * @param   arg     pointer to the worker structure
+ * @return          NULL
+ */
+static void* worker_main(void* arg)
+{
+    struct osc_pipeline_worker* worker = (struct osc_pipeline_worker*)arg;
+    struct osc_udp_packet packets[OSC_UDP_DEFAULT_BATCH];
+    long backoff_ns = WORKER_BACKOFF_NS;
+    while(!__atomic_load_n(&worker->stop, __ATOMIC_ACQUIRE)) {
+        size_t packet_count = 0;
+        if(osc_udp_receive(&worker->socket, packets, OSC_UDP_DEFAULT_BATCH, WORKER_POLL_MS, &packet_count) == 1) {
+            count(&worker->receive_errors, 1);
+            if(permanent_error(errno)) {
+                break;
+            }
+            struct timespec ts = {0, backoff_ns};
+            nanosleep(&ts, NULL);
+            if(backoff_ns < WORKER_POLL_MS * 1000000L) {
+                backoff_ns *= 2;
+            }
+            continue;
+        }
+        backoff_ns = WORKER_BACKOFF_NS;
+        if(worker->socket.stats.truncated != worker->truncated) {
+            count(&worker->truncated, worker->socket.stats.truncated - worker->truncated);
+        }
+        count(&worker->packets, packet_count);
+        for(size_t i = 0; i < packet_count; i++) {
+            if(osc_packet_is_bundle(packets[i].data, packets[i].length)) {
+                struct osc_bundle_view bundle;
+                if(osc_bundle_view_init(&bundle, packets[i].data, packets[i].length) == 1) {
+                    count(&worker->invalid, 1);
+                    continue;
+                }
+                struct osc_bundle_walker walker;
+                struct osc_message_view msg;
+                struct osc_timetag timetag;
+                osc_bundle_walker_init(&walker, &bundle);
+                while(osc_bundle_walker_next(&walker, &msg, &timetag) == 0) {
+                    deliver(worker, &msg);
+                }
+            }
+            else {
+                struct osc_message_view msg;
+                if(osc_message_view_init(&msg, packets[i].data, packets[i].length) == 1) {
+                    count(&worker->invalid, 1);
+                    continue;
+                }
+                deliver(worker, &msg);
+            }
+        }
+    }
+
+return NULL;
+}
+
+/**
+ * The function run by the consumer threads
+ * Rings are visited in turn, at most CONSUMER_BURST messages at a time; an idle consumer yields, then sleeps
+ *
+ * @param   arg     pointer to the consumer structure
+ * @return          NULL
+ */
+static void* consumer_main(void* arg)
+{
+    struct osc_pipeline_consumer* consumer = (struct osc_pipeline_consumer*)arg;
+    struct osc_pipeline* pipeline = consumer->pipeline;
+    size_t idle = 0;
+    for(;;) {
+        int stopping = __atomic_load_n(&consumer->stop, __ATOMIC_ACQUIRE);
+        size_t handled = 0;
+        for(size_t w = 0; w < pipeline->worker_count; w++) {
+            struct osc_ring* ring = forward_ring(pipeline, w, consumer->index);
+            void* value = NULL;
+            for(size_t n = 0; n < CONSUMER_BURST && osc_ring_pop(ring, &value) == 0; n++) {
+                struct pipeline_item* item = (struct pipeline_item*)value;
+                struct osc_message_view msg;
+                msg.address = item->data;
+                msg.typetag = item->data + item->typetag;
+                msg.arguments = item->data + item->arguments;
+                msg.length = item->length;
+                pipeline->handler(&msg, consumer->index, pipeline->context);
+                if(osc_ring_push(return_ring(pipeline, w, consumer->index), item) == 1) {
+                    free(item);
+                }
+                handled++;
+            }
+        }
+        if(handled > 0) {
+            count(&consumer->handled, handled);
+            idle = 0;
+            continue;
+        }
+        if(stopping) {
+            break;
+        }
+        if(++idle < IDLE_SPINS) {
+            sched_yield();
+        }
+        else {
+            struct timespec ts = {0, IDLE_SLEEP_NS};
+            nanosleep(&ts, NULL);
+        }
+    }
+
+return NULL;
+}
+
+/**
+ * Frees the items left in a ring
+ *
+ * @param   ring        pointer to the ring
+ */
+static void drain_ring(struct osc_ring* ring)
+{
+    void* value = NULL;
+    while(osc_ring_pop(ring, &value) == 0) {
+        free(value);
+    }
+}
+
+int osc_pipeline_new(struct osc_pipeline* pipeline, const char* host, uint16_t port, size_t worker_count, size_t consumer_count,
+                     size_t buffer_size, enum osc_affinity affinity, osc_pipeline_handler handler, void* context)
+{
+    memset(pipeline, 0, sizeof(*pipeline));
+    if(worker_count == 0 || consumer_count == 0) {
+        return 1;
+    }
+    pipeline->affinity = affinity;
+    pipeline->handler = handler;
+    pipeline->context = context;
+    pipeline->workers = (struct osc_pipeline_worker*)calloc(worker_count, sizeof(struct osc_pipeline_worker));
+    pipeline->consumers = (struct osc_pipeline_consumer*)calloc(consumer_count, sizeof(struct osc_pipeline_consumer));
+    size_t ring_count = 2 * worker_count * consumer_count;
+    void* rings = NULL;
+    if(posix_memalign(&rings, OSC_CACHE_LINE, ring_count * sizeof(struct osc_ring)) == 0) {
+        memset(rings, 0, ring_count * sizeof(struct osc_ring));
+        pipeline->rings = (struct osc_ring*)rings;
+    }
+    if(pipeline->workers == NULL || pipeline->consumers == NULL || pipeline->rings == NULL) {
+        osc_pipeline_destroy(pipeline);
+        return 1;
+    }
+    for(size_t w = 0; w < worker_count; w++) {
+        pipeline->workers[w].socket.fd = -1;
+    }
+    pipeline->worker_count = worker_count;
+    pipeline->consumer_count = consumer_count;
+    for(size_t i = 0; i < ring_count; i++) {
+        if(osc_ring_new(&pipeline->rings[i], OSC_PIPELINE_RING_CAPACITY, OSC_RING_SPSC) == 1) {
+            osc_pipeline_destroy(pipeline);
+            return 1;
+        }
+    }
+    for(size_t w = 0; w < worker_count; w++) {
+        struct osc_pipeline_worker* worker = &pipeline->workers[w];
+        worker->pipeline = pipeline;
+        worker->index = w;
+        if(osc_udp_new_reuseport(&worker->socket, host, port, 0, buffer_size) == 1) {
+            osc_pipeline_destroy(pipeline);
+            return 1;
+        }
+        if(w == 0) {
+            if(osc_udp_local_port(&worker->socket, &port) == 1) {
+                osc_pipeline_destroy(pipeline);
+                return 1;
+            }
+            pipeline->port = port;
+        }
+    }
+    for(size_t c = 0; c < consumer_count; c++) {
+        pipeline->consumers[c].pipeline = pipeline;
+        pipeline->consumers[c].index = c;
+    }
+
+return 0;
+}
+
+void osc_pipeline_destroy(struct osc_pipeline* pipeline)
+{
+    osc_pipeline_stop(pipeline);
+    if(pipeline->rings != NULL) {
+        for(size_t i = 0; i < 2 * pipeline->worker_count * pipeline->consumer_count; i++) {
+            if(pipeline->rings[i].cells != NULL) {
+                drain_ring(&pipeline->rings[i]);
+                osc_ring_destroy(&pipeline->rings[i]);
+            }
+        }
+    }
+    if(pipeline->workers != NULL) {
+        for(size_t w = 0; w < pipeline->worker_count; w++) {
+            osc_udp_destroy(&pipeline->workers[w].socket);
+        }
+    }
+    free(pipeline->rings);
+    free(pipeline->workers);
+    free(pipeline->consumers);
+    memset(pipeline, 0, sizeof(*pipeline));
+}
+
+uint16_t osc_pipeline_port(const struct osc_pipeline* pipeline)
+{
+return pipeline->port;
+}
+
+int osc_pipeline_start(struct osc_pipeline* pipeline)
+{
+    if(pipeline->running) {
+        return 0;
+    }
+    pipeline->running = 1;
+    for(size_t c = 0; c < pipeline->consumer_count; c++) {
+        struct osc_pipeline_consumer* consumer = &pipeline->consumers[c];
+        consumer->stop = 0;
+        if(pthread_create(&consumer->thread, NULL, consumer_main, consumer) != 0) {
+            osc_pipeline_stop(pipeline);
+            return 1;
+        }
+        consumer->started = 1;
+    }
+    for(size_t w = 0; w < pipeline->worker_count; w++) {
+        struct osc_pipeline_worker* worker = &pipeline->workers[w];
+        worker->stop = 0;
+        if(pthread_create(&worker->thread, NULL, worker_main, worker) != 0) {
+            osc_pipeline_stop(pipeline);
+            return 1;
+        }
+        worker->started = 1;
+    }
+
+return 0;
+}
+
+void osc_pipeline_stop(struct osc_pipeline* pipeline)
+{
+    if(!pipeline->running) {
+        return;
+    }
+    for(size_t w = 0; w < pipeline->worker_count; w++) {
+        __atomic_store_n(&pipeline->workers[w].stop, 1, __ATOMIC_RELEASE);
+    }
+    for(size_t w = 0; w < pipeline->worker_count; w++) {
+        if(pipeline->workers[w].started) {
+            pthread_join(pipeline->workers[w].thread, NULL);
+            pipeline->workers[w].started = 0;
+        }
+    }
+    for(size_t c = 0; c < pipeline->consumer_count; c++) {
+        __atomic_store_n(&pipeline->consumers[c].stop, 1, __ATOMIC_RELEASE);
+    }
+    for(size_t c = 0; c < pipeline->consumer_count; c++) {
+        if(pipeline->consumers[c].started) {
+            pthread_join(pipeline->consumers[c].thread, NULL);
+            pipeline->consumers[c].started = 0;
+        }
+    }
+    pipeline->running = 0;
+}
+
+void osc_pipeline_stats(const struct osc_pipeline* pipeline, struct osc_pipeline_stats* stats)
+{
+    memset(stats, 0, sizeof(*stats));
+    for(size_t w = 0; w < pipeline->worker_count; w++) {
+        stats->packets += __atomic_load_n(&pipeline->workers[w].packets, __ATOMIC_RELAXED);
+        stats->messages += __atomic_load_n(&pipeline->workers[w].messages, __ATOMIC_RELAXED);
+        stats->dropped += __atomic_load_n(&pipeline->workers[w].dropped, __ATOMIC_RELAXED);
+        stats->invalid += __atomic_load_n(&pipeline->workers[w].invalid, __ATOMIC_RELAXED);
+        stats->truncated += __atomic_load_n(&pipeline->workers[w].truncated, __ATOMIC_RELAXED);
+        stats->receive_errors += __atomic_load_n(&pipeline->workers[w].receive_errors, __ATOMIC_RELAXED);
+    }
+    for(size_t c = 0; c < pipeline->consumer_count; c++) {
+        stats->handled += __atomic_load_n(&pipeline->consumers[c].handled, __ATOMIC_RELAXED);
+    }
+}
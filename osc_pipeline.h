@@ -0,0 +1,119 @@
+/** @file osc_pipeline.h */
+
+#ifndef OSC_PIPELINE_H
+#define OSC_PIPELINE_H
+
+#include <stdint.h>
+#include <stdlib.h>
+#include "osc.h"
+#include "osc_ring.h"
+#include "osc_udp.h"
+
+#define OSC_PIPELINE_RING_CAPACITY 4096
+
+/**
+ * Function called on a consumer thread for every decoded message
+ * Handlers of different consumers run concurrently, per-consumer state can be indexed by consumer
+ *
+ * @param   msg         pointer to the osc_message_view of the message (valid until the handler returns)
+ * @param   consumer    the index of the consumer thread
+ * @param   context     the context pointer given to the pipeline
+ */
+typedef void (*osc_pipeline_handler)(const struct osc_message_view* msg, size_t consumer, void* context);
+
+/**
+ * Structure representing the osc_pipeline counters
+ * dropped counts the messages lost because the ring of their consumer was full, invalid the malformed packets,
+ * truncated the datagrams dropped because they did not fit into a receive buffer and receive_errors the failed
+ * receive calls (a worker backs off after a failure and stops if its socket is unusable)
+ */
+struct osc_pipeline_stats {
+    uint64_t packets;
+    uint64_t messages;
+    uint64_t handled;
+    uint64_t dropped;
+    uint64_t invalid;
+    uint64_t truncated;
+    uint64_t receive_errors;
+};
+
+struct osc_pipeline_worker;
+struct osc_pipeline_consumer;
+
+/**
+ * Structure representing a multi-threaded receive pipeline
+ * Each of the worker_count workers owns an SO_REUSEPORT socket bound to the same port, receives and parses datagrams
+ * and pushes copies of the decoded messages to the consumers through one SPSC ring per (worker, consumer) pair;
+ * consumers hand the messages to the handler and return the copies to their worker through a second ring for reuse
+ * rings holds worker_count * consumer_count forward rings followed by as many return rings
+ * running is set between osc_pipeline_start and osc_pipeline_stop
+ */
+struct osc_pipeline {
+    struct osc_pipeline_worker* workers;
+    size_t worker_count;
+    struct osc_pipeline_consumer* consumers;
+    size_t consumer_count;
+    struct osc_ring* rings;
+    enum osc_affinity affinity;
+    osc_pipeline_handler handler;
+    void* context;
+    uint16_t port;
+    int running;
+};
+
+/**
+ * Creates a new osc_pipeline instance and binds its worker sockets
+ *
+ * @param   pipeline        pointer to the osc_pipeline structure
+ * @param   host            the numeric IPv4 or IPv6 address to bind to (NULL for any IPv4 address)
+ * @param   port            the port to bind to (0 for an ephemeral port, see osc_pipeline_port)
+ * @param   worker_count    the number of receiving threads
+ * @param   consumer_count  the number of handling threads
+ * @param   buffer_size     the size of each receive buffer, bounding the datagram size (0 for OSC_UDP_DEFAULT_BUFFER_SIZE)
+ * @param   affinity        how messages are spread over the consumers (OSC_AFFINITY_NONE hands them out round-robin)
+ * @param   handler         the function called for every message
+ * @param   context         pointer passed to the handler
+ * @return                  returns 0 on success or 1 if a socket could not be bound or memory allocation failed
+ */
+int osc_pipeline_new(struct osc_pipeline* pipeline, const char* host, uint16_t port, size_t worker_count, size_t consumer_count,
+                     size_t buffer_size, enum osc_affinity affinity, osc_pipeline_handler handler, void* context);
+
+/**
+ * Destroys an osc_pipeline instance, stopping it first if it is running
+ *
+ * @param   pipeline        pointer to the osc_pipeline structure
+ */
+void osc_pipeline_destroy(struct osc_pipeline* pipeline);
+
+/**
+ * Finds the port the pipeline sockets are bound to
+ *
+ * @param   pipeline        pointer to the osc_pipeline structure
+ * @return                  the local port
+ */
+uint16_t osc_pipeline_port(const struct osc_pipeline* pipeline);
+
+/**
+ * Starts the worker and consumer threads
+ *
+ * @param   pipeline        pointer to the osc_pipeline structure
+ * @return                  returns 0 on success or 1 if a thread could not be created (the started ones are stopped)
+ */
+int osc_pipeline_start(struct osc_pipeline* pipeline);
+
+/**
+ * Stops the worker threads, lets the consumers drain the rings and joins all threads
+ *
+ * @param   pipeline        pointer to the osc_pipeline structure
+ */
+void osc_pipeline_stop(struct osc_pipeline* pipeline);
+
+/**
+ * Sums up the counters of all workers and consumers (may be called while the pipeline is running)
+ *
+ * @param   pipeline        pointer to the osc_pipeline structure
+ * @param   stats           set to the counters
+ */
+void osc_pipeline_stats(const struct osc_pipeline* pipeline, struct osc_pipeline_stats* stats);
+
+#endif //OSC_PIPELINE_H
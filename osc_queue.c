@@ -0,0 +1,274 @@
+/** @file osc_queue.c */
+
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include "osc_queue.h"
+
+#define NIL UINT32_MAX
+
+/**
+ * Hashes bytes with 32-bit FNV-1a, continuing from the given hash
+ *
+ * @param   hash    the hash to continue from
+ * @param   data    pointer to the bytes
+ * @param   length  the number of bytes
+ * @return          the hash
+ */
+static uint32_t hash_bytes(uint32_t hash, const char* data, size_t length)
+{
+    for(size_t i = 0; i < length; i++) {
+        hash ^= (unsigned char)data[i];
+        hash *= 16777619u;
+    }
+
+return hash;
+}
+
+/**
+ * Finds the coalescing key of a packet
+ *
+ * @param   packet  pointer to the osc_packet structure
+ * @param   mode    the coalescing mode
+ * @param   entry   pointer to the entry receiving address, key, key_length and hash
+ * @return          returns 0 if the packet has a key or 1 if it must be appended
+ */
+static int find_key(const struct osc_packet* packet, enum osc_coalesce mode, struct osc_queue_entry* entry)
+{
+    struct osc_message_view view;
+    if(mode == OSC_COALESCE_NONE || osc_message_view_init(&view, packet->data, packet->length) == 1) {
+        return 1;
+    }
+    entry->address = view.address;
+    entry->key = NULL;
+    entry->key_length = 0;
+    if(mode == OSC_COALESCE_ADDRESS_KEY) {
+        switch(view.typetag[1]) {
+            case OSC_TT_INT:
+            case OSC_TT_FLOAT:  entry->key_length = 4; break;
+            case OSC_TT_STRING: entry->key_length = strlen(view.arguments) + 1; break;
+            default:            return 1;
+        }
+        entry->key = view.arguments;
+    }
+    uint32_t hash = hash_bytes(2166136261u, view.address, strlen(view.address) + 1);
+    entry->hash = hash_bytes(hash, entry->key, entry->key_length);
+
+return 0;
+}
+
+/**
+ * Tells whether two entries have the same coalescing key
+ *
+ * @param   a       pointer to the first entry
+ * @param   b       pointer to the second entry
+ * @return          returns 1 if the keys are equal or 0 otherwise
+ */
+static int same_key(const struct osc_queue_entry* a, const struct osc_queue_entry* b)
+{
+return a->hash == b->hash && a->key_length == b->key_length && strcmp(a->address, b->address) == 0 &&
+       (a->key_length == 0 || memcmp(a->key, b->key, a->key_length) == 0);
+}
+
+/**
+ * Finds the table slot holding the pending entry with the same key as the given one, or the empty slot ending the probe
+ *
+ * @param   queue   pointer to the osc_queue structure
+ * @param   entry   pointer to the entry whose key is looked up
+ * @return          the slot index
+ */
+static size_t find_slot(const struct osc_queue* queue, const struct osc_queue_entry* entry)
+{
+    size_t slot = entry->hash & queue->table_mask;
+    while(queue->table[slot] != 0 && !same_key(&queue->entries[queue->table[slot] - 1], entry)) {
+        slot = (slot + 1) & queue->table_mask;
+    }
+
+return slot;
+}
+
+/**
+ * Removes the slot of an entry from the table, shifting the following entries of the probe sequence back
+ *
+ * @param   queue   pointer to the osc_queue structure
+ * @param   slot    the slot to empty
+ */
+static void remove_slot(struct osc_queue* queue, size_t slot)
+{
+    size_t next = (slot + 1) & queue->table_mask;
+    while(queue->table[next] != 0) {
+        size_t home = queue->entries[queue->table[next] - 1].hash & queue->table_mask;
+        // the entry may move back to slot only if slot lies between its home slot and its current slot
+        if(((next - home) & queue->table_mask) >= ((next - slot) & queue->table_mask)) {
+            queue->table[slot] = queue->table[next];
+            slot = next;
+        }
+        next = (next + 1) & queue->table_mask;
+    }
+    queue->table[slot] = 0;
+}
+
+int osc_queue_new(struct osc_queue* queue, size_t capacity)
+{
+    memset(queue, 0, sizeof(*queue));
+    if(capacity == 0 || capacity >= NIL / 2) {
+        return 1;
+    }
+    size_t table_size = 16;
+    while(table_size < 2 * capacity) {
+        table_size *= 2;
+    }
+    queue->entries = (struct osc_queue_entry*)calloc(capacity, sizeof(struct osc_queue_entry));
+    queue->table = (uint32_t*)calloc(table_size, sizeof(uint32_t));
+    if(queue->entries == NULL || queue->table == NULL) {
+        osc_queue_destroy(queue);
+        return 1;
+    }
+    queue->capacity = capacity;
+    queue->table_mask = table_size - 1;
+    queue->head = NIL;
+    queue->tail = NIL;
+    for(size_t i = 0; i < capacity; i++) {
+        queue->entries[i].next = i + 1 < capacity ? (uint32_t)(i + 1) : NIL;
+    }
+    queue->free_list = 0;
+
+return 0;
+}
+
+void osc_queue_destroy(struct osc_queue* queue)
+{
+    while(queue->count != 0) {
+        osc_packet_release(osc_queue_pop(queue));
+    }
+    free(queue->entries);
+    free(queue->table);
+    memset(queue, 0, sizeof(*queue));
+}
+
+int osc_queue_push(struct osc_queue* queue, struct osc_packet* packet, enum osc_coalesce mode)
+{
+    struct osc_queue_entry key;
+    size_t slot = 0;
+    int coalescible = find_key(packet, mode, &key) == 0;
+    if(coalescible) {
+        slot = find_slot(queue, &key);
+        if(queue->table[slot] != 0) {
+            struct osc_queue_entry* entry = &queue->entries[queue->table[slot] - 1];
+            osc_packet_release(entry->packet);
+            entry->packet = osc_packet_retain(packet);
+            entry->address = key.address;
+            entry->key = key.key;
+            queue->stats.pushed++;
+            queue->stats.coalesced++;
+            return 0;
+        }
+    }
+    if(queue->free_list == NIL) {
+        queue->stats.rejected++;
+        return 1;
+    }
+    uint32_t index = queue->free_list;
+    struct osc_queue_entry* entry = &queue->entries[index];
+    queue->free_list = entry->next;
+    entry->packet = osc_packet_retain(packet);
+    entry->address = NULL;
+    if(coalescible) {
+        entry->address = key.address;
+        entry->key = key.key;
+        entry->key_length = key.key_length;
+        entry->hash = key.hash;
+        queue->table[slot] = index + 1;
+    }
+    entry->next = NIL;
+    if(queue->tail != NIL) {
+        queue->entries[queue->tail].next = index;
+    }
+    else {
+        queue->head = index;
+    }
+    queue->tail = index;
+    queue->count++;
+    queue->stats.pushed++;
+
+return 0;
+}
+
+int osc_queue_push_message(struct osc_queue* queue, const struct osc_message* msg, enum osc_coalesce mode)
+{
+    struct osc_packet* packet = osc_packet_copy((const char*)msg->raw_data + 4, osc_message_serialized_length(msg));
+    if(packet == NULL) {
+        return 1;
+    }
+    int return_value = osc_queue_push(queue, packet, mode);
+    osc_packet_release(packet);
+
+return return_value;
+}
+
+struct osc_packet* osc_queue_pop(struct osc_queue* queue)
+{
+    if(queue->head == NIL) {
+        return NULL;
+    }
+    uint32_t index = queue->head;
+    struct osc_queue_entry* entry = &queue->entries[index];
+    if(entry->address != NULL) {
+        remove_slot(queue, find_slot(queue, entry));
+    }
+    queue->head = entry->next;
+    if(queue->head == NIL) {
+        queue->tail = NIL;
+    }
+    struct osc_packet* packet = entry->packet;
+    entry->packet = NULL;
+    entry->next = queue->free_list;
+    queue->free_list = index;
+    queue->count--;
+    queue->stats.popped++;
+
+return packet;
+}
+
+const struct osc_packet* osc_queue_peek(const struct osc_queue* queue)
+{
+    if(queue->head == NIL) {
+        return NULL;
+    }
+
+return queue->entries[queue->head].packet;
+}
+
+int osc_queue_send_udp(struct osc_queue* queue, struct osc_udp_socket* sock, size_t max_packets, size_t* count)
+{
+    *count = 0;
+    if(sock->destination_length == 0 || (sock->tx_count != 0 && osc_udp_flush(sock) == 1)) {
+        return 1;
+    }
+    while(*count < max_packets && osc_queue_peek(queue) != NULL) {
+        // a round fills the socket queue at most, so that nothing is sent before the round is flushed
+        size_t round = 0;
+        uint32_t index = queue->head;
+        while(round < sock->batch && *count + round < max_packets && index != NIL) {
+            if(osc_udp_queue_packet(sock, queue->entries[index].packet, NULL, 0) == 1) {
+                return 1;
+            }
+            index = queue->entries[index].next;
+            round++;
+        }
+        if(osc_udp_flush(sock) == 1) {
+            return 1;
+        }
+        for(size_t i = 0; i < round; i++) {
+            osc_packet_release(osc_queue_pop(queue));
+        }
+        *count += round;
+    }
+
+return 0;
+}
+
+void osc_queue_stats(const struct osc_queue* queue, struct osc_queue_stats* stats)
+{
+    *stats = queue->stats;
+}
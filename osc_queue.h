@@ -0,0 +1,143 @@
+/** @file osc_queue.h */
+
+#ifndef OSC_QUEUE_H
+#define OSC_QUEUE_H
+
+#include <stdint.h>
+#include <stdlib.h>
+#include "osc.h"
+#include "osc_packet.h"
+#include "osc_udp.h"
+
+/**
+ * Coalescing modes of the packets pushed into an osc_queue
+ * OSC_COALESCE_NONE always appends, OSC_COALESCE_ADDRESS replaces the pending packet with the same address and
+ * OSC_COALESCE_ADDRESS_KEY the pending packet with the same address and the same first argument (an int32, float or
+ * string key such as a channel number); a replaced packet keeps its place in the queue
+ */
+enum osc_coalesce {
+    OSC_COALESCE_NONE,
+    OSC_COALESCE_ADDRESS,
+    OSC_COALESCE_ADDRESS_KEY
+};
+
+/**
+ * Structure representing the osc_queue counters
+ * coalesced counts the pending packets replaced by a newer one, rejected the packets refused because the queue was full
+ */
+struct osc_queue_stats {
+    uint64_t pushed;
+    uint64_t coalesced;
+    uint64_t rejected;
+    uint64_t popped;
+};
+
+/**
+ * Structure representing a pending packet of an osc_queue
+ * address and key point into the packet: the address, and for OSC_COALESCE_ADDRESS_KEY the first argument bytes
+ * (address is NULL for packets that are never replaced); hash is the hash of both, next links the entries in
+ * FIFO order (and the unused ones in the free list)
+ */
+struct osc_queue_entry {
+    struct osc_packet* packet;
+    const char* address;
+    const char* key;
+    size_t key_length;
+    uint32_t hash;
+    uint32_t next;
+};
+
+/**
+ * Structure representing a bounded outbound queue whose state-like packets coalesce (latest value wins)
+ * entries is a pool of capacity entries linked in FIFO order from head to tail, the unused ones in free_list
+ * table is an open-addressing hash table (linear probing) of the coalescible pending entries, holding entry index + 1
+ * (0 for an empty slot)
+ */
+struct osc_queue {
+    struct osc_queue_entry* entries;
+    size_t capacity;
+    size_t count;
+    uint32_t head;
+    uint32_t tail;
+    uint32_t free_list;
+    uint32_t* table;
+    size_t table_mask;
+    struct osc_queue_stats stats;
+};
+
+/**
+ * Creates a new osc_queue instance
+ *
+ * @param   queue       pointer to the osc_queue structure
+ * @param   capacity    the maximum number of pending packets
+ * @return              returns 0 on success or 1 if capacity is 0 or too large or memory allocation failed
+ */
+int osc_queue_new(struct osc_queue* queue, size_t capacity);
+
+/**
+ * Destroys an osc_queue instance, releasing the pending packets
+ *
+ * @param   queue       pointer to the osc_queue structure
+ */
+void osc_queue_destroy(struct osc_queue* queue);
+
+/**
+ * Pushes a packet, replacing the pending packet with the same key if mode allows it (the queue holds a reference
+ * to the packet until it is popped or replaced)
+ * Bundles and packets without the key mode asks for (no first argument of a supported type) are always appended
+ *
+ * @param   queue       pointer to the osc_queue structure
+ * @param   packet      pointer to the osc_packet structure
+ * @param   mode        the coalescing mode of the packet
+ * @return              returns 0 on success or 1 if the packet had to be appended and the queue is full
+ */
+int osc_queue_push(struct osc_queue* queue, struct osc_packet* packet, enum osc_coalesce mode);
+
+/**
+ * Pushes a copy of an osc_message instance (see osc_queue_push)
+ *
+ * @param   queue       pointer to the osc_queue structure
+ * @param   msg         pointer to the osc_message structure
+ * @param   mode        the coalescing mode of the message
+ * @return              returns 0 on success or 1 if the queue is full or memory allocation failed
+ */
+int osc_queue_push_message(struct osc_queue* queue, const struct osc_message* msg, enum osc_coalesce mode);
+
+/**
+ * Removes the oldest pending packet
+ *
+ * @param   queue       pointer to the osc_queue structure
+ * @return              the packet, whose reference passes to the caller, or NULL if the queue is empty
+ */
+struct osc_packet* osc_queue_pop(struct osc_queue* queue);
+
+/**
+ * Finds the oldest pending packet without removing it
+ *
+ * @param   queue       pointer to the osc_queue structure
+ * @return              the packet or NULL if the queue is empty
+ */
+const struct osc_packet* osc_queue_peek(const struct osc_queue* queue);
+
+/**
+ * Sends up to max_packets packets to the default destination of an osc_udp_socket, flushing the socket queue every
+ * batch packets; a packet is popped only once the flush that sent it succeeded, so on failure it stays pending (and
+ * keeps coalescing) to be sent by the next call, possibly a second time if the failed flush sent it
+ *
+ * @param   queue       pointer to the osc_queue structure
+ * @param   sock        pointer to the osc_udp_socket structure
+ * @param   max_packets the maximum number of packets to send
+ * @param   count       set to the number of packets sent and popped
+ * @return              returns 0 on success or 1 if the socket has no destination or sending failed
+ */
+int osc_queue_send_udp(struct osc_queue* queue, struct osc_udp_socket* sock, size_t max_packets, size_t* count);
+
+/**
+ * Copies the counters of an osc_queue instance
+ *
+ * @param   queue       pointer to the osc_queue structure
+ * @param   stats       pointer to the osc_queue_stats structure to fill
+ */
+void osc_queue_stats(const struct osc_queue* queue, struct osc_queue_stats* stats);
+
+#endif //OSC_QUEUE_H
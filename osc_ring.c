@@ -0,0 +1,101 @@
+/** @file osc_ring.c */
+
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include "osc_ring.h"
+
+/**
+ * Structure representing a cell of an osc_ring
+ * sequence equals the position when the cell is free to write and the position + 1 when it holds a value to read
+ */
+struct osc_ring_cell {
+    size_t sequence;
+    void* value;
+};
+
+int osc_ring_new(struct osc_ring* ring, size_t capacity, enum osc_ring_mode mode)
+{
+    memset(ring, 0, sizeof(*ring));
+    size_t size = 2;
+    while(size < capacity) {
+        size *= 2;
+    }
+    ring->cells = (struct osc_ring_cell*)malloc(size * sizeof(struct osc_ring_cell));
+    if(ring->cells == NULL) {
+        return 1;
+    }
+    for(size_t i = 0; i < size; i++) {
+        ring->cells[i].sequence = i;
+        ring->cells[i].value = NULL;
+    }
+    ring->mask = size - 1;
+    ring->mode = mode;
+
+return 0;
+}
+
+void osc_ring_destroy(struct osc_ring* ring)
+{
+    free(ring->cells);
+    ring->cells = NULL;
+    ring->mask = 0;
+}
+
+int osc_ring_push(struct osc_ring* ring, void* value)
+{
+    size_t position = __atomic_load_n(&ring->head, __ATOMIC_RELAXED);
+    struct osc_ring_cell* cell = NULL;
+    for(;;) {
+        cell = &ring->cells[position & ring->mask];
+        size_t sequence = __atomic_load_n(&cell->sequence, __ATOMIC_ACQUIRE);
+        intptr_t difference = (intptr_t)sequence - (intptr_t)position;
+        if(difference < 0) {
+            return 1;
+        }
+        if(difference > 0) {
+            position = __atomic_load_n(&ring->head, __ATOMIC_RELAXED);
+            continue;
+        }
+        if(ring->mode == OSC_RING_SPSC) {
+            __atomic_store_n(&ring->head, position + 1, __ATOMIC_RELAXED);
+            break;
+        }
+        if(__atomic_compare_exchange_n(&ring->head, &position, position + 1, 1, __ATOMIC_RELAXED, __ATOMIC_RELAXED)) {
+            break;
+        }
+    }
+    cell->value = value;
+    __atomic_store_n(&cell->sequence, position + 1, __ATOMIC_RELEASE);
+
+return 0;
+}
+
+int osc_ring_pop(struct osc_ring* ring, void** value)
+{
+    size_t position = __atomic_load_n(&ring->tail, __ATOMIC_RELAXED);
+    struct osc_ring_cell* cell = NULL;
+    for(;;) {
+        cell = &ring->cells[position & ring->mask];
+        size_t sequence = __atomic_load_n(&cell->sequence, __ATOMIC_ACQUIRE);
+        intptr_t difference = (intptr_t)sequence - (intptr_t)(position + 1);
+        if(difference < 0) {
+            return 1;
+        }
+        if(difference > 0) {
+            position = __atomic_load_n(&ring->tail, __ATOMIC_RELAXED);
+            continue;
+        }
+        if(ring->mode == OSC_RING_SPSC) {
+            __atomic_store_n(&ring->tail, position + 1, __ATOMIC_RELAXED);
+            break;
+        }
+        if(__atomic_compare_exchange_n(&ring->tail, &position, position + 1, 1, __ATOMIC_RELAXED, __ATOMIC_RELAXED)) {
+            break;
+        }
+    }
+    *value = cell->value;
+    __atomic_store_n(&cell->sequence, position + ring->mask + 1, __ATOMIC_RELEASE);
+
+return 0;
+}
@@ -0,0 +1,71 @@
+/** @file osc_ring.h */
+
+#ifndef OSC_RING_H
+#define OSC_RING_H
+
+#include <stdint.h>
+#include <stdlib.h>
+
+#define OSC_CACHE_LINE 64
+
+/**
+ * Concurrency mode of an osc_ring
+ * OSC_RING_SPSC allows one producer thread and one consumer thread, OSC_RING_MPMC any number of both
+ */
+enum osc_ring_mode {
+    OSC_RING_SPSC,
+    OSC_RING_MPMC
+};
+
+struct osc_ring_cell;
+
+/**
+ * Structure representing a bounded lock-free queue of pointers
+ * Every cell carries a sequence number telling whether it is ready to be written or read at a given position,
+ * so producers and consumers only contend on head and tail (claimed by compare-and-swap in OSC_RING_MPMC mode)
+ * head is the next position to write, tail the next position to read; they live on separate cache lines
+ */
+struct osc_ring {
+    struct osc_ring_cell* cells;
+    size_t mask;
+    enum osc_ring_mode mode;
+    size_t head __attribute__((aligned(OSC_CACHE_LINE)));
+    size_t tail __attribute__((aligned(OSC_CACHE_LINE)));
+};
+
+/**
+ * Creates a new osc_ring instance
+ *
+ * @param   ring        pointer to the osc_ring structure
+ * @param   capacity    the maximum number of queued pointers (rounded up to a power of two)
+ * @param   mode        the concurrency mode of the ring
+ * @return              returns 0 on success or 1 if memory allocation failed
+ */
+int osc_ring_new(struct osc_ring* ring, size_t capacity, enum osc_ring_mode mode);
+
+/**
+ * Destroys an osc_ring instance by freeing its cells (the queued pointers are not freed)
+ *
+ * @param   ring        pointer to the osc_ring structure
+ */
+void osc_ring_destroy(struct osc_ring* ring);
+
+/**
+ * Queues a pointer
+ *
+ * @param   ring        pointer to the osc_ring structure
+ * @param   value       the pointer to queue
+ * @return              returns 0 on success or 1 if the ring is full
+ */
+int osc_ring_push(struct osc_ring* ring, void* value);
+
+/**
+ * Dequeues the oldest pointer
+ *
+ * @param   ring        pointer to the osc_ring structure
+ * @param   value       set to the dequeued pointer
+ * @return              returns 0 on success or 1 if the ring is empty
+ */
+int osc_ring_pop(struct osc_ring* ring, void** value);
+
+#endif //OSC_RING_H
@@ -0,0 +1,497 @@
+/** @file osc_scheduler.c */
+
+#ifndef _DEFAULT_SOURCE
+    #define _DEFAULT_SOURCE
+#endif // _DEFAULT_SOURCE
+
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <endian.h>
+#include "osc_scheduler.h"
+
+#define NTP_UNIX_EPOCH_DELTA 2208988800ULL
+#define SLOT_BITS 6
+#define SLOT_MASK (OSC_SCHEDULER_SLOTS - 1)
+
+/**
+ * Structure representing a bundle waiting in the scheduler
+ * data holds a copy of the whole bundle (without the 4B length prefix)
+ */
+struct osc_scheduled_bundle {
+    struct osc_scheduled_bundle* next;
+    uint64_t due_ns;
+    uint64_t due_tick;
+    uint64_t sequence;
+    struct osc_timetag timetag;
+    size_t length;
+    char data[];
+};
+
+/**
+ * Reads the given clock in nanoseconds
+ *
+ * @param   clock_id    the clock to read
+ * @param   ns          set to the clock value in nanoseconds
+ * @return              returns 0 on success or 1 if the clock could not be read
+ */
+static int read_clock(clockid_t clock_id, uint64_t* ns)
+{
+    struct timespec ts;
+    if(clock_gettime(clock_id, &ts) != 0) {
+        return 1;
+    }
+    *ns = (uint64_t)ts.tv_sec * 1000000000ULL + (uint64_t)ts.tv_nsec;
+
+return 0;
+}
+
+/**
+ * Calls the handler for every message of a bundle
+ *
+ * @param   data        pointer to the first byte of the bundle ("#bundle")
+ * @param   length      the length of the bundle
+ * @param   timetag     the timetag of the bundle in the host endianity
+ * @param   handler     the function to call
+ * @param   context     pointer passed to the handler
+ * @return              the number of messages dispatched
+ */
+static size_t dispatch_bundle(const char* data, size_t length, struct osc_timetag timetag,
+                              osc_scheduled_handler handler, void* context)
+{
+    struct osc_bundle_view view;
+    view.data = data;
+    view.length = length;
+    size_t count = 0;
+    struct osc_message_view msg;
+    OSC_MESSAGE_VIEW_NULL(&msg);
+    while(1) {
+        msg = osc_bundle_view_next_message(&view, msg);
+        if(msg.address == NULL) {
+            break;
+        }
+        handler(&msg, timetag, context);
+        count++;
+    }
+
+return count;
+}
+
+/**
+ * Sorts a list of scheduled bundles by due time, keeping the insertion order of equal due times
+ *
+ * @param   list        the first entry of the list
+ * @return              the first entry of the sorted list
+ */
+static struct osc_scheduled_bundle* sort_by_due(struct osc_scheduled_bundle* list)
+{
+    if(list == NULL || list->next == NULL) {
+        return list;
+    }
+    struct osc_scheduled_bundle* slow = list;
+    struct osc_scheduled_bundle* fast = list->next;
+    while(fast != NULL && fast->next != NULL) {
+        slow = slow->next;
+        fast = fast->next->next;
+    }
+    struct osc_scheduled_bundle* second = slow->next;
+    slow->next = NULL;
+    struct osc_scheduled_bundle* a = sort_by_due(list);
+    struct osc_scheduled_bundle* b = sort_by_due(second);
+    struct osc_scheduled_bundle head;
+    struct osc_scheduled_bundle* tail = &head;
+    while(a != NULL && b != NULL) {
+        if(b->due_ns < a->due_ns || (b->due_ns == a->due_ns && b->sequence < a->sequence)) {
+            tail->next = b;
+            b = b->next;
+        }
+        else {
+            tail->next = a;
+            a = a->next;
+        }
+        tail = tail->next;
+    }
+    tail->next = a != NULL ? a : b;
+
+return head.next;
+}
+
+/**
+ * Puts a scheduled bundle into the wheel slot covering its due tick
+ *
+ * @param   scheduler   pointer to the osc_scheduler structure
+ * @param   entry       the scheduled bundle
+ * @param   expired     list receiving the entry if its due tick has already been reached
+ */
+static void wheel_insert(struct osc_scheduler* scheduler, struct osc_scheduled_bundle* entry,
+                         struct osc_scheduled_bundle** expired)
+{
+    if(entry->due_tick <= scheduler->current_tick) {
+        entry->next = *expired;
+        *expired = entry;
+        return;
+    }
+    uint64_t delta = entry->due_tick - scheduler->current_tick;
+    for(int level = 0; level < OSC_SCHEDULER_LEVELS; level++) {
+        if(delta < (1ULL << (SLOT_BITS * (level + 1)))) {
+            size_t slot = (entry->due_tick >> (SLOT_BITS * level)) & SLOT_MASK;
+            entry->next = scheduler->wheel[level][slot];
+            scheduler->wheel[level][slot] = entry;
+            return;
+        }
+    }
+    entry->next = scheduler->overflow;
+    scheduler->overflow = entry;
+}
+
+/**
+ * Re-inserts every entry of a list relative to the current tick
+ *
+ * @param   scheduler   pointer to the osc_scheduler structure
+ * @param   list        the first entry of the list
+ * @param   expired     list receiving the entries that became due
+ */
+static void wheel_cascade(struct osc_scheduler* scheduler, struct osc_scheduled_bundle* list,
+                          struct osc_scheduled_bundle** expired)
+{
+    while(list != NULL) {
+        struct osc_scheduled_bundle* next = list->next;
+        wheel_insert(scheduler, list, expired);
+        list = next;
+    }
+}
+
+/**
+ * Records the dispatch jitter of a bundle and dispatches it
+ *
+ * @param   scheduler   pointer to the osc_scheduler structure
+ * @param   entry       the scheduled bundle
+ * @param   now_ns      the current CLOCK_MONOTONIC time in nanoseconds
+ * @return              the number of messages dispatched
+ */
+static size_t dispatch_entry(struct osc_scheduler* scheduler, struct osc_scheduled_bundle* entry, uint64_t now_ns)
+{
+    if(entry->due_ns != 0 && now_ns > entry->due_ns) {
+        uint64_t jitter = now_ns - entry->due_ns;
+        scheduler->stats.total_jitter_ns += jitter;
+        if(jitter > scheduler->stats.max_jitter_ns) {
+            scheduler->stats.max_jitter_ns = jitter;
+        }
+    }
+    scheduler->stats.dispatched++;
+
+return dispatch_bundle(entry->data, entry->length, entry->timetag, scheduler->handler, scheduler->context);
+}
+
+/**
+ * Dispatches and frees every entry of a list in order
+ *
+ * @param   scheduler   pointer to the osc_scheduler structure
+ * @param   list        the first entry of the list
+ * @param   now_ns      the current CLOCK_MONOTONIC time in nanoseconds
+ * @return              the number of messages dispatched
+ */
+static size_t dispatch_list(struct osc_scheduler* scheduler, struct osc_scheduled_bundle* list, uint64_t now_ns)
+{
+    size_t count = 0;
+    while(list != NULL) {
+        struct osc_scheduled_bundle* next = list->next;
+        count += dispatch_entry(scheduler, list, now_ns);
+        free(list);
+        list = next;
+    }
+
+return count;
+}
+
+/**
+ * Frees every entry of a list
+ *
+ * @param   list        the first entry of the list
+ */
+static void free_list(struct osc_scheduled_bundle* list)
+{
+    while(list != NULL) {
+        struct osc_scheduled_bundle* next = list->next;
+        free(list);
+        list = next;
+    }
+}
+
+int osc_scheduler_new(struct osc_scheduler* scheduler, uint64_t tick_ns, osc_scheduled_handler handler, void* context)
+{
+    memset(scheduler, 0, sizeof(*scheduler));
+    scheduler->tick_ns = tick_ns == 0 ? OSC_SCHEDULER_DEFAULT_TICK_NS : tick_ns;
+    scheduler->handler = handler;
+    scheduler->context = context;
+    scheduler->late_policy = OSC_LATE_DISPATCH;
+    scheduler->late_threshold_ns = scheduler->tick_ns;
+    if(read_clock(CLOCK_MONOTONIC, &scheduler->origin_ns) == 1) {
+        return 1;
+    }
+
+return osc_scheduler_resync_clock(scheduler);
+}
+
+void osc_scheduler_destroy(struct osc_scheduler* scheduler)
+{
+    for(int level = 0; level < OSC_SCHEDULER_LEVELS; level++) {
+        for(int slot = 0; slot < OSC_SCHEDULER_SLOTS; slot++) {
+            free_list(scheduler->wheel[level][slot]);
+            scheduler->wheel[level][slot] = NULL;
+        }
+    }
+    free_list(scheduler->overflow);
+    free_list(scheduler->ready);
+    scheduler->overflow = NULL;
+    scheduler->ready = NULL;
+    scheduler->ready_tail = NULL;
+    scheduler->pending = 0;
+}
+
+void osc_scheduler_set_late_policy(struct osc_scheduler* scheduler, enum osc_late_policy policy, uint64_t threshold_ns,
+                                   osc_scheduled_handler late_handler, void* late_context)
+{
+    scheduler->late_policy = policy;
+    scheduler->late_threshold_ns = threshold_ns;
+    scheduler->late_handler = late_handler;
+    scheduler->late_context = late_context;
+}
+
+int osc_scheduler_resync_clock(struct osc_scheduler* scheduler)
+{
+    uint64_t realtime_ns = 0;
+    uint64_t monotonic_ns = 0;
+    if(read_clock(CLOCK_MONOTONIC, &monotonic_ns) == 1 || read_clock(CLOCK_REALTIME, &realtime_ns) == 1) {
+        return 1;
+    }
+    scheduler->realtime_offset_ns = (int64_t)(realtime_ns - monotonic_ns);
+
+return 0;
+}
+
+uint64_t osc_scheduler_timetag_to_ns(const struct osc_scheduler* scheduler, struct osc_timetag timetag)
+{
+    if(timetag.sec < NTP_UNIX_EPOCH_DELTA) {
+        return 0;
+    }
+    uint64_t unix_ns = (uint64_t)(timetag.sec - NTP_UNIX_EPOCH_DELTA) * 1000000000ULL +
+                       (((uint64_t)timetag.frac * 1000000000ULL) >> 32);
+    int64_t monotonic_ns = (int64_t)unix_ns - scheduler->realtime_offset_ns;
+    if(monotonic_ns <= 0) {
+        return 0;
+    }
+
+return (uint64_t)monotonic_ns;
+}
+
+uint64_t osc_scheduler_now_ns(void)
+{
+    uint64_t ns = 0;
+    read_clock(CLOCK_MONOTONIC, &ns);
+
+return ns;
+}
+
+int osc_scheduler_add_bundle(struct osc_scheduler* scheduler, const struct osc_bundle* bundle)
+{
+    struct osc_bundle_view view;
+    osc_bundle_view_from_bundle(&view, bundle);
+
+return osc_scheduler_add_bundle_view(scheduler, &view);
+}
+
+/**
+ * Checks whether two timetags are equal
+ *
+ * @param   a           the first timetag
+ * @param   b           the second timetag
+ * @return              returns 1 if the timetags are equal or 0 otherwise
+ */
+static int same_timetag(struct osc_timetag a, struct osc_timetag b)
+{
+return a.sec == b.sec && a.frac == b.frac;
+}
+
+/**
+ * Queues a scheduled bundle either on the ready list or in the timing wheel
+ *
+ * @param   scheduler   pointer to the osc_scheduler structure
+ * @param   entry       the scheduled bundle (due_ns must be set)
+ */
+static void enqueue_entry(struct osc_scheduler* scheduler, struct osc_scheduled_bundle* entry)
+{
+    entry->next = NULL;
+    entry->sequence = scheduler->sequence++;
+    entry->due_tick = 0;
+    if(entry->due_ns > scheduler->origin_ns) {
+        entry->due_tick = (entry->due_ns - scheduler->origin_ns + scheduler->tick_ns - 1) / scheduler->tick_ns;
+    }
+    if(entry->due_tick <= scheduler->current_tick) {
+        if(scheduler->ready_tail == NULL) {
+            scheduler->ready = entry;
+        }
+        else {
+            scheduler->ready_tail->next = entry;
+        }
+        scheduler->ready_tail = entry;
+        return;
+    }
+    wheel_insert(scheduler, entry, NULL);
+    scheduler->pending++;
+}
+
+int osc_scheduler_add_bundle_view(struct osc_scheduler* scheduler, const struct osc_bundle_view* view)
+{
+    struct osc_bundle_walker walker;
+    struct osc_message_view msg;
+    struct osc_timetag timetag;
+    uint64_t now_ns = osc_scheduler_now_ns();
+    osc_bundle_walker_init(&walker, view);
+    int more = (osc_bundle_walker_next(&walker, &msg, &timetag) == 0);
+    // every run of messages sharing an effective timetag is scheduled as a flat bundle of its own
+    while(more) {
+        struct osc_timetag group_tag = timetag;
+        uint64_t due_ns = osc_scheduler_timetag_to_ns(scheduler, group_tag);
+        scheduler->stats.scheduled++;
+        if(due_ns != 0 && now_ns > due_ns + scheduler->late_threshold_ns) {
+            scheduler->stats.late++;
+            osc_scheduled_handler handler = NULL;
+            void* context = NULL;
+            switch(scheduler->late_policy) {
+                case OSC_LATE_DROP:     scheduler->stats.dropped++; break;
+                case OSC_LATE_DISPATCH: scheduler->stats.dispatched++;
+                                        handler = scheduler->handler;
+                                        context = scheduler->context; break;
+                case OSC_LATE_REPORT:   handler = scheduler->late_handler;
+                                        context = scheduler->late_context; break;
+            }
+            do {
+                if(handler != NULL) {
+                    handler(&msg, group_tag, context);
+                }
+                more = (osc_bundle_walker_next(&walker, &msg, &timetag) == 0);
+            } while(more && same_timetag(timetag, group_tag));
+            continue;
+        }
+        struct osc_bundle_walker scan = walker;
+        struct osc_message_view scan_msg;
+        struct osc_timetag scan_tag;
+        size_t length = 16 + 4 + msg.length;
+        while(osc_bundle_walker_next(&scan, &scan_msg, &scan_tag) == 0 && same_timetag(scan_tag, group_tag)) {
+            length += 4 + scan_msg.length;
+        }
+        struct osc_scheduled_bundle* entry = (struct osc_scheduled_bundle*)malloc(sizeof(struct osc_scheduled_bundle) + length);
+        if(entry == NULL) {
+            return 1;
+        }
+        uint32_t be_value = htobe32(group_tag.sec);
+        memcpy(entry->data, "#bundle", 8);
+        memcpy(entry->data + 8, &be_value, 4);
+        be_value = htobe32(group_tag.frac);
+        memcpy(entry->data + 12, &be_value, 4);
+        char* p_element = entry->data + 16;
+        do {
+            be_value = htobe32((uint32_t)msg.length);
+            memcpy(p_element, &be_value, 4);
+            memcpy(p_element + 4, msg.address, msg.length);
+            p_element += 4 + msg.length;
+            more = (osc_bundle_walker_next(&walker, &msg, &timetag) == 0);
+        } while(more && same_timetag(timetag, group_tag));
+        entry->length = length;
+        entry->timetag = group_tag;
+        entry->due_ns = due_ns;
+        enqueue_entry(scheduler, entry);
+    }
+
+return 0;
+}
+
+size_t osc_scheduler_advance(struct osc_scheduler* scheduler, uint64_t now_ns)
+{
+    size_t count = 0;
+    uint64_t target_tick = 0;
+    if(now_ns > scheduler->origin_ns) {
+        target_tick = (now_ns - scheduler->origin_ns) / scheduler->tick_ns;
+    }
+    struct osc_scheduled_bundle* ready = scheduler->ready;
+    scheduler->ready = NULL;
+    scheduler->ready_tail = NULL;
+    count += dispatch_list(scheduler, ready, now_ns);
+    while(scheduler->current_tick < target_tick) {
+        if(scheduler->pending == 0) {
+            scheduler->current_tick = target_tick;
+            break;
+        }
+        uint64_t tick = ++scheduler->current_tick;
+        struct osc_scheduled_bundle* expired = NULL;
+        for(int level = 1; level <= OSC_SCHEDULER_LEVELS; level++) {
+            if(((tick >> (SLOT_BITS * (level - 1))) & SLOT_MASK) != 0) {
+                break;
+            }
+            struct osc_scheduled_bundle* list = NULL;
+            if(level == OSC_SCHEDULER_LEVELS) {
+                list = scheduler->overflow;
+                scheduler->overflow = NULL;
+            }
+            else {
+                size_t slot = (tick >> (SLOT_BITS * level)) & SLOT_MASK;
+                list = scheduler->wheel[level][slot];
+                scheduler->wheel[level][slot] = NULL;
+            }
+            wheel_cascade(scheduler, list, &expired);
+        }
+        struct osc_scheduled_bundle** slot = &scheduler->wheel[0][tick & SLOT_MASK];
+        while(*slot != NULL) {
+            struct osc_scheduled_bundle* entry = *slot;
+            *slot = entry->next;
+            entry->next = expired;
+            expired = entry;
+        }
+        for(struct osc_scheduled_bundle* entry = expired; entry != NULL; entry = entry->next) {
+            scheduler->pending--;
+        }
+        count += dispatch_list(scheduler, sort_by_due(expired), now_ns);
+    }
+
+return count;
+}
+
+size_t osc_scheduler_poll(struct osc_scheduler* scheduler)
+{
+return osc_scheduler_advance(scheduler, osc_scheduler_now_ns());
+}
+
+int osc_scheduler_next_deadline(const struct osc_scheduler* scheduler, uint64_t* deadline_ns)
+{
+    uint64_t best_tick = UINT64_MAX;
+    if(scheduler->ready != NULL) {
+        best_tick = scheduler->current_tick;
+    }
+    else if(scheduler->pending == 0) {
+        return 1;
+    }
+    for(int level = 0; level < OSC_SCHEDULER_LEVELS; level++) {
+        uint64_t base = scheduler->current_tick >> (SLOT_BITS * level);
+        for(uint64_t k = 1; k <= OSC_SCHEDULER_SLOTS; k++) {
+            if(scheduler->wheel[level][(base + k) & SLOT_MASK] != NULL) {
+                uint64_t tick = (base + k) << (SLOT_BITS * level);
+                if(tick < best_tick) {
+                    best_tick = tick;
+                }
+                break;
+            }
+        }
+    }
+    if(scheduler->overflow != NULL) {
+        uint64_t span = SLOT_BITS * OSC_SCHEDULER_LEVELS;
+        uint64_t tick = ((scheduler->current_tick >> span) + 1) << span;
+        if(tick < best_tick) {
+            best_tick = tick;
+        }
+    }
+    *deadline_ns = scheduler->origin_ns + best_tick * scheduler->tick_ns;
+
+return 0;
+}
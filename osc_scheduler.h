@@ -0,0 +1,178 @@
+/** @file osc_scheduler.h */
+
+#ifndef OSC_SCHEDULER_H
+#define OSC_SCHEDULER_H
+
+#include <stdint.h>
+#include <stdlib.h>
+#include "osc.h"
+
+#define OSC_SCHEDULER_LEVELS 5
+#define OSC_SCHEDULER_SLOTS 64
+#define OSC_SCHEDULER_DEFAULT_TICK_NS 100000
+
+/**
+ * What the scheduler does with a bundle whose timetag is already in the past when it is added
+ * OSC_LATE_DROP drops the bundle, OSC_LATE_DISPATCH dispatches it immediately,
+ * OSC_LATE_REPORT hands its messages to the late handler instead of the regular one
+ */
+enum osc_late_policy {
+    OSC_LATE_DROP,
+    OSC_LATE_DISPATCH,
+    OSC_LATE_REPORT
+};
+
+/**
+ * Function called for every message of a bundle that became due
+ *
+ * @param   msg         pointer to the osc_message_view of the message
+ * @param   timetag     the effective timetag of the message (see osc_bundle_walker_next)
+ * @param   context     the context pointer given to the scheduler
+ */
+typedef void (*osc_scheduled_handler)(const struct osc_message_view* msg, struct osc_timetag timetag, void* context);
+
+/**
+ * Structure representing the osc_scheduler counters
+ * jitter is the delay between the due time of a bundle and the moment it was dispatched
+ */
+struct osc_scheduler_stats {
+    uint64_t scheduled;
+    uint64_t dispatched;
+    uint64_t late;
+    uint64_t dropped;
+    uint64_t max_jitter_ns;
+    uint64_t total_jitter_ns;
+};
+
+struct osc_scheduled_bundle;
+
+/**
+ * Structure representing an osc_scheduler
+ * Pending bundles are kept in a hierarchical timing wheel of OSC_SCHEDULER_LEVELS levels of OSC_SCHEDULER_SLOTS slots,
+ * level n covering OSC_SCHEDULER_SLOTS^(n+1) ticks of tick_ns nanoseconds; bundles beyond the last level wait in overflow
+ * ready holds the bundles to dispatch on the next poll (immediate timetags)
+ * origin_ns is the CLOCK_MONOTONIC time of tick 0, realtime_offset_ns converts CLOCK_REALTIME to CLOCK_MONOTONIC
+ */
+struct osc_scheduler {
+    struct osc_scheduled_bundle* wheel[OSC_SCHEDULER_LEVELS][OSC_SCHEDULER_SLOTS];
+    struct osc_scheduled_bundle* overflow;
+    struct osc_scheduled_bundle* ready;
+    struct osc_scheduled_bundle* ready_tail;
+    uint64_t tick_ns;
+    uint64_t origin_ns;
+    uint64_t current_tick;
+    int64_t realtime_offset_ns;
+    uint64_t sequence;
+    size_t pending;
+    enum osc_late_policy late_policy;
+    uint64_t late_threshold_ns;
+    osc_scheduled_handler handler;
+    void* context;
+    osc_scheduled_handler late_handler;
+    void* late_context;
+    struct osc_scheduler_stats stats;
+};
+
+/**
+ * Creates a new osc_scheduler instance
+ * The default late policy is OSC_LATE_DISPATCH with a threshold of one tick
+ *
+ * @param   scheduler   pointer to the osc_scheduler structure
+ * @param   tick_ns     the resolution of the timing wheel in nanoseconds (0 for OSC_SCHEDULER_DEFAULT_TICK_NS)
+ * @param   handler     the function to call for every message of a due bundle
+ * @param   context     pointer passed to the handler
+ * @return              returns 0 on success or 1 if the clocks could not be read
+ */
+int osc_scheduler_new(struct osc_scheduler* scheduler, uint64_t tick_ns, osc_scheduled_handler handler, void* context);
+
+/**
+ * Destroys an osc_scheduler instance by freeing all pending bundles
+ *
+ * @param   scheduler   pointer to the osc_scheduler structure
+ */
+void osc_scheduler_destroy(struct osc_scheduler* scheduler);
+
+/**
+ * Sets what happens to bundles that are added after their timetag has passed
+ *
+ * @param   scheduler       pointer to the osc_scheduler structure
+ * @param   policy          the policy to apply to late bundles
+ * @param   threshold_ns    how far in the past a timetag may be before the bundle counts as late
+ * @param   late_handler    the function to call for the messages of late bundles (OSC_LATE_REPORT only)
+ * @param   late_context    pointer passed to the late handler
+ */
+void osc_scheduler_set_late_policy(struct osc_scheduler* scheduler, enum osc_late_policy policy, uint64_t threshold_ns,
+                                   osc_scheduled_handler late_handler, void* late_context);
+
+/**
+ * Re-samples CLOCK_REALTIME against CLOCK_MONOTONIC (call it after the system clock was stepped)
+ *
+ * @param   scheduler   pointer to the osc_scheduler structure
+ * @return              returns 0 on success or 1 if the clocks could not be read
+ */
+int osc_scheduler_resync_clock(struct osc_scheduler* scheduler);
+
+/**
+ * Converts an NTP timetag into CLOCK_MONOTONIC nanoseconds
+ *
+ * @param   scheduler   pointer to the osc_scheduler structure
+ * @param   timetag     the timetag in the host endianity
+ * @return              the CLOCK_MONOTONIC time in nanoseconds (0 for the immediate timetag)
+ */
+uint64_t osc_scheduler_timetag_to_ns(const struct osc_scheduler* scheduler, struct osc_timetag timetag);
+
+/**
+ * Reads CLOCK_MONOTONIC in nanoseconds
+ *
+ * @return              the current CLOCK_MONOTONIC time in nanoseconds
+ */
+uint64_t osc_scheduler_now_ns(void);
+
+/**
+ * Copies an osc_bundle instance into the scheduler to be dispatched when its timetag becomes due
+ * Nested bundles are handled as in osc_scheduler_add_bundle_view
+ *
+ * @param   scheduler   pointer to the osc_scheduler structure
+ * @param   bundle      pointer to the osc_bundle structure
+ * @return              returns 0 on success or 1 if memory allocation failed
+ */
+int osc_scheduler_add_bundle(struct osc_scheduler* scheduler, const struct osc_bundle* bundle);
+
+/**
+ * Copies a validated osc_bundle_view into the scheduler to be dispatched when its timetag becomes due
+ * Messages of nested bundles are scheduled at their effective timetag, each run of messages sharing
+ * an effective timetag being queued (and counted in the stats) as a bundle of its own
+ *
+ * @param   scheduler   pointer to the osc_scheduler structure
+ * @param   view        pointer to the osc_bundle_view structure
+ * @return              returns 0 on success or 1 if memory allocation failed
+ */
+int osc_scheduler_add_bundle_view(struct osc_scheduler* scheduler, const struct osc_bundle_view* view);
+
+/**
+ * Dispatches, in timetag order, every bundle that is due at the given CLOCK_MONOTONIC time
+ *
+ * @param   scheduler   pointer to the osc_scheduler structure
+ * @param   now_ns      the current CLOCK_MONOTONIC time in nanoseconds
+ * @return              the number of messages dispatched
+ */
+size_t osc_scheduler_advance(struct osc_scheduler* scheduler, uint64_t now_ns);
+
+/**
+ * Dispatches, in timetag order, every bundle that is due now
+ *
+ * @param   scheduler   pointer to the osc_scheduler structure
+ * @return              the number of messages dispatched
+ */
+size_t osc_scheduler_poll(struct osc_scheduler* scheduler);
+
+/**
+ * Finds a CLOCK_MONOTONIC time no later than the due time of the earliest pending bundle
+ *
+ * @param   scheduler   pointer to the osc_scheduler structure
+ * @param   deadline_ns set to the deadline in nanoseconds
+ * @return              returns 0 on success or 1 if no bundle is pending
+ */
+int osc_scheduler_next_deadline(const struct osc_scheduler* scheduler, uint64_t* deadline_ns);
+
+#endif //OSC_SCHEDULER_H
@@ -0,0 +1,292 @@
+/** @file osc_stream.c */
+
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include "osc_stream.h"
+
+/**
+ * Makes sure the reassembly buffer can hold the given number of bytes
+ *
+ * @param   decoder     pointer to the osc_stream_decoder structure
+ * @param   needed      the number of bytes the buffer has to hold
+ * @return              returns 0 on success or 1 if memory reallocation failed
+ */
+static int reserve_partial(struct osc_stream_decoder* decoder, size_t needed)
+{
+    if(needed <= decoder->partial_capacity) {
+        return 0;
+    }
+    size_t new_capacity = decoder->partial_capacity == 0 ? 256 : decoder->partial_capacity;
+    while(new_capacity < needed) {
+        new_capacity *= 2;
+    }
+    char* memory_alloc = (char*)realloc(decoder->partial, new_capacity);
+    if(memory_alloc == NULL) {
+        return 1;
+    }
+    decoder->partial = memory_alloc;
+    decoder->partial_capacity = new_capacity;
+
+return 0;
+}
+
+/**
+ * Consumes bytes of the current chunk
+ *
+ * @param   decoder     pointer to the osc_stream_decoder structure
+ * @param   count       the number of bytes to consume
+ */
+static void consume(struct osc_stream_decoder* decoder, size_t count)
+{
+    decoder->input += count;
+    decoder->input_length -= count;
+}
+
+/**
+ * Finds the first SLIP END or ESC byte
+ *
+ * @param   p           pointer to the first byte to look at
+ * @param   length      the number of bytes to look at
+ * @return              the offset of the first END or ESC byte or length if there is none
+ */
+static size_t find_special(const char* p, size_t length)
+{
+    const unsigned char* uchar_ptr = (const unsigned char*)p;
+    size_t i = 0;
+    while(i < length && uchar_ptr[i] != OSC_SLIP_END && uchar_ptr[i] != OSC_SLIP_ESC) {
+        i++;
+    }
+
+return i;
+}
+
+/**
+ * Decodes the next packet of a length-prefixed stream (see osc_stream_decoder_next)
+ */
+static int next_length_prefixed(struct osc_stream_decoder* decoder, const char** packet, size_t* length)
+{
+    for(;;) {
+        if(decoder->discard) {
+            size_t skipped = decoder->remaining < decoder->input_length ? decoder->remaining : decoder->input_length;
+            consume(decoder, skipped);
+            decoder->remaining -= skipped;
+            if(decoder->remaining > 0) {
+                return 1;
+            }
+            decoder->discard = 0;
+        }
+        if(decoder->expected == 0) {
+            if(decoder->prefix_length == 0 && decoder->input_length >= 4) {
+                memcpy(decoder->prefix, decoder->input, 4);
+                consume(decoder, 4);
+            }
+            else {
+                while(decoder->prefix_length < 4 && decoder->input_length > 0) {
+                    decoder->prefix[decoder->prefix_length++] = (unsigned char)*decoder->input;
+                    consume(decoder, 1);
+                }
+                if(decoder->prefix_length < 4) {
+                    return 1;
+                }
+            }
+            decoder->prefix_length = 0;
+            size_t packet_length = ((size_t)decoder->prefix[0] << 24) | ((size_t)decoder->prefix[1] << 16) |
+                                   ((size_t)decoder->prefix[2] << 8) | (size_t)decoder->prefix[3];
+            if(packet_length > decoder->max_packet) {
+                decoder->oversized++;
+                decoder->discard = 1;
+                decoder->remaining = packet_length;
+                continue;
+            }
+            if(packet_length == 0) {
+                continue;
+            }
+            decoder->expected = packet_length;
+            decoder->partial_length = 0;
+        }
+        if(decoder->partial_length == 0 && decoder->input_length >= decoder->expected) {
+            *packet = decoder->input;
+            *length = decoder->expected;
+            consume(decoder, decoder->expected);
+            decoder->expected = 0;
+            return 0;
+        }
+        if(decoder->input_length == 0) {
+            return 1;
+        }
+        if(reserve_partial(decoder, decoder->expected) == 1) {
+            return 2;
+        }
+        size_t copied = decoder->expected - decoder->partial_length;
+        if(copied > decoder->input_length) {
+            copied = decoder->input_length;
+        }
+        memcpy(decoder->partial + decoder->partial_length, decoder->input, copied);
+        consume(decoder, copied);
+        decoder->partial_length += copied;
+        if(decoder->partial_length < decoder->expected) {
+            return 1;
+        }
+        *packet = decoder->partial;
+        *length = decoder->partial_length;
+        decoder->partial_length = 0;
+        decoder->expected = 0;
+        return 0;
+    }
+}
+
+/**
+ * Appends decoded bytes to the packet being reassembled, switching to discard mode if it grows too large
+ *
+ * @param   decoder     pointer to the osc_stream_decoder structure
+ * @param   data        pointer to the first byte to append
+ * @param   count       the number of bytes to append
+ * @return              returns 0 on success or 1 if memory reallocation failed
+ */
+static int append_partial(struct osc_stream_decoder* decoder, const char* data, size_t count)
+{
+    if(decoder->discard || count == 0) {
+        return 0;
+    }
+    if(decoder->partial_length + count > decoder->max_packet) {
+        decoder->oversized++;
+        decoder->discard = 1;
+        decoder->partial_length = 0;
+        return 0;
+    }
+    if(reserve_partial(decoder, decoder->partial_length + count) == 1) {
+        return 1;
+    }
+    memcpy(decoder->partial + decoder->partial_length, data, count);
+    decoder->partial_length += count;
+
+return 0;
+}
+
+/**
+ * Decodes the next packet of a SLIP stream (see osc_stream_decoder_next)
+ */
+static int next_slip(struct osc_stream_decoder* decoder, const char** packet, size_t* length)
+{
+    while(decoder->input_length > 0) {
+        if(decoder->partial_length == 0 && !decoder->escape && !decoder->discard) {
+            size_t special = find_special(decoder->input, decoder->input_length);
+            if(special < decoder->input_length && (unsigned char)decoder->input[special] == OSC_SLIP_END) {
+                const char* p_packet = decoder->input;
+                consume(decoder, special + 1);
+                if(special == 0) {
+                    continue;
+                }
+                if(special > decoder->max_packet) {
+                    decoder->oversized++;
+                    continue;
+                }
+                *packet = p_packet;
+                *length = special;
+                return 0;
+            }
+        }
+        if(decoder->escape) {
+            unsigned char c = (unsigned char)*decoder->input;
+            consume(decoder, 1);
+            decoder->escape = 0;
+            if(c == OSC_SLIP_END) {
+                decoder->discard = 0;
+                decoder->partial_length = 0;
+                continue;
+            }
+            char decoded = (char)(c == OSC_SLIP_ESC_END ? OSC_SLIP_END : c == OSC_SLIP_ESC_ESC ? OSC_SLIP_ESC : c);
+            if(append_partial(decoder, &decoded, 1) == 1) {
+                return 2;
+            }
+            continue;
+        }
+        size_t run = find_special(decoder->input, decoder->input_length);
+        if(append_partial(decoder, decoder->input, run) == 1) {
+            return 2;
+        }
+        consume(decoder, run);
+        if(decoder->input_length == 0) {
+            break;
+        }
+        unsigned char c = (unsigned char)*decoder->input;
+        consume(decoder, 1);
+        if(c == OSC_SLIP_ESC) {
+            decoder->escape = 1;
+            continue;
+        }
+        if(decoder->discard) {
+            decoder->discard = 0;
+            decoder->partial_length = 0;
+            continue;
+        }
+        if(decoder->partial_length > 0) {
+            *packet = decoder->partial;
+            *length = decoder->partial_length;
+            decoder->partial_length = 0;
+            return 0;
+        }
+    }
+
+return 1;
+}
+
+int osc_stream_decoder_new(struct osc_stream_decoder* decoder, enum osc_stream_framing framing, size_t max_packet)
+{
+    memset(decoder, 0, sizeof(*decoder));
+    decoder->framing = framing;
+    decoder->max_packet = max_packet == 0 ? OSC_STREAM_DEFAULT_MAX_PACKET : max_packet;
+
+return 0;
+}
+
+void osc_stream_decoder_destroy(struct osc_stream_decoder* decoder)
+{
+    free(decoder->partial);
+    memset(decoder, 0, sizeof(*decoder));
+}
+
+void osc_stream_decoder_feed(struct osc_stream_decoder* decoder, const void* data, size_t length)
+{
+    decoder->input = (const char*)data;
+    decoder->input_length = length;
+}
+
+int osc_stream_decoder_next(struct osc_stream_decoder* decoder, const char** packet, size_t* length)
+{
+    if(decoder->framing == OSC_FRAMING_SLIP) {
+        return next_slip(decoder, packet, length);
+    }
+
+return next_length_prefixed(decoder, packet, length);
+}
+
+size_t osc_slip_encoded_max_length(size_t length)
+{
+return 2 * length + 2;
+}
+
+size_t osc_slip_encode(const void* packet, size_t length, void* out)
+{
+    const unsigned char* p_in = (const unsigned char*)packet;
+    unsigned char* p_out = (unsigned char*)out;
+    size_t written = 0;
+    p_out[written++] = OSC_SLIP_END;
+    for(size_t i = 0; i < length; i++) {
+        if(p_in[i] == OSC_SLIP_END) {
+            p_out[written++] = OSC_SLIP_ESC;
+            p_out[written++] = OSC_SLIP_ESC_END;
+        }
+        else if(p_in[i] == OSC_SLIP_ESC) {
+            p_out[written++] = OSC_SLIP_ESC;
+            p_out[written++] = OSC_SLIP_ESC_ESC;
+        }
+        else {
+            p_out[written++] = p_in[i];
+        }
+    }
+    p_out[written++] = OSC_SLIP_END;
+
+return written;
+}
@@ -0,0 +1,111 @@
+/** @file osc_stream.h */
+
+#ifndef OSC_STREAM_H
+#define OSC_STREAM_H
+
+#include <stdint.h>
+#include <stdlib.h>
+#include "osc.h"
+
+#define OSC_STREAM_DEFAULT_MAX_PACKET 65536
+#define OSC_SLIP_END 0xC0
+#define OSC_SLIP_ESC 0xDB
+#define OSC_SLIP_ESC_END 0xDC
+#define OSC_SLIP_ESC_ESC 0xDD
+
+/**
+ * Framing of OSC packets in a byte stream
+ * OSC_FRAMING_LENGTH_PREFIX prefixes every packet with its 4B big-endian length (OSC 1.0, the osc_message raw_data layout)
+ * OSC_FRAMING_SLIP delimits every packet with SLIP END bytes (OSC 1.1)
+ */
+enum osc_stream_framing {
+    OSC_FRAMING_LENGTH_PREFIX,
+    OSC_FRAMING_SLIP
+};
+
+/**
+ * Structure representing an incremental decoder of a stream of OSC packets
+ * input and input_length are the part of the last fed chunk that has not been decoded yet
+ * partial holds a packet that spans several chunks (or, with SLIP framing, contains escaped bytes) while it is reassembled
+ * prefix holds the bytes of a length prefix split across chunks, expected is the length of the packet being reassembled
+ * (OSC_FRAMING_LENGTH_PREFIX only), escape is set when the last byte was a SLIP ESC
+ * discard is set while the bytes of an oversized packet are skipped, remaining being the bytes left to skip
+ * (OSC_FRAMING_LENGTH_PREFIX only); oversized counts the skipped packets
+ */
+struct osc_stream_decoder {
+    enum osc_stream_framing framing;
+    size_t max_packet;
+    const char* input;
+    size_t input_length;
+    char* partial;
+    size_t partial_length;
+    size_t partial_capacity;
+    unsigned char prefix[4];
+    size_t prefix_length;
+    size_t expected;
+    int escape;
+    int discard;
+    size_t remaining;
+    uint64_t oversized;
+};
+
+/**
+ * Creates a new osc_stream_decoder instance
+ *
+ * @param   decoder     pointer to the osc_stream_decoder structure
+ * @param   framing     the framing of the stream
+ * @param   max_packet  the largest accepted packet, larger packets are skipped (0 for OSC_STREAM_DEFAULT_MAX_PACKET)
+ * @return              returns 0 on success
+ */
+int osc_stream_decoder_new(struct osc_stream_decoder* decoder, enum osc_stream_framing framing, size_t max_packet);
+
+/**
+ * Destroys an osc_stream_decoder instance by freeing its reassembly buffer
+ *
+ * @param   decoder     pointer to the osc_stream_decoder structure
+ */
+void osc_stream_decoder_destroy(struct osc_stream_decoder* decoder);
+
+/**
+ * Hands the next chunk of the stream to the decoder
+ * The chunk is not copied and must stay valid until osc_stream_decoder_next returns 1
+ *
+ * @param   decoder     pointer to the osc_stream_decoder structure
+ * @param   data        pointer to the first byte of the chunk
+ * @param   length      the length of the chunk
+ */
+void osc_stream_decoder_feed(struct osc_stream_decoder* decoder, const void* data, size_t length);
+
+/**
+ * Decodes the next complete packet of the stream (without its framing)
+ * A packet lying entirely in the current chunk is returned in place; only packets split across chunks
+ * (or, with SLIP framing, containing escaped bytes) are copied into the reassembly buffer
+ * The packet stays valid until the next osc_stream_decoder_next or osc_stream_decoder_feed call
+ *
+ * @param   decoder     pointer to the osc_stream_decoder structure
+ * @param   packet      set to the first byte of the packet
+ * @param   length      set to the length of the packet
+ * @return              returns 0 if a packet was decoded, 1 if the chunk is used up (feed the next one)
+ *                      or 2 if memory allocation failed
+ */
+int osc_stream_decoder_next(struct osc_stream_decoder* decoder, const char** packet, size_t* length);
+
+/**
+ * Finds the largest size of a SLIP-encoded packet
+ *
+ * @param   length      the length of the packet
+ * @return              the largest number of bytes osc_slip_encode writes for the packet
+ */
+size_t osc_slip_encoded_max_length(size_t length);
+
+/**
+ * Encodes a packet with SLIP framing (an END byte before and after the escaped packet bytes)
+ *
+ * @param   packet      pointer to the first byte of the packet
+ * @param   length      the length of the packet
+ * @param   out         pointer to the output buffer (at least osc_slip_encoded_max_length(length) bytes)
+ * @return              the number of bytes written
+ */
+size_t osc_slip_encode(const void* packet, size_t length, void* out);
+
+#endif //OSC_STREAM_H
@@ -0,0 +1,325 @@
+/** @file osc_udp.c */
+
+#ifndef _GNU_SOURCE
+    #define _GNU_SOURCE
+#endif // _GNU_SOURCE
+
+#include <stdio.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <unistd.h>
+#include <poll.h>
+#include <netdb.h>
+#include <netinet/in.h>
+#include <sys/socket.h>
+#include <sys/uio.h>
+#include "osc_udp.h"
+
+/**
+ * Resolves a numeric address and port into a socket address
+ *
+ * @param   host            the numeric IPv4 or IPv6 address (NULL for any IPv4 address)
+ * @param   port            the port
+ * @param   address         set to the socket address
+ * @param   address_length  set to the length of the socket address
+ * @return                  returns 0 on success or 1 if the address is invalid
+ */
+static int resolve_address(const char* host, uint16_t port, struct sockaddr_storage* address, socklen_t* address_length)
+{
+    struct addrinfo hints;
+    memset(&hints, 0, sizeof(hints));
+    hints.ai_family = host == NULL ? AF_INET : AF_UNSPEC;
+    hints.ai_socktype = SOCK_DGRAM;
+    hints.ai_flags = AI_NUMERICHOST | AI_NUMERICSERV | AI_PASSIVE;
+    char service[8];
+    snprintf(service, sizeof(service), "%u", (unsigned int)port);
+    struct addrinfo* result = NULL;
+    if(getaddrinfo(host, service, &hints, &result) != 0) {
+        return 1;
+    }
+    memcpy(address, result->ai_addr, result->ai_addrlen);
+    *address_length = result->ai_addrlen;
+    freeaddrinfo(result);
+
+return 0;
+}
+
+/**
+ * Empties the send queue, releasing the references held on queued packets
+ *
+ * @param   sock        pointer to the osc_udp_socket structure
+ */
+static void release_packets(struct osc_udp_socket* sock)
+{
+    if(sock->tx_packets != NULL) {
+        for(size_t i = 0; i < sock->tx_count; i++) {
+            osc_packet_release(sock->tx_packets[i]);
+            sock->tx_packets[i] = NULL;
+        }
+    }
+    sock->tx_count = 0;
+}
+
+/**
+ * Creates a new osc_udp_socket instance (see osc_udp_new)
+ *
+ * @param   sock        pointer to the osc_udp_socket structure
+ * @param   host        the numeric IPv4 or IPv6 address to bind to (NULL for any IPv4 address)
+ * @param   port        the port to bind to (0 for an ephemeral port)
+ * @param   batch       the maximum number of datagrams per system call (0 for OSC_UDP_DEFAULT_BATCH)
+ * @param   buffer_size the size of each receive buffer (0 for OSC_UDP_DEFAULT_BUFFER_SIZE)
+ * @param   reuse_port  whether SO_REUSEPORT is set before binding
+ * @return              returns 0 on success or 1 on failure
+ */
+static int udp_open(struct osc_udp_socket* sock, const char* host, uint16_t port, size_t batch, size_t buffer_size, int reuse_port)
+{
+    memset(sock, 0, sizeof(*sock));
+    sock->fd = -1;
+    sock->batch = batch == 0 ? OSC_UDP_DEFAULT_BATCH : batch;
+    sock->buffer_size = buffer_size == 0 ? OSC_UDP_DEFAULT_BUFFER_SIZE : buffer_size;
+    struct sockaddr_storage address;
+    socklen_t address_length = 0;
+    if(resolve_address(host, port, &address, &address_length) == 1) {
+        return 1;
+    }
+    sock->rx_buffers = (char*)malloc(sock->batch * sock->buffer_size);
+    sock->rx_headers = (struct mmsghdr*)calloc(sock->batch, sizeof(struct mmsghdr));
+    sock->rx_iovecs = (struct iovec*)calloc(sock->batch, sizeof(struct iovec));
+    sock->rx_addresses = (struct sockaddr_storage*)calloc(sock->batch, sizeof(struct sockaddr_storage));
+    sock->tx_headers = (struct mmsghdr*)calloc(sock->batch, sizeof(struct mmsghdr));
+    sock->tx_iovecs = (struct iovec*)calloc(sock->batch, sizeof(struct iovec));
+    sock->tx_addresses = (struct sockaddr_storage*)calloc(sock->batch, sizeof(struct sockaddr_storage));
+    sock->tx_packets = (struct osc_packet**)calloc(sock->batch, sizeof(struct osc_packet*));
+    if(sock->rx_buffers == NULL || sock->rx_headers == NULL || sock->rx_iovecs == NULL || sock->rx_addresses == NULL ||
+       sock->tx_headers == NULL || sock->tx_iovecs == NULL || sock->tx_addresses == NULL ||
+       sock->tx_packets == NULL) {
+        osc_udp_destroy(sock);
+        return 1;
+    }
+    sock->fd = socket(address.ss_family, SOCK_DGRAM | SOCK_CLOEXEC, 0);
+    int option = 1;
+    if(sock->fd < 0 || (reuse_port && setsockopt(sock->fd, SOL_SOCKET, SO_REUSEPORT, &option, sizeof(option)) != 0) ||
+       bind(sock->fd, (struct sockaddr*)&address, address_length) != 0) {
+        osc_udp_destroy(sock);
+        return 1;
+    }
+    for(size_t i = 0; i < sock->batch; i++) {
+        sock->rx_iovecs[i].iov_base = sock->rx_buffers + i * sock->buffer_size;
+        sock->rx_iovecs[i].iov_len = sock->buffer_size;
+        sock->rx_headers[i].msg_hdr.msg_iov = &sock->rx_iovecs[i];
+        sock->rx_headers[i].msg_hdr.msg_iovlen = 1;
+        sock->tx_headers[i].msg_hdr.msg_iov = &sock->tx_iovecs[i];
+        sock->tx_headers[i].msg_hdr.msg_iovlen = 1;
+    }
+
+return 0;
+}
+
+int osc_udp_new(struct osc_udp_socket* sock, const char* host, uint16_t port, size_t batch, size_t buffer_size)
+{
+return udp_open(sock, host, port, batch, buffer_size, 0);
+}
+
+int osc_udp_new_reuseport(struct osc_udp_socket* sock, const char* host, uint16_t port, size_t batch, size_t buffer_size)
+{
+return udp_open(sock, host, port, batch, buffer_size, 1);
+}
+
+void osc_udp_destroy(struct osc_udp_socket* sock)
+{
+    release_packets(sock);
+    if(sock->fd >= 0) {
+        close(sock->fd);
+    }
+    free(sock->rx_buffers);
+    free(sock->rx_headers);
+    free(sock->rx_iovecs);
+    free(sock->rx_addresses);
+    free(sock->tx_headers);
+    free(sock->tx_iovecs);
+    free(sock->tx_addresses);
+    free(sock->tx_packets);
+    memset(sock, 0, sizeof(*sock));
+    sock->fd = -1;
+}
+
+int osc_udp_local_port(const struct osc_udp_socket* sock, uint16_t* port)
+{
+    struct sockaddr_storage address;
+    socklen_t address_length = sizeof(address);
+    if(getsockname(sock->fd, (struct sockaddr*)&address, &address_length) != 0) {
+        return 1;
+    }
+    if(address.ss_family == AF_INET6) {
+        *port = ntohs(((struct sockaddr_in6*)&address)->sin6_port);
+    }
+    else {
+        *port = ntohs(((struct sockaddr_in*)&address)->sin_port);
+    }
+
+return 0;
+}
+
+int osc_udp_set_destination(struct osc_udp_socket* sock, const char* host, uint16_t port)
+{
+    if(host == NULL) {
+        return 1;
+    }
+
+return resolve_address(host, port, &sock->destination, &sock->destination_length);
+}
+
+int osc_udp_queue_to(struct osc_udp_socket* sock, const void* data, size_t length, const struct sockaddr* address, socklen_t address_length)
+{
+    if(address == NULL) {
+        address = (const struct sockaddr*)&sock->destination;
+        address_length = sock->destination_length;
+    }
+    if(address_length == 0 || address_length > sizeof(struct sockaddr_storage)) {
+        return 1;
+    }
+    if(sock->tx_count == sock->batch && osc_udp_flush(sock) == 1) {
+        return 1;
+    }
+    size_t i = sock->tx_count++;
+    memcpy(&sock->tx_addresses[i], address, address_length);
+    sock->tx_iovecs[i].iov_base = (void*)data;
+    sock->tx_iovecs[i].iov_len = length;
+    sock->tx_headers[i].msg_hdr.msg_name = &sock->tx_addresses[i];
+    sock->tx_headers[i].msg_hdr.msg_namelen = address_length;
+
+return 0;
+}
+
+int osc_udp_queue_packet(struct osc_udp_socket* sock, struct osc_packet* packet, const struct sockaddr* address, socklen_t address_length)
+{
+    if(osc_udp_queue_to(sock, packet->data, packet->length, address, address_length) == 1) {
+        return 1;
+    }
+    sock->tx_packets[sock->tx_count - 1] = osc_packet_retain(packet);
+
+return 0;
+}
+
+int osc_udp_queue_message(struct osc_udp_socket* sock, const struct osc_message* msg)
+{
+return osc_udp_queue_to(sock, (const char*)msg->raw_data + 4, osc_message_serialized_length(msg), NULL, 0);
+}
+
+int osc_udp_queue_bundle(struct osc_udp_socket* sock, const struct osc_bundle* bundle)
+{
+return osc_udp_queue_to(sock, (const char*)bundle->raw_data + 4, osc_bundle_serialized_length(bundle), NULL, 0);
+}
+
+int osc_udp_flush(struct osc_udp_socket* sock)
+{
+    size_t sent = 0;
+    int return_value = 0;
+    while(sent < sock->tx_count) {
+        int result = sendmmsg(sock->fd, sock->tx_headers + sent, sock->tx_count - sent, 0);
+        sock->stats.send_calls++;
+        if(result < 0) {
+            if(errno == EINTR) {
+                continue;
+            }
+            return_value = 1;
+            break;
+        }
+        sent += result;
+    }
+    sock->stats.sent += sent;
+    release_packets(sock);
+
+return return_value;
+}
+
+int osc_udp_receive(struct osc_udp_socket* sock, struct osc_udp_packet* packets, size_t max_packets, int timeout_ms, size_t* count)
+{
+    *count = 0;
+    if(max_packets > sock->batch) {
+        max_packets = sock->batch;
+    }
+    if(max_packets == 0) {
+        return 0;
+    }
+    int flags = MSG_WAITFORONE;
+    if(timeout_ms >= 0) {
+        struct pollfd pfd;
+        pfd.fd = sock->fd;
+        pfd.events = POLLIN;
+        int ready = poll(&pfd, 1, timeout_ms);
+        if(ready < 0 && errno != EINTR) {
+            return 1;
+        }
+        if(ready <= 0) {
+            return 0;
+        }
+        flags = MSG_DONTWAIT;
+    }
+    for(size_t i = 0; i < max_packets; i++) {
+        sock->rx_headers[i].msg_hdr.msg_name = &sock->rx_addresses[i];
+        sock->rx_headers[i].msg_hdr.msg_namelen = sizeof(struct sockaddr_storage);
+        sock->rx_headers[i].msg_hdr.msg_flags = 0;
+    }
+    int result = 0;
+    do {
+        result = recvmmsg(sock->fd, sock->rx_headers, max_packets, flags, NULL);
+    } while(result < 0 && errno == EINTR);
+    sock->stats.receive_calls++;
+    if(result < 0) {
+        return (errno == EAGAIN || errno == EWOULDBLOCK) ? 0 : 1;
+    }
+    size_t received = 0;
+    for(int i = 0; i < result; i++) {
+        if(sock->rx_headers[i].msg_hdr.msg_flags & MSG_TRUNC) {
+            sock->stats.truncated++;
+            continue;
+        }
+        struct osc_udp_packet* packet = &packets[received++];
+        packet->data = (const char*)sock->rx_iovecs[i].iov_base;
+        packet->length = sock->rx_headers[i].msg_len;
+        memcpy(&packet->source, &sock->rx_addresses[i], sock->rx_headers[i].msg_hdr.msg_namelen);
+        packet->source_length = sock->rx_headers[i].msg_hdr.msg_namelen;
+    }
+    sock->stats.received += received;
+    *count = received;
+
+return 0;
+}
+
+int osc_udp_receive_dispatch(struct osc_udp_socket* sock, struct osc_dispatcher* dispatcher, int timeout_ms, size_t* count)
+{
+    struct osc_udp_packet packets[OSC_UDP_DEFAULT_BATCH];
+    size_t packet_count = 0;
+    *count = 0;
+    if(osc_udp_receive(sock, packets, OSC_UDP_DEFAULT_BATCH, timeout_ms, &packet_count) == 1) {
+        return 1;
+    }
+    for(size_t i = 0; i < packet_count; i++) {
+        if(osc_packet_is_bundle(packets[i].data, packets[i].length)) {
+            struct osc_bundle_view bundle;
+            if(osc_bundle_view_init(&bundle, packets[i].data, packets[i].length) == 1) {
+                continue;
+            }
+            struct osc_bundle_walker walker;
+            struct osc_message_view msg;
+            struct osc_timetag timetag;
+            osc_bundle_walker_init(&walker, &bundle);
+            while(osc_bundle_walker_next(&walker, &msg, &timetag) == 0) {
+                osc_dispatcher_dispatch(dispatcher, &msg);
+                (*count)++;
+            }
+        }
+        else {
+            struct osc_message_view msg;
+            if(osc_message_view_init(&msg, packets[i].data, packets[i].length) == 0) {
+                osc_dispatcher_dispatch(dispatcher, &msg);
+                (*count)++;
+            }
+        }
+    }
+
+return 0;
+}
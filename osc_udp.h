@@ -0,0 +1,202 @@
+/** @file osc_udp.h */
+
+#ifndef OSC_UDP_H
+#define OSC_UDP_H
+
+#include <stdint.h>
+#include <stdlib.h>
+#include <sys/socket.h>
+#include "osc.h"
+#include "osc_dispatch.h"
+#include "osc_packet.h"
+
+#define OSC_UDP_DEFAULT_BATCH 64
+#define OSC_UDP_DEFAULT_BUFFER_SIZE 2048
+
+struct mmsghdr;
+struct iovec;
+
+/**
+ * Structure representing a datagram received by osc_udp_receive
+ * data points to the first byte of the packet inside the receive buffer pool (a packet never includes the 4B length prefix)
+ * and stays valid until the next osc_udp_receive call on the same socket
+ * source is the address of the sender
+ */
+struct osc_udp_packet {
+    const char* data;
+    size_t length;
+    struct sockaddr_storage source;
+    socklen_t source_length;
+};
+
+/**
+ * Structure representing the osc_udp_socket counters
+ * truncated counts the datagrams dropped because they did not fit into a receive buffer
+ */
+struct osc_udp_stats {
+    uint64_t sent;
+    uint64_t received;
+    uint64_t truncated;
+    uint64_t send_calls;
+    uint64_t receive_calls;
+};
+
+/**
+ * Structure representing a batching UDP socket
+ * Received datagrams are read batch at a time by recvmmsg into a pool of batch buffers of buffer_size bytes that is
+ * recycled on every receive; queued datagrams are sent batch at a time by sendmmsg
+ * tx_packets holds the osc_packet reference of each queued datagram queued by osc_udp_queue_packet (NULL otherwise)
+ * destination is the default destination of queued datagrams (destination_length is 0 if it is not set)
+ */
+struct osc_udp_socket {
+    int fd;
+    size_t batch;
+    size_t buffer_size;
+    char* rx_buffers;
+    struct mmsghdr* rx_headers;
+    struct iovec* rx_iovecs;
+    struct sockaddr_storage* rx_addresses;
+    struct mmsghdr* tx_headers;
+    struct iovec* tx_iovecs;
+    struct sockaddr_storage* tx_addresses;
+    struct osc_packet** tx_packets;
+    size_t tx_count;
+    struct sockaddr_storage destination;
+    socklen_t destination_length;
+    struct osc_udp_stats stats;
+};
+
+/**
+ * Creates a new osc_udp_socket instance bound to the given numeric address and port
+ *
+ * @param   sock        pointer to the osc_udp_socket structure
+ * @param   host        the numeric IPv4 or IPv6 address to bind to (NULL for any IPv4 address)
+ * @param   port        the port to bind to (0 for an ephemeral port)
+ * @param   batch       the maximum number of datagrams per system call (0 for OSC_UDP_DEFAULT_BATCH)
+ * @param   buffer_size the size of each receive buffer (0 for OSC_UDP_DEFAULT_BUFFER_SIZE)
+ * @return              returns 0 on success or 1 if the address is invalid, the socket could not be bound or memory allocation failed
+ */
+int osc_udp_new(struct osc_udp_socket* sock, const char* host, uint16_t port, size_t batch, size_t buffer_size);
+
+/**
+ * Creates a new osc_udp_socket instance with SO_REUSEPORT set, so that several sockets (typically one per thread)
+ * can be bound to the same address and port, the kernel spreading the incoming datagrams between them
+ *
+ * @param   sock        pointer to the osc_udp_socket structure
+ * @param   host        the numeric IPv4 or IPv6 address to bind to (NULL for any IPv4 address)
+ * @param   port        the port to bind to (0 for an ephemeral port)
+ * @param   batch       the maximum number of datagrams per system call (0 for OSC_UDP_DEFAULT_BATCH)
+ * @param   buffer_size the size of each receive buffer (0 for OSC_UDP_DEFAULT_BUFFER_SIZE)
+ * @return              returns 0 on success or 1 if the address is invalid, the socket could not be bound or memory allocation failed
+ */
+int osc_udp_new_reuseport(struct osc_udp_socket* sock, const char* host, uint16_t port, size_t batch, size_t buffer_size);
+
+/**
+ * Destroys an osc_udp_socket instance by closing the socket and freeing the buffers (queued datagrams are discarded
+ * and the references to queued packets released)
+ *
+ * @param   sock        pointer to the osc_udp_socket structure
+ */
+void osc_udp_destroy(struct osc_udp_socket* sock);
+
+/**
+ * Finds the port the socket is bound to
+ *
+ * @param   sock        pointer to the osc_udp_socket structure
+ * @param   port        set to the local port
+ * @return              returns 0 on success or 1 if the socket address could not be read
+ */
+int osc_udp_local_port(const struct osc_udp_socket* sock, uint16_t* port);
+
+/**
+ * Sets the default destination of queued datagrams
+ *
+ * @param   sock        pointer to the osc_udp_socket structure
+ * @param   host        the numeric IPv4 or IPv6 address of the destination
+ * @param   port        the destination port
+ * @return              returns 0 on success or 1 if the address is invalid
+ */
+int osc_udp_set_destination(struct osc_udp_socket* sock, const char* host, uint16_t port);
+
+/**
+ * Queues a datagram for the given destination, flushing the queue first if it is full
+ * The data is not copied and must stay valid until the queue is flushed
+ *
+ * @param   sock            pointer to the osc_udp_socket structure
+ * @param   data            pointer to the first byte of the packet (without the 4B length prefix)
+ * @param   length          the length of the packet
+ * @param   address         the destination (NULL for the default destination)
+ * @param   address_length  the length of address
+ * @return                  returns 0 on success or 1 if there is no destination or the queue could not be flushed
+ */
+int osc_udp_queue_to(struct osc_udp_socket* sock, const void* data, size_t length, const struct sockaddr* address, socklen_t address_length);
+
+/**
+ * Queues an osc_message instance for the default destination (the length prefix is stripped)
+ * The message must not be modified or destroyed until the queue is flushed
+ *
+ * @param   sock        pointer to the osc_udp_socket structure
+ * @param   msg         pointer to the osc_message structure
+ * @return              returns 0 on success or 1 if there is no destination or the queue could not be flushed
+ */
+int osc_udp_queue_message(struct osc_udp_socket* sock, const struct osc_message* msg);
+
+/**
+ * Queues an osc_bundle instance for the default destination (the length prefix is stripped)
+ * The bundle must not be modified or destroyed until the queue is flushed
+ *
+ * @param   sock        pointer to the osc_udp_socket structure
+ * @param   bundle      pointer to the osc_bundle structure
+ * @return              returns 0 on success or 1 if there is no destination or the queue could not be flushed
+ */
+int osc_udp_queue_bundle(struct osc_udp_socket* sock, const struct osc_bundle* bundle);
+
+/**
+ * Queues a reference-counted packet for the given destination, flushing the queue first if it is full
+ * The data is not copied: the socket holds a reference to the packet until the queue is flushed, so the same packet
+ * can be queued for any number of destinations and released by the caller right away
+ *
+ * @param   sock            pointer to the osc_udp_socket structure
+ * @param   packet          pointer to the osc_packet structure
+ * @param   address         the destination (NULL for the default destination)
+ * @param   address_length  the length of address
+ * @return                  returns 0 on success or 1 if there is no destination or the queue could not be flushed
+ */
+int osc_udp_queue_packet(struct osc_udp_socket* sock, struct osc_packet* packet, const struct sockaddr* address, socklen_t address_length);
+
+/**
+ * Sends every queued datagram with as few sendmmsg calls as possible
+ * The queue is empty afterwards, even on failure, and the references to the queued packets are released
+ *
+ * @param   sock        pointer to the osc_udp_socket structure
+ * @return              returns 0 on success or 1 if a datagram could not be sent
+ */
+int osc_udp_flush(struct osc_udp_socket* sock);
+
+/**
+ * Receives up to max_packets datagrams (at most batch) with a single recvmmsg call
+ * Truncated datagrams are dropped and counted in the stats
+ *
+ * @param   sock        pointer to the osc_udp_socket structure
+ * @param   packets     pointer to the array receiving the packets
+ * @param   max_packets the capacity of packets
+ * @param   timeout_ms  how long to wait for the first datagram (-1 waits forever, 0 does not wait)
+ * @param   count       set to the number of packets received
+ * @return              returns 0 on success (including a timeout) or 1 if the socket failed
+ */
+int osc_udp_receive(struct osc_udp_socket* sock, struct osc_udp_packet* packets, size_t max_packets, int timeout_ms, size_t* count);
+
+/**
+ * Receives a batch of datagrams and dispatches their messages
+ * Invalid packets are skipped; the messages of bundles are dispatched immediately in depth-first order regardless
+ * of their timetags (use osc_udp_receive and an osc_scheduler for timed delivery)
+ *
+ * @param   sock        pointer to the osc_udp_socket structure
+ * @param   dispatcher  pointer to the osc_dispatcher structure
+ * @param   timeout_ms  how long to wait for the first datagram (-1 waits forever, 0 does not wait)
+ * @param   count       set to the number of messages dispatched
+ * @return              returns 0 on success (including a timeout) or 1 if the socket failed
+ */
+int osc_udp_receive_dispatch(struct osc_udp_socket* sock, struct osc_dispatcher* dispatcher, int timeout_ms, size_t* count);
+
+#endif //OSC_UDP_H
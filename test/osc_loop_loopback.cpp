@@ -0,0 +1,193 @@
+/** @file osc_loop_loopback.cpp */
+
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <ctime>
+#include "osc_loop.hpp"
+
+#define COUNT 200
+
+#define CHECK(condition) \
+    do { \
+    if(!(condition)) { \
+        std::fprintf(stderr, "%s:%d: check failed: %s\n", __FILE__, __LINE__, #condition); \
+        std::exit(1); \
+    } \
+    } while (0)
+
+using namespace std::chrono_literals;
+
+/**
+ * Opens a pair of loopback sockets, the first one sending to the second one by default
+ *
+ * @param   sender      pointer to the osc_udp_socket structure of the sender
+ * @param   receiver    pointer to the osc_udp_socket structure of the receiver
+ */
+static void open_pair(osc_udp_socket* sender, osc_udp_socket* receiver)
+{
+    uint16_t port = 0;
+    CHECK(osc_udp_new(receiver, "127.0.0.1", 0, 16, 512) == 0);
+    CHECK(osc_udp_new(sender, "127.0.0.1", 0, 16, 512) == 0);
+    CHECK(osc_udp_local_port(receiver, &port) == 0);
+    CHECK(osc_udp_set_destination(sender, "127.0.0.1", port) == 0);
+}
+
+/**
+ * Finds the NTP timetag of the current time plus an offset
+ *
+ * @param   offset_ns   the offset in nanoseconds
+ * @return              the timetag in the host endianity
+ */
+static osc::timetag timetag_in(uint64_t offset_ns)
+{
+    struct timespec now;
+    clock_gettime(CLOCK_REALTIME, &now);
+    uint64_t ns = (uint64_t)now.tv_nsec + offset_ns;
+    osc::timetag tag;
+    tag.sec = (uint32_t)(now.tv_sec + 2208988800u + ns / 1000000000u);
+    tag.frac = (uint32_t)(((ns % 1000000000u) << 32) / 1000000000u);
+    return tag;
+}
+
+static std::size_t received_count;
+
+/**
+ * Counts the datagrams of the burst, stopping the loop once all of them arrived
+ */
+static void on_burst(osc_loop_endpoint*, const osc_udp_packet* packets, std::size_t count, void* context)
+{
+    for(std::size_t i = 0; i < count; i++) {
+        CHECK(osc::decode<std::int32_t>(packets[i].data, packets[i].length).has_value());
+    }
+    received_count += count;
+    if(received_count == COUNT) {
+        osc_loop_stop(static_cast<osc_loop*>(context));
+    }
+}
+
+/**
+ * Stops the loop of a run that did not complete in time
+ */
+static void on_timeout(osc_loop_timer*, void*)
+{
+    std::fprintf(stderr, "timed out\n");
+    std::exit(1);
+}
+
+/**
+ * Queues COUNT datagrams through the C API before running the loop (more than the socket batch, so the socket queue
+ * is flushed while they are queued) and checks that all of them are received and counted
+ */
+static void run_burst(osc_loop* loop)
+{
+    osc_udp_socket sender, receiver;
+    osc_loop_endpoint sending, receiving;
+    osc_loop_timer timeout;
+    open_pair(&sender, &receiver);
+    CHECK(osc_loop_add(loop, &sending, &sender, &on_burst, loop) == 0);
+    CHECK(osc_loop_add(loop, &receiving, &receiver, &on_burst, loop) == 0);
+    received_count = 0;
+    for(std::int32_t i = 0; i < COUNT; i++) {
+        auto packet = osc::encode("/burst", i);
+        osc_packet* copy = osc_packet_copy(packet.data(), packet.size());
+        CHECK(copy != nullptr && osc_loop_send(loop, &sending, copy, nullptr, 0) == 0);
+        osc_packet_release(copy);
+    }
+    CHECK(osc_loop_timer_start(loop, &timeout, osc::deadline_awaiter::now_ns() + 5000000000u, &on_timeout, nullptr) == 0);
+    CHECK(osc_loop_run(loop) == 0);
+    osc_loop_timer_cancel(loop, &timeout);
+    struct osc_loop_stats stats;
+    osc_loop_stats(loop, &stats);
+    CHECK(received_count == COUNT);
+    CHECK(stats.sent == COUNT && stats.send_errors == 0 && stats.received == COUNT);
+    osc_loop_remove(loop, &sending);
+    osc_loop_remove(loop, &receiving);
+    osc_udp_destroy(&sender);
+    osc_udp_destroy(&receiver);
+}
+
+static int finished;
+
+/**
+ * Answers every ping with a pong holding the same value
+ */
+static osc::task serve(osc::endpoint& server)
+{
+    for(int served = 0; served < COUNT; ) {
+        osc::datagrams batch = co_await osc::recv(server);
+        for(const osc_udp_packet& packet : batch) {
+            auto value = osc::decode<std::int32_t>(packet.data, packet.length);
+            CHECK(value.has_value());
+            auto reply = osc::encode("/pong", std::get<0>(*value));
+            osc_packet* copy = osc_packet_copy(reply.data(), reply.size());
+            CHECK(server.send(copy, reinterpret_cast<const sockaddr*>(&packet.source), packet.source_length));
+            osc_packet_release(copy);
+            served++;
+        }
+    }
+    finished++;
+}
+
+/**
+ * Sends COUNT pings one at a time and waits for each pong, then waits with osc::sleep_for and osc::until
+ */
+static osc::task ping(osc::loop& owner, osc::endpoint& client)
+{
+    for(std::int32_t i = 0; i < COUNT; i++) {
+        CHECK(client.send(osc::encode("/ping", i)));
+        osc::datagrams batch = co_await osc::recv(client);
+        CHECK(batch.size() == 1);
+        auto value = osc::decode<std::int32_t>(batch.packets[0].data, batch.packets[0].length);
+        CHECK(value.has_value() && std::get<0>(*value) == i);
+    }
+    uint64_t start = osc::deadline_awaiter::now_ns();
+    co_await osc::sleep_for(owner, 5ms);
+    CHECK(osc::deadline_awaiter::now_ns() - start >= 5000000u);
+    start = osc::deadline_awaiter::now_ns();
+    co_await osc::until(owner, timetag_in(20000000u));
+    CHECK(osc::deadline_awaiter::now_ns() - start >= 10000000u);
+    finished++;
+}
+
+/**
+ * Runs a ping-pong between two coroutines over loopback with the C++ awaitables
+ */
+static void run_coroutines(osc_loop_backend backend)
+{
+    osc::loop owner(backend);
+    osc_udp_socket client_socket, server_socket;
+    open_pair(&client_socket, &server_socket);
+    {
+        osc::endpoint server(owner, server_socket);
+        osc::endpoint client(owner, client_socket);
+        finished = 0;
+        serve(server);
+        ping(owner, client);
+        owner.run();
+        CHECK(finished == 2);
+        CHECK(owner.stats().received == 2 * COUNT);
+    }
+    osc_udp_destroy(&client_socket);
+    osc_udp_destroy(&server_socket);
+}
+
+int main()
+{
+    for(osc_loop_backend backend : {OSC_LOOP_IO_URING, OSC_LOOP_EPOLL}) {
+        const char* name = backend == OSC_LOOP_IO_URING ? "io_uring" : "epoll";
+        osc_loop loop;
+        if(osc_loop_new(&loop, backend, 0, 0) != 0) {
+            CHECK(backend == OSC_LOOP_IO_URING);
+            std::printf("%s: not available, skipped\n", name);
+            continue;
+        }
+        run_burst(&loop);
+        osc_loop_destroy(&loop);
+        run_coroutines(backend);
+        std::printf("%s: ok\n", name);
+    }
+
+return 0;
+}
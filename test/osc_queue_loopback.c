@@ -0,0 +1,90 @@
+/** @file osc_queue_loopback.c */
+
+#include <stdio.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include "osc.h"
+#include "osc_queue.h"
+#include "osc_udp.h"
+
+#define CHECK(condition) \
+    do { \
+    if(!(condition)) { \
+        fprintf(stderr, "%s:%d: check failed: %s\n", __FILE__, __LINE__, #condition); \
+        exit(1); \
+    } \
+    } while (0)
+
+/**
+ * Pushes a /level message holding the given value, coalescing it by address
+ *
+ * @param   queue       pointer to the osc_queue structure
+ * @param   value       the value of the message
+ */
+static void push_level(struct osc_queue* queue, int32_t value)
+{
+    struct osc_message msg;
+    CHECK(osc_message_new(&msg) == 0);
+    CHECK(osc_message_set_address(&msg, "/level") == 0);
+    CHECK(osc_message_add_int32(&msg, value) == 0);
+    CHECK(osc_queue_push_message(queue, &msg, OSC_COALESCE_ADDRESS) == 0);
+    osc_message_destroy(&msg);
+}
+
+int main(void)
+{
+    struct osc_udp_socket sender, receiver;
+    struct osc_queue queue;
+    uint16_t port = 0;
+    size_t count = 0;
+    CHECK(osc_udp_new(&receiver, "127.0.0.1", 0, 16, 512) == 0);
+    CHECK(osc_udp_new(&sender, "127.0.0.1", 0, 16, 512) == 0);
+    CHECK(osc_udp_local_port(&receiver, &port) == 0);
+    CHECK(osc_queue_new(&queue, 8) == 0);
+
+    // without a destination nothing is popped
+    push_level(&queue, 1);
+    CHECK(osc_queue_send_udp(&queue, &sender, 8, &count) == 1);
+    CHECK(count == 0 && queue.count == 1 && osc_queue_peek(&queue) != NULL);
+
+    // a datagram too large for UDP makes the flush fail: the value behind it stays pending and keeps coalescing
+    CHECK(osc_udp_set_destination(&sender, "127.0.0.1", port) == 0);
+    struct osc_message huge;
+    osc_blob blob = osc_blob_new(70000);
+    CHECK(blob != NULL && osc_message_new(&huge) == 0);
+    CHECK(osc_message_set_address(&huge, "/huge") == 0 && osc_message_add_blob(&huge, blob) == 0);
+    struct osc_queue stuck;
+    CHECK(osc_queue_new(&stuck, 8) == 0);
+    CHECK(osc_queue_push_message(&stuck, &huge, OSC_COALESCE_NONE) == 0);
+    push_level(&stuck, 2);
+    CHECK(osc_queue_send_udp(&stuck, &sender, 8, &count) == 1);
+    CHECK(count == 0 && stuck.count == 2);
+    push_level(&stuck, 3);
+    CHECK(stuck.count == 2);
+    osc_packet_release(osc_queue_pop(&stuck));
+
+    // once the socket can send, the newest value goes out and the queue empties
+    CHECK(osc_queue_send_udp(&queue, &sender, 8, &count) == 0 && count == 1 && queue.count == 0);
+    CHECK(osc_queue_send_udp(&stuck, &sender, 8, &count) == 0 && count == 1 && stuck.count == 0);
+    struct osc_udp_packet packet;
+    int32_t expected[] = {1, 3};
+    for(size_t i = 0; i < 2; i++) {
+        struct osc_message_view view;
+        int32_t value = 0;
+        CHECK(osc_udp_receive(&receiver, &packet, 1, 1000, &count) == 0 && count == 1);
+        CHECK(osc_message_view_init(&view, packet.data, packet.length) == 0);
+        CHECK(osc_message_view_read_int32_array(&view, 0, &value, 1) == 1 && value == expected[i]);
+    }
+    CHECK(osc_udp_receive(&receiver, &packet, 1, 0, &count) == 0 && count == 0);
+
+    osc_queue_destroy(&queue);
+    osc_queue_destroy(&stuck);
+    osc_message_destroy(&huge);
+    osc_blob_destroy(blob);
+    osc_udp_destroy(&sender);
+    osc_udp_destroy(&receiver);
+    printf("ok\n");
+
+return 0;
+}
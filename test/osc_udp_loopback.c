@@ -0,0 +1,71 @@
+/** @file osc_udp_loopback.c */
+
+#include <stdio.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include "osc.h"
+#include "osc_udp.h"
+
+#define COUNT 10
+#define SEND_BATCH 4
+
+#define CHECK(condition) \
+    do { \
+    if(!(condition)) { \
+        fprintf(stderr, "%s:%d: check failed: %s\n", __FILE__, __LINE__, #condition); \
+        exit(1); \
+    } \
+    } while (0)
+
+int main(void)
+{
+    struct osc_udp_socket sender, receiver;
+    struct osc_message msgs[COUNT];
+    uint16_t port = 0;
+    CHECK(osc_udp_new(&receiver, "127.0.0.1", 0, 16, 64) == 0);
+    CHECK(osc_udp_new(&sender, "127.0.0.1", 0, SEND_BATCH, 0) == 0);
+    CHECK(osc_udp_local_port(&receiver, &port) == 0);
+    CHECK(osc_udp_set_destination(&sender, "127.0.0.1", port) == 0);
+
+    // queueing past the batch flushes the full queue with a single sendmmsg call
+    for(int32_t i = 0; i < COUNT; i++) {
+        CHECK(osc_message_new(&msgs[i]) == 0);
+        CHECK(osc_message_set_address(&msgs[i], "/udp") == 0 && osc_message_add_int32(&msgs[i], i) == 0);
+        CHECK(osc_udp_queue_message(&sender, &msgs[i]) == 0);
+        CHECK(sender.stats.sent == (uint64_t)(i / SEND_BATCH) * SEND_BATCH);
+        CHECK(sender.stats.send_calls == (uint64_t)(i / SEND_BATCH));
+    }
+    CHECK(sender.tx_count == COUNT % SEND_BATCH);
+
+    // a datagram larger than the receive buffers is dropped and counted
+    char oversize[128];
+    memset(oversize, 0, sizeof(oversize));
+    memcpy(oversize, "/big\0\0\0\0,\0\0\0", 12);
+    CHECK(osc_udp_queue_to(&sender, oversize, sizeof(oversize), NULL, 0) == 0);
+    CHECK(osc_udp_flush(&sender) == 0);
+    CHECK(sender.tx_count == 0 && sender.stats.sent == COUNT + 1 && sender.stats.send_calls == COUNT / SEND_BATCH + 1);
+
+    // the datagrams waiting in the socket are read by one recvmmsg call
+    struct osc_udp_packet packets[16];
+    size_t count = 0;
+    CHECK(osc_udp_receive(&receiver, packets, 16, 1000, &count) == 0);
+    CHECK(count == COUNT && receiver.stats.received == COUNT && receiver.stats.truncated == 1);
+    CHECK(receiver.stats.receive_calls == 1);
+    for(size_t i = 0; i < count; i++) {
+        struct osc_message_view view;
+        int32_t value = -1;
+        CHECK(osc_message_view_init(&view, packets[i].data, packets[i].length) == 0);
+        CHECK(osc_message_view_read_int32_array(&view, 0, &value, 1) == 1 && value == (int32_t)i);
+    }
+    CHECK(osc_udp_receive(&receiver, packets, 16, 0, &count) == 0 && count == 0);
+
+    for(size_t i = 0; i < COUNT; i++) {
+        osc_message_destroy(&msgs[i]);
+    }
+    osc_udp_destroy(&sender);
+    osc_udp_destroy(&receiver);
+    printf("ok\n");
+
+return 0;
+}